@@ -51,6 +51,7 @@ HEADERS += libs/opmapcontrol/opmapcontrol.h \
            libs/opmapcontrol/src/mapwidget/opmapwidget.h \
            libs/opmapcontrol/src/mapwidget/trailitem.h \
            libs/opmapcontrol/src/mapwidget/traillineitem.h \
+           libs/opmapcontrol/src/mapwidget/trackitem.h \
            libs/opmapcontrol/src/mapwidget/uavitem.h \
            libs/opmapcontrol/src/mapwidget/uavmapfollowtype.h \
            libs/opmapcontrol/src/mapwidget/uavtrailtype.h \
@@ -101,6 +102,7 @@ SOURCES += libs/opmapcontrol/src/core/alllayersoftype.cpp \
            libs/opmapcontrol/src/mapwidget/opmapwidget.cpp \
            libs/opmapcontrol/src/mapwidget/trailitem.cpp \
            libs/opmapcontrol/src/mapwidget/traillineitem.cpp \
+           libs/opmapcontrol/src/mapwidget/trackitem.cpp \
            libs/opmapcontrol/src/mapwidget/uavitem.cpp \
            libs/opmapcontrol/src/mapwidget/waypointitem.cpp \
            libs/opmapcontrol/src/internals/projections/lks94projection.cpp \
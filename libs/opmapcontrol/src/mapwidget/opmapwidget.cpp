@@ -117,6 +117,13 @@ namespace mapcontrol
         return p_TrailCursor;
     }
 
+    TrackItem *OPMapWidget::AddTrack()
+    {
+        TrackItem *track = new TrackItem(map, this);
+        track->setParentItem(map);
+        return track;
+    }
+
     UAVItem* OPMapWidget::AddUAV(int id)
     {
         UAVItem* newUAV = new UAVItem(map,this);
@@ -40,6 +40,7 @@
 #include "QtSvg/QGraphicsSvgItem"
 #include "uavitem.h"
 #include "gpsitem.h"
+#include "trackitem.h"
 #include "homeitem.h"
 #include "waypointlineitem.h"
 #include "mapripper.h"
@@ -369,6 +370,12 @@ namespace mapcontrol
 
         GPSItem *AddTrail();
         GPSItem *AddTrailCursor();
+        /**
+        * @brief Adds an item showing a complete recorded track
+        *
+        * @return TrackItem* owned by the map
+        */
+        TrackItem *AddTrack();
 
         UAVItem* AddUAV(int id);
         void AddUAV(int id, UAVItem* uav);
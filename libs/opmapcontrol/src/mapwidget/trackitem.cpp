@@ -0,0 +1,253 @@
+/**
+******************************************************************************
+*
+* @file       trackitem.cpp
+* @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2010.
+* @brief      A graphicsItem representing a complete recorded track
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   OPMapWidget
+* @{
+*
+*****************************************************************************/
+/*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+#include "trackitem.h"
+#include "mapgraphicitem.h"
+
+#include <QPainter>
+#include <algorithm>
+#include <limits>
+#include <math.h>
+
+namespace mapcontrol
+{
+    const int TrackItem::ChunkSize;
+
+    TrackItem::TrackItem(MapGraphicItem* map, OPMapWidget* parent) :
+        GraphicsItem(map, parent),
+        centerLat(0)
+    {
+        pen.setColor(Qt::green);
+        pen.setWidth(1);
+        pen.setCosmetic(true);
+        this->setZValue(3);
+    }
+
+    TrackItem::~TrackItem()
+    {
+    }
+
+    void TrackItem::SetTrack(const QVector<double> &keys, const QVector<internals::PointLatLng> &points)
+    {
+        this->keys = keys;
+        this->points = points;
+        zoomPoints.clear();
+
+        chunkBounds.clear();
+        double minLat = 90, maxLat = -90;
+        for(int first = 0; first < points.size(); first += ChunkSize)
+        {
+            const int last = qMin(first + ChunkSize, points.size());
+            double chunkMinLat = points.at(first).Lat(), chunkMaxLat = chunkMinLat;
+            double chunkMinLng = points.at(first).Lng(), chunkMaxLng = chunkMinLng;
+            for(int i = first + 1; i < last; ++i)
+            {
+                chunkMinLat = qMin(chunkMinLat, points.at(i).Lat());
+                chunkMaxLat = qMax(chunkMaxLat, points.at(i).Lat());
+                chunkMinLng = qMin(chunkMinLng, points.at(i).Lng());
+                chunkMaxLng = qMax(chunkMaxLng, points.at(i).Lng());
+            }
+            // a straight north-south or east-west chunk must not become a null rect
+            chunkBounds.append(QRectF(QPointF(chunkMinLng, chunkMinLat), QPointF(chunkMaxLng, chunkMaxLat)).adjusted(-1e-7, -1e-7, 1e-7, 1e-7));
+            minLat = qMin(minLat, chunkMinLat);
+            maxLat = qMax(maxLat, chunkMaxLat);
+        }
+        centerLat = points.isEmpty() ? 0 : (minLat + maxLat) / 2;
+
+        computeImportance();
+        RefreshPos();
+    }
+
+    void TrackItem::Clear()
+    {
+        SetTrack(QVector<double>(), QVector<internals::PointLatLng>());
+    }
+
+    void TrackItem::SetColor(const QColor &color)
+    {
+        pen.setColor(color);
+        this->update();
+    }
+
+    int TrackItem::IndexOfKey(double key) const
+    {
+        if(keys.isEmpty())
+            return -1;
+
+        QVector<double>::const_iterator it = std::lower_bound(keys.constBegin(), keys.constEnd(), key);
+        if(it == keys.constEnd())
+            return keys.size() - 1;
+        int index = it - keys.constBegin();
+        if(index > 0 && (key - keys.at(index - 1)) < (keys.at(index) - key))
+            --index;
+        return index;
+    }
+
+    /**
+      * Douglas-Peucker run once for all zoom levels: the importance of a point is the
+      * deviation at which the algorithm would keep it. A point can not be more
+      * important than the point which split its range.
+      */
+    void TrackItem::computeImportance()
+    {
+        const int count = points.size();
+        importance.fill(0, count);
+        if(count == 0)
+            return;
+
+        importance[0] = std::numeric_limits<double>::max();
+        importance[count - 1] = std::numeric_limits<double>::max();
+
+        // flat projection in meters around the track center
+        const double metersPerDeg = 6378137.0 * M_PI / 180.0;
+        const double lngScale = metersPerDeg * cos(centerLat * M_PI / 180.0);
+        QVector<QPointF> local(count);
+        for(int i = 0; i < count; ++i)
+            local[i] = QPointF(points.at(i).Lng() * lngScale, points.at(i).Lat() * metersPerDeg);
+
+        struct Range { int first; int last; double limit; };
+        QVector<Range> ranges;
+        ranges.append({0, count - 1, std::numeric_limits<double>::max()});
+        while(!ranges.isEmpty())
+        {
+            const Range range = ranges.takeLast();
+            if(range.last - range.first < 2)
+                continue;
+
+            const QPointF a = local.at(range.first);
+            const QPointF d = local.at(range.last) - a;
+            const double len2 = d.x() * d.x() + d.y() * d.y();
+
+            double maxDist2 = -1;
+            int maxIndex = range.first + 1;
+            for(int i = range.first + 1; i < range.last; ++i)
+            {
+                const QPointF p = local.at(i) - a;
+                double t = (len2 > 0) ? (p.x() * d.x() + p.y() * d.y()) / len2 : 0;
+                t = qBound(0.0, t, 1.0);
+                const double ex = t * d.x() - p.x();
+                const double ey = t * d.y() - p.y();
+                const double dist2 = ex * ex + ey * ey;
+                if(dist2 > maxDist2)
+                {
+                    maxDist2 = dist2;
+                    maxIndex = i;
+                }
+            }
+
+            const double limit = qMin(sqrt(maxDist2), range.limit);
+            importance[maxIndex] = limit;
+            ranges.append({range.first, maxIndex, limit});
+            ranges.append({maxIndex, range.last, limit});
+        }
+    }
+
+    const QVector<int> &TrackItem::pointsForZoom(int zoom)
+    {
+        QHash<int, QVector<int> >::const_iterator it = zoomPoints.constFind(zoom);
+        if(it != zoomPoints.constEnd())
+            return it.value();
+
+        // half a pixel at this zoom level is not visible
+        const double tolerance = 0.5 * map->Projection()->GetGroundResolution(zoom, centerLat);
+        QVector<int> &selected = zoomPoints[zoom];
+        for(int i = 0; i < importance.size(); ++i)
+        {
+            if(importance.at(i) > tolerance)
+                selected.append(i);
+        }
+        return selected;
+    }
+
+    void TrackItem::RefreshPos()
+    {
+        this->prepareGeometryChange();
+        path = QPainterPath();
+        if(points.size() < 2)
+            return;
+
+        // visible area in lat/lng, one screen of margin so lines leaving the view stay intact
+        const QRectF mapRect = map->boundingRect();
+        const QPointF corners[] = {mapRect.topLeft(), mapRect.topRight(), mapRect.bottomLeft(), mapRect.bottomRight()};
+        double minLat = 90, maxLat = -90, minLng = 180, maxLng = -180;
+        for(const QPointF &corner : corners)
+        {
+            internals::PointLatLng c = map->FromLocalToLatLng(static_cast<int>(corner.x()), static_cast<int>(corner.y()));
+            minLat = qMin(minLat, c.Lat());
+            maxLat = qMax(maxLat, c.Lat());
+            minLng = qMin(minLng, c.Lng());
+            maxLng = qMax(maxLng, c.Lng());
+        }
+        QRectF view(QPointF(minLng, minLat), QPointF(maxLng, maxLat));
+        view.adjust(-view.width(), -view.height(), view.width(), view.height());
+
+        // prefix count of visible chunks to test a run of chunks in O(1)
+        QVector<int> visibleChunks(chunkBounds.size() + 1, 0);
+        for(int c = 0; c < chunkBounds.size(); ++c)
+            visibleChunks[c + 1] = visibleChunks[c] + (chunkBounds.at(c).intersects(view) ? 1 : 0);
+
+        const QVector<int> &selected = pointsForZoom(static_cast<int>(ceil(map->ZoomTotal())));
+        bool penDown = false;
+        for(int s = 1; s < selected.size(); ++s)
+        {
+            const int prev = selected.at(s - 1);
+            const int cur = selected.at(s);
+            if(visibleChunks[cur / ChunkSize + 1] - visibleChunks[prev / ChunkSize] == 0)
+            {
+                penDown = false;
+                continue;
+            }
+            if(!penDown)
+            {
+                core::Point p = map->FromLatLngToLocal(points.at(prev));
+                path.moveTo(p.X(), p.Y());
+                penDown = true;
+            }
+            core::Point p = map->FromLatLngToLocal(points.at(cur));
+            path.lineTo(p.X(), p.Y());
+        }
+        this->update();
+    }
+
+    void TrackItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+    {
+        Q_UNUSED(option);
+        Q_UNUSED(widget);
+        painter->setPen(pen);
+        painter->setBrush(Qt::NoBrush);
+        painter->drawPath(path);
+    }
+
+    QRectF TrackItem::boundingRect() const
+    {
+        return path.boundingRect().adjusted(-2, -2, 2, 2);
+    }
+
+    int TrackItem::type() const
+    {
+        return Type;
+    }
+}
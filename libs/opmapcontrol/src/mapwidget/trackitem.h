@@ -0,0 +1,117 @@
+/**
+******************************************************************************
+*
+* @file       trackitem.h
+* @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2010.
+* @brief      A graphicsItem representing a complete recorded track
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   OPMapWidget
+* @{
+*
+*****************************************************************************/
+/*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+#ifndef TRACKITEM_H
+#define TRACKITEM_H
+
+#include <QHash>
+#include <QPainterPath>
+#include <QPen>
+#include <QVector>
+#include "graphicsitem.h"
+#include "graphicsusertypes.h"
+
+namespace mapcontrol
+{
+    /**
+    * @brief A single QGraphicsItem showing a whole recorded track, like the GPS
+    *        trail of a log. Other than the trail of a GPSItem it does not create
+    *        an item per position.
+    *
+    *        The track is simplified once (Douglas-Peucker importance of every point)
+    *        and for each zoom level only the points which deviate more than half a
+    *        pixel are drawn. Points are grouped in chunks with a lat/lng bounding
+    *        box, so only chunks near the visible area are projected on a refresh.
+    *        Every point carries a key (like a log index or a time stamp) and
+    *        IndexOfKey() finds a point by key with a binary search.
+    *
+    * @class TrackItem trackitem.h "mapwidget/trackitem.h"
+    */
+    class TrackItem : public GraphicsItem
+    {
+        Q_OBJECT
+        Q_INTERFACES(QGraphicsItem)
+    public:
+        enum { Type = usertypes::TRACKITEM };
+        TrackItem(MapGraphicItem* map, OPMapWidget* parent);
+        ~TrackItem();
+
+        /**
+        * @brief Sets the track to be shown
+        *
+        * @param keys ascending key of every point
+        * @param points position of every point, same size as keys
+        */
+        void SetTrack(QVector<double> const& keys, QVector<internals::PointLatLng> const& points);
+        /**
+        * @brief Removes all points of the track
+        */
+        void Clear();
+        /**
+        * @brief Sets the color of the track line
+        */
+        void SetColor(QColor const& color);
+
+        /**
+        * @brief Returns the number of points of the track
+        */
+        int Count()const{return points.size();}
+        /**
+        * @brief Returns the index of the point whose key is nearest to key
+        *
+        * @return index of the point, -1 if the track is empty
+        */
+        int IndexOfKey(double key)const;
+        /**
+        * @brief Returns the position of the point at index
+        */
+        internals::PointLatLng PointAt(int index)const{return points.at(index);}
+
+        void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
+                    QWidget *widget);
+        QRectF boundingRect() const;
+        void RefreshPos();
+        int type() const;
+
+    private:
+        static const int ChunkSize = 256;
+
+        void computeImportance();
+        const QVector<int> &pointsForZoom(int zoom);
+
+        QVector<double> keys;
+        QVector<internals::PointLatLng> points;
+        QVector<double> importance;             // deviation in meters at which a point becomes visible
+        QVector<QRectF> chunkBounds;            // lat/lng bounds of ChunkSize points (x = lng, y = lat)
+        QHash<int, QVector<int> > zoomPoints;   // points drawn at a zoom level
+        double centerLat;
+
+        QPainterPath path;
+        QPen pen;
+    };
+}
+
+#endif // TRACKITEM_H
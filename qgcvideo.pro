@@ -31,7 +31,9 @@ HEADERS += \
     src/QGC.h \
     src/apps/qgcvideo/QGCVideoMainWindow.h \
     src/apps/qgcvideo/QGCVideoApp.h \
-    src/apps/qgcvideo/QGCVideoWidget.h
+    src/apps/qgcvideo/QGCVideoWidget.h \
+    src/apps/qgcvideo/QGCVideoDecoder.h \
+    src/apps/qgcvideo/QGCVideoConversion.h
 
 SOURCES += \
     src/comm/UDPLink.cc \
@@ -40,7 +42,9 @@ SOURCES += \
     src/apps/qgcvideo/main.cc \
     src/apps/qgcvideo/QGCVideoMainWindow.cc \
     src/apps/qgcvideo/QGCVideoApp.cc \
-    src/apps/qgcvideo/QGCVideoWidget.cc
+    src/apps/qgcvideo/QGCVideoWidget.cc \
+    src/apps/qgcvideo/QGCVideoDecoder.cc \
+    src/apps/qgcvideo/QGCVideoConversion.cc
 
 FORMS += \
     src/apps/qgcvideo/QGCVideoMainWindow.ui
@@ -62,10 +62,11 @@ extern CComModule _Module;
 #if defined(FLITE_AUDIO_ENABLED)
 extern "C" {
 #include <flite/flite.h>
-    cst_voice* register_cmu_us_kal(const char* voxdir);
 };
 #endif
 
+/** MAV_SEVERITY_CRITICAL, more severe text pre-empts other speech */
+static const int CriticalSeverity = 2;
 
 
 /**
@@ -102,23 +103,10 @@ GAudioOutput::GAudioOutput(QObject* parent) : QObject(parent),
 
 #ifdef FLITE_AUDIO_ENABLED
     // Remove Phonon Audio for linux and use alsa
-    flite_init();
-
     QLOG_INFO() << "Using Alsa Audio driver";
 
-    // Create shared dir tmp_audio
-    // we create new spoken audio files here. we don't delete them as befor.
-    // we save audiofiles like message inside.
-    // if new messages will create in code this new messages will saved as audio file on first call
-    // this save time and also it will possible to queue audio messages later because the are not temporary
-    QDir dir(QString("%1/%2").arg( QGC::appDataDirectory() ).arg( "tmp_audio" ));
-    if (!dir.exists()) {
-        QLOG_WARN() << "Create directory tmp_audio";
-        dir.mkpath(".");
-    }else
-    {
-        QLOG_WARN() << "Dir directory tmp_audio exists";
-    }
+    // Synthesis takes longer than the phrase is spoken, keep it off the GUI thread
+    m_synthesizer = new SpeechSynthesizer(AlsaAudio::instance(this), this);
 
 #endif
 
@@ -171,8 +159,13 @@ GAudioOutput::GAudioOutput(QObject* parent) : QObject(parent),
 GAudioOutput::~GAudioOutput()
 {
     QLOG_INFO() << "~GAudioOutput()";
+#ifdef FLITE_AUDIO_ENABLED
+    m_synthesizer->stop();
+    m_synthesizer->wait();
+#endif
 #ifdef Q_OS_LINUX
-    // wait until thread is running before terminate AlsaAudio thread
+    // wait until the current playback is finished before terminate AlsaAudio thread
+    AlsaAudio::instance(this)->stop();
     AlsaAudio::instance(this)->wait();
 #endif
 #ifdef Q_OS_MAC
@@ -213,8 +206,6 @@ bool GAudioOutput::say(QString text, int severity)
             //don't say system %1 [HACK] :(
             return true;
 
-        // TODO Add severity filter
-        Q_UNUSED(severity);
         bool res = false;
         if (!emergency)
         {
@@ -228,34 +219,12 @@ bool GAudioOutput::say(QString text, int severity)
 #endif
 
 #ifdef FLITE_AUDIO_ENABLED
-            // spokenfilename is the filename created from spoken text
-            QString spokenFilename = text;
-            spokenFilename.replace(QRegExp(" "), "_");
-            spokenFilename = QGC::appDataDirectory() + "/tmp_audio/" + spokenFilename + ".wav";
-
-            // alsadriver is a qthread. tmp. files dont work here
-            QFile file( spokenFilename );
-            if (!file.exists(spokenFilename)){ // if file not exist we create a new one
-                if (file.open(QIODevice::ReadWrite))
-                {
-                    QLOG_INFO() << file.fileName() << " file not exist, create a new one";
-                    cst_voice *v = register_cmu_us_kal(NULL);
-                    cst_wave *wav = flite_text_to_wave(text.toStdString().c_str(), v);
-                    cst_wave_save(wav, file.fileName().toStdString().c_str(), "riff");
-                    file.close();
-                    AlsaAudio::instance(this)->enqueueFilname(file.fileName());
-                    if(!AlsaAudio::instance(this)->isRunning())
-                        AlsaAudio::instance(this)->start();
-                    res = true;
-                }
-            }else // we open existing file
-            {
-                QLOG_INFO() << file.fileName() << " file exist, playing this file";
-                AlsaAudio::instance(this)->enqueueFilname(file.fileName());
-                if(!AlsaAudio::instance(this)->isRunning())
-                    AlsaAudio::instance(this)->start();
-                res = true;
-            }
+            // Returns at once, the audio is played when synthesized (or at once if said before).
+            // Critical messages go ahead of the queued chatter
+            m_synthesizer->say(text, severity <= CriticalSeverity);
+            res = true;
+#else
+            Q_UNUSED(severity);
 #endif
 
 #ifdef Q_OS_MAC
@@ -284,7 +253,7 @@ bool GAudioOutput::alert(QString text)
         // Play alert sound
         beep();
         // Say alert message
-        say(text, 2);
+        say(text, CriticalSeverity);
         return true;
     }
     else
@@ -358,9 +327,7 @@ void GAudioOutput::beep()
         QFile f(QGC::shareDirectory()+QString("/files/audio/alert.wav"));
 
 #ifdef Q_OS_LINUX
-        AlsaAudio::instance(this)->enqueueFilname(f.fileName());
-        if(!AlsaAudio::instance(this)->isRunning())
-            AlsaAudio::instance(this)->start();
+        AlsaAudio::instance(this)->enqueueFilname(f.fileName(), true);
 #endif
 
     }
@@ -36,6 +36,7 @@ This file is part of the PIXHAWK project
 #include <QTimer>
 #include <QStringList>
 #include <audio/AlsaAudio.h>
+#include <audio/SpeechSynthesizer.h>
 #ifdef Q_OS_MAC
 #include <QtMultimedia>
 #endif
@@ -75,8 +76,12 @@ public:
     bool isMuted();
 
 public slots:
-    /** @brief Say this text if current output priority matches */
-    bool say(QString text, int severity=1);
+    /**
+     * @brief Say this text if current output priority matches
+     * @param severity MAV_SEVERITY of the text, critical and more severe text is spoken before other queued text.
+     *        Less severe text is chatter, which may be dropped or cut off. Pass MAV_SEVERITY_CRITICAL for safety announcements.
+     */
+    bool say(QString text, int severity=6);
     /** @brief Play alert sound and say notification message */
     bool alert(QString text);
     /** @brief Start emergency sound */
@@ -103,8 +108,8 @@ protected:
 #ifdef Q_OS_MAC
     SpeechChannel *m_speech_channel;
 #endif
-#ifdef Q_OS_LINUX
-    //cst_voice* voice; ///< The flite voice object
+#ifdef FLITE_AUDIO_ENABLED
+    SpeechSynthesizer *m_synthesizer; ///< Synthesizes with flite in its own thread
 #endif
     int voiceIndex;   ///< The index of the flite voice to use (awb, slt, rms)
     // Phonon::MediaObject* m_media; ///< The output object for audio
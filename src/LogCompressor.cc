@@ -31,13 +31,503 @@ This file is part of the QGROUNDCONTROL project
 #include <QFileInfo>
 #include <QDir>
 #include <QTemporaryFile>
-#include <QTextStream>
 #include <QStringList>
-#include <QFileInfo>
 #include <QList>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QDataStream>
+#include <QScopedPointer>
+#include <QtNumeric>
+#include <algorithm>
+#include <cstring>
 #include "LogCompressor.h"
 
+namespace
+{
+
+const qint64 ChunkSize = 4 * 1024 * 1024;   ///< Bytes of input handed to one parse job
+const int ReorderWindow = 64;               ///< Timestamps held back to merge lines arriving out of order
+const int ColumnBlockRows = 4096;           ///< Rows per block of the columnar output
+const qint64 CopyBlockSize = 1024 * 1024;   ///< Bytes copied at once when assembling the output
+const char ColumnarMagic[8] = { 'Q', 'G', 'C', 'L', 'O', 'G', 'C', '1' };
+const quint32 ColumnarByteOrderMark = 0x01020304;
+const quint32 ColumnarVersion = 1;
+
+/** @brief One line of the raw log: timestamp, uas id, message name, value */
+struct ParsedLine
+{
+    quint64 timestamp;
+    QByteArray name;
+    QByteArray value;
+    double number;
+};
+
+/**
+ * @brief ChunkParser - Splits a block of complete lines into ParsedLines. Several of them run
+ *        on the thread pool at once, the merge of the results stays on the compressor thread
+ *        so the column order does not depend on the scheduling.
+ */
+class ChunkParser : public QRunnable
+{
+public:
+    ChunkParser(const QByteArray &chunk, const QByteArray &delimiter, bool parseNumbers, QVector<ParsedLine> *result) :
+        m_chunk(chunk),
+        m_delimiter(delimiter),
+        m_parseNumbers(parseNumbers),
+        mp_result(result)
+    {
+        setAutoDelete(true);
+    }
+
+    void run() override
+    {
+        int pos = 0;
+        while (pos < m_chunk.size()) {
+            int end = m_chunk.indexOf('\n', pos);
+            if (end < 0) {
+                end = m_chunk.size();
+            }
+            int lineEnd = end;
+            if (lineEnd > pos && m_chunk.at(lineEnd - 1) == '\r') {
+                --lineEnd;
+            }
+            parseLine(pos, lineEnd);
+            pos = end + 1;
+        }
+    }
+
+private:
+    void parseLine(int begin, int end)
+    {
+        int fieldBegin[4];
+        int fieldEnd[4];
+        int pos = begin;
+        for (int i = 0; i < 4; ++i) {
+            fieldBegin[i] = pos;
+            const int next = m_chunk.indexOf(m_delimiter, pos);
+            if (next < 0 || next >= end) {
+                if (i < 3) {
+                    return; // Truncated line
+                }
+                fieldEnd[i] = end;
+            } else {
+                fieldEnd[i] = next;
+                pos = next + m_delimiter.size();
+            }
+        }
+
+        bool ok = false;
+        ParsedLine line;
+        line.timestamp = QByteArray::fromRawData(m_chunk.constData() + fieldBegin[0],
+                                                 fieldEnd[0] - fieldBegin[0]).toULongLong(&ok);
+        if (!ok) {
+            return;
+        }
+        line.name = m_chunk.mid(fieldBegin[2], fieldEnd[2] - fieldBegin[2]);
+        line.value = m_chunk.mid(fieldBegin[3], fieldEnd[3] - fieldBegin[3]);
+        line.number = qQNaN();
+        if (m_parseNumbers) {
+            const double number = line.value.toDouble(&ok);
+            if (ok) {
+                line.number = number;
+            }
+        }
+        mp_result->append(line);
+    }
+
+    QByteArray m_chunk;
+    QByteArray m_delimiter;
+    bool m_parseNumbers;
+    QVector<ParsedLine> *mp_result;
+};
+
+/** @brief RowWriter - Output side of the compressor, rows arrive in timestamp order with holes already filled */
+class RowWriter
+{
+public:
+    virtual ~RowWriter() {}
+    virtual bool open() = 0;
+    virtual bool writeRow(quint64 timestamp, const QVector<LogCompressor::Cell> &cells) = 0;
+    /**
+     * @param lateRows Rows older than rows already written, only the cells which are set count.
+     *        A late row with the timestamp of a written row is merged into it.
+     */
+    virtual bool finish(const QList<QByteArray> &columnNames, const QMap<quint64, QVector<LogCompressor::Cell> > &lateRows) = 0;
+    virtual QString errorString() const = 0;
+    /** @brief Description of the columns written, for the status message */
+    virtual QString header() const = 0;
+};
+
+/**
+ * @brief TextRowWriter - Writes the delimiter separated text file. The column set is only known
+ *        at the end, so rows go to a temporary file next to the output and are copied behind the
+ *        header once done. Rows written before a column showed up are padded on the copy, and
+ *        rows which arrived too late for the reorder window are merged in at their place.
+ */
+class TextRowWriter : public RowWriter
+{
+public:
+    TextRowWriter(const QString &fileName, const QByteArray &delimiter, bool holeFilling) :
+        m_outFile(fileName),
+        m_bodyFile(QFileInfo(fileName).absoluteDir().filePath("logcompressor_XXXXXX.tmp")),
+        m_delimiter(delimiter),
+        m_holeFilling(holeFilling),
+        m_padding(holeFilling ? QByteArray("NaN") : QByteArray()),
+        m_firstRowColumns(-1)
+    {
+    }
+
+    bool open() override
+    {
+        return m_bodyFile.open() && m_outFile.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    }
+
+    bool writeRow(quint64 timestamp, const QVector<LogCompressor::Cell> &cells) override
+    {
+        m_line = QByteArray::number(timestamp);
+        for (const LogCompressor::Cell &cell : cells) {
+            m_line += m_delimiter;
+            m_line += cell.text;
+        }
+        m_line += '\n';
+        if (m_firstRowColumns < 0) {
+            m_firstRowColumns = cells.size();
+        }
+        return m_bodyFile.write(m_line) == m_line.size();
+    }
+
+    bool finish(const QList<QByteArray> &columnNames, const QMap<quint64, QVector<LogCompressor::Cell> > &lateRows) override
+    {
+        QByteArray headerLine = "timestamp_ms";
+        for (const QByteArray &name : columnNames) {
+            headerLine += m_delimiter + name;
+        }
+        headerLine += '\n';
+        // Clean header names from symbols Matlab considers as Latex syntax
+        headerLine = headerLine.replace("timestamp", "TIMESTAMP");
+        headerLine = headerLine.replace(":", "");
+        headerLine = headerLine.replace("_", "");
+        headerLine = headerLine.replace(".", "");
+        m_header = QString::fromLatin1(headerLine);
+        if (m_outFile.write(headerLine) != headerLine.size() || !m_bodyFile.flush() || !m_bodyFile.seek(0)) {
+            return false;
+        }
+
+        const int columnCount = columnNames.size();
+        if (lateRows.isEmpty() && (m_firstRowColumns < 0 || m_firstRowColumns == columnCount)) {
+            // The schema did not grow after the first row and nothing came late, plain block copy
+            while (!m_bodyFile.atEnd()) {
+                const QByteArray block = m_bodyFile.read(CopyBlockSize);
+                if (block.isEmpty() || m_outFile.write(block) != block.size()) {
+                    return false;
+                }
+            }
+        } else {
+            QMap<quint64, QVector<LogCompressor::Cell> >::const_iterator late = lateRows.constBegin();
+            QList<QByteArray> previous;     // Values of the last row written, for hole filling
+            for (int i = 0; i < columnCount; ++i) {
+                previous.append(m_padding);
+            }
+            while (!m_bodyFile.atEnd()) {
+                QByteArray line = m_bodyFile.readLine();
+                if (line.endsWith('\n')) {
+                    line.chop(1);
+                }
+                QList<QByteArray> fields = splitLine(line);
+                while (fields.size() < columnCount + 1) {
+                    fields.append(m_padding);
+                }
+                const quint64 timestamp = fields.first().toULongLong();
+                for (; late != lateRows.constEnd() && late.key() < timestamp; ++late) {
+                    if (!writeLateRow(late.key(), late.value(), previous)) {
+                        return false;
+                    }
+                }
+                if (late != lateRows.constEnd() && late.key() == timestamp) {
+                    mergeCells(fields, late.value());
+                    ++late;
+                }
+                if (!writeFields(fields, previous)) {
+                    return false;
+                }
+            }
+            for (; late != lateRows.constEnd(); ++late) {
+                if (!writeLateRow(late.key(), late.value(), previous)) {
+                    return false;
+                }
+            }
+        }
+        m_outFile.close();
+        return m_outFile.error() == QFile::NoError;
+    }
+
+    QString errorString() const override
+    {
+        return m_outFile.error() != QFile::NoError ? m_outFile.errorString() : m_bodyFile.errorString();
+    }
+
+    QString header() const override
+    {
+        return m_header;
+    }
+
+private:
+    QList<QByteArray> splitLine(const QByteArray &line) const
+    {
+        QList<QByteArray> fields;
+        int pos = 0;
+        forever {
+            const int next = line.indexOf(m_delimiter, pos);
+            if (next < 0) {
+                fields.append(line.mid(pos));
+                return fields;
+            }
+            fields.append(line.mid(pos, next - pos));
+            pos = next + m_delimiter.size();
+        }
+    }
+
+    static void mergeCells(QList<QByteArray> &fields, const QVector<LogCompressor::Cell> &cells)
+    {
+        for (int i = 0; i < cells.size() && i + 1 < fields.size(); ++i) {
+            if (cells.at(i).set) {
+                fields[i + 1] = cells.at(i).text;
+            }
+        }
+    }
+
+    bool writeLateRow(quint64 timestamp, const QVector<LogCompressor::Cell> &cells, QList<QByteArray> &previous)
+    {
+        // Holes are filled from the row before it in the output, later rows keep their values
+        QList<QByteArray> fields;
+        fields.append(QByteArray::number(timestamp));
+        for (const QByteArray &value : previous) {
+            fields.append(m_holeFilling ? value : QByteArray());
+        }
+        mergeCells(fields, cells);
+        return writeFields(fields, previous);
+    }
+
+    bool writeFields(const QList<QByteArray> &fields, QList<QByteArray> &previous)
+    {
+        m_line = fields.first();
+        for (int i = 1; i < fields.size(); ++i) {
+            m_line += m_delimiter;
+            m_line += fields.at(i);
+            if (i <= previous.size()) {
+                previous[i - 1] = fields.at(i);
+            }
+        }
+        m_line += '\n';
+        return m_outFile.write(m_line) == m_line.size();
+    }
+
+    QFile m_outFile;
+    QTemporaryFile m_bodyFile;
+    QByteArray m_delimiter;
+    bool m_holeFilling;
+    QByteArray m_padding;       ///< Value of a column that did not exist yet when the row was written
+    QByteArray m_line;
+    QString m_header;
+    int m_firstRowColumns;      ///< Columns known when the first row was written, -1 before
+};
+
+/**
+ * @brief ColumnarRowWriter - Writes the columnar binary file, see LogCompressor::readColumnarFile()
+ *        for the layout. Blocks go to a temporary file next to the output first, like the text
+ *        rows, so rows which arrived too late for the reorder window can be merged in at their
+ *        place when the file is assembled.
+ */
+class ColumnarRowWriter : public RowWriter
+{
+public:
+    ColumnarRowWriter(const QString &fileName, bool holeFilling) :
+        m_outFile(fileName),
+        m_bodyFile(QFileInfo(fileName).absoluteDir().filePath("logcompressor_XXXXXX.tmp")),
+        m_holeFilling(holeFilling)
+    {
+    }
+
+    bool open() override
+    {
+        if (!m_bodyFile.open() || !m_outFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            return false;
+        }
+        const QDataStream::ByteOrder byteOrder = QSysInfo::ByteOrder == QSysInfo::BigEndian ? QDataStream::BigEndian : QDataStream::LittleEndian;
+        m_body.setDevice(&m_bodyFile);
+        m_body.setByteOrder(byteOrder);
+        m_out.setDevice(&m_outFile);
+        m_out.setByteOrder(byteOrder);
+        m_out.writeRawData(ColumnarMagic, sizeof(ColumnarMagic));
+        m_out << ColumnarByteOrderMark << ColumnarVersion;
+        m_timestamps.reserve(ColumnBlockRows);
+        return m_out.status() == QDataStream::Ok;
+    }
+
+    bool writeRow(quint64 timestamp, const QVector<LogCompressor::Cell> &cells) override
+    {
+        m_values.resize(cells.size());
+        for (int i = 0; i < cells.size(); ++i) {
+            m_values[i] = cells.at(i).number;
+        }
+        return appendRow(timestamp, m_values, m_body);
+    }
+
+    bool finish(const QList<QByteArray> &columnNames, const QMap<quint64, QVector<LogCompressor::Cell> > &lateRows) override
+    {
+        if (!m_timestamps.isEmpty() && !writeBlock(m_body)) {
+            return false;
+        }
+        if (!m_bodyFile.flush() || !m_bodyFile.seek(0)) {
+            return false;
+        }
+
+        if (lateRows.isEmpty()) {
+            // Nothing came late, plain block copy
+            while (!m_bodyFile.atEnd()) {
+                const QByteArray block = m_bodyFile.read(CopyBlockSize);
+                if (block.isEmpty() || m_outFile.write(block) != block.size()) {
+                    return false;
+                }
+            }
+        } else if (!mergeLateRows(columnNames.size(), lateRows)) {
+            return false;
+        }
+
+        const quint64 footerOffset = static_cast<quint64>(m_outFile.pos());
+        m_out << quint32(0) << quint32(columnNames.size());
+        for (const QByteArray &name : columnNames) {
+            m_out << quint32(name.size());
+            m_out.writeRawData(name.constData(), name.size());
+        }
+        m_out << footerOffset;
+        m_out.writeRawData(ColumnarMagic, sizeof(ColumnarMagic));
+        m_header = QString::fromLatin1(columnNames.isEmpty() ? QByteArray() : columnNames.first());
+        for (int i = 1; i < columnNames.size(); ++i) {
+            m_header += ", " + QString::fromLatin1(columnNames.at(i));
+        }
+        m_outFile.close();
+        return m_out.status() == QDataStream::Ok && m_outFile.error() == QFile::NoError;
+    }
+
+    QString errorString() const override
+    {
+        return m_outFile.error() != QFile::NoError ? m_outFile.errorString() : m_bodyFile.errorString();
+    }
+
+    QString header() const override
+    {
+        return m_header;
+    }
+
+private:
+    /** @brief Reads the blocks back from the body file and writes them with the late rows in place */
+    bool mergeLateRows(int columnCount, const QMap<quint64, QVector<LogCompressor::Cell> > &lateRows)
+    {
+        QMap<quint64, QVector<LogCompressor::Cell> >::const_iterator late = lateRows.constBegin();
+        QVector<double> previous(columnCount, qQNaN());     // Values of the last row written, for hole filling
+        QVector<quint64> timestamps;
+        QVector<double> blockValues;
+        QVector<double> row;
+        while (!m_bodyFile.atEnd()) {
+            quint32 rows = 0;
+            quint32 columns = 0;
+            m_body >> rows >> columns;
+            timestamps.resize(static_cast<int>(rows));
+            blockValues.resize(static_cast<int>(rows * columns));
+            const int timestampBytes = static_cast<int>(rows * sizeof(quint64));
+            const int valueBytes = static_cast<int>(rows * columns * sizeof(double));
+            if (m_body.status() != QDataStream::Ok
+                    || m_body.readRawData(reinterpret_cast<char*>(timestamps.data()), timestampBytes) != timestampBytes
+                    || m_body.readRawData(reinterpret_cast<char*>(blockValues.data()), valueBytes) != valueBytes) {
+                return false;
+            }
+            for (quint32 r = 0; r < rows; ++r) {
+                const quint64 timestamp = timestamps.at(static_cast<int>(r));
+                for (; late != lateRows.constEnd() && late.key() < timestamp; ++late) {
+                    if (!writeLateRow(late.key(), late.value(), previous)) {
+                        return false;
+                    }
+                }
+                row.fill(qQNaN(), columnCount);
+                for (quint32 c = 0; c < columns; ++c) {
+                    row[static_cast<int>(c)] = blockValues.at(static_cast<int>(c * rows + r));
+                }
+                if (late != lateRows.constEnd() && late.key() == timestamp) {
+                    mergeCells(row, late.value());
+                    ++late;
+                }
+                previous = row;
+                if (!appendRow(timestamp, row, m_out)) {
+                    return false;
+                }
+            }
+        }
+        for (; late != lateRows.constEnd(); ++late) {
+            if (!writeLateRow(late.key(), late.value(), previous)) {
+                return false;
+            }
+        }
+        return m_timestamps.isEmpty() || writeBlock(m_out);
+    }
+
+    static void mergeCells(QVector<double> &row, const QVector<LogCompressor::Cell> &cells)
+    {
+        for (int i = 0; i < cells.size() && i < row.size(); ++i) {
+            if (cells.at(i).set) {
+                row[i] = cells.at(i).number;
+            }
+        }
+    }
+
+    bool writeLateRow(quint64 timestamp, const QVector<LogCompressor::Cell> &cells, QVector<double> &previous)
+    {
+        // Holes are filled from the row before it in the output, later rows keep their values
+        QVector<double> row = m_holeFilling ? previous : QVector<double>(previous.size(), qQNaN());
+        mergeCells(row, cells);
+        previous = row;
+        return appendRow(timestamp, row, m_out);
+    }
 
+    bool appendRow(quint64 timestamp, const QVector<double> &values, QDataStream &stream)
+    {
+        const int rows = m_timestamps.size();
+        while (m_columns.size() < values.size()) {
+            m_columns.append(QVector<double>(rows, qQNaN()));
+            m_columns.last().reserve(ColumnBlockRows);
+        }
+        m_timestamps.append(timestamp);
+        for (int i = 0; i < m_columns.size(); ++i) {
+            m_columns[i].append(i < values.size() ? values.at(i) : qQNaN());
+        }
+        return m_timestamps.size() < ColumnBlockRows || writeBlock(stream);
+    }
+
+    bool writeBlock(QDataStream &stream)
+    {
+        const int rows = m_timestamps.size();
+        stream << quint32(rows) << quint32(m_columns.size());
+        stream.writeRawData(reinterpret_cast<const char*>(m_timestamps.constData()), rows * static_cast<int>(sizeof(quint64)));
+        for (QVector<double> &column : m_columns) {
+            stream.writeRawData(reinterpret_cast<const char*>(column.constData()), rows * static_cast<int>(sizeof(double)));
+            column.resize(0);
+        }
+        m_timestamps.resize(0);
+        return stream.status() == QDataStream::Ok;
+    }
+
+    QFile m_outFile;
+    QTemporaryFile m_bodyFile;
+    QDataStream m_out;
+    QDataStream m_body;
+    bool m_holeFilling;
+    QVector<quint64> m_timestamps;          ///< Timestamps of the current block
+    QVector<QVector<double> > m_columns;    ///< Values of the current block, column by column
+    QVector<double> m_values;               ///< Numbers of the row being written
+    QString m_header;
+};
+
+} // namespace
 
 /**
  * Initializes all the variables necessary for a compression run. This won't actually happen
@@ -49,21 +539,173 @@ LogCompressor::LogCompressor(QString logFileName, QString outFileName, QString d
 	running(true),
 	currentDataLine(0),
     delimiter(delimiter),
-    holeFillingEnabled(true)
+    holeFillingEnabled(true),
+    outputFormat(TextOutput),
+    rowsFlushed(0),
+    firstTimestamp(0),
+    lastFlushedTimestamp(0)
+{
+}
+
+void LogCompressor::setOutputFormat(OutputFormat format)
+{
+    outputFormat = format;
+}
+
+/**
+ * Layout of the columnar file, all values in the byte order of the writing machine (see the byte order mark):
+ *   header:  char[8] "QGCLOGC1", quint32 byte order mark 0x01020304, quint32 version
+ *   blocks:  quint32 rowCount, quint32 columnCount, quint64 timestamps[rowCount],
+ *            then per column double values[rowCount] (NaN for holes)
+ *   footer:  quint32 0 (end of blocks), quint32 columnCount, per column quint32 length + name bytes,
+ *            quint64 file offset of the footer, char[8] "QGCLOGC1"
+ * The column count can only grow from block to block, columns missing from a block are all NaN.
+ */
+bool LogCompressor::readColumnarFile(const QString &fileName, QList<QByteArray> &columnNames,
+                                     QVector<quint64> &timestamps, QVector<QVector<double> > &columns)
+{
+    columnNames.clear();
+    timestamps.clear();
+    columns.clear();
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QDataStream stream(&file);
+    char magic[sizeof(ColumnarMagic)];
+    quint32 byteOrderMark = 0;
+    quint32 version = 0;
+    if (stream.readRawData(magic, sizeof(magic)) != static_cast<int>(sizeof(magic)) || memcmp(magic, ColumnarMagic, sizeof(magic)) != 0) {
+        return false;
+    }
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream >> byteOrderMark;
+    if (byteOrderMark != ColumnarByteOrderMark) {
+        stream.setByteOrder(QDataStream::BigEndian);
+    }
+    stream >> version;
+    if (version != ColumnarVersion) {
+        return false;
+    }
+
+    forever {
+        quint32 rows = 0;
+        quint32 columnCount = 0;
+        stream >> rows >> columnCount;
+        if (stream.status() != QDataStream::Ok) {
+            return false;
+        }
+        if (rows == 0) {
+            break;  // footer
+        }
+        const int firstRow = timestamps.size();
+        for (quint32 r = 0; r < rows; ++r) {
+            quint64 timestamp = 0;
+            stream >> timestamp;
+            timestamps.append(timestamp);
+        }
+        while (static_cast<quint32>(columns.size()) < columnCount) {
+            columns.append(QVector<double>(firstRow, qQNaN()));
+        }
+        for (int c = 0; c < columns.size(); ++c) {
+            QVector<double> &column = columns[c];
+            if (static_cast<quint32>(c) >= columnCount) {
+                column.resize(timestamps.size());
+                std::fill(column.begin() + firstRow, column.end(), qQNaN());
+                continue;
+            }
+            for (quint32 r = 0; r < rows; ++r) {
+                double value = 0.0;
+                stream >> value;
+                column.append(value);
+            }
+        }
+    }
+
+    quint32 nameCount = 0;
+    stream >> nameCount;
+    for (quint32 i = 0; i < nameCount && stream.status() == QDataStream::Ok; ++i) {
+        quint32 length = 0;
+        stream >> length;
+        QByteArray name(static_cast<int>(length), '\0');
+        if (stream.readRawData(name.data(), name.size()) != name.size()) {
+            return false;
+        }
+        columnNames.append(name);
+    }
+    while (static_cast<quint32>(columns.size()) < nameCount) {
+        columns.append(QVector<double>(timestamps.size(), qQNaN()));
+    }
+    return stream.status() == QDataStream::Ok;
+}
+
+/**
+ * @return The column of the message name, new names are appended to the schema
+ */
+int LogCompressor::columnOf(const QByteArray &name)
 {
+    const QHash<QByteArray, int>::const_iterator iter = columnIndexes.constFind(name);
+    if (iter != columnIndexes.constEnd()) {
+        return iter.value();
+    }
+    const int column = columnNames.size();
+    columnNames.append(name);
+    columnIndexes.insert(name, column);
+    Cell initial;
+    initial.text = holeFillingEnabled ? QByteArray("NaN") : QByteArray();
+    lastCells.append(initial);
+    return column;
 }
 
+/**
+ * Takes the oldest pending row and fills its holes with the previous value of the
+ * same column (or NaN / blank, see holeFillingEnabled).
+ * @return false for the very first row, which is only used to seed the hole filling
+ *         since it could be incomplete
+ */
+bool LogCompressor::takeRow(quint64 &timestamp, QVector<Cell> &cells)
+{
+    QMap<quint64, QVector<Cell> >::iterator oldest = pendingRows.begin();
+    timestamp = oldest.key();
+    const QVector<Cell> &row = oldest.value();
+
+    cells.resize(columnNames.size());
+    for (int i = 0; i < cells.size(); ++i) {
+        if (i < row.size() && row.at(i).set) {
+            cells[i] = row.at(i);
+            lastCells[i] = row.at(i);
+        } else if (holeFillingEnabled) {
+            cells[i] = lastCells.at(i);
+        } else {
+            cells[i] = Cell();
+        }
+    }
+    pendingRows.erase(oldest);
+    if (rowsFlushed == 0) {
+        firstTimestamp = timestamp;
+    }
+    lastFlushedTimestamp = timestamp;
+    return rowsFlushed++ > 0;
+}
+
+/**
+ * Converts the log in a single pass. The input is read in chunks which are parsed on a
+ * thread pool, lines are then merged into rows by timestamp. Rows are held back in a small
+ * reorder window only, so memory stays bounded no matter how large the log is. Lines
+ * arriving more than ReorderWindow timestamps late are kept aside and merged into the
+ * output at their place when it is assembled, so the rows stay sorted. Their values only
+ * fill holes of their own row.
+ */
 void LogCompressor::run()
 {
 	// Verify that the input file is useable
 	QFile infile(logFileName);
-	if (!infile.exists() || !infile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+	if (!infile.exists() || !infile.open(QIODevice::ReadOnly)) {
 		emit logProcessingStatusChanged(tr("Log Compressor: Cannot start/compress log file, since input file %1 is not readable").arg(QFileInfo(infile.fileName()).absoluteFilePath()));
 		return;
 	}
 
-//    outFileName = logFileName;
-
     QString outFileName;
 
 #if QT_VERSION < QT_VERSION_CHECK(5, 14, 0)
@@ -73,124 +715,103 @@ void LogCompressor::run()
 #endif
 
     parts.replace(0, parts.first() + "_compressed");
-    parts.replace(parts.size()-1, "txt");
+    parts.replace(parts.size()-1, outputFormat == ColumnarBinaryOutput ? "bin" : "txt");
     outFileName = parts.join(".");
 
+    columnIndexes.clear();
+    columnNames.clear();
+    pendingRows.clear();
+    lateRows.clear();
+    lastCells.clear();
+    rowsFlushed = 0;
+    firstTimestamp = 0;
+    lastFlushedTimestamp = 0;
+    currentDataLine = 0;
+
+    const QByteArray delimiterBytes = delimiter.toLocal8Bit();
+    QScopedPointer<RowWriter> writer;
+    if (outputFormat == ColumnarBinaryOutput) {
+        writer.reset(new ColumnarRowWriter(outFileName, holeFillingEnabled));
+    } else {
+        writer.reset(new TextRowWriter(outFileName, delimiterBytes, holeFillingEnabled));
+    }
+
 	// Verify that the output file is useable
-    QFile outTmpFile(outFileName);
-    if (!outTmpFile.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)) {
-		emit logProcessingStatusChanged(tr("Log Compressor: Cannot start/compress log file, since output file %1 is not writable").arg(QFileInfo(outTmpFile.fileName()).absoluteFilePath()));
+    if (!writer->open()) {
+		emit logProcessingStatusChanged(tr("Log Compressor: Cannot start/compress log file, since output file %1 is not writable").arg(QFileInfo(outFileName).absoluteFilePath()));
 		return;
 	}
 
-
-	// First we search the input file through keySearchLimit number of lines
-	// looking for variables. This is neccessary before CSV files require
-	// the same number of fields for every line.
-	const unsigned int keySearchLimit = 15000;
-	unsigned int keyCounter = 0;
-	QTextStream in(&infile);
-	QMap<QString, int> messageMap;
-
-	while (!in.atEnd() && keyCounter < keySearchLimit) {
-		QString messageName = in.readLine().split(delimiter).at(2);
-		messageMap.insert(messageName, 0);
-		++keyCounter;
-	}
-
-	// Now update each key with its index in the output string. These are
-	// all offset by one to account for the first field: timestamp_ms.
-    QMap<QString, int>::iterator i = messageMap.begin();
-	int j;
-	for (i = messageMap.begin(), j = 1; i != messageMap.end(); ++i, ++j) {
-		i.value() = j;
-	}
-
-	// Open the output file and write the header line to it
-	QStringList headerList(messageMap.keys());
-
-	QString headerLine = "timestamp_ms" + delimiter + headerList.join(delimiter) + "\n";
-    // Clean header names from symbols Matlab considers as Latex syntax
-    headerLine = headerLine.replace("timestamp", "TIMESTAMP");
-    headerLine = headerLine.replace(":", "");
-    headerLine = headerLine.replace("_", "");
-    headerLine = headerLine.replace(".", "");
-	outTmpFile.write(headerLine.toLocal8Bit());
-
-    emit logProcessingStatusChanged(tr("Log compressor: Dataset contains dimensions: ") + headerLine);
-
-    // Template list stores a list for populating with data as it's parsed from messages.
-    QStringList templateList;
-    for (int i = 0; i < headerList.size() + 1; ++i) {
-        templateList << (holeFillingEnabled?"NaN":"");
-    }
-
-
-//	// Reset our position in the input file before we start the main processing loop.
-//    in.seek(0);
-
-//    // Search through all lines and build a list of unique timestamps
-//    QMap<quint64, QStringList> timestampMap;
-//    while (!in.atEnd()) {
-//        quint64 timestamp = in.readLine().split(delimiter).at(0).toULongLong();
-//        timestampMap.insert(timestamp, templateList);
-//    }
-
-    // Jump back to start of file
-    in.seek(0);
-
-    // Map of final output lines, key is time
-    QMap<quint64, QStringList> timestampMap;
-
-    // Run through the whole file and fill map of timestamps
-    while (!in.atEnd()) {
-        QStringList newLine = in.readLine().split(delimiter);
-        quint64 timestamp = newLine.at(0).toULongLong();
-
-        // Check if timestamp does exist - if not, add it
-        if (!timestampMap.contains(timestamp)) {
-            timestampMap.insert(timestamp, templateList);
+    QThreadPool pool;
+    const int jobCount = qMax(1, QThread::idealThreadCount());
+    const bool parseNumbers = outputFormat == ColumnarBinaryOutput;
+    QByteArray carry;
+    quint64 timestamp = 0;
+    QVector<Cell> cells;
+    bool writeOk = true;
+
+    while (writeOk && !infile.atEnd()) {
+        // Cut up to jobCount chunks at line boundaries, the partial last line is carried over
+        QVector<QByteArray> chunks;
+        for (int i = 0; i < jobCount && !infile.atEnd(); ++i) {
+            QByteArray chunk = carry + infile.read(ChunkSize);
+            carry.clear();
+            if (!infile.atEnd()) {
+                const int lastNewline = chunk.lastIndexOf('\n');
+                if (lastNewline < 0) {
+                    carry = chunk;
+                    continue;
+                }
+                carry = chunk.mid(lastNewline + 1);
+                chunk.truncate(lastNewline + 1);
+            }
+            chunks.append(chunk);
         }
 
-        QStringList list = timestampMap.value(timestamp);
-
-        QString currentDataName = newLine.at(2);
-        QString currentDataValue = newLine.at(3);
-        list.replace(messageMap.value(currentDataName), currentDataValue);
-        timestampMap.insert(timestamp, list);
-    }
-
-    int lineCounter = 0;
-
-    QStringList lastList = timestampMap.values().at(1);
-
-    foreach (QStringList list, timestampMap.values()) {
-        // Write this current time set out to the file
-        // only do so from the 2nd line on, since the first
-        // line could be incomplete
-        if (lineCounter > 1) {
-            // Set the timestamp
-            list.replace(0,QString("%1").arg(timestampMap.keys().at(lineCounter)));
-
-            // Fill holes if necessary
-            if (holeFillingEnabled) {
-                int index = 0;
-                foreach (QString str, list) {
-                    if (str == "" || str == "NaN") {
-                        list.replace(index, lastList.at(index));
+        QVector<QVector<ParsedLine> > parsed(chunks.size());
+        for (int i = 0; i < chunks.size(); ++i) {
+            pool.start(new ChunkParser(chunks.at(i), delimiterBytes, parseNumbers, &parsed[i]));
+        }
+        pool.waitForDone();
+
+        // Merge in file order so the columns keep the order of their first appearance
+        for (const QVector<ParsedLine> &lines : parsed) {
+            for (const ParsedLine &line : lines) {
+                const int column = columnOf(line.name);
+                QVector<Cell> *row;
+                if (rowsFlushed > 0 && line.timestamp <= lastFlushedTimestamp) {
+                    // Its row already left the reorder window
+                    row = &lateRows[line.timestamp];
+                } else {
+                    row = &pendingRows[line.timestamp];
+                }
+                if (row->size() <= column) {
+                    row->resize(column + 1);
+                }
+                Cell &cell = (*row)[column];
+                cell.text = line.value;
+                cell.number = line.number;
+                cell.set = true;
+
+                while (writeOk && pendingRows.size() > ReorderWindow) {
+                    if (takeRow(timestamp, cells)) {
+                        writeOk = writer->writeRow(timestamp, cells);
                     }
-                    index++;
                 }
             }
+            currentDataLine += lines.size();
+        }
+    }
 
-            // Set last list
-            lastList = list;
-
-            // Write data columns
-            QString output = list.join(delimiter) + "\n";
-            outTmpFile.write(output.toLocal8Bit());
+    while (writeOk && !pendingRows.isEmpty()) {
+        if (takeRow(timestamp, cells)) {
+            writeOk = writer->writeRow(timestamp, cells);
         }
-        lineCounter++;
+    }
+
+    // The first row only seeds the hole filling, late lines up to it are dropped with it
+    while (!lateRows.isEmpty() && lateRows.firstKey() <= firstTimestamp) {
+        lateRows.erase(lateRows.begin());
     }
 
 	// We're now done with the source file
@@ -198,7 +819,16 @@ void LogCompressor::run()
 
     emit logProcessingStatusChanged(tr("Log Compressor: Writing output to file %1").arg(QFileInfo(outFileName).absoluteFilePath()));
 
+    if (!writeOk || !writer->finish(columnNames, lateRows)) {
+        emit logProcessingStatusChanged(tr("Log Compressor: Failed writing output file %1: %2").arg(outFileName, writer->errorString()));
+        running = false;
+        return;
+    }
+    emit logProcessingStatusChanged(tr("Log compressor: Dataset contains dimensions: ") + writer->header());
+
 	// Clean up and update the status before we return.
+    pendingRows.clear();
+    lateRows.clear();
 	currentDataLine = 0;
     emit logProcessingStatusChanged(tr("Log compressor: Finished processing file: %1").arg(outFileName));
 	emit finishedFile(outFileName);
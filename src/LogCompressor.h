@@ -2,18 +2,48 @@
 #define LOGCOMPRESSOR_H
 
 #include <QThread>
+#include <QHash>
+#include <QMap>
+#include <QStringList>
+#include <QVector>
+#include <QtNumeric>
 
 class LogCompressor : public QThread
 {
     Q_OBJECT
 public:
+    /** @brief Format of the compressed output file */
+    enum OutputFormat
+    {
+        TextOutput,             ///< Delimiter separated text, one line per timestamp
+        ColumnarBinaryOutput    ///< Blocks of rows stored column by column as doubles, see readColumnarFile()
+    };
+
     /** @brief Create the log compressor. It will only get active upon calling startCompression() */
     LogCompressor(QString logFileName, QString outFileName="", QString delimiter="\t");
+    /** @brief Select the output format, must be called before startCompression() */
+    void setOutputFormat(OutputFormat format);
     /** @brief Start the compression of a raw, line-based logfile into a CSV file */
     void startCompression(bool holeFilling=false);
     bool isFinished();
     int getCurrentLine();
 
+    /**
+     * @brief Reads a file written with ColumnarBinaryOutput
+     * @param columns Values column by column, NaN for holes and for values which are not numbers
+     * @return false if the file cannot be read or is no columnar log
+     */
+    static bool readColumnarFile(const QString &fileName, QList<QByteArray> &columnNames,
+                                 QVector<quint64> &timestamps, QVector<QVector<double> > &columns);
+
+    /** @brief One value of a row, kept as text and as number so both output formats can use it */
+    struct Cell
+    {
+        QByteArray text;
+        double number = qQNaN();    ///< Only parsed for ColumnarBinaryOutput
+        bool set = false;           ///< False for a hole
+    };
+
 protected:
     void run();                     ///< This function actually performs the compression. It's an overloaded function from QThread
     QString logFileName;            ///< The input file name.
@@ -22,6 +52,20 @@ protected:
     int currentDataLine;            ///< The current line of data that is being processed. Only relevant when running==true
     QString delimiter;              ///< Delimiter between fields in the output file. Defaults to tab ('\t')
     bool holeFillingEnabled;        ///< Enables the filling of holes in the dataset with the previous value (or NaN if none exists)
+    OutputFormat outputFormat;      ///< Format of the written file. Defaults to TextOutput
+
+private:
+    int columnOf(const QByteArray &name);
+    bool takeRow(quint64 &timestamp, QVector<Cell> &cells);
+
+    QHash<QByteArray, int> columnIndexes;           ///< Column of every message name, in order of discovery
+    QList<QByteArray> columnNames;                  ///< Message names by column
+    QMap<quint64, QVector<Cell> > pendingRows;      ///< Rows not written yet, bounded by the reorder window
+    QMap<quint64, QVector<Cell> > lateRows;         ///< Lines older than the rows already written, merged in at the end
+    QVector<Cell> lastCells;                        ///< Last value of every column, used for hole filling
+    qint64 rowsFlushed;                             ///< Number of rows taken out of pendingRows so far
+    quint64 firstTimestamp;                         ///< Timestamp of the first row, which is not written
+    quint64 lastFlushedTimestamp;                   ///< Timestamp of the last row taken out of pendingRows
 
 signals:
     /** @brief This signal is emitted when there is a change in the status of the parsing algorithm. For instance if an error is encountered.
@@ -35,4 +79,4 @@ signals:
     void finishedFile(QString fileName);
 };
 
-#endif // LOGCOMPRESSOR_H
\ No newline at end of file
+#endif // LOGCOMPRESSOR_H
@@ -0,0 +1,131 @@
+/*=====================================================================
+
+ QGroundControl Open Source Ground Control Station
+
+ (c) 2009 - 2011 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+ This file is part of the QGROUNDCONTROL project
+
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+ ======================================================================*/
+
+/**
+ * @file
+ *   @brief Implementation of the raw plane conversions
+ *
+ */
+
+#include "QGCVideoConversion.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define QGCVIDEO_SSE2
+#include <emmintrin.h>
+#endif
+
+// BT.601 coefficients scaled by 64
+static const int CoeffRV = 90;  // 1.402
+static const int CoeffGU = 22;  // 0.344
+static const int CoeffGV = 46;  // 0.714
+static const int CoeffBU = 113; // 1.772
+
+static inline unsigned char clampToByte(int value)
+{
+    return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+#ifdef QGCVIDEO_SSE2
+/** @brief Interleave eight pixels of three 8 bit channels with opaque alpha and store them */
+static inline void storeRgba8(__m128i r, __m128i g, __m128i b, unsigned char* out)
+{
+    const __m128i alpha = _mm_set1_epi8(static_cast<char>(0xFF));
+    const __m128i rg = _mm_unpacklo_epi8(r, g);
+    const __m128i ba = _mm_unpacklo_epi8(b, alpha);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi16(rg, ba));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), _mm_unpackhi_epi16(rg, ba));
+}
+#endif
+
+void QGCVideoConversion::greyToGL(const unsigned char* grey, int width, int height, unsigned char* rgba, int stride)
+{
+    for (int row = 0; row < height; ++row)
+    {
+        // OpenGL images start with the bottom row
+        const unsigned char* in = grey + (height - 1 - row) * width;
+        unsigned char* out = rgba + row * stride;
+        int x = 0;
+#ifdef QGCVIDEO_SSE2
+        for (; x + 8 <= width; x += 8)
+        {
+            const __m128i value = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + x));
+            storeRgba8(value, value, value, out + x * 4);
+        }
+#endif
+        for (; x < width; ++x)
+        {
+            out[x * 4] = in[x];
+            out[x * 4 + 1] = in[x];
+            out[x * 4 + 2] = in[x];
+            out[x * 4 + 3] = 0xFF;
+        }
+    }
+}
+
+void QGCVideoConversion::yuvToGL(const unsigned char* y, const unsigned char* u, const unsigned char* v,
+                                 int width, int height, unsigned char* rgba, int stride)
+{
+#ifdef QGCVIDEO_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi16(128);
+    const __m128i coeffRV = _mm_set1_epi16(CoeffRV);
+    const __m128i coeffGU = _mm_set1_epi16(CoeffGU);
+    const __m128i coeffGV = _mm_set1_epi16(CoeffGV);
+    const __m128i coeffBU = _mm_set1_epi16(CoeffBU);
+#endif
+    for (int row = 0; row < height; ++row)
+    {
+        const int offset = (height - 1 - row) * width;
+        const unsigned char* inY = y + offset;
+        const unsigned char* inU = u + offset;
+        const unsigned char* inV = v + offset;
+        unsigned char* out = rgba + row * stride;
+        int x = 0;
+#ifdef QGCVIDEO_SSE2
+        for (; x + 8 <= width; x += 8)
+        {
+            // Widen to 16 bit, the largest intermediate value is 255 * 64 + 113 * 128
+            const __m128i y16 = _mm_slli_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(inY + x)), zero), 6);
+            const __m128i u16 = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(inU + x)), zero), bias);
+            const __m128i v16 = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(inV + x)), zero), bias);
+
+            const __m128i r = _mm_srai_epi16(_mm_add_epi16(y16, _mm_mullo_epi16(v16, coeffRV)), 6);
+            const __m128i g = _mm_srai_epi16(_mm_sub_epi16(_mm_sub_epi16(y16, _mm_mullo_epi16(u16, coeffGU)),
+                                                           _mm_mullo_epi16(v16, coeffGV)), 6);
+            const __m128i b = _mm_srai_epi16(_mm_add_epi16(y16, _mm_mullo_epi16(u16, coeffBU)), 6);
+
+            storeRgba8(_mm_packus_epi16(r, r), _mm_packus_epi16(g, g), _mm_packus_epi16(b, b), out + x * 4);
+        }
+#endif
+        for (; x < width; ++x)
+        {
+            const int luma = inY[x] << 6;
+            const int cb = inU[x] - 128;
+            const int cr = inV[x] - 128;
+            out[x * 4] = clampToByte((luma + CoeffRV * cr) >> 6);
+            out[x * 4 + 1] = clampToByte((luma - CoeffGU * cb - CoeffGV * cr) >> 6);
+            out[x * 4 + 2] = clampToByte((luma + CoeffBU * cb) >> 6);
+            out[x * 4 + 3] = 0xFF;
+        }
+    }
+}
@@ -0,0 +1,53 @@
+/*=====================================================================
+
+ QGroundControl Open Source Ground Control Station
+
+ (c) 2009 - 2011 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+ This file is part of the QGROUNDCONTROL project
+
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+ ======================================================================*/
+
+/**
+ * @file
+ *   @brief Conversion of raw camera planes into OpenGL images
+ *
+ *   The output has the layout QGLWidget::convertToGLFormat() produces and
+ *   glDrawPixels(GL_RGBA, GL_UNSIGNED_BYTE) expects: RGBA bytes, rows from
+ *   bottom to top. Eight pixels are converted at once with SSE2 where the
+ *   compiler targets it, the plain C++ path gives the same results.
+ *
+ */
+
+#ifndef QGCVIDEOCONVERSION_H
+#define QGCVIDEOCONVERSION_H
+
+namespace QGCVideoConversion
+{
+    /** @brief Grey plane to RGBA, each output row is stride bytes long */
+    void greyToGL(const unsigned char* grey, int width, int height, unsigned char* rgba, int stride);
+
+    /**
+     * @brief Full resolution YUV planes to RGBA
+     *
+     * ITU-R BT.601 with full range luma and chroma centred at 128, computed
+     * in 6 bit fixed point.
+     */
+    void yuvToGL(const unsigned char* y, const unsigned char* u, const unsigned char* v,
+                 int width, int height, unsigned char* rgba, int stride);
+}
+
+#endif // QGCVIDEOCONVERSION_H
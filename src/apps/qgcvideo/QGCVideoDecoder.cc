@@ -0,0 +1,272 @@
+/*=====================================================================
+
+ QGroundControl Open Source Ground Control Station
+
+ (c) 2009 - 2011 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+ This file is part of the QGROUNDCONTROL project
+
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+ ======================================================================*/
+
+/**
+ * @file
+ *   @brief Implementation of the decoder thread
+ *
+ */
+
+#include "QGCVideoDecoder.h"
+#include "QGCVideoConversion.h"
+
+static const double AverageWeight = 0.1; ///< Weight of the newest value in the running averages
+
+QGCVideoDecoder::QGCVideoDecoder(QObject* parent) :
+    QThread(parent),
+    partMask(0),
+    currentId(-1),
+    firstPartTime(0),
+    stopping(false),
+    colorEnabled(false),
+    writeIndex(0),
+    readyIndex(-1),
+    showIndex(2),
+    lastTakeTime(0),
+    displayInterval(0.0)
+{
+    for (int i = 0; i < ChannelCount; ++i)
+    {
+        planes[i] = QByteArray(FrameWidth * FrameHeight, static_cast<char>(255));
+    }
+    for (int i = 0; i < 3; ++i)
+    {
+        frames[i].firstPartTime = 0;
+        frames[i].completeTime = 0;
+        frames[i].decodedTime = 0;
+    }
+    stats.receiveLatency = 0.0;
+    stats.decodeLatency = 0.0;
+    stats.displayLatency = 0.0;
+    stats.totalLatency = 0.0;
+    stats.framesShown = 0;
+    stats.framesDropped = 0;
+    stats.datagramsDropped = 0;
+    clock.start();
+}
+
+QGCVideoDecoder::~QGCVideoDecoder()
+{
+    stop();
+}
+
+void QGCVideoDecoder::stop()
+{
+    mutex.lock();
+    stopping = true;
+    wake.wakeAll();
+    mutex.unlock();
+    wait();
+}
+
+void QGCVideoDecoder::addDatagram(const QByteArray& data)
+{
+    Datagram datagram;
+    datagram.data = data;
+    QMutexLocker locker(&mutex);
+    datagram.time = clock.nsecsElapsed() / 1000;
+    if (queue.size() >= maxQueuedDatagrams)
+    {
+        // The decoder is stalled, old parts are the least useful
+        queue.removeFirst();
+        stats.datagramsDropped++;
+    }
+    queue.append(datagram);
+    wake.wakeOne();
+}
+
+void QGCVideoDecoder::setColorEnabled(bool enabled)
+{
+    QMutexLocker locker(&mutex);
+    colorEnabled = enabled;
+}
+
+QGCVideoDecoder::Statistics QGCVideoDecoder::statistics() const
+{
+    QMutexLocker locker(&mutex);
+    return stats;
+}
+
+bool QGCVideoDecoder::takeFrame(QImage images[ChannelCount])
+{
+    QMutexLocker locker(&mutex);
+    const qint64 now = clock.nsecsElapsed() / 1000;
+    if (lastTakeTime > 0)
+    {
+        const double interval = (now - lastTakeTime) / 1000.0;
+        displayInterval = (displayInterval == 0.0) ? interval : (1.0 - AverageWeight) * displayInterval + AverageWeight * interval;
+    }
+    lastTakeTime = now;
+
+    if (readyIndex < 0)
+    {
+        return false;
+    }
+    showIndex = readyIndex;
+    readyIndex = -1;
+
+    const Frame& frame = frames[showIndex];
+    for (int i = 0; i < ChannelCount; ++i)
+    {
+        images[i] = frame.images[i];
+    }
+    updateAverage(stats.receiveLatency, frame.completeTime - frame.firstPartTime);
+    updateAverage(stats.decodeLatency, frame.decodedTime - frame.completeTime);
+    updateAverage(stats.displayLatency, now - frame.decodedTime);
+    updateAverage(stats.totalLatency, now - frame.firstPartTime);
+    stats.framesShown++;
+    return true;
+}
+
+void QGCVideoDecoder::updateAverage(double& average, qint64 value)
+{
+    const double milliseconds = value / 1000.0;
+    average = (stats.framesShown == 0) ? milliseconds : (1.0 - AverageWeight) * average + AverageWeight * milliseconds;
+}
+
+void QGCVideoDecoder::run()
+{
+    QList<Datagram> pending;
+    mutex.lock();
+    while (!stopping)
+    {
+        if (queue.isEmpty())
+        {
+            wake.wait(&mutex);
+            continue;
+        }
+        pending.swap(queue);
+        mutex.unlock();
+
+        foreach (const Datagram& datagram, pending)
+        {
+            addPart(datagram);
+        }
+        pending.clear();
+
+        mutex.lock();
+    }
+    mutex.unlock();
+}
+
+void QGCVideoDecoder::addPart(const Datagram& datagram)
+{
+    const QByteArray& data = datagram.data;
+    if (data.size() < 4)
+    {
+        return;
+    }
+    const int part = static_cast<unsigned char>(data.at(0));
+    const int id = static_cast<unsigned char>(data.at(1));
+    if (part < 1 || part > FramePartCount)
+    {
+        return;
+    }
+
+    if (id != currentId)
+    {
+        if (partMask != 0)
+        {
+            QMutexLocker locker(&mutex);
+            stats.framesDropped++;
+        }
+        currentId = id;
+        partMask = 0;
+    }
+    if (partMask == 0)
+    {
+        firstPartTime = datagram.time;
+    }
+
+    // De-interleave the channels into their planes
+    const int count = qMin(data.size() / 4 - 1, FramePartPixels);
+    const int offset = (part - 1) * FramePartPixels;
+    const unsigned char* in = reinterpret_cast<const unsigned char*>(data.constData()) + 4;
+    unsigned char* out0 = reinterpret_cast<unsigned char*>(planes[0].data()) + offset;
+    unsigned char* out1 = reinterpret_cast<unsigned char*>(planes[1].data()) + offset;
+    unsigned char* out2 = reinterpret_cast<unsigned char*>(planes[2].data()) + offset;
+    unsigned char* out3 = reinterpret_cast<unsigned char*>(planes[3].data()) + offset;
+    for (int i = 0; i < count; ++i)
+    {
+        out0[i] = in[i * 4];
+        out1[i] = in[i * 4 + 1] + 127;
+        out2[i] = in[i * 4 + 2] + 127;
+        out3[i] = in[i * 4 + 3];
+    }
+
+    partMask |= 1 << (part - 1);
+    if (partMask != (1 << FramePartCount) - 1)
+    {
+        return;
+    }
+    partMask = 0;
+
+    bool color;
+    {
+        QMutexLocker locker(&mutex);
+        // The waiting frame is younger than one display interval, it would
+        // be replaced before the GUI shows it. Skip the conversion.
+        if (readyIndex >= 0 && datagram.time - frames[readyIndex].completeTime < displayInterval * 1000.0)
+        {
+            stats.framesDropped++;
+            return;
+        }
+        color = colorEnabled;
+    }
+
+    // Only the decoder thread changes writeIndex
+    Frame& frame = frames[writeIndex];
+    frame.firstPartTime = firstPartTime;
+    frame.completeTime = datagram.time;
+    for (int i = 0; i < ChannelCount; ++i)
+    {
+        // Reuse the buffer unless the GUI still holds the image
+        QImage& image = frame.images[i];
+        if (image.isNull() || !image.isDetached())
+        {
+            image = QImage(FrameWidth, FrameHeight, QImage::Format_ARGB32);
+        }
+        const unsigned char* plane = reinterpret_cast<const unsigned char*>(planes[i].constData());
+        if (i == 0 && color)
+        {
+            QGCVideoConversion::yuvToGL(plane,
+                                        reinterpret_cast<const unsigned char*>(planes[1].constData()),
+                                        reinterpret_cast<const unsigned char*>(planes[2].constData()),
+                                        FrameWidth, FrameHeight, image.bits(), image.bytesPerLine());
+        }
+        else
+        {
+            QGCVideoConversion::greyToGL(plane, FrameWidth, FrameHeight, image.bits(), image.bytesPerLine());
+        }
+    }
+
+    QMutexLocker locker(&mutex);
+    frame.decodedTime = clock.nsecsElapsed() / 1000;
+    const int replaced = readyIndex;
+    if (replaced >= 0)
+    {
+        stats.framesDropped++;
+    }
+    readyIndex = writeIndex;
+    writeIndex = (replaced >= 0) ? replaced : 3 - readyIndex - showIndex;
+}
@@ -0,0 +1,139 @@
+/*=====================================================================
+
+ QGroundControl Open Source Ground Control Station
+
+ (c) 2009 - 2011 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+ This file is part of the QGROUNDCONTROL project
+
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+ ======================================================================*/
+
+/**
+ * @file
+ *   @brief Decoder thread of the video streamer
+ *
+ *   A frame arrives in FramePartCount UDP datagrams. Each one starts with the
+ *   part number (1 to FramePartCount), the frame id and two unused bytes,
+ *   followed by four interleaved 8 bit channels of FramePartPixels pixels.
+ *   Channels 2 and 3 are signed and shifted by 127.
+ *
+ *   The datagrams are queued by the GUI thread and reassembled and converted
+ *   to OpenGL images on the decoder thread. Decoded frames go through three
+ *   buffers: the one being written by the decoder, the newest complete one and
+ *   the one shown by the GUI, so neither side ever waits for the other. The GUI
+ *   takes frames at its display rate; frames completed faster than that replace
+ *   the waiting frame, and are not even converted while the waiting frame is
+ *   younger than one display interval.
+ *
+ */
+
+#ifndef QGCVIDEODECODER_H
+#define QGCVIDEODECODER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+class QGCVideoDecoder : public QThread
+{
+    Q_OBJECT
+public:
+    static const int ChannelCount = 4;
+    static const int FrameWidth = 376;
+    static const int FrameHeight = 240;
+    static const int FramePartCount = 8;
+    static const int FramePartPixels = FrameWidth * FrameHeight / FramePartCount;
+
+    /** @brief Frame delay and rate, times in milliseconds averaged over the last frames */
+    struct Statistics
+    {
+        double receiveLatency;  ///< First datagram of a frame to the last one
+        double decodeLatency;   ///< Last datagram to the converted images
+        double displayLatency;  ///< Converted images to taken by the GUI
+        double totalLatency;    ///< First datagram to taken by the GUI
+        int framesShown;
+        int framesDropped;
+        int datagramsDropped;
+    };
+
+    explicit QGCVideoDecoder(QObject* parent = NULL);
+    ~QGCVideoDecoder();
+
+    /** @brief Queue a received datagram, called from the GUI thread */
+    void addDatagram(const QByteArray& data);
+    /**
+     * @brief Take the newest decoded frame, at most once per displayed frame
+     * @param images Receives ChannelCount images in OpenGL format
+     * @return false if no new frame was decoded since the last call
+     */
+    bool takeFrame(QImage images[ChannelCount]);
+    Statistics statistics() const;
+    void stop();
+
+public slots:
+    /** @brief Show channels 1 to 3 as one YUV colour image in place of channel 1 */
+    void setColorEnabled(bool enabled);
+
+protected:
+    void run();
+
+private:
+    struct Frame
+    {
+        QImage images[ChannelCount];
+        qint64 firstPartTime;
+        qint64 completeTime;
+        qint64 decodedTime;
+    };
+
+    struct Datagram
+    {
+        QByteArray data;
+        qint64 time;
+    };
+
+    void addPart(const Datagram& datagram);
+    void updateAverage(double& average, qint64 value);
+
+    static const int maxQueuedDatagrams = 64;
+
+    // Decoder thread only
+    QByteArray planes[ChannelCount];    ///< Reassembly buffers, one plane per channel
+    int partMask;                       ///< Bit per received part of the current frame
+    int currentId;                      ///< Id of the frame being reassembled, -1 before the first one
+    qint64 firstPartTime;
+
+    mutable QMutex mutex;
+    QWaitCondition wake;
+    bool stopping;
+    bool colorEnabled;
+    QList<Datagram> queue;              ///< Datagrams not yet reassembled
+    QElapsedTimer clock;                ///< Time base of all time stamps
+
+    Frame frames[3];                    ///< Triple buffer
+    int writeIndex;                     ///< Buffer written by the decoder
+    int readyIndex;                     ///< Newest complete buffer, -1 if the GUI took it
+    int showIndex;                      ///< Buffer last taken by the GUI
+    qint64 lastTakeTime;
+    double displayInterval;             ///< Average time between two takeFrame() calls
+    Statistics stats;
+};
+
+#endif // QGCVIDEODECODER_H
@@ -33,7 +33,9 @@
 #define QGCVIDEOMAINWINDOW_H
 
 #include <QMainWindow>
+#include <QTimer>
 #include "UDPLink.h"
+#include "QGCVideoDecoder.h"
 
 
 
@@ -53,9 +55,17 @@ public:
 public slots:
 
     void receiveBytes(LinkInterface* link, QByteArray data);
+    /** @brief Show the newest decoded frame, called at the display rate */
+    void presentFrame();
+    /** @brief Show frame rate and latency in the status bar */
+    void showStatistics();
 
 protected:
     UDPLink link;
+    QGCVideoDecoder decoder;
+    QTimer presentTimer;
+    QTimer statisticsTimer;
+    int lastFramesShown;
 
 private:
     Ui::QGCVideoMainWindow *ui;
@@ -1175,3 +1175,8 @@ void QGCVideoWidget::copyImage(const QImage& img)
     qDebug() << "QGCVideoWidget::copyImage()";
     this->glImage = QGLWidget::convertToGLFormat(img);
 }
+
+void QGCVideoWidget::setGLImage(const QImage& img)
+{
+    this->glImage = img;
+}
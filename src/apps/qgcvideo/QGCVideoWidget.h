@@ -21,6 +21,8 @@ public:
     QGCVideoWidget(QWidget* parent = NULL);
     ~QGCVideoWidget();
 
+    static const int updateInterval = 40;
+
     void resizeGL(int w, int h);
 
 public slots:
@@ -30,6 +32,8 @@ public slots:
     void saveImage(QString fileName);
     /** @brief Copy an image from an external buffer */
     void copyImage(const QImage& img);
+    /** @brief Show an image which is already in OpenGL format, without copying it */
+    void setGLImage(const QImage& img);
     void enableHUDInstruments(bool enabled) { hudInstrumentsEnabled = enabled; }
     void enableVideo(bool enabled) { videoEnabled = enabled; }
     void enableFlow(bool enabled) { flowEnabled = enabled; }
@@ -79,8 +83,6 @@ protected:
     void contextMenuEvent (QContextMenuEvent* event);
     void createActions();
 
-    static const int updateInterval = 40;
-
     QImage* image; ///< Double buffer image
     QImage glImage; ///< The background / camera image
     float yawInt; ///< The yaw integral. Used to damp the yaw indication.
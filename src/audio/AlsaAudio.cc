@@ -60,6 +60,8 @@ This file is part of the QGROUNDCONTROL project
 
 AlsaAudio::AlsaAudio(QObject *parent) :
     QThread(parent),
+    aa_playingCritical(false),
+    aa_stop(false),
     aa_Volume(1.0f)
 {
 }
@@ -77,21 +79,131 @@ AlsaAudio* AlsaAudio::instance(QObject *par)
     return _instance;
 }
 
-void AlsaAudio::enqueueFilname(QString name)
+void AlsaAudio::enqueueFilname(QString name, bool critical)
 {
-    aa_fileNameQueue.enqueue(name);
+    QueueEntry entry;
+    entry.fileName = name;
+    enqueue(entry, critical);
+}
+
+void AlsaAudio::enqueuePcm(QSharedPointer<const AlsaPcmBuffer> pcm, bool critical)
+{
+    QueueEntry entry;
+    entry.pcm = pcm;
+    enqueue(entry, critical);
+}
+
+void AlsaAudio::enqueue(const QueueEntry &entry, bool critical)
+{
+    QMutexLocker locker(&aa_queueMutex);
+    if (critical)
+    {
+        aa_criticalQueue.enqueue(entry);
+    }
+    else
+    {
+        aa_queue.enqueue(entry);
+    }
+    aa_stop = false;
+    aa_queueCondition.wakeOne();
+    locker.unlock();
+
+    // The thread keeps waiting for new entries once started
+    if (!isRunning())
+    {
+        start();
+    }
+}
+
+void AlsaAudio::stop()
+{
+    QMutexLocker locker(&aa_queueMutex);
+    aa_stop = true;
+    aa_queueCondition.wakeOne();
+}
+
+bool AlsaAudio::alsa_preempted()
+{
+    QMutexLocker locker(&aa_queueMutex);
+    return aa_stop || (!aa_playingCritical && !aa_criticalQueue.isEmpty());
 }
 
 // main qthread
 void AlsaAudio::run()
 {
-    while (!aa_fileNameQueue.isEmpty()){
-        QString filetoplay = aa_fileNameQueue.dequeue();
-        alsa_play( filetoplay );
-    }
+    forever
+    {
+        QMutexLocker locker(&aa_queueMutex);
+        while (!aa_stop && aa_criticalQueue.isEmpty() && aa_queue.isEmpty())
+        {
+            aa_queueCondition.wait(&aa_queueMutex);
+        }
+        if (aa_stop)
+        {
+            return;
+        }
+        aa_playingCritical = !aa_criticalQueue.isEmpty();
+        QueueEntry entry = aa_playingCritical ? aa_criticalQueue.dequeue() : aa_queue.dequeue();
+        locker.unlock();
 
+        if (entry.pcm)
+        {
+            alsa_play_pcm( *entry.pcm );
+        }
+        else
+        {
+            alsa_play( entry.fileName );
+        }
+    }
 }
 
+bool AlsaAudio::alsa_play_pcm( const AlsaPcmBuffer &pcm )
+{
+#ifndef Q_OS_LINUX
+    Q_UNUSED(pcm);
+#endif
+
+#ifdef Q_OS_LINUX
+    static float buffer [BUFFER_LEN];
+    snd_pcm_t * alsa_dev;
+
+    if (pcm.channels < 1 || pcm.channels > 2 || pcm.samples.isEmpty())
+    {
+        QLOG_INFO() << "Error : channels = " << pcm.channels << " samples = " << pcm.samples.size();
+        return false;
+    }
+
+    alsa_dev = alsa_open (pcm.channels, pcm.sampleRate);
+
+    if (!alsa_dev)
+    {
+        QLOG_ERROR() << "Failure playing audio buffer";
+        return false;
+    }
+
+    const float *samples = pcm.samples.constData();
+    const int count = pcm.samples.size();
+    for (int offset = 0; offset < count && !alsa_preempted(); offset += BUFFER_LEN)
+    {
+        const int readcount = qMin(BUFFER_LEN, count - offset);
+        int m;
+        for (m = 0; m < readcount; m++)
+            buffer [m] = samples [offset + m] * aa_Volume;
+        for (; m < BUFFER_LEN; m++)
+            buffer [m] = 0;
+        alsa_write_float (alsa_dev, buffer, BUFFER_LEN / pcm.channels, pcm.channels);
+    }
+
+    if (alsa_preempted())
+    {
+        // Do not let the rest of the ring buffer delay what pre-empted us
+        snd_pcm_drop (alsa_dev);
+    }
+    snd_pcm_close (alsa_dev);
+#endif // Q_OS_LINUX
+
+    return true;
+} /* alsa_play_pcm */
 
 bool AlsaAudio::alsa_play( QString filename )
 {
@@ -146,7 +258,7 @@ bool AlsaAudio::alsa_play( QString filename )
         else
             scale = 32700.0 / scale;
 
-        while ((readcount = sf_read_float (sndfile, buffer, BUFFER_LEN)))
+        while (!alsa_preempted() && (readcount = sf_read_float (sndfile, buffer, BUFFER_LEN)))
         {
             for (m = 0; m < readcount; m++)
                 buffer [m] *= scale * aa_Volume;
@@ -158,7 +270,7 @@ bool AlsaAudio::alsa_play( QString filename )
     else
     {
         int m;
-        while ((readcount = sf_read_float (sndfile, buffer, BUFFER_LEN)))
+        while (!alsa_preempted() && (readcount = sf_read_float (sndfile, buffer, BUFFER_LEN)))
         {
             for (m = 0; m < readcount; m++)
                 buffer [m] *= aa_Volume;
@@ -168,6 +280,10 @@ bool AlsaAudio::alsa_play( QString filename )
         }
     }
 
+    if (alsa_preempted())
+    {
+        snd_pcm_drop (alsa_dev);
+    }
     snd_pcm_close (alsa_dev);
 
     sf_close (sndfile);
@@ -34,6 +34,10 @@ This file is part of the QGROUNDCONTROL project
 #include <QSettings>
 #include <QThread>
 #include <QQueue>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QSharedPointer>
+#include <QVector>
 #include "logging.h"
 
 #ifdef Q_OS_LINUX
@@ -43,6 +47,15 @@ This file is part of the QGROUNDCONTROL project
 #define BUFFER_LEN (2048)
 #endif // Q_OS_LINUX
 
+/** @brief Synthesized or decoded audio, interleaved float samples in -1.0 .. 1.0 */
+class AlsaPcmBuffer
+{
+public:
+    QVector<float> samples;
+    int channels = 1;
+    int sampleRate = 0;
+};
+
 class AlsaAudio : public QThread
 {
 //    Q_OBJECT
@@ -53,7 +66,18 @@ public:
     static AlsaAudio* instance(QObject *par);
 
     /** @brief enqueue new filename */
-    void enqueueFilname(QString name);
+    void enqueueFilname(QString name, bool critical=false);
+
+    /**
+     * @brief enqueue audio which is already in memory
+     *
+     * Critical audio is played before everything else queued and cuts off
+     * non critical audio which is playing.
+     */
+    void enqueuePcm(QSharedPointer<const AlsaPcmBuffer> pcm, bool critical=false);
+
+    /** @brief Stop the thread, cutting off the current playback and dropping the queue, wait() for it afterwards */
+    void stop();
 
     /** @brief set volume double 0.0f - 1.0f */
     double getAAVolume(){
@@ -69,12 +93,29 @@ public slots:
     void run();
 
 private:
-    QQueue<QString> aa_fileNameQueue;
+    class QueueEntry
+    {
+    public:
+        QString fileName;
+        QSharedPointer<const AlsaPcmBuffer> pcm;
+    };
+
+    void enqueue(const QueueEntry &entry, bool critical);
+
+    QMutex aa_queueMutex;
+    QWaitCondition aa_queueCondition;
+    QQueue<QueueEntry> aa_criticalQueue;
+    QQueue<QueueEntry> aa_queue;
+    bool aa_playingCritical;
+    bool aa_stop;
     double aa_Volume;
 
 protected:
 
     bool alsa_play( QString filename );
+    bool alsa_play_pcm( const AlsaPcmBuffer &pcm );
+    /** @brief true if critical audio waits while something else is played */
+    bool alsa_preempted();
 #ifdef Q_OS_LINUX
     snd_pcm_t * alsa_open( int channels, int srate );
     int alsa_write_float( snd_pcm_t *alsa_dev, float *data, int frames, int channels );
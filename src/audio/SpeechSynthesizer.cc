@@ -0,0 +1,171 @@
+/*=====================================================================
+
+QGroundControl Open Source Ground Control Station
+
+(c) 2009, 2010 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+This file is part of the QGROUNDCONTROL project
+
+    QGROUNDCONTROL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    QGROUNDCONTROL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Implementation of the speech synthesis thread
+ *
+ */
+
+#include "SpeechSynthesizer.h"
+
+#if defined(FLITE_AUDIO_ENABLED)
+extern "C" {
+#include <flite/flite.h>
+    cst_voice* register_cmu_us_kal(const char* voxdir);
+};
+#endif
+
+SpeechSynthesizer::SpeechSynthesizer(AlsaAudio *audio, QObject *parent) :
+    QThread(parent),
+    m_audio(audio),
+    m_cache(s_cacheSizeKb),
+    m_stop(false)
+{
+}
+
+void SpeechSynthesizer::say(const QString &text, bool critical)
+{
+    QMutexLocker locker(&m_mutex);
+    if (playCached(text, critical))
+    {
+        return;
+    }
+
+    Request request;
+    request.text = text;
+    request.critical = critical;
+    if (critical)
+    {
+        m_criticalQueue.enqueue(request);
+    }
+    else
+    {
+        foreach (const Request &queued, m_chatterQueue)
+        {
+            if (queued.text == text)
+            {
+                return;
+            }
+        }
+        if (m_chatterQueue.size() >= s_maxQueuedChatter)
+        {
+            QLOG_DEBUG() << "Dropping outdated speech:" << m_chatterQueue.head().text;
+            m_chatterQueue.dequeue();
+        }
+        m_chatterQueue.enqueue(request);
+    }
+    m_stop = false;
+    m_condition.wakeOne();
+    locker.unlock();
+
+    if (!isRunning())
+    {
+        start(QThread::LowPriority);
+    }
+}
+
+void SpeechSynthesizer::stop()
+{
+    QMutexLocker locker(&m_mutex);
+    m_stop = true;
+    m_condition.wakeOne();
+}
+
+bool SpeechSynthesizer::playCached(const QString &text, bool critical)
+{
+    QSharedPointer<const AlsaPcmBuffer> *pcm = m_cache.object(text);
+    if (!pcm)
+    {
+        return false;
+    }
+    m_audio->enqueuePcm(*pcm, critical);
+    return true;
+}
+
+void SpeechSynthesizer::run()
+{
+#ifdef FLITE_AUDIO_ENABLED
+    flite_init();
+#endif
+    forever
+    {
+        QMutexLocker locker(&m_mutex);
+        while (!m_stop && m_criticalQueue.isEmpty() && m_chatterQueue.isEmpty())
+        {
+            m_condition.wait(&m_mutex);
+        }
+        if (m_stop)
+        {
+            return;
+        }
+        const Request request = m_criticalQueue.isEmpty() ? m_chatterQueue.dequeue() : m_criticalQueue.dequeue();
+        // The same phrase may have been queued twice before the first one was synthesized
+        if (playCached(request.text, request.critical))
+        {
+            continue;
+        }
+        locker.unlock();
+
+        QSharedPointer<const AlsaPcmBuffer> pcm = synthesize(request.text);
+        if (pcm.isNull())
+        {
+            continue;
+        }
+        m_audio->enqueuePcm(pcm, request.critical);
+
+        locker.relock();
+        const int costKb = qMax(1, static_cast<int>(pcm->samples.size() * sizeof(float) / 1024));
+        m_cache.insert(request.text, new QSharedPointer<const AlsaPcmBuffer>(pcm), costKb);
+    }
+}
+
+QSharedPointer<const AlsaPcmBuffer> SpeechSynthesizer::synthesize(const QString &text)
+{
+#ifdef FLITE_AUDIO_ENABLED
+    static cst_voice *voice = register_cmu_us_kal(NULL);
+
+    cst_wave *wav = flite_text_to_wave(text.toStdString().c_str(), voice);
+    if (!wav)
+    {
+        QLOG_WARN() << "Speech synthesis failed for" << text;
+        return QSharedPointer<const AlsaPcmBuffer>();
+    }
+
+    QSharedPointer<AlsaPcmBuffer> pcm(new AlsaPcmBuffer);
+    pcm->channels = cst_wave_num_channels(wav);
+    pcm->sampleRate = cst_wave_sample_rate(wav);
+    const int count = cst_wave_num_samples(wav) * pcm->channels;
+    const short *samples = cst_wave_samples(wav);
+    pcm->samples.resize(count);
+    for (int i = 0; i < count; i++)
+    {
+        pcm->samples[i] = samples[i] / 32768.0f;
+    }
+    delete_wave(wav);
+    return pcm;
+#else
+    Q_UNUSED(text);
+    return QSharedPointer<const AlsaPcmBuffer>();
+#endif
+}
@@ -0,0 +1,83 @@
+/*=====================================================================
+
+QGroundControl Open Source Ground Control Station
+
+(c) 2009, 2010 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+This file is part of the QGROUNDCONTROL project
+
+    QGROUNDCONTROL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    QGROUNDCONTROL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Speech synthesis thread feeding AlsaAudio
+ *
+ *   Text is synthesized with flite off the GUI thread. Critical phrases are
+ *   synthesized before queued chatter, and the synthesized audio of recent
+ *   phrases (mode names, armed/disarmed, ...) is kept in memory, so repeating
+ *   them goes straight to AlsaAudio without synthesizing again.
+ *
+ */
+
+#ifndef SPEECHSYNTHESIZER_H
+#define SPEECHSYNTHESIZER_H
+
+#include <QCache>
+#include <QMutex>
+#include <QQueue>
+#include <QThread>
+#include <QWaitCondition>
+#include "AlsaAudio.h"
+
+class SpeechSynthesizer : public QThread
+{
+public:
+    explicit SpeechSynthesizer(AlsaAudio *audio, QObject *parent = NULL);
+
+    /** @brief Queue text to be spoken, critical text is spoken before any queued chatter */
+    void say(const QString &text, bool critical);
+
+    /** @brief Stop the thread after the current phrase, wait() for it afterwards */
+    void stop();
+
+protected:
+    void run();
+
+private:
+    static const int s_cacheSizeKb = 8 * 1024;  ///< About two minutes of 16 kHz speech
+    static const int s_maxQueuedChatter = 8;    ///< Older chatter is outdated and dropped
+
+    class Request
+    {
+    public:
+        QString text;
+        bool critical;
+    };
+
+    /** @brief Hands cached audio to AlsaAudio, false if text is not cached. Call with m_mutex locked */
+    bool playCached(const QString &text, bool critical);
+    QSharedPointer<const AlsaPcmBuffer> synthesize(const QString &text);
+
+    AlsaAudio *m_audio;
+    QMutex m_mutex;
+    QWaitCondition m_condition;
+    QQueue<Request> m_criticalQueue;
+    QQueue<Request> m_chatterQueue;
+    QCache<QString, QSharedPointer<const AlsaPcmBuffer> > m_cache;   ///< Least recently used phrases are evicted first
+    bool m_stop;
+};
+
+#endif // SPEECHSYNTHESIZER_H
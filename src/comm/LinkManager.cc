@@ -601,6 +601,19 @@ UASInterface* LinkManager::createUAS(MAVLinkProtocol* mavlink, LinkInterface* li
     return uas;
 }
 
+void LinkManager::removeUAS(int sysid)
+{
+    UASInterface *uas = m_uasMap.take(sysid);
+    UASObject *obj = m_uasObjectMap.take(sysid);
+    if (uas)
+    {
+        // Removed explicitly, the destroyed() signal comes too late for the qobject_cast
+        UASManager::instance()->removeUAS(uas);
+        delete uas;
+    }
+    delete obj;
+}
+
 UASObject *LinkManager::getUasObject(int uasid)
 {
     if (m_uasObjectMap.contains(uasid))
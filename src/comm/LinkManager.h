@@ -72,6 +72,8 @@ public:
 
     UASInterface* getUas(int id);
     UASInterface* createUAS(MAVLinkProtocol* mavlink, LinkInterface* link, int sysid, mavlink_heartbeat_t* heartbeat, QObject* parent = nullptr);
+    // Unregisters and deletes the UAS and UASObject created by createUAS()
+    void removeUAS(int sysid);
 
     void addLink(LinkInterface *link);
     QList<int> getLinks() const;
@@ -37,6 +37,7 @@ This file is part of the APM_PLANNER project
 #include "LinkManager.h"
 #include "UASManager.h"
 #include "UASInterface.h"
+#include "MAVLinkValueBus.h"
 
 #include <QDataStream>
 
@@ -339,6 +340,7 @@ void MAVLinkDecoder::emitFieldValue(mavlink_message_t* msg, int fieldid, quint64
             else
             {
                 mp_uas->valueChangedRec(msg->sysid, name, unit, b, time);
+                publishValue(msg, fieldid, -1, name, b, true);
             }
         }
         break;
@@ -356,6 +358,7 @@ void MAVLinkDecoder::emitFieldValue(mavlink_message_t* msg, int fieldid, quint64
                 else
                 {
                     mp_uas->valueChangedRec(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
+                    publishValue(msg, fieldid, j, name, nums[j], true);
                 }
             }
         }
@@ -371,6 +374,7 @@ void MAVLinkDecoder::emitFieldValue(mavlink_message_t* msg, int fieldid, quint64
             else
             {
                 mp_uas->valueChangedRec(msg->sysid, name, fieldType, u, time);
+                publishValue(msg, fieldid, -1, name, u, true);
             }
         }
         break;
@@ -388,6 +392,7 @@ void MAVLinkDecoder::emitFieldValue(mavlink_message_t* msg, int fieldid, quint64
                 else
                 {
                     mp_uas->valueChangedRec(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
+                    publishValue(msg, fieldid, j, name, nums[j], true);
                 }
             }
         }
@@ -403,6 +408,7 @@ void MAVLinkDecoder::emitFieldValue(mavlink_message_t* msg, int fieldid, quint64
             else
             {
                 mp_uas->valueChangedRec(msg->sysid, name, fieldType, n, time);
+                publishValue(msg, fieldid, -1, name, n, true);
             }
         }
         break;
@@ -420,6 +426,7 @@ void MAVLinkDecoder::emitFieldValue(mavlink_message_t* msg, int fieldid, quint64
                 else
                 {
                     mp_uas->valueChangedRec(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
+                    publishValue(msg, fieldid, j, name, nums[j], true);
                 }
             }
         }
@@ -435,6 +442,7 @@ void MAVLinkDecoder::emitFieldValue(mavlink_message_t* msg, int fieldid, quint64
             else
             {
                 mp_uas->valueChangedRec(msg->sysid, name, fieldType, n, time);
+                publishValue(msg, fieldid, -1, name, n, true);
             }
         }
         break;
@@ -452,6 +460,7 @@ void MAVLinkDecoder::emitFieldValue(mavlink_message_t* msg, int fieldid, quint64
                 else
                 {
                     mp_uas->valueChangedRec(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
+                    publishValue(msg, fieldid, j, name, nums[j], true);
                 }
             }
         }
@@ -467,6 +476,7 @@ void MAVLinkDecoder::emitFieldValue(mavlink_message_t* msg, int fieldid, quint64
             else
             {
                 mp_uas->valueChangedRec(msg->sysid, name, fieldType, n, time);
+                publishValue(msg, fieldid, -1, name, n, true);
             }
         }
         break;
@@ -484,6 +494,7 @@ void MAVLinkDecoder::emitFieldValue(mavlink_message_t* msg, int fieldid, quint64
                 else
                 {
                     mp_uas->valueChangedRec(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
+                    publishValue(msg, fieldid, j, name, nums[j], true);
                 }
             }
         }
@@ -499,6 +510,7 @@ void MAVLinkDecoder::emitFieldValue(mavlink_message_t* msg, int fieldid, quint64
             else
             {
                 mp_uas->valueChangedRec(msg->sysid, name, fieldType, n, time);
+                publishValue(msg, fieldid, -1, name, n, true);
             }
         }
         break;
@@ -516,6 +528,7 @@ void MAVLinkDecoder::emitFieldValue(mavlink_message_t* msg, int fieldid, quint64
                 else
                 {
                     mp_uas->valueChangedRec(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
+                    publishValue(msg, fieldid, j, name, nums[j], true);
                 }
             }
         }
@@ -531,6 +544,7 @@ void MAVLinkDecoder::emitFieldValue(mavlink_message_t* msg, int fieldid, quint64
             else
             {
                 mp_uas->valueChangedRec(msg->sysid, name, fieldType, n, time);
+                publishValue(msg, fieldid, -1, name, n, true);
             }
         }
         break;
@@ -548,6 +562,7 @@ void MAVLinkDecoder::emitFieldValue(mavlink_message_t* msg, int fieldid, quint64
                 else
                 {
                     mp_uas->valueChangedRec(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
+                    publishValue(msg, fieldid, j, name, nums[j], false);
                 }
             }
         }
@@ -563,6 +578,7 @@ void MAVLinkDecoder::emitFieldValue(mavlink_message_t* msg, int fieldid, quint64
             else
             {
                 mp_uas->valueChangedRec(msg->sysid, name, fieldType, f, time);
+                publishValue(msg, fieldid, -1, name, f, false);
             }
         }
         break;
@@ -580,6 +596,7 @@ void MAVLinkDecoder::emitFieldValue(mavlink_message_t* msg, int fieldid, quint64
                 else
                 {
                     mp_uas->valueChangedRec(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
+                    publishValue(msg, fieldid, j, name, nums[j], false);
                 }
             }
         }
@@ -595,6 +612,7 @@ void MAVLinkDecoder::emitFieldValue(mavlink_message_t* msg, int fieldid, quint64
             else
             {
                 mp_uas->valueChangedRec(msg->sysid, name, fieldType, f, time);
+                publishValue(msg, fieldid, -1, name, f, false);
             }
         }
         break;
@@ -612,6 +630,7 @@ void MAVLinkDecoder::emitFieldValue(mavlink_message_t* msg, int fieldid, quint64
                 else
                 {
                     mp_uas->valueChangedRec(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, static_cast<quint64>(nums[j]), time);
+                    publishValue(msg, fieldid, j, name, static_cast<double>(nums[j]), true);
                 }
             }
         }
@@ -627,6 +646,7 @@ void MAVLinkDecoder::emitFieldValue(mavlink_message_t* msg, int fieldid, quint64
             else
             {
                 mp_uas->valueChangedRec(msg->sysid, name, fieldType, static_cast<quint64>(n), time);
+                publishValue(msg, fieldid, -1, name, static_cast<double>(n), true);
             }
         }
         break;
@@ -644,6 +664,7 @@ void MAVLinkDecoder::emitFieldValue(mavlink_message_t* msg, int fieldid, quint64
                 else
                 {
                     mp_uas->valueChangedRec(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, static_cast<quint64>(nums[j]), time);
+                    publishValue(msg, fieldid, j, name, static_cast<double>(nums[j]), true);
                 }
             }
         }
@@ -659,6 +680,7 @@ void MAVLinkDecoder::emitFieldValue(mavlink_message_t* msg, int fieldid, quint64
             else
             {
                 mp_uas->valueChangedRec(msg->sysid, name, fieldType, static_cast<quint64>(n), time);
+                publishValue(msg, fieldid, -1, name, static_cast<double>(n), true);
             }
         }
         break;
@@ -666,6 +688,43 @@ void MAVLinkDecoder::emitFieldValue(mavlink_message_t* msg, int fieldid, quint64
         QLOG_DEBUG() << "WARNING: UNKNOWN MAVLINK TYPE";
     }
 }
+void MAVLinkDecoder::publishValue(const mavlink_message_t *msg, int fieldid, int element, const QString &name, double value, bool integer)
+{
+    MAVLinkValueBus *bus = MAVLinkValueBus::instance();
+
+    // These are named by their content, so the field does not identify the series
+    const bool namedByContent = msg->msgid == MAVLINK_MSG_ID_DEBUG_VECT || msg->msgid == MAVLINK_MSG_ID_DEBUG
+            || msg->msgid == MAVLINK_MSG_ID_NAMED_VALUE_FLOAT || msg->msgid == MAVLINK_MSG_ID_NAMED_VALUE_INT;
+    const bool componentMulti = m_componentMulti.value(msg->msgid, false);
+    const quint64 key = (static_cast<quint64>(msg->sysid) << 56)
+            | (static_cast<quint64>(componentMulti ? msg->compid : 0) << 48)
+            | (static_cast<quint64>(componentMulti) << 47)
+            | (static_cast<quint64>(msg->msgid & 0xFFFFFF) << 16)
+            | (static_cast<quint64>(fieldid & 0xFF) << 8)
+            | static_cast<quint64>((element + 1) & 0xFF);
+
+    int series = -1;
+    if (!namedByContent)
+    {
+        series = m_valueSeries.value(key, -1);
+    }
+    if (series < 0)
+    {
+        // Series names drop the "M<sysid>:" prefix, every sample carries its system
+        QString seriesName = name.mid(name.indexOf(':') + 1);
+        if (element >= 0)
+        {
+            seriesName += '.' + QString::number(element);
+        }
+        series = bus->registerSeries(seriesName);
+        if (!namedByContent)
+        {
+            m_valueSeries.insert(key, series);
+        }
+    }
+    bus->publish(msg->sysid, series, value, integer);
+}
+
 quint64 MAVLinkDecoder::getUnixTimeFromMs(int systemID, quint64 time)
 {
     quint64 ret = 0;
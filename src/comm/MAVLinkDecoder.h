@@ -73,6 +73,8 @@ public slots:
     void emitFieldValue(mavlink_message_t* msg, int fieldid, quint64 time);
 
 private:
+    /** @brief Queue a value for the live plot, element is the array index or -1 */
+    void publishValue(const mavlink_message_t *msg, int fieldid, int element, const QString &name, double value, bool integer);
 
     QHash<int,int> m_componentID;
     QHash<int,bool> m_componentMulti;
@@ -82,6 +84,8 @@ private:
     QHash<quint32, mavlink_message_info_t> messageInfo;
     QHash<QString, quint32> m_messageNameToID;
 
+    QHash<quint64, int> m_valueSeries;  ///< MAVLinkValueBus series per sysid/compid/msgid/field/element
+
     QMap<int,quint64> onboardTimeOffset;
     QMap<int,quint64> firstOnboardTime;
     QMap<int,quint64> onboardToGCSUnixTimeOffsetAndDelay;
@@ -0,0 +1,173 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2014 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+#include "MAVLinkMessageSlotTable.h"
+
+#include <QThread>
+#include <atomic>
+#include <cstring>
+
+const int MAVLinkMessageSlotTable::Capacity;
+const int MAVLinkMessageSlotTable::HashSize;
+const int MAVLinkMessageSlotTable::SlotPending;
+const int MAVLinkMessageSlotTable::SlotOverflow;
+
+MAVLinkMessageSlotTable::MAVLinkMessageSlotTable() :
+    m_used(0)
+{
+    for (int i = 0; i < HashSize; ++i)
+    {
+        m_hashKeys[i].storeRelease(0);
+        m_hashSlots[i].storeRelease(SlotPending);
+    }
+    for (int i = 0; i < Capacity; ++i)
+    {
+        m_slots[i].sequence.storeRelease(0);
+        m_slots[i].count.storeRelease(0);
+        m_slots[i].key.storeRelease(0);
+        memset(&m_slots[i].message, 0, sizeof(mavlink_message_t));
+    }
+}
+
+quint64 MAVLinkMessageSlotTable::makeKey(const mavlink_message_t &message)
+{
+    // msgid is 24 bits wide in MAVLink 2
+    return (static_cast<quint64>(message.sysid) << 32)
+            | (static_cast<quint64>(message.compid) << 24)
+            | (message.msgid & 0xFFFFFF);
+}
+
+int MAVLinkMessageSlotTable::findOrInsert(quint64 key)
+{
+    const quint64 stored = key + 1;
+    int bucket = static_cast<int>(((key * Q_UINT64_C(0x9E3779B97F4A7C15)) >> 40) % HashSize);
+
+    for (int probe = 0; probe < HashSize; ++probe)
+    {
+        const quint64 current = m_hashKeys[bucket].loadAcquire();
+        if (current == stored)
+        {
+            // Another writer may just be allocating the slot for this bucket
+            int slot = m_hashSlots[bucket].loadAcquire();
+            while (slot == SlotPending)
+            {
+                QThread::yieldCurrentThread();
+                slot = m_hashSlots[bucket].loadAcquire();
+            }
+            return slot;
+        }
+        if (current == 0 && m_hashKeys[bucket].testAndSetOrdered(0, stored))
+        {
+            const int slot = m_used.fetchAndAddOrdered(1);
+            if (slot >= Capacity)
+            {
+                m_used.fetchAndAddOrdered(-1);
+                m_hashSlots[bucket].storeRelease(SlotOverflow);
+                return SlotOverflow;
+            }
+            m_slots[slot].key.storeRelease(stored);
+            m_hashSlots[bucket].storeRelease(slot);
+            return slot;
+        }
+        if (current == 0)
+        {
+            // Lost the race for this bucket, it may hold our key now
+            continue;
+        }
+        bucket = (bucket + 1) % HashSize;
+    }
+    return SlotOverflow;
+}
+
+void MAVLinkMessageSlotTable::update(const mavlink_message_t &message)
+{
+    const int slotIndex = findOrInsert(makeKey(message));
+    if (slotIndex < 0)
+    {
+        return;
+    }
+    Slot &slot = m_slots[slotIndex];
+
+    // Seqlock write: make the sequence odd, copy, make it even again.
+    // Concurrent writers to the same slot serialize on the odd state.
+    quint32 sequence = slot.sequence.loadAcquire();
+    while ((sequence & 1) || !slot.sequence.testAndSetAcquire(sequence, sequence + 1))
+    {
+        sequence = slot.sequence.loadAcquire();
+    }
+    memcpy(&slot.message, &message, sizeof(mavlink_message_t));
+    slot.sequence.storeRelease(sequence + 2);
+    slot.count.fetchAndAddRelease(1);
+}
+
+int MAVLinkMessageSlotTable::size() const
+{
+    return qMin(m_used.loadAcquire(), Capacity);
+}
+
+quint64 MAVLinkMessageSlotTable::count(int slot) const
+{
+    if (slot < 0 || slot >= Capacity)
+    {
+        return 0;
+    }
+    return m_slots[slot].count.loadAcquire();
+}
+
+int MAVLinkMessageSlotTable::systemId(int slot) const
+{
+    return static_cast<int>(((m_slots[slot].key.loadAcquire() - 1) >> 32) & 0xFF);
+}
+
+int MAVLinkMessageSlotTable::componentId(int slot) const
+{
+    return static_cast<int>(((m_slots[slot].key.loadAcquire() - 1) >> 24) & 0xFF);
+}
+
+quint32 MAVLinkMessageSlotTable::messageId(int slot) const
+{
+    return static_cast<quint32>((m_slots[slot].key.loadAcquire() - 1) & 0xFFFFFF);
+}
+
+bool MAVLinkMessageSlotTable::read(int slot, mavlink_message_t &message) const
+{
+    if (count(slot) == 0)
+    {
+        return false;
+    }
+    const Slot &source = m_slots[slot];
+    forever
+    {
+        const quint32 before = source.sequence.loadAcquire();
+        if (before & 1)
+        {
+            continue;
+        }
+        memcpy(&message, &source.message, sizeof(mavlink_message_t));
+        // Keep the copy from being reordered past the second sequence load
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (source.sequence.loadAcquire() == before)
+        {
+            return true;
+        }
+    }
+}
@@ -0,0 +1,92 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2014 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief MAVLinkMessageSlotTable
+ *          Holds the latest message and a receive counter for every
+ *          (sysid, compid, msgid) triple seen. Writers update it without
+ *          locks from the protocol thread, readers (GUI) poll it.
+ */
+
+#ifndef MAVLINKMESSAGESLOTTABLE_H
+#define MAVLINKMESSAGESLOTTABLE_H
+
+#include <mavlink.h>
+
+#include <QAtomicInteger>
+
+class MAVLinkMessageSlotTable
+{
+public:
+    static const int Capacity = 2048;   ///< Maximum number of distinct (sysid, compid, msgid) triples
+
+    MAVLinkMessageSlotTable();
+
+    /**
+     * @brief update - Stores message as the latest one of its slot and counts it.
+     *        Lock free, may be called from any thread.
+     */
+    void update(const mavlink_message_t &message);
+
+    /**
+     * @brief size - Number of slots in use. Slots are never released, so a
+     *        slot index stays valid for the lifetime of the table.
+     */
+    int size() const;
+
+    /** @brief Number of messages stored into slot so far, 0 if the slot is not ready yet */
+    quint64 count(int slot) const;
+
+    int systemId(int slot) const;
+    int componentId(int slot) const;
+    quint32 messageId(int slot) const;
+
+    /**
+     * @brief read - Copies the latest message of slot
+     * @return false if the slot holds no message yet
+     */
+    bool read(int slot, mavlink_message_t &message) const;
+
+private:
+    static const int HashSize = Capacity * 2;
+    static const int SlotPending = -1;
+    static const int SlotOverflow = -2;
+
+    struct Slot
+    {
+        QAtomicInteger<quint32> sequence;   ///< Seqlock, odd while a writer updates message
+        QAtomicInteger<quint64> count;
+        QAtomicInteger<quint64> key;
+        mavlink_message_t message;
+    };
+
+    static quint64 makeKey(const mavlink_message_t &message);
+    int findOrInsert(quint64 key);
+
+    QAtomicInteger<quint64> m_hashKeys[HashSize];   ///< key + 1, 0 marks an empty bucket
+    QAtomicInt m_hashSlots[HashSize];
+    QAtomicInt m_used;
+    Slot m_slots[Capacity];
+};
+
+#endif // MAVLINKMESSAGESLOTTABLE_H
@@ -39,10 +39,21 @@ This file is part of the APM_PLANNER project
 
 #include <cstring>
 #include <QDataStream>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QtAlgorithms>
+
+const int MAVLinkProtocol::MaxLinks;
+const int MAVLinkProtocol::LatencyBuckets;
 
 MAVLinkProtocol::MAVLinkProtocol()
 {
     m_systemID = QGC::MavlinkID();
+    memset(m_lastSequence, 0, sizeof(m_lastSequence));
+    for (int i = 0; i < MaxLinks; ++i)
+    {
+        resetCounters(m_linkCounters[i]);
+    }
 }
 
 MAVLinkProtocol::~MAVLinkProtocol()
@@ -67,12 +78,28 @@ void MAVLinkProtocol::receiveBytes(LinkInterface* link, const QByteArray &dataBy
     memset(&message, 0, sizeof(mavlink_message_t));
     mavlink_status_t status;
 
+    LinkCounters &counters = m_linkCounters[slotForLink(link->getId())];
+    counters.rxBytes.fetchAndAddRelaxed(static_cast<quint64>(dataBytes.size()));
+    QElapsedTimer frameTimer;
+    frameTimer.start();
+
     //QLOG_DEBUG() << "MAVLinkProtocol received size:" << dataBytes.size() << " " << dataBytes.at(0);
 
     for(const auto &data : dataBytes)
     {
         unsigned int decodeState = mavlink_parse_char(MAVLINK_COMM_0, static_cast<quint8>(data), &message, &status);
 
+        // packet_rx_drop_count holds the framing errors of this byte only. A bad
+        // CRC or signature is added to the channel status after that copy was
+        // made, take it from there so it is neither lost nor counted twice.
+        mavlink_status_t* channelStatus = mavlink_get_channel_status(MAVLINK_COMM_0);
+        const quint64 parseErrors = status.packet_rx_drop_count + channelStatus->parse_error;
+        channelStatus->parse_error = 0;
+        if (parseErrors > 0)
+        {
+            counters.crcErrors.fetchAndAddRelaxed(parseErrors);
+        }
+
         if (decodeState == 0 && !decodedFirstPacket)
         {
             nonmavlinkCount++;
@@ -116,6 +143,7 @@ void MAVLinkProtocol::receiveBytes(LinkInterface* link, const QByteArray &dataBy
                     // Write message into buffer, prepending start sign
                     int len = mavlink_msg_to_send_buffer(sendbuffer, &commandMessage);
                     link->writeBytes(reinterpret_cast<const char*>(sendbuffer), len);
+                    counters.txBytes.fetchAndAddRelaxed(static_cast<quint64>(len));
 
                     // also request the message using MAV_CMD_REQUEST_MESSAGE
                     command.command = MAV_CMD_REQUEST_MESSAGE;
@@ -125,6 +153,7 @@ void MAVLinkProtocol::receiveBytes(LinkInterface* link, const QByteArray &dataBy
                     // Write message into buffer, prepending start sign
                     len = mavlink_msg_to_send_buffer(sendbuffer, &commandMessage);
                     link->writeBytes(reinterpret_cast<const char*>(sendbuffer), len);
+                    counters.txBytes.fetchAndAddRelaxed(static_cast<quint64>(len));
                 }
                 else
                 {
@@ -247,13 +276,19 @@ void MAVLinkProtocol::receiveBytes(LinkInterface* link, const QByteArray &dataBy
 
             if (m_isOnline)
             {
-                 handleMessage(link, message);
+                 handleMessage(link, message, counters);
             }
+
+            // Time spent on this frame since the previous one was done
+            const qint64 nsecs = frameTimer.nsecsElapsed();
+            frameTimer.start();
+            const int bucket = nsecs > 0 ? qMin(63 - qCountLeadingZeroBits(static_cast<quint64>(nsecs)), LatencyBuckets - 1) : 0;
+            counters.latencyBuckets[bucket].fetchAndAddRelaxed(1);
         }
     }
 }
 
-void MAVLinkProtocol::handleMessage(LinkInterface *link, const mavlink_message_t &message)
+void MAVLinkProtocol::handleMessage(LinkInterface *link, const mavlink_message_t &message, LinkCounters &counters)
 {
     // ORDER MATTERS HERE!
     // If the matching UAS object does not yet exist, it has to be created
@@ -317,72 +352,48 @@ void MAVLinkProtocol::handleMessage(LinkInterface *link, const mavlink_message_t
     if (uas != nullptr)
     {
         // Increase receive counter
-        quint8 linkId = static_cast<quint8>(link->getId());
-        quint64 currentTotalReceiveCounter = 0;
-        {   // scope for lock
-            QMutexLocker lock(&totalCounterMutex);
-            totalReceiveCounter[linkId]++;
-            currentTotalReceiveCounter = totalReceiveCounter.value(linkId);
-        }
-
-        currReceiveCounter[linkId]++;
+        const quint64 currentTotalReceiveCounter = counters.rxFrames.fetchAndAddRelaxed(1) + 1;
+        counters.currReceiveCounter++;
 
         // Update last message sequence ID
-        quint8 expectedSequence = 0;
-        if (lastIndex.contains(message.sysid))
+        quint16 &lastSequence = m_lastSequence[(message.sysid << 8) | message.compid];
+        if (lastSequence & 0x100)
         {
-            if (lastIndex.value(message.sysid).contains(message.compid))
-            {
-                //Sequence is uint8 type -> next value after 255 is 0. We do expect the overrun here!
-                expectedSequence = lastIndex[message.sysid][message.compid] + 1;
-            }
-            else
-            {
-                lastIndex[message.sysid].insert(message.compid, message.seq);
-                expectedSequence = message.seq;
-            }
-        }
-        else
-        {
-            lastIndex.insert(message.sysid,QMap<int, quint8>());
-            lastIndex[message.sysid].insert(message.compid, message.seq);
-            expectedSequence = message.seq;
-        }
+            //Sequence is uint8 type -> next value after 255 is 0. We do expect the overrun here!
+            const quint8 expectedSequence = static_cast<quint8>((lastSequence & 0xFF) + 1);
 
-        // Make some noise if a message was skipped
-        //QLOG_DEBUG() << "SYSID" << message.sysid << "COMPID" << message.compid << "MSGID" << message.msgid << "EXPECTED SEQ:" << expectedSequence << "SEQ" << message.seq;
-        if (message.seq != expectedSequence)
-        {
-            // Determine how many messages were skipped accounting for 0-wraparound
-            int16_t lostMessages = message.seq - expectedSequence;
-            if (lostMessages < 0)
+            // Make some noise if a message was skipped
+            //QLOG_DEBUG() << "SYSID" << message.sysid << "COMPID" << message.compid << "MSGID" << message.msgid << "EXPECTED SEQ:" << expectedSequence << "SEQ" << message.seq;
+            if (message.seq != expectedSequence)
             {
-                // Usually, this happens in the case of an out-of order packet
-                lostMessages = 0;
-            }
-            else
-            {
-                // TODO Console generates excessive load at high loss rates, needs better GUI visualization
-                //QLOG_DEBUG() << QString("Lost %1 messages for comp %4: expected sequence ID %2 but received %3.").arg(lostMessages).arg(expectedSequence).arg(message.seq).arg(message.compid);
-            }
-            {   // Scope for lock
-                QMutexLocker lock(&totalCounterMutex);
-                totalLossCounter[linkId] += static_cast<quint64>(lostMessages);
+                // Determine how many messages were skipped accounting for 0-wraparound
+                int16_t lostMessages = message.seq - expectedSequence;
+                if (lostMessages < 0)
+                {
+                    // Usually, this happens in the case of an out-of order packet
+                    lostMessages = 0;
+                }
+                else
+                {
+                    // TODO Console generates excessive load at high loss rates, needs better GUI visualization
+                    //QLOG_DEBUG() << QString("Lost %1 messages for comp %4: expected sequence ID %2 but received %3.").arg(lostMessages).arg(expectedSequence).arg(message.seq).arg(message.compid);
+                }
+                counters.sequenceGaps.fetchAndAddRelaxed(static_cast<quint64>(lostMessages));
+                counters.currLossCounter += static_cast<quint64>(lostMessages);
             }
-            currLossCounter[linkId]  += static_cast<quint64>(lostMessages);
         }
 
         // Update the last sequence ID
-        lastIndex[message.sysid][message.compid] = message.seq;
+        lastSequence = 0x100 | message.seq;
 
         // Update on every 32th packet
         if (currentTotalReceiveCounter % 32 == 0)
         {
             // Calculate new receive loss ratio
-            double receiveLoss = static_cast<double>(currLossCounter[linkId]) / static_cast<double>(currReceiveCounter[linkId]+currLossCounter[linkId]);
+            double receiveLoss = static_cast<double>(counters.currLossCounter) / static_cast<double>(counters.currReceiveCounter + counters.currLossCounter);
             receiveLoss *= 100.0;
-            currLossCounter[linkId] = 0;
-            currReceiveCounter[linkId] = 0;
+            counters.currLossCounter = 0;
+            counters.currReceiveCounter = 0;
             emit receiveLossChanged(message.sysid, static_cast<float>(receiveLoss));
         }
 
@@ -432,37 +443,164 @@ bool MAVLinkProtocol::startLogging(const QString& filename)
 quint64 MAVLinkProtocol::getTotalMessagesReceived(int mavLinkID) const
 {
     quint64 result = 0;
-    QMutexLocker lock(&totalCounterMutex);
+    for (int i = 0; i < MaxLinks; ++i)
+    {
+        const int linkId = m_linkSlotIds[i].loadAcquire();
+        if (linkId > 0 && (mavLinkID == 0 || linkId == mavLinkID))  // ID = 0 means all devices
+        {
+            result += m_linkCounters[i].rxFrames.loadAcquire();
+        }
+    }
+    return result;
+}
 
-    if(mavLinkID == 0)  // ID = 0 means all devices
+quint64 MAVLinkProtocol::getTotalMessagesLost(int mavLinkID) const
+{
+    quint64 result = 0;
+    for (int i = 0; i < MaxLinks; ++i)
     {
-        for (quint64 count : qAsConst(totalReceiveCounter))
+        const int linkId = m_linkSlotIds[i].loadAcquire();
+        if (linkId > 0 && (mavLinkID == 0 || linkId == mavLinkID))  // ID = 0 means all devices
         {
-            result += count; // create sum of all devices
+            result += m_linkCounters[i].sequenceGaps.loadAcquire();
         }
     }
-    if(totalReceiveCounter.contains(mavLinkID))
+    return result;
+}
+
+LinkStatistics MAVLinkProtocol::getLinkStatistics(int linkId) const
+{
+    const int slot = findSlotForLink(linkId);
+    if (slot < 0)
+    {
+        LinkStatistics empty;
+        empty.linkId = linkId;
+        return empty;
+    }
+    return makeSnapshot(linkId, m_linkCounters[slot]);
+}
+
+QList<LinkStatistics> MAVLinkProtocol::getLinkStatistics() const
+{
+    QList<LinkStatistics> result;
+    for (int i = 0; i < MaxLinks; ++i)
     {
-        result = totalReceiveCounter[mavLinkID];
+        const int linkId = m_linkSlotIds[i].loadAcquire();
+        if (linkId > 0)
+        {
+            result.append(makeSnapshot(linkId, m_linkCounters[i]));
+        }
     }
     return result;
 }
 
-quint64 MAVLinkProtocol::getTotalMessagesLost(int mavLinkID) const
+void MAVLinkProtocol::recordTransmit(LinkInterface *link, qint64 bytes)
 {
-    quint64 result = 0;
-    QMutexLocker lock(&totalCounterMutex);
+    if (link && bytes > 0)
+    {
+        m_linkCounters[slotForLink(link->getId())].txBytes.fetchAndAddRelaxed(static_cast<quint64>(bytes));
+    }
+}
 
-    if(mavLinkID == 0)  // ID = 0 means all devices
+int MAVLinkProtocol::findSlotForLink(int linkId) const
+{
+    for (int i = 0; i < MaxLinks; ++i)
     {
-        for (quint64 count : qAsConst(totalLossCounter))
+        if (m_linkSlotIds[i].loadAcquire() == linkId)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int MAVLinkProtocol::slotForLink(int linkId)
+{
+    forever
+    {
+        const int slot = findSlotForLink(linkId);
+        if (slot >= 0)
+        {
+            return slot;
+        }
+        for (int i = 0; i < MaxLinks; ++i)
+        {
+            if (m_linkSlotIds[i].testAndSetOrdered(0, linkId))
+            {
+                return i;
+            }
+            if (m_linkSlotIds[i].loadAcquire() == linkId)
+            {
+                // Claimed concurrently by the transmit side
+                return i;
+            }
+        }
+
+        // All slots taken by links created earlier in this session, recycle one.
+        // The slot is marked busy while its counters are reset, so neither the
+        // old link nor another thread recycling it can touch them meanwhile.
+        const int recycled = linkId % MaxLinks;
+        const int previous = m_linkSlotIds[recycled].loadAcquire();
+        if (previous > 0 && m_linkSlotIds[recycled].testAndSetOrdered(previous, RecyclingSlot))
         {
-            result += count; // create sum of all devices
+            resetCounters(m_linkCounters[recycled]);
+            m_linkSlotIds[recycled].storeRelease(linkId);
+            return recycled;
         }
+        // Recycled by another thread, possibly for this link, look again
+        QThread::yieldCurrentThread();
     }
-    if(totalLossCounter.contains(mavLinkID))
+}
+
+void MAVLinkProtocol::resetCounters(LinkCounters &counters)
+{
+    counters.rxBytes.storeRelease(0);
+    counters.txBytes.storeRelease(0);
+    counters.rxFrames.storeRelease(0);
+    counters.crcErrors.storeRelease(0);
+    counters.sequenceGaps.storeRelease(0);
+    for (int i = 0; i < LatencyBuckets; ++i)
     {
-        result = totalLossCounter[mavLinkID];
+        counters.latencyBuckets[i].storeRelease(0);
     }
-    return result;
+    counters.currReceiveCounter = 0;
+    counters.currLossCounter = 0;
+}
+
+LinkStatistics MAVLinkProtocol::makeSnapshot(int linkId, const LinkCounters &counters)
+{
+    LinkStatistics stats;
+    stats.linkId = linkId;
+    stats.rxBytes = counters.rxBytes.loadAcquire();
+    stats.txBytes = counters.txBytes.loadAcquire();
+    stats.rxFrames = counters.rxFrames.loadAcquire();
+    stats.crcErrors = counters.crcErrors.loadAcquire();
+    stats.sequenceGaps = counters.sequenceGaps.loadAcquire();
+
+    quint64 buckets[LatencyBuckets];
+    quint64 total = 0;
+    for (int i = 0; i < LatencyBuckets; ++i)
+    {
+        buckets[i] = counters.latencyBuckets[i].loadAcquire();
+        total += buckets[i];
+    }
+
+    // Percentiles are reported as the upper bound of the log2 bucket they fall in
+    qint64 *percentiles[] = { &stats.parseLatencyP50, &stats.parseLatencyP90, &stats.parseLatencyP99 };
+    const double fractions[] = { 0.5, 0.9, 0.99 };
+    for (int p = 0; p < 3; ++p)
+    {
+        const quint64 target = static_cast<quint64>(total * fractions[p]);
+        quint64 seen = 0;
+        for (int i = 0; i < LatencyBuckets && total > 0; ++i)
+        {
+            seen += buckets[i];
+            if (seen > target)
+            {
+                *percentiles[p] = Q_INT64_C(1) << (i + 1);
+                break;
+            }
+        }
+    }
+    return stats;
 }
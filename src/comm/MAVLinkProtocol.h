@@ -45,7 +45,24 @@ This file is part of the APM_PLANNER project
 
 #include <QFile>
 #include <QByteArray>
-#include <QMap>
+#include <QAtomicInteger>
+#include <QList>
+
+/**
+ * @brief Snapshot of the receive / transmit statistics of one link
+ */
+struct LinkStatistics
+{
+    int linkId = 0;
+    quint64 rxBytes = 0;
+    quint64 txBytes = 0;
+    quint64 rxFrames = 0;        ///< Successfully decoded frames
+    quint64 crcErrors = 0;       ///< Frames dropped by the parser (bad CRC, signature or framing)
+    quint64 sequenceGaps = 0;    ///< Messages missing according to the sequence numbers
+    qint64 parseLatencyP50 = 0;  ///< Parse and dispatch time per frame in nsecs, 50th percentile
+    qint64 parseLatencyP90 = 0;
+    qint64 parseLatencyP99 = 0;
+};
 
 class LinkManager;
 class MAVLinkProtocol : public QObject
@@ -76,11 +93,31 @@ public:
      */
     quint64 getTotalMessagesLost(int mavLinkID) const;
 
+    /*!
+     * \brief getLinkStatistics - Get a snapshot of the statistics of one link.
+     *        Lock free, can be polled from any thread.
+     * \param linkId - ID of the link
+     * \return - Statistics, all zero if nothing was received on the link
+     */
+    LinkStatistics getLinkStatistics(int linkId) const;
+    /*!
+     * \brief getLinkStatistics - Get a snapshot of the statistics of all links seen so far
+     */
+    QList<LinkStatistics> getLinkStatistics() const;
+    /*!
+     * \brief recordTransmit - Account bytes sent on a link
+     */
+    void recordTransmit(LinkInterface *link, qint64 bytes);
+
+    static const int MaxLinks = 32;
+    static const int LatencyBuckets = 32;
+
 public slots:
     void receiveBytes(LinkInterface* link, const QByteArray &dataBytes);
 
 private:
-    void handleMessage(LinkInterface *link, const mavlink_message_t &message);
+    struct LinkCounters;
+    void handleMessage(LinkInterface *link, const mavlink_message_t &message, LinkCounters &counters);
 
     quint8 m_systemID    = QGC::defaultMavlinkSystemId;
     quint8 m_componentID = QGC::defaultComponentId;
@@ -94,12 +131,34 @@ private:
     bool versionMismatchIgnore = false;
     bool m_enable_version_check = false;
 
-    mutable QMutex totalCounterMutex;
-    QMap<int, quint64> totalReceiveCounter;
-    QMap<int, quint64> totalLossCounter;
-    QMap<int, quint64> currReceiveCounter;
-    QMap<int, quint64> currLossCounter;
-    QMap<int,QMap<int, quint8> > lastIndex;
+    // Counters of one link. Everything but txBytes is written by the thread
+    // running receiveBytes(), txBytes also by senders on other threads through
+    // recordTransmit(). All writes are atomic adds, so they never race and
+    // snapshots can be read lock free from any thread. When a slot is recycled
+    // for a new link it is reset while its ID is RecyclingSlot; an add from the
+    // old link that is already under way may still land in the new counters.
+    struct LinkCounters
+    {
+        QAtomicInteger<quint64> rxBytes;
+        QAtomicInteger<quint64> txBytes;
+        QAtomicInteger<quint64> rxFrames;
+        QAtomicInteger<quint64> crcErrors;
+        QAtomicInteger<quint64> sequenceGaps;
+        QAtomicInteger<quint64> latencyBuckets[LatencyBuckets];
+        quint64 currReceiveCounter;
+        quint64 currLossCounter;
+    };
+
+    int slotForLink(int linkId);
+    int findSlotForLink(int linkId) const;
+    static void resetCounters(LinkCounters &counters);
+    static LinkStatistics makeSnapshot(int linkId, const LinkCounters &counters);
+
+    static const int RecyclingSlot = -1;
+    QAtomicInt m_linkSlotIds[MaxLinks];      ///< Link ID owning each slot of m_linkCounters, 0 if free, RecyclingSlot while reset
+    LinkCounters m_linkCounters[MaxLinks];
+    // Last sequence number per (sysid << 8 | compid), bit 8 set once a message was seen
+    quint16 m_lastSequence[256 * 256];
 
 signals:
     void protocolStatusMessage(const QString& title, const QString& message);
@@ -0,0 +1,129 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2014 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+#include "MAVLinkValueBus.h"
+
+#include <QDateTime>
+#include <QMutexLocker>
+
+const int MAVLinkValueBus::Capacity;
+
+MAVLinkValueBus *MAVLinkValueBus::instance()
+{
+    static MAVLinkValueBus bus;
+    return &bus;
+}
+
+MAVLinkValueBus::MAVLinkValueBus() :
+    m_enqueuePosition(0),
+    m_dequeuePosition(0),
+    m_dropped(0)
+{
+    // Bounded multi producer queue: a cell is free for position p while its
+    // sequence is p and holds a sample while its sequence is p + 1.
+    for (int i = 0; i < Capacity; ++i)
+    {
+        m_cells[i].sequence.storeRelease(static_cast<quint32>(i));
+    }
+    m_clock.start();
+    m_epochOffset = QDateTime::currentMSecsSinceEpoch();
+}
+
+int MAVLinkValueBus::registerSeries(const QString &name)
+{
+    QMutexLocker locker(&m_seriesMutex);
+    const auto iter = m_seriesIds.constFind(name);
+    if (iter != m_seriesIds.constEnd())
+    {
+        return iter.value();
+    }
+    const int series = m_seriesNames.size();
+    m_seriesNames.append(name);
+    m_seriesIds.insert(name, series);
+    return series;
+}
+
+QString MAVLinkValueBus::seriesName(int series) const
+{
+    QMutexLocker locker(&m_seriesMutex);
+    return m_seriesNames.value(series);
+}
+
+bool MAVLinkValueBus::publish(int uasId, int series, double value, bool integer)
+{
+    quint32 position = m_enqueuePosition.loadAcquire();
+    Cell *cell = nullptr;
+    forever
+    {
+        cell = &m_cells[position & (Capacity - 1)];
+        const qint32 diff = static_cast<qint32>(cell->sequence.loadAcquire() - position);
+        if (diff == 0)
+        {
+            if (m_enqueuePosition.testAndSetOrdered(position, position + 1))
+            {
+                break;
+            }
+            position = m_enqueuePosition.loadAcquire();
+        }
+        else if (diff < 0)
+        {
+            // The consumer fell a whole queue behind
+            m_dropped.fetchAndAddRelaxed(1);
+            return false;
+        }
+        else
+        {
+            position = m_enqueuePosition.loadAcquire();
+        }
+    }
+
+    cell->sample.series = series;
+    cell->sample.uasId = uasId;
+    cell->sample.msecs = m_epochOffset + m_clock.elapsed();
+    cell->sample.value = value;
+    cell->sample.integer = integer;
+    cell->sequence.storeRelease(position + 1);
+    return true;
+}
+
+int MAVLinkValueBus::drain(QVector<Sample> &samples)
+{
+    int count = 0;
+    forever
+    {
+        Cell &cell = m_cells[m_dequeuePosition & (Capacity - 1)];
+        if (static_cast<qint32>(cell.sequence.loadAcquire() - (m_dequeuePosition + 1)) < 0)
+        {
+            break;
+        }
+        samples.append(cell.sample);
+        cell.sequence.storeRelease(m_dequeuePosition + Capacity);
+        ++m_dequeuePosition;
+        ++count;
+    }
+    return count;
+}
+
+quint64 MAVLinkValueBus::droppedSamples() const
+{
+    return m_dropped.loadAcquire();
+}
@@ -0,0 +1,101 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2014 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief MAVLinkValueBus
+ *          Carries decoded values from MAVLinkDecoder to the live plot.
+ *          Values are identified by an integer series id and queued in a
+ *          bounded lock free queue, the consumer drains them in batches.
+ */
+
+#ifndef MAVLINKVALUEBUS_H
+#define MAVLINKVALUEBUS_H
+
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+class MAVLinkValueBus
+{
+public:
+    struct Sample
+    {
+        int series;
+        int uasId;
+        qint64 msecs;       ///< Unix time in msecs the sample was published
+        double value;
+        bool integer;
+    };
+
+    static const int Capacity = 65536;  ///< Queued samples, must be a power of two
+
+    static MAVLinkValueBus *instance();
+
+    /**
+     * @brief registerSeries - Get the id of the series called name, creating it
+     *        on first use. Takes a lock, producers should cache the id.
+     */
+    int registerSeries(const QString &name);
+    QString seriesName(int series) const;
+
+    /**
+     * @brief publish - Queue one sample. Lock free, may be called from any thread.
+     * @return false if the queue was full and the sample got dropped
+     */
+    bool publish(int uasId, int series, double value, bool integer);
+
+    /**
+     * @brief drain - Append all queued samples to samples. Only one thread may drain.
+     * @return Number of samples appended
+     */
+    int drain(QVector<Sample> &samples);
+
+    quint64 droppedSamples() const;
+
+private:
+    MAVLinkValueBus();
+    Q_DISABLE_COPY(MAVLinkValueBus)
+
+    struct Cell
+    {
+        QAtomicInteger<quint32> sequence;
+        Sample sample;
+    };
+
+    Cell m_cells[Capacity];
+    QAtomicInteger<quint32> m_enqueuePosition;
+    quint32 m_dequeuePosition;
+    QAtomicInteger<quint64> m_dropped;
+
+    QElapsedTimer m_clock;
+    qint64 m_epochOffset;
+
+    mutable QMutex m_seriesMutex;
+    QHash<QString, int> m_seriesIds;
+    QVector<QString> m_seriesNames;
+};
+
+#endif // MAVLINKVALUEBUS_H
@@ -0,0 +1,178 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2014 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief TLogIndex
+ *          Frame index of a MAVLink telemetry log (tlog).
+ */
+
+#include "TLogIndex.h"
+
+#include <mavlink.h>
+
+#include <algorithm>
+
+namespace
+{
+const int TimestampSize = 8;
+
+quint64 readTimestamp(const uchar *data)
+{
+    quint64 value = 0;
+    for (int i = 0; i < TimestampSize; ++i)
+    {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+}
+
+const quint64 TLogIndex::MaxRecordGapUsec;
+
+TLogIndex::TLogIndex() :
+    m_startTimestamp(0),
+    m_skippedBytes(0)
+{
+}
+
+void TLogIndex::clear()
+{
+    m_entries.clear();
+    m_startTimestamp = 0;
+    m_skippedBytes = 0;
+}
+
+int TLogIndex::frameLength(const uchar *data, qint64 available)
+{
+    if (available < MAVLINK_CORE_HEADER_MAVLINK1_LEN + 1 + MAVLINK_NUM_CHECKSUM_BYTES)
+    {
+        return 0;
+    }
+
+    int headerLength = 0;
+    int signatureLength = 0;
+    quint32 msgid = 0;
+    const int payloadLength = data[1];
+
+    if (data[0] == MAVLINK_STX_MAVLINK1)
+    {
+        headerLength = MAVLINK_CORE_HEADER_MAVLINK1_LEN + 1;
+        msgid = data[5];
+    }
+    else if (data[0] == MAVLINK_STX)
+    {
+        if (available < MAVLINK_NUM_HEADER_BYTES)
+        {
+            return 0;
+        }
+        headerLength = MAVLINK_NUM_HEADER_BYTES;
+        signatureLength = (data[2] & MAVLINK_IFLAG_SIGNED) ? MAVLINK_SIGNATURE_BLOCK_LEN : 0;
+        msgid = data[7] | (data[8] << 8) | (static_cast<quint32>(data[9]) << 16);
+    }
+    else
+    {
+        return 0;
+    }
+
+    const int length = headerLength + payloadLength + MAVLINK_NUM_CHECKSUM_BYTES + signatureLength;
+    if (length > available)
+    {
+        return 0;
+    }
+
+    // Unknown messages can not be CRC checked and would be dropped by the
+    // mavlink parser anyway, so they are treated as garbage here too.
+    const mavlink_msg_entry_t *entry = mavlink_get_msg_entry(msgid);
+    if (!entry)
+    {
+        return 0;
+    }
+
+    uint16_t crc = crc_calculate(data + 1, static_cast<uint16_t>(headerLength - 1 + payloadLength));
+    crc_accumulate(entry->crc_extra, &crc);
+    const uchar *crcBytes = data + headerLength + payloadLength;
+    if ((crc & 0xFF) != crcBytes[0] || (crc >> 8) != crcBytes[1])
+    {
+        return 0;
+    }
+    return length;
+}
+
+bool TLogIndex::build(const uchar *data, qint64 size)
+{
+    clear();
+
+    // A typical tlog record is around 40 bytes, reserve accordingly to avoid
+    // reallocations on multi hundred MB logs.
+    m_entries.reserve(static_cast<int>(qMin<qint64>(size / 40, 50000000)));
+
+    quint64 lastTimestamp = 0;
+    quint64 time = 0;
+    qint64 pos = 0;
+
+    while (pos + TimestampSize < size)
+    {
+        const int length = frameLength(data + pos + TimestampSize, size - pos - TimestampSize);
+        if (length == 0)
+        {
+            // Not a valid record, resync on the next byte
+            ++m_skippedBytes;
+            ++pos;
+            continue;
+        }
+
+        const quint64 timestamp = readTimestamp(data + pos);
+        if (m_entries.isEmpty())
+        {
+            m_startTimestamp = timestamp;
+        }
+        else if (timestamp > lastTimestamp)
+        {
+            time += qMin(timestamp - lastTimestamp, MaxRecordGapUsec);
+        }
+        lastTimestamp = timestamp;
+
+        Entry entry;
+        entry.time = time;
+        entry.offset = pos + TimestampSize;
+        m_entries.append(entry);
+
+        pos += TimestampSize + length;
+    }
+    m_skippedBytes += size - pos;
+    m_entries.squeeze();
+
+    return !m_entries.isEmpty();
+}
+
+int TLogIndex::indexForTime(quint64 time) const
+{
+    const auto it = std::lower_bound(m_entries.constBegin(), m_entries.constEnd(), time,
+                                     [](const Entry &entry, quint64 value) { return entry.time < value; });
+    return static_cast<int>(it - m_entries.constBegin());
+}
+
+quint64 TLogIndex::duration() const
+{
+    return m_entries.isEmpty() ? 0 : m_entries.last().time;
+}
@@ -0,0 +1,111 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2014 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief TLogIndex
+ *          Frame index of a MAVLink telemetry log (tlog).
+ *          A tlog is a sequence of records, each being an 8 byte big endian
+ *          timestamp (usec since epoch) followed by one complete MAVLink frame.
+ *          The index stores the file offset of every valid frame together with
+ *          a monotonic replay time, so a replay can seek to an exact frame.
+ */
+
+#ifndef TLOGINDEX_H
+#define TLOGINDEX_H
+
+#include <QtGlobal>
+#include <QVector>
+
+class TLogIndex
+{
+public:
+    struct Entry
+    {
+        quint64 time;   ///< Replay time in usec relative to the first frame
+        qint64 offset;  ///< File offset of the MAVLink frame (after the timestamp)
+    };
+
+    /**
+     * @brief Gaps between two consecutive records larger than this are
+     *        collapsed. Tlogs are opened in append mode, so one file may
+     *        contain several sessions hours or days apart.
+     */
+    static const quint64 MaxRecordGapUsec = 10000000;
+
+    TLogIndex();
+
+    /**
+     * @brief build - Scans a complete tlog image and creates the index.
+     *        Frames failing the CRC check are skipped and the scan resyncs
+     *        on the next valid record.
+     * @param data - Pointer to the file content
+     * @param size - Size of the file content
+     * @return true if at least one frame was found
+     */
+    bool build(const uchar *data, qint64 size);
+
+    void clear();
+
+    /** @brief Exchanges the content with other, never fails */
+    void swap(TLogIndex &other)
+    {
+        m_entries.swap(other.m_entries);
+        qSwap(m_startTimestamp, other.m_startTimestamp);
+        qSwap(m_skippedBytes, other.m_skippedBytes);
+    }
+
+    int size() const { return m_entries.size(); }
+    bool isEmpty() const { return m_entries.isEmpty(); }
+    const Entry &at(int index) const { return m_entries.at(index); }
+
+    /**
+     * @brief indexForTime - Finds the first frame with a replay time >= time
+     * @param time - Replay time in usec relative to the first frame
+     * @return Index of the frame, size() if time is behind the last frame
+     */
+    int indexForTime(quint64 time) const;
+
+    /** @brief Replay time of the last frame in usec */
+    quint64 duration() const;
+
+    /** @brief Original timestamp of the first frame in usec since epoch */
+    quint64 startTimestamp() const { return m_startTimestamp; }
+
+    /** @brief Number of bytes skipped during build() because they were not part of a valid record */
+    qint64 skippedBytes() const { return m_skippedBytes; }
+
+    /**
+     * @brief frameLength - Calculates the length of the MAVLink frame starting at data
+     * @param data - Pointer to the first byte (STX) of the frame
+     * @param available - Number of bytes readable from data
+     * @return Length of the frame in bytes, 0 if data does not hold a complete valid frame
+     */
+    static int frameLength(const uchar *data, qint64 available);
+
+private:
+    QVector<Entry> m_entries;
+    quint64 m_startTimestamp;
+    qint64 m_skippedBytes;
+};
+
+#endif // TLOGINDEX_H
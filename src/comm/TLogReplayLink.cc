@@ -3,22 +3,43 @@
 #include "UASObject.h"
 #include "ArduPilotMegaMAV.h"
 #include "LinkManager.h"
-#include "MainWindow.h"
+#include "logging.h"
 
-#include <QDebug>
-#include <QDateTime>
+#include <QElapsedTimer>
 #include <QFile>
 
+namespace
+{
+// Maximum number of decoded messages waiting in the GUI event queue. Keeps
+// "as fast as possible" replays from flooding the event loop.
+const int MaxPendingMessages = 512;
+// Remaining wait times above this are slept on the wait condition, below it
+// the thread sleeps the exact remainder.
+const qint64 CoarseWaitThresholdNsecs = 2000000;
+const qint64 ProgressIntervalNsecs = 100000000;
+}
+
+const int TLogReplayLink::MinSpeed;
+
 TLogReplayLink::TLogReplayLink(QObject *parent) :
     LinkInterface(),
     m_toBeDeleted(false),
     m_threadRun(false),
-    m_speedVar(50),
-    m_posVar(0),
+    m_speedVar(100),
+    m_seekVar(-1),
+    m_pause(false),
+    m_controlGeneration(0),
+    m_pendingMessages(0),
     m_mavlinkDecoder(new MAVLinkDecoder()),
     m_mavlinkInspector(NULL)
 {
     Q_UNUSED(parent);
+    qRegisterMetaType<mavlink_message_t>("mavlink_message_t");
+    // The replay thread only decodes, everything touching the UAS objects is
+    // done by dispatchMessage() in the thread this link lives in (GUI thread).
+    QObject::connect(this, SIGNAL(messageDecoded(mavlink_message_t)),
+                     this, SLOT(dispatchMessage(mavlink_message_t)), Qt::QueuedConnection);
+    QObject::connect(this, SIGNAL(finished()), this, SLOT(replayFinished()), Qt::QueuedConnection);
 }
 int TLogReplayLink::getId() const
 {
@@ -75,28 +96,38 @@ void TLogReplayLink::readBytes()
 }
 void TLogReplayLink::setSpeed(int speed)
 {
-    m_variableAccessMutex.lock();
-    m_speedVar = speed;
-    m_variableAccessMutex.unlock();
+    QMutexLocker locker(&m_variableAccessMutex);
+    m_speedVar = speed > 0 ? qMax(speed, MinSpeed) : 0;
+    ++m_controlGeneration;
+    m_controlChanged.wakeAll();
 }
-void TLogReplayLink::setPosition(qint64 pos)
+
+void TLogReplayLink::seekToTime(qint64 msecs)
 {
-    m_variableAccessMutex.lock();
-    m_posVar = pos;
-    m_variableAccessMutex.unlock();
+    QMutexLocker locker(&m_variableAccessMutex);
+    m_seekVar = qMax<qint64>(0, msecs);
+    ++m_controlGeneration;
+    m_controlChanged.wakeAll();
 }
 
 void TLogReplayLink::play()
 {
+    QMutexLocker locker(&m_variableAccessMutex);
     m_pause = false;
+    ++m_controlGeneration;
+    m_controlChanged.wakeAll();
 }
 
 void TLogReplayLink::pause()
 {
+    QMutexLocker locker(&m_variableAccessMutex);
     m_pause = true;
+    ++m_controlGeneration;
+    m_controlChanged.wakeAll();
 }
 bool TLogReplayLink::isPaused()
 {
+    QMutexLocker locker(&m_variableAccessMutex);
     return m_pause;
 }
 void TLogReplayLink::setMavlinkDecoder(MAVLinkDecoder *decoder)
@@ -110,210 +141,222 @@ void TLogReplayLink::setMavlinkInspector(QGCMAVLinkInspector *inspector)
 
 void TLogReplayLink::run()
 {
-    m_pause = false;
-    m_threadRun = true;
+    quint32 generation = 0;
+    {
+        QMutexLocker locker(&m_variableAccessMutex);
+        m_threadRun = true;
+        // Force anchoring the clock on the first frame
+        generation = m_controlGeneration - 1;
+    }
     emit connected(this);
     emit connected(true);
     emit connected();
+
     QFile file(m_logFile);
-    file.open(QIODevice::ReadOnly);
-    int bytesize = 0;
-    qint64 msecs = QDateTime::currentMSecsSinceEpoch();
-    MainWindow::instance()->toolBar().disableConnectWidget(true);
-    MainWindow::instance()->toolBar().overrideDisableConnectWidget(true);
-    int privSpeedVar = 100;
-    mavlink_message_t message;
-    mavlink_status_t status;
-    QByteArray timebuf;
-    bool firsttime = true;
-    int delay = 0;
-    qint64 lastLogTime = 0;
-    qint64 lastPcTime = 0;
-    bool nexttime = false;
-    qint64 privatepos = 0;
-    while (!file.atEnd() && m_threadRun)
+    if (!file.open(QIODevice::ReadOnly))
     {
-        if (QDateTime::currentMSecsSinceEpoch() - msecs > 1000)
-        {
-            msecs = QDateTime::currentMSecsSinceEpoch();
-            m_variableAccessMutex.lock();
+        emit communicationError(getName(), tr("Could not open log file %1").arg(m_logFile));
+        m_toBeDeleted = true;
+        return;
+    }
+    const qint64 fileSize = file.size();
+    const uchar *data = file.map(0, fileSize);
+    if (!data)
+    {
+        emit communicationError(getName(), tr("Could not map log file %1").arg(m_logFile));
+        m_toBeDeleted = true;
+        return;
+    }
+
+    // Indexing a large log takes a while, the GUI must not wait on the mutex meanwhile
+    QElapsedTimer clock;
+    clock.start();
+    TLogIndex index;
+    index.build(data, fileSize);
+    QLOG_DEBUG() << "TLogReplayLink: indexed" << index.size() << "frames in" << clock.elapsed()
+                 << "msecs," << index.skippedBytes() << "bytes skipped";
+    {
+        QMutexLocker locker(&m_variableAccessMutex);
+        m_index.swap(index);
+    }
+
+    const qint64 totalMsecs = static_cast<qint64>(m_index.duration() / 1000);
+    emit logProgress(0, totalMsecs);
 
-            //m_speedVar is a value, between 25 and 175. These are speed percentages.
-            privSpeedVar = m_speedVar; //50 - ((m_speedVar) / 4);
-            if (privatepos != m_posVar)
+    // The replay is paced against a monotonic clock. Every change of speed,
+    // position or pause state re-anchors log time to wall clock time, so no
+    // error accumulates between frames.
+    qint64 anchorNsecs = 0;
+    quint64 anchorTime = 0;
+    int speed = 100;
+    qint64 lastProgressNsecs = -ProgressIntervalNsecs;
+    int current = 0;
+
+    while (current < m_index.size())
+    {
+        qint64 targetNsecs = 0;
+        {
+            QMutexLocker locker(&m_variableAccessMutex);
+            while (m_pause && m_threadRun)
+            {
+                m_controlChanged.wait(&m_variableAccessMutex);
+            }
+            if (!m_threadRun)
+            {
+                break;
+            }
+            if (m_seekVar >= 0)
             {
-                privatepos = m_posVar;
-                if (privatepos > 0 && privatepos < 100)
+                current = m_index.indexForTime(static_cast<quint64>(m_seekVar) * 1000);
+                m_seekVar = -1;
+                if (current >= m_index.size())
                 {
-                    file.seek((privatepos / 100.0) * file.size());
+                    break;
                 }
             }
-            m_variableAccessMutex.unlock();
-        }
-        emit logProgress(file.pos(),file.size());
-        QByteArray bytes = file.read(128);
-        bytesize+=128;
-
-        for (int i=0;i<bytes.size();i++)
-        {
-            unsigned int decodeState = mavlink_parse_char(14, (uint8_t)(bytes[i]), &message, &status);
-            if (decodeState != 1)
+            if (generation != m_controlGeneration)
+            {
+                generation = m_controlGeneration;
+                speed = m_speedVar;
+                anchorNsecs = clock.nsecsElapsed();
+                anchorTime = m_index.at(current).time;
+            }
+            if (speed > 0)
             {
-                //Not a mavlink byte!
-                if (nexttime)
+                const qint64 logDiffNsecs = static_cast<qint64>(m_index.at(current).time - anchorTime) * 1000;
+                targetNsecs = anchorNsecs + (logDiffNsecs / speed) * 100;
+                const qint64 remaining = targetNsecs - clock.nsecsElapsed();
+                if (remaining > CoarseWaitThresholdNsecs)
                 {
-                    timebuf.append(bytes[i]);
+                    // Sleep on the wait condition, so a seek, pause or stop wakes us immediately
+                    m_controlChanged.wait(&m_variableAccessMutex,
+                                          static_cast<unsigned long>((remaining - CoarseWaitThresholdNsecs / 2) / 1000000));
+                    continue;
                 }
-                if (timebuf.size() == 8)
-                {
-                    nexttime = false;
-
-                    //Should be a timestamp for the next packet.
-                    quint64 logmsecs = quint64(static_cast<unsigned char>(timebuf.at(0))) << 56;
-                    logmsecs += quint64(static_cast<unsigned char>(timebuf.at(1))) << 48;
-                    logmsecs += quint64(static_cast<unsigned char>(timebuf.at(2))) << 40;
-                    logmsecs += quint64(static_cast<unsigned char>(timebuf.at(3))) << 32;
-                    logmsecs += quint64(static_cast<unsigned char>(timebuf.at(4))) << 24;
-                    logmsecs += quint64(static_cast<unsigned char>(timebuf.at(5))) << 16;
-                    logmsecs += quint64(static_cast<unsigned char>(timebuf.at(6))) << 8;
-                    logmsecs += quint64(static_cast<unsigned char>(timebuf.at(7))) << 0;
-
-                    timebuf.clear();
+            }
+        }
 
-                    if (firsttime)
-                    {
-                        firsttime = false;
-                        lastLogTime = logmsecs;
-                        lastPcTime = QDateTime::currentMSecsSinceEpoch();
-                    }
-                    else
-                    {
-                        //Difference in time between the last time we read a timestamp, and this time
-                        qint64 pcdiff = QDateTime::currentMSecsSinceEpoch() - lastPcTime;
-                        lastPcTime = QDateTime::currentMSecsSinceEpoch();
+        if (speed > 0)
+        {
+            const qint64 remaining = targetNsecs - clock.nsecsElapsed();
+            if (remaining > 0)
+            {
+                usleep(static_cast<unsigned long>(remaining / 1000));
+            }
+        }
 
-                        //Difference in time between the last timestamp we fired off, and this one
-                        qint64 logdiff = logmsecs - lastLogTime;
-                        lastLogTime = logmsecs;
-                        logdiff /= 1000;
+        const TLogIndex::Entry &entry = m_index.at(current);
+        const int length = TLogIndex::frameLength(data + entry.offset, fileSize - entry.offset);
 
-                        if (logdiff < pcdiff)
-                        {
-                            //The next mavlink packet was fired faster than our loop is running, send it immediatly
-                            //Fire immediatly
-                            delay = 0;
-                        }
-                        else
-                        {
-                            //The next mavlink packet was sent logdiff-pcdiff millseconds after the current time
-                            delay = logdiff-pcdiff;
+        mavlink_message_t buffer;
+        mavlink_message_t message;
+        mavlink_status_t bufferStatus;
+        mavlink_status_t status;
+        memset(&bufferStatus, 0, sizeof(bufferStatus));
+        for (int i = 0; i < length; ++i)
+        {
+            if (mavlink_frame_char_buffer(&buffer, &bufferStatus, data[entry.offset + i], &message, &status) == MAVLINK_FRAMING_OK
+                    && message.sysid != QGC::MavlinkID())
+            {
+                //Good decode, GCS packets are ignored
+                m_pendingMessages.ref();
+                emit messageDecoded(message);
+            }
+        }
+        ++current;
 
-                        }
-                    }
+        const qint64 now = clock.nsecsElapsed();
+        if (now - lastProgressNsecs > ProgressIntervalNsecs)
+        {
+            lastProgressNsecs = now;
+            emit logProgress(static_cast<qint64>(entry.time / 1000), totalMsecs);
+        }
 
-                }
-            }
-            else if (decodeState == 1)
-            {
-                nexttime = true;
-                //Good decode
-                if (message.sysid == QGC::MavlinkID())
-                {
-                    //GCS packet, ignore it
-                }
-                else
-                {
-                    UASInterface* uas = UASManager::instance()->getUASForId(message.sysid);
-                    if (!uas && message.msgid == MAVLINK_MSG_ID_HEARTBEAT)
-                    {
-                        mavlink_heartbeat_t heartbeat;
-                        // Reset version field to 0
-                        heartbeat.mavlink_version = 0;
-                        mavlink_msg_heartbeat_decode(&message, &heartbeat);
+        while (m_pendingMessages.load() > MaxPendingMessages && m_threadRun)
+        {
+            msleep(1);
+        }
+    }
+    file.unmap(const_cast<uchar*>(data));
 
+    if (m_threadRun)
+    {
+        m_toBeDeleted = true;
+        emit logProgress(totalMsecs, totalMsecs);
+    }
+}
 
-                        // Create a new UAS object
-                        if (heartbeat.autopilot == MAV_AUTOPILOT_ARDUPILOTMEGA)
-                        {
-                            ArduPilotMegaMAV* mav = new ArduPilotMegaMAV(0, message.sysid);
-                            mav->setSystemType((int)heartbeat.type);
-                            uas = mav;
-                            // Make UAS aware that this link can be used to communicate with the actual robot
-                            uas->addLink(this);
-                            UASObject *obj = new UASObject();
-                            LinkManager::instance()->addSimObject(message.sysid,obj);
+void TLogReplayLink::dispatchMessage(mavlink_message_t message)
+{
+    m_pendingMessages.deref();
 
-                            // Now add UAS to "official" list, which makes the whole application aware of it
-                            UASManager::instance()->addUAS(uas);
+    UASInterface* uas = UASManager::instance()->getUASForId(message.sysid);
+    if (!uas && message.msgid == MAVLINK_MSG_ID_HEARTBEAT)
+    {
+        mavlink_heartbeat_t heartbeat;
+        // Reset version field to 0
+        heartbeat.mavlink_version = 0;
+        mavlink_msg_heartbeat_decode(&message, &heartbeat);
 
-                        }
-                    }
-                    else if (uas)
-                    {
-                        if (delay > 0 && delay < 10000)
-                        {
-                            //Split the delay into 100msec chunks, to allow for canceling.
-                            int realdelay = delay / ((double)privSpeedVar / 100.0);
-                            int repeat = realdelay / 100;
-                            for (int i=0;i<repeat;i++)
-                            {
-                                msleep(100);
-                                if (!m_threadRun)
-                                {
-                                    //Break out
-                                    MainWindow::instance()->toolBar().overrideDisableConnectWidget(false);
-                                    MainWindow::instance()->toolBar().disableConnectWidget(false);
-                                    emit disconnected(this);
-                                    emit disconnected();
-                                    emit connected(false);
-                                    UASManager::instance()->removeUAS(UASManager::instance()->getActiveUAS());
-                                    return;
-                                }
-                            }
-                            msleep(realdelay - repeat);
-                            //msleep(delay / ((double)privSpeedVar / 100.0));
-                        }
-                        else
-                        {
-                            msleep(1);
-                        }
-                        uas->receiveMessage(this,message);
-                        LinkManager::instance()->getUasObject(message.sysid)->messageReceived(this,message);
-                        m_mavlinkDecoder->receiveMessage(this,message);
-                        if (m_mavlinkInspector)
-                        {
-                            m_mavlinkInspector->receiveMessage(this,message);
-                        }
-                    }
-                    else
-                    {
-                        //no UAS, and not a heartbeat
-                    }
-                }
+        // Create a new UAS object
+        if (heartbeat.autopilot == MAV_AUTOPILOT_ARDUPILOTMEGA)
+        {
+            ArduPilotMegaMAV* mav = new ArduPilotMegaMAV(0, message.sysid);
+            mav->setSystemType((int)heartbeat.type);
+            uas = mav;
+            // Make UAS aware that this link can be used to communicate with the actual robot
+            uas->addLink(this);
+            UASObject *obj = new UASObject();
+            LinkManager::instance()->addSimObject(message.sysid,obj);
+            m_replaySystems.append(message.sysid);
 
-            }
+            // Now add UAS to "official" list, which makes the whole application aware of it
+            UASManager::instance()->addUAS(uas);
+        }
+    }
+    else if (uas)
+    {
+        uas->receiveMessage(this,message);
+        UASObject *obj = LinkManager::instance()->getUasObject(message.sysid);
+        if (obj)
+        {
+            obj->messageReceived(this,message);
         }
-        while (m_pause)
+        m_mavlinkDecoder->receiveMessage(this,message);
+        if (m_mavlinkInspector)
         {
-            msleep(100);
+            m_mavlinkInspector->receiveMessage(this,message);
         }
     }
-    if (m_threadRun)
+    else
     {
-        m_toBeDeleted = true;
+        //no UAS, and not a heartbeat
     }
+}
+
+void TLogReplayLink::replayFinished()
+{
     LinkManager *lm = LinkManager::instance();
-    if (lm){
-        LinkManager::instance()->removeSimObject(UASManager::instance()->getActiveUAS()->getSystemId());
-    } else {
-        QLOG_ERROR() << "TLogReplayLink: failed to get Linkmanager instance";
+    foreach (int sysid, m_replaySystems)
+    {
+        if (lm)
+        {
+            lm->removeSimObject(sysid);
+        }
+        else
+        {
+            QLOG_ERROR() << "TLogReplayLink: failed to get Linkmanager instance";
+        }
+        UASInterface *uas = UASManager::instance()->getUASForId(sysid);
+        if (uas)
+        {
+            UASManager::instance()->removeUAS(uas);
+        }
     }
-    MainWindow::instance()->toolBar().overrideDisableConnectWidget(false);
-    MainWindow::instance()->toolBar().disableConnectWidget(false);
+    m_replaySystems.clear();
     emit disconnected(this);
     emit disconnected();
     emit connected(false);
-    UASManager::instance()->removeUAS(UASManager::instance()->getActiveUAS());
 }
 
 void TLogReplayLink::setLog(QString logfile)
@@ -322,8 +365,10 @@ void TLogReplayLink::setLog(QString logfile)
 }
 void TLogReplayLink::stop()
 {
+    QMutexLocker locker(&m_variableAccessMutex);
     m_toBeDeleted = false;
     m_threadRun = false;
+    m_controlChanged.wakeAll();
 }
 
 bool TLogReplayLink::toBeDeleted()
@@ -4,8 +4,20 @@
 #include "LinkInterface.h"
 #include "MAVLinkDecoder.h"
 #include "QGCMAVLinkInspector.h"
+#include "TLogIndex.h"
+#include <QAtomicInt>
 #include <QMutex>
+#include <QWaitCondition>
 
+/**
+ * @brief Replays a MAVLink telemetry log (tlog)
+ *
+ * The log is scanned once into a TLogIndex holding the offset and replay time
+ * of every frame. Playback runs in the link thread and is paced by a monotonic
+ * clock, so seeking to an exact time and changing the speed are cheap.
+ * Decoded messages are handed to the GUI thread through a queued signal, all
+ * UAS handling is done there.
+ */
 class TLogReplayLink : public LinkInterface
 {
     Q_OBJECT
@@ -32,11 +44,14 @@ public:
     void stop();
     bool toBeDeleted();
 
-    //Speed is 1-100, being slowest to fastest
+    //Speed is a percentage, 100 being realtime. Values <= 0 replay as fast as possible
     void setSpeed(int speed);
-    void setPosition(qint64 pos);
+    //Seek to an exact replay time in msecs relative to the start of the log
+    void seekToTime(qint64 msecs);
     void disableTimeouts() { }
     void enableTimeouts() { }
+
+    static const int MinSpeed = 10;
 signals:
     /*void bytesReceived(LinkInterface* link, QByteArray data);
     void connected();
@@ -48,19 +63,28 @@ signals:
     void communicationError(const QString& linkname, const QString& error);
     void communicationUpdate(const QString& linkname, const QString& text);
     void deleteLink(LinkInterface* const link);*/
+    //Position and total are replay times in msecs
     void logProgress(qint64 pos,qint64 total);
+    void messageDecoded(mavlink_message_t message);
 public slots:
 private slots:
     void run();
     void readBytes();
+    void dispatchMessage(mavlink_message_t message);
+    void replayFinished();
 private:
     QString m_logFile;
     bool m_toBeDeleted;
     bool m_threadRun;
     QMutex m_variableAccessMutex;
+    QWaitCondition m_controlChanged;
     int m_speedVar;
-    qint64 m_posVar;
+    qint64 m_seekVar;
     bool m_pause;
+    quint32 m_controlGeneration;
+    QAtomicInt m_pendingMessages;
+    TLogIndex m_index;
+    QList<int> m_replaySystems;
     MAVLinkDecoder *m_mavlinkDecoder;
     QGCMAVLinkInspector *m_mavlinkInspector;
 };
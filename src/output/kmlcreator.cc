@@ -12,6 +12,8 @@
 #include <QMutex>
 #include <QQuaternion>
 #include <quazip.h>
+#include <quazipfile.h>
+#include <quazipnewinfo.h>
 #include <math.h>
 
 #include <JlCompress.h>
@@ -214,9 +216,8 @@ void quat_to_euler(QQuaternion& q, float &roll, float &pitch, float &yaw)
     yaw = rad2deg * get_euler_yaw(q);
 }
 
-static Attitude attFromNKQ1(NKQ1& q) {
-    QQuaternion quat(q.q1, q.q2, q.q3, q.q4);
-    float roll, pitch, yaw;
+void quatToKmlEuler(float q1, float q2, float q3, float q4, float &roll, float &pitch, float &yaw) {
+    QQuaternion quat(q1, q2, q3, q4);
     quat_to_euler(quat, roll, pitch, yaw);
 
     // special handling for pitch angles near 90 degrees
@@ -243,6 +244,11 @@ static Attitude attFromNKQ1(NKQ1& q) {
             if (yaw > 180) yaw -= 360;
         }
     }
+}
+
+static Attitude attFromNKQ1(NKQ1& q) {
+    float roll, pitch, yaw;
+    quatToKmlEuler(q.q1, q.q2, q.q3, q.q4, roll, pitch, yaw);
 
     Attitude a;
     a.values.insert("Roll", QString::number(roll, 'f', 5));
@@ -286,19 +292,18 @@ Placemark& Placemark::addquat(Attitude &a) {
 }
 
 void SummaryData::add(GPSRecord &gps) {
-    float speed = gps.speed().toFloat();
+    add(gps.speed().toFloat(), gps.alt().toFloat(), gps.lat().toFloat(), gps.lng().toFloat());
+}
+
+void SummaryData::add(float speed, float alt, float lat, float lng) {
     if(speed > topSpeed) {
         topSpeed = speed;
     }
 
-    float alt = gps.alt().toFloat();
     if(alt > highestAltitude) {
         highestAltitude = alt;
     }
 
-    float lat = gps.lat().toFloat();
-    float lng = gps.lng().toFloat();
-
     if(lastLat != 0 && lastLng != 0) {
         float dist = distanceBetween(lastLat, lastLng, lat, lng);
         totalDistance += dist;
@@ -1023,4 +1028,517 @@ void KMLCreator::writeLogPlacemarkElement(QXmlStreamWriter &writer, Placemark *p
     endLogPlaceMark(seq, startUtc, endUtc, coords, writer, p);
 }
 
+/*
+ * KMLTrackWriter
+ */
+
+/**
+ * @brief Douglas-Peucker simplification of points[first..last] on a local flat projection.
+ * @param tolerance maximum deviation in metres, 0 keeps all points
+ * @param keep receives the indexes of the points to be written, first and last are always kept
+ */
+static void simplifyTrack(const QVector<TrackPoint> &points, int first, int last, double tolerance, QVector<int> &keep) {
+    keep.clear();
+    if(last < first) {
+        return;
+    }
+    if(tolerance <= 0 || last - first < 2) {
+        for(int i = first; i <= last; ++i) {
+            keep.append(i);
+        }
+        return;
+    }
+
+    const double metersPerDeg = 6371000.0 * M_PI / 180.0;
+    const double lat0 = points.at(first).lat;
+    const double lng0 = points.at(first).lng;
+    const double lngScale = metersPerDeg * cos(lat0 * M_PI / 180.0);
+
+    QVector<bool> used(last - first + 1, false);
+    used[0] = true;
+    used[last - first] = true;
+
+    QVector<QPair<int, int> > ranges;
+    ranges.append(qMakePair(first, last));
+    const double tolerance2 = tolerance * tolerance;
+
+    while(!ranges.isEmpty()) {
+        const QPair<int, int> range = ranges.takeLast();
+        const TrackPoint &a = points.at(range.first);
+        const TrackPoint &b = points.at(range.second);
+        const double ax = (a.lng - lng0) * lngScale;
+        const double ay = (a.lat - lat0) * metersPerDeg;
+        const double dx = (b.lng - lng0) * lngScale - ax;
+        const double dy = (b.lat - lat0) * metersPerDeg - ay;
+        const double dz = b.alt - a.alt;
+        const double len2 = dx * dx + dy * dy + dz * dz;
+
+        double maxDist2 = 0;
+        int maxIndex = -1;
+        for(int i = range.first + 1; i < range.second; ++i) {
+            const TrackPoint &p = points.at(i);
+            const double px = (p.lng - lng0) * lngScale - ax;
+            const double py = (p.lat - lat0) * metersPerDeg - ay;
+            const double pz = p.alt - a.alt;
+            double t = (len2 > 0)? (px * dx + py * dy + pz * dz) / len2: 0;
+            t = qBound(0.0, t, 1.0);
+            const double ex = t * dx - px;
+            const double ey = t * dy - py;
+            const double ez = t * dz - pz;
+            const double dist2 = ex * ex + ey * ey + ez * ez;
+            if(dist2 > maxDist2) {
+                maxDist2 = dist2;
+                maxIndex = i;
+            }
+        }
+
+        if(maxIndex != -1 && maxDist2 > tolerance2) {
+            used[maxIndex - first] = true;
+            ranges.append(qMakePair(range.first, maxIndex));
+            ranges.append(qMakePair(maxIndex, range.second));
+        }
+    }
+
+    for(int i = 0; i < used.size(); ++i) {
+        if(used.at(i)) {
+            keep.append(first + i);
+        }
+    }
+}
+
+static QString trackDescription(const TrackPoint &p) {
+    QString s = QString("<b>Speed:</b>%1<br><b>Alt:</b>%2<br><b>HDOP:</b>%3<br>")
+            .arg(p.speed).arg(p.alt).arg(p.hdop);
+    if(p.hasAttitude) {
+        s += QString("<b>Roll in:</b>%1<br><b>Roll:</b>%2<br><b>Pitch in:</b>%3<br>"
+                     "<b>Pitch:</b>%4<br><b>Yaw in:</b>%5<br><b>Yaw:</b>%6<br>")
+                .arg(p.attitude.rollIn).arg(p.attitude.roll)
+                .arg(p.attitude.pitchIn).arg(p.attitude.pitch)
+                .arg(p.attitude.yawIn).arg(p.attitude.yaw);
+    }
+    return s;
+}
+
+static QString trackRPYdescription(const TrackPoint &p) {
+    QString s;
+    s.append(QString("RPY: %1, %2, %3\n")
+             .arg(p.quatAttitude.roll,6,'f',1)
+             .arg(p.quatAttitude.pitch,6,'f',1)
+             .arg(p.quatAttitude.yaw,6,'f',1));
+    s.append(QString("Alt: %1\nSpeed: %2\nCourse: %3\nvZ: %4")
+             .arg(p.alt,6,'f',1)
+             .arg(p.speed,6,'f',1)
+             .arg(p.course,6,'f',1)
+             .arg(p.vz,6,'f',1));
+    return s;
+}
+
+static QString trackPointName(const QString &title, int idx, const TrackPoint &p, const QString &dateTime) {
+    QString timeLabel = dateTime.mid(dateTime.indexOf('T')+1, 12);
+    return QString("%1: %2: %3: %4").arg(title).arg(idx).arg(p.timeSec,5,'f',3).arg(timeLabel);
+}
+
+KMLTrackWriter::KMLTrackWriter(MAV_TYPE mav_type, double iconInterval, double simplifyTolerance) :
+    m_hasGps(false),
+    m_mav_type(mav_type),
+    m_iconInterval(iconInterval),
+    m_simplifyTolerance(simplifyTolerance)
+{
+    TrackSegment s;
+    s.title = "Flight Path";
+    s.mode = "None";
+    s.color = "FF0000FF";
+    m_segments.append(s);
+}
+
+void KMLTrackWriter::startSegment(int modeNum) {
+    TrackSegment s;
+    s.mode = toModeString(m_mav_type, QString::number(modeNum));
+    s.title = QString("Flight Mode %1").arg(s.mode.trimmed());
+    s.color = getColorFor(s.mode);
+    QLOG_DEBUG() << "MAV_TYPE: " << m_mav_type << ", flight mode: " << modeNum << ": " << s.mode << ", color: " << s.color;
+    m_segments.append(s);
+}
+
+void KMLTrackWriter::addGps(const TrackPoint &p) {
+    m_segments.last().gps.append(p);
+    m_lastGps = p;
+    m_hasGps = true;
+}
+
+void KMLTrackWriter::addPoint(const TrackPoint &p) {
+    m_segments.last().points.append(p);
+}
+
+void KMLTrackWriter::addWaypoint(double lat, double lng, double alt) {
+    TrackPoint p;
+    p.lat = lat;
+    p.lng = lng;
+    p.alt = alt;
+    m_waypoints.append(p);
+}
+
+const TrackPoint *KMLTrackWriter::lastGps() const {
+    return m_hasGps? &m_lastGps: 0;
+}
+
+QString KMLTrackWriter::finish(const QString &fileName, bool kmz) {
+    if(fileName.isEmpty()) {
+        QLOG_DEBUG() << "No filename specified.";
+        return "";
+    }
+
+    // Prefer the POS positions for the summary, old logs only have GPS
+    bool hasPoints = false;
+    foreach(const TrackSegment &s, m_segments) {
+        hasPoints |= !s.points.isEmpty();
+    }
+    foreach(const TrackSegment &s, m_segments) {
+        foreach(const TrackPoint &p, hasPoints? s.points: s.gps) {
+            m_summary.add(p.speed, p.alt, p.lat, p.lng);
+        }
+    }
+
+    QFile model(":/files/vehicles/block_plane/block_plane_0.dae");
+    QString baseModelFile = QFileInfo(model).fileName();
+
+    if(!kmz) {
+        QLOG_DEBUG() << "write kml to " << fileName;
+
+        QFile file(fileName);
+        if(!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            QLOG_ERROR() << "Unable to write to " << fileName;
+            return "";
+        }
+        QXmlStreamWriter writer(&file);
+        writeDocument(writer);
+        file.close();
+
+        // Make sure the model file is in place.
+        model.copy(QFileInfo(file).absoluteDir().absoluteFilePath(baseModelFile));
+        return fileName;
+    }
+
+    QString kmzFile(fileName);
+    if(kmzFile.endsWith(".kml")) {
+        kmzFile.replace(kmzFile.length() - 4, 4, ".kmz");
+    }
+    else if(!kmzFile.endsWith(".kmz")) {
+        kmzFile += ".kmz";
+    }
+
+    QLOG_DEBUG() << "write kmz to " << kmzFile;
+
+    // The document is compressed while it is written, no temporary kml is needed
+    QuaZip zip(kmzFile);
+    if(!zip.open(QuaZip::mdCreate)) {
+        QLOG_ERROR() << "Unable to write to " << kmzFile << " error " << zip.getZipError();
+        return "";
+    }
+
+    QuaZipFile kmlOut(&zip);
+    if(!kmlOut.open(QIODevice::WriteOnly, QuaZipNewInfo(QFileInfo(kmzFile).completeBaseName() + ".kml"))) {
+        QLOG_ERROR() << "Unable to add kml to " << kmzFile << " error " << kmlOut.getZipError();
+        zip.close();
+        return "";
+    }
+    QXmlStreamWriter writer(&kmlOut);
+    writeDocument(writer);
+    kmlOut.close();
+
+    if(model.open(QIODevice::ReadOnly)) {
+        QuaZipFile modelOut(&zip);
+        if(modelOut.open(QIODevice::WriteOnly, QuaZipNewInfo(baseModelFile))) {
+            modelOut.write(model.readAll());
+            modelOut.close();
+        }
+        model.close();
+    }
+
+    zip.close();
+    if(zip.getZipError() != 0) {
+        QLOG_ERROR() << "Error writing " << kmzFile << " error " << zip.getZipError();
+        return "";
+    }
+
+    QLOG_DEBUG() << "Done";
+    return kmzFile;
+}
+
+void KMLTrackWriter::writeDocument(QXmlStreamWriter &writer) {
+    writer.setAutoFormatting(true);
+    writer.setAutoFormattingIndent(4);
+    writer.writeStartDocument();
+    writer.writeStartElement("kml");
+    writer.writeAttribute("xmlns:xsi", "http://www.w3.org/2001/XMLSchema-instance");
+    writer.writeAttribute("xmlns:xsd", "http://www.w3.org/2001/XMLSchema");
+    writer.writeStartElement("Document");
+
+    writer.writeStartElement("Style");
+        writer.writeAttribute(QString("id"), QString("yellowLineGreenPoly"));
+        writer.writeStartElement("LineStyle");
+            writer.writeTextElement("color", "7F00FFFF");
+            writer.writeTextElement("colorMode", "normal");
+            writer.writeTextElement("width", "2");
+        writer.writeEndElement(); // LineStyle
+        writer.writeStartElement("PolyStyle");
+            writer.writeTextElement("color", "7F00FF00");
+            writer.writeTextElement("colorMode", "normal");
+        writer.writeEndElement(); // PolyStyle
+    writer.writeEndElement(); // Style
+
+    const QString summary = m_summary.summarize();
+
+    writer.writeStartElement("Folder");
+    writer.writeTextElement("name", "Flight Path");
+    writer.writeTextElement("description", summary);
+    foreach(const TrackSegment &s, m_segments) {
+        writePathElement(writer, s);
+    }
+    writer.writeEndElement(); // Folder
+
+    writer.writeStartElement("Folder");
+    writer.writeTextElement("name", "Flight Path (segmented)");
+    writer.writeTextElement("description", summary);
+    foreach(const TrackSegment &s, m_segments) {
+        writeSegmentElements(writer, s);
+    }
+    writer.writeEndElement(); // Folder
+
+    writer.writeStartElement("Folder");
+    writer.writeTextElement("name", "Attitudes");
+    int idx = 0;
+    foreach(const TrackSegment &s, m_segments) {
+        writeAttitudeElements(writer, s, idx);
+    }
+    writer.writeEndElement(); // Folder
+
+    writer.writeStartElement("Folder");
+    writer.writeTextElement("name", "EKFattitudes");
+    idx = 0;
+    foreach(const TrackSegment &s, m_segments) {
+        writeQuatAttitudeElements(writer, s, idx);
+    }
+    writer.writeEndElement(); // Folder
+
+    writer.writeStartElement("Folder");
+    writer.writeTextElement("name", "Waypoints");
+    writeWaypointsElement(writer);
+    writer.writeEndElement(); // Folder
+
+    writer.writeEndElement(); // Document
+    writer.writeEndDocument(); // kml
+}
+
+// Stream the coordinates point by point instead of building one huge string
+void KMLTrackWriter::writeCoordinates(QXmlStreamWriter &writer, const QVector<TrackPoint> &points, int first, int last) {
+    QVector<int> keep;
+    simplifyTrack(points, first, last, m_simplifyTolerance, keep);
+
+    writer.writeStartElement("coordinates");
+    writer.writeCharacters("\n");
+    QString coord;
+    foreach(int i, keep) {
+        const TrackPoint &p = points.at(i);
+        coord = QString::number(p.lng, 'f', 7);
+        coord += ',';
+        coord += QString::number(p.lat, 'f', 7);
+        coord += ',';
+        coord += QString::number(p.alt, 'f', 2);
+        coord += '\n';
+        writer.writeCharacters(coord);
+    }
+    writer.writeEndElement(); // coordinates
+}
+
+void KMLTrackWriter::writeLineStyle(QXmlStreamWriter &writer, const QString &color) {
+    writer.writeTextElement("styleUrl", "#yellowLineGreenPoly");
+
+    writer.writeStartElement("Style");
+        writer.writeStartElement("LineStyle");
+        writer.writeTextElement("color", color);
+        writer.writeTextElement("colorMode", "normal");
+        writer.writeTextElement("width", "2");
+        writer.writeEndElement(); // LineStyle
+    writer.writeEndElement(); // Style
+}
+
+// create a Placemark element containing the entire trajectory
+void KMLTrackWriter::writePathElement(QXmlStreamWriter &writer, const TrackSegment &s) {
+    if(s.gps.isEmpty()) {
+        return;
+    }
+
+    QString start = utc2KmlTimeStamp(s.gps.first().utcMs);
+    QString end = utc2KmlTimeStamp(s.gps.last().utcMs);
+
+    writer.writeStartElement("Placemark");
+
+    writer.writeStartElement("TimeSpan");
+    writer.writeTextElement("begin", start);
+    writer.writeTextElement("end", end);
+    writer.writeEndElement(); // TimeSpan
+
+    writer.writeTextElement("name", s.title);
+    writer.writeTextElement("description", start + ", " + end);
+    writeLineStyle(writer, s.color);
+
+    writer.writeStartElement("LineString");
+    writer.writeTextElement("altitudeMode", "absolute");
+    writeCoordinates(writer, s.gps, 0, s.gps.size() - 1);
+    writer.writeEndElement(); // LineString
+
+    writer.writeEndElement(); // Placemark
+}
+
+// for each 1000 milliseconds of data, create a Placemark representing that segment of the trajectory
+void KMLTrackWriter::writeSegmentElements(QXmlStreamWriter &writer, const TrackSegment &s) {
+    const int count = s.points.size();
+    int seq = 0;
+    int first = 0;
+    for(int i = 1; i <= count; ++i) {
+        // the last point of a segment is the first of the next one so that segments are contiguous
+        if(i < count && s.points.at(i - 1).utcMs < s.points.at(first).utcMs + 1000) {
+            continue;
+        }
+        const int last = i - 1;
+        if(i == count && last == first && seq > 0) {
+            break;  // nothing left behind the previous segment
+        }
+
+        writer.writeStartElement("Placemark");
+
+        writer.writeStartElement("TimeSpan");
+        writer.writeTextElement("begin", utc2KmlTimeStamp(s.points.at(first).utcMs));
+        writer.writeTextElement("end", utc2KmlTimeStamp(s.points.at(last).utcMs));
+        writer.writeEndElement(); // TimeSpan
+
+        writer.writeTextElement("name", s.title + ": " + QString::number(seq++));
+        writer.writeTextElement("description", utc2KmlTimeStamp(s.points.at(first).utcMs));
+        writeLineStyle(writer, s.color);
+
+        writer.writeStartElement("LineString");
+        writer.writeTextElement("altitudeMode", "absolute");
+        writeCoordinates(writer, s.points, first, last);
+        writer.writeEndElement(); // LineString
+
+        writer.writeEndElement(); // Placemark
+
+        first = last;
+    }
+}
+
+void KMLTrackWriter::writeModelElement(QXmlStreamWriter &writer, const TrackPoint &p, const TrackAttitude *att,
+                                       const QString &name, const QString &heading, const QString &desc) {
+    writer.writeStartElement("Placemark");
+        writer.writeStartElement("TimeStamp");
+            writer.writeTextElement("when", utc2KmlTimeStamp(p.utcMs));
+        writer.writeEndElement(); // TimeStamp
+
+        writer.writeTextElement("name", name);
+        writer.writeTextElement("visibility", "0");
+
+        if(!desc.isEmpty()) {
+            writer.writeStartElement("description");
+            writer.writeCDATA(desc);
+            writer.writeEndElement(); // description
+        }
+
+        writer.writeStartElement("Model");
+            writer.writeTextElement("altitudeMode", "absolute");
+
+            writer.writeStartElement("Location");
+                writer.writeTextElement("latitude", QString::number(p.lat, 'f', 7));
+                writer.writeTextElement("longitude", QString::number(p.lng, 'f', 7));
+                writer.writeTextElement("altitude", QString::number(p.alt, 'f', 2));
+            writer.writeEndElement(); // Location
+
+            if(att) {
+                writer.writeStartElement("Orientation");
+                writer.writeTextElement("heading", heading);
+                    // the sign of tilt and roll has to be changed
+                    writer.writeTextElement("tilt", QString::number(att->pitch * -1));
+                    writer.writeTextElement("roll", QString::number(att->roll * -1));
+                writer.writeEndElement(); // Orientation
+            }
+
+            writer.writeStartElement("Scale");
+                writer.writeTextElement("x", ".5");
+                writer.writeTextElement("y", ".5");
+                writer.writeTextElement("z", ".5");
+            writer.writeEndElement(); // Scale
+
+            writer.writeStartElement("Link");
+                writer.writeTextElement("href", "block_plane_0.dae");
+            writer.writeEndElement(); // Link
+
+        writer.writeEndElement(); // Model
+
+    writer.writeEndElement(); // Placemark
+}
+
+void KMLTrackWriter::writeAttitudeElements(QXmlStreamWriter &writer, const TrackSegment &s, int &idx) {
+    // decimate by 5 to reduce the default logging rate to 5Hz
+    for(int index = 0; index < s.points.size(); index += 5) {
+        const TrackPoint &p = s.points.at(index);
+        const float yaw = (s.mode == "AUTO")? p.attitude.navYaw: p.attitude.yaw;
+        writeModelElement(writer, p, p.hasAttitude? &p.attitude: 0,
+                          trackPointName(s.title, idx++, p, utc2KmlTimeStamp(p.utcMs)),
+                          QString::number(yaw), trackDescription(p));
+    }
+}
+
+void KMLTrackWriter::writeQuatAttitudeElements(QXmlStreamWriter &writer, const TrackSegment &s, int &idx) {
+    if(s.points.isEmpty()) {
+        return;
+    }
+
+    float curLat = s.points.first().lat;
+    float curLng = s.points.first().lng;
+
+    foreach(const TrackPoint &p, s.points) {
+        if(!p.hasQuatAttitude) {
+            continue;
+        }
+        double distance = 1000 * distanceBetween(curLat, curLng, p.lat, p.lng);
+        if(distance > m_iconInterval) {
+            curLat = p.lat;
+            curLng = p.lng;
+            writeModelElement(writer, p, &p.quatAttitude,
+                              trackPointName(s.title, idx++, p, utc2KmlTimeStamp(p.utcMs)),
+                              QString::number(p.quatAttitude.yaw), trackRPYdescription(p));
+        }
+    }
+}
+
+void KMLTrackWriter::writeWaypointsElement(QXmlStreamWriter &writer) {
+    writer.writeStartElement("Placemark");
+        writer.writeTextElement("name", "Waypoints");
+
+        writer.writeStartElement("Style");
+            writer.writeStartElement("LineStyle");
+                writer.writeTextElement("color", "FFFFFFFF");
+                writer.writeTextElement("colorMode", "normal");
+                writer.writeTextElement("width", "2");
+            writer.writeEndElement(); // LineStyle
+
+            writer.writeStartElement("PolyStyle");
+                writer.writeTextElement("color", "7F000000");
+                writer.writeTextElement("colorMode", "normal");
+            writer.writeEndElement(); // PolyStyle
+        writer.writeEndElement(); // Style
+
+        writer.writeStartElement("LineString");
+            writer.writeTextElement("extrude", "1");
+            writer.writeTextElement("altitudeMode", "relativeToGround");
+            QString coordString;
+            foreach(const TrackPoint &p, m_waypoints) {
+                coordString += QString("%1,%2,%3 ").arg(p.lng, 0, 'f', 7).arg(p.lat, 0, 'f', 7).arg(p.alt);
+            }
+            writer.writeTextElement("coordinates", coordString);
+        writer.writeEndElement(); // LineString
+
+    writer.writeEndElement(); // Placemark
+}
+
 } // namespace kml
@@ -13,6 +13,7 @@ extern mavlink_status_t m_mavlink_status[MAVLINK_COMM_NUM_BUFFERS]; // defined i
 #include <QStringList>
 #include <QXmlStreamWriter>
 #include <QPointer>
+#include <QVector>
 
 #include "logdata.h"
 
@@ -323,6 +324,7 @@ struct SummaryData {
     {}
 
     void add(GPSRecord& gps);
+    void add(float speed, float alt, float lat, float lng);
     QString summarize();
 };
 
@@ -383,6 +385,114 @@ private:
     double m_iconInterval;
 };
 
+/**
+ * @brief Attitude of the vehicle in degrees as used by the KMLTrackWriter.
+ */
+struct TrackAttitude {
+    float roll;
+    float pitch;
+    float yaw;
+    float rollIn;
+    float pitchIn;
+    float yawIn;
+    float navYaw;
+
+    TrackAttitude()
+    : roll(0), pitch(0), yaw(0), rollIn(0), pitchIn(0), yawIn(0), navYaw(0)
+    {}
+};
+
+/**
+ * @brief A position of the vehicle together with the GPS and attitude data belonging
+ * to it. Unlike GPSRecord it holds plain numbers, so a whole flight can be collected
+ * without keeping a hashtable of strings per point.
+ */
+struct TrackPoint {
+    double lat;
+    double lng;
+    double alt;
+    qint64 utcMs;       // UTC time in msec
+    double timeSec;     // log time stamp in seconds
+    float speed;
+    float course;
+    float vz;
+    float hdop;
+
+    bool hasAttitude;
+    bool hasQuatAttitude;
+    TrackAttitude attitude;       // from ATT
+    TrackAttitude quatAttitude;   // from the EKF quaternion (XKQ1 or NKQ1)
+
+    TrackPoint()
+    : lat(0), lng(0), alt(0), utcMs(0), timeSec(0), speed(0), course(0), vz(0), hdop(0),
+      hasAttitude(false), hasQuatAttitude(false)
+    {}
+};
+
+/**
+ * @brief The part of a flight flown in one flight mode.
+ */
+struct TrackSegment {
+    QString title;
+    QString mode;
+    QString color;
+    QVector<TrackPoint> gps;      // GPS fixes, used for the complete flight path
+    QVector<TrackPoint> points;   // POS positions, used for segments and attitude models
+};
+
+/**
+ * @brief Writes a KML or KMZ file from positions which are already typed.
+ *
+ * This is the counterpart of the KMLCreator for callers which have the log in memory
+ * and can hand over numbers instead of log lines. Call startSegment() for every flight
+ * mode change, add the positions with addGps() / addPoint() and the mission with
+ * addWaypoint(). finish() streams all placemarks into the file. Path and segment line
+ * strings are simplified with the given tolerance, a tolerance of 0 keeps all points.
+ * If kmz is true the KML document and the model are written straight into a .kmz
+ * archive without a temporary file.
+ */
+class KMLTrackWriter {
+public:
+    KMLTrackWriter(MAV_TYPE mav_type, double iconInterval, double simplifyTolerance);
+
+    void startSegment(int modeNum);
+    void addGps(const TrackPoint &p);
+    void addPoint(const TrackPoint &p);
+    void addWaypoint(double lat, double lng, double alt);
+
+    const TrackPoint *lastGps() const;
+
+    QString finish(const QString &fileName, bool kmz);
+
+private:
+    void writeDocument(QXmlStreamWriter &writer);
+    void writeCoordinates(QXmlStreamWriter &writer, const QVector<TrackPoint> &points, int first, int last);
+    void writeLineStyle(QXmlStreamWriter &writer, const QString &color);
+    void writePathElement(QXmlStreamWriter &writer, const TrackSegment &s);
+    void writeSegmentElements(QXmlStreamWriter &writer, const TrackSegment &s);
+    void writeModelElement(QXmlStreamWriter &writer, const TrackPoint &p, const TrackAttitude *att,
+                           const QString &name, const QString &heading, const QString &desc);
+    void writeAttitudeElements(QXmlStreamWriter &writer, const TrackSegment &s, int &idx);
+    void writeQuatAttitudeElements(QXmlStreamWriter &writer, const TrackSegment &s, int &idx);
+    void writeWaypointsElement(QXmlStreamWriter &writer);
+
+    QVector<TrackSegment> m_segments;
+    QVector<TrackPoint> m_waypoints;
+    SummaryData m_summary;
+    TrackPoint m_lastGps;
+    bool m_hasGps;
+
+    MAV_TYPE m_mav_type;
+    double m_iconInterval;
+    double m_simplifyTolerance;
+};
+
+/**
+ * @brief Converts an EKF quaternion to roll, pitch and yaw in degrees the way Google Earth
+ * expects them (with special handling near +-90 degrees pitch).
+ */
+void quatToKmlEuler(float q1, float q2, float q3, float q4, float &roll, float &pitch, float &yaw);
+
 } // namespace kml
 
 #endif // KMLCREATOR_H
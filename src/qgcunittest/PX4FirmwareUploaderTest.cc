@@ -0,0 +1,302 @@
+#include "PX4FirmwareUploaderTest.h"
+#include "PX4FirmwareUploader.h"
+
+#include <QSocketNotifier>
+#include <QTemporaryFile>
+#include <QTimer>
+#include <cstdlib>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+/** @brief Byte at a time CRC32 as the bootloader computes it, the reference for the sliced one */
+quint32 referenceCrc32(quint32 state, const QByteArray &bytes)
+{
+    for (int i = 0; i < bytes.size(); i++)
+    {
+        state ^= static_cast<uchar>(bytes[i]);
+        for (int bit = 0; bit < 8; bit++)
+        {
+            state = (state & 1) ? (0xedb88320 ^ (state >> 1)) : (state >> 1);
+        }
+    }
+    return state;
+}
+
+QByteArray randomBytes(int size)
+{
+    QByteArray bytes(size, 0);
+    for (int i = 0; i < size; i++)
+    {
+        bytes[i] = static_cast<char>(qrand());
+    }
+    return bytes;
+}
+
+#ifdef Q_OS_UNIX
+/** @brief Answers the PX4 bootloader protocol on the master side of a pseudo terminal */
+class BootloaderEmulator
+{
+public:
+    static const int FlashSize = 256 * 1024;
+
+    explicit BootloaderEmulator(int bootloaderRev) :
+        maxPendingFrames(0),
+        maxFrameSize(0),
+        rebooted(false),
+        m_master(-1),
+        m_slave(-1),
+        m_bootloaderRev(bootloaderRev),
+        m_pendingFrames(0)
+    {
+        m_master = posix_openpt(O_RDWR | O_NOCTTY);
+        if (m_master < 0 || grantpt(m_master) != 0 || unlockpt(m_master) != 0)
+        {
+            return;
+        }
+        fcntl(m_master, F_SETFL, fcntl(m_master, F_GETFL) | O_NONBLOCK);
+        slaveName = QString::fromLocal8Bit(ptsname(m_master));
+
+        // Keeps the terminal open (and raw) while the uploader opens and closes it
+        m_slave = ::open(ptsname(m_master), O_RDWR | O_NOCTTY);
+        termios settings;
+        tcgetattr(m_slave, &settings);
+        cfmakeraw(&settings);
+        tcsetattr(m_slave, TCSANOW, &settings);
+
+        m_notifier.reset(new QSocketNotifier(m_master, QSocketNotifier::Read));
+        QObject::connect(m_notifier.data(), &QSocketNotifier::activated, [this]() { readable(); });
+
+        // Flash writes take time, frames are acknowledged one per tick
+        m_ackTimer.setInterval(1);
+        QObject::connect(&m_ackTimer, &QTimer::timeout, [this]() { acknowledgeFrame(); });
+    }
+
+    ~BootloaderEmulator()
+    {
+        m_notifier.reset();
+        if (m_slave >= 0)
+        {
+            ::close(m_slave);
+        }
+        if (m_master >= 0)
+        {
+            ::close(m_master);
+        }
+    }
+
+    bool isOpen() const { return m_slave >= 0; }
+
+    QString slaveName;
+    QByteArray flash;
+    int maxPendingFrames;
+    int maxFrameSize;
+    bool rebooted;
+
+private:
+    void readable()
+    {
+        char buffer[4096];
+        ssize_t size;
+        while ((size = ::read(m_master, buffer, sizeof(buffer))) > 0)
+        {
+            m_input.append(buffer, static_cast<int>(size));
+        }
+        while (parseCommand())
+        {
+        }
+    }
+
+    bool parseCommand()
+    {
+        if (m_input.size() < 2)
+        {
+            return false;
+        }
+        const uchar command = static_cast<uchar>(m_input[0]);
+        int length = 2;
+        switch (command)
+        {
+        case 0x21:  // GET_SYNC
+        case 0x23:  // CHIP_ERASE
+            reply(QByteArray());
+            break;
+        case 0x22:  // GET_DEVICE
+        {
+            length = 3;
+            if (m_input.size() < length)
+            {
+                return false;
+            }
+            const uchar info = static_cast<uchar>(m_input[1]);
+            reply(word(info == 0x04 ? FlashSize : (info == 0x02 ? 9 : (info == 0x01 ? m_bootloaderRev : 5))));
+            break;
+        }
+        case 0x2B:  // GET_SN
+            length = 6;
+            if (m_input.size() < length)
+            {
+                return false;
+            }
+            reply(word(0x12345678));
+            break;
+        case 0x27:  // PROG_MULTI
+        {
+            length = static_cast<uchar>(m_input[1]) + 3;
+            if (m_input.size() < length)
+            {
+                return false;
+            }
+            flash.append(m_input.mid(2, length - 3));
+            maxFrameSize = qMax(maxFrameSize, length - 3);
+            maxPendingFrames = qMax(maxPendingFrames, ++m_pendingFrames);
+            m_ackTimer.start();
+            break;
+        }
+        case 0x29:  // GET_CRC
+        {
+            QByteArray padded = flash;
+            padded.append(QByteArray(FlashSize - flash.size(), static_cast<char>(0xFF)));
+            reply(word(referenceCrc32(0, padded)));
+            break;
+        }
+        case 0x30:  // REBOOT
+            rebooted = true;
+            break;
+        default:
+            QWARN(qPrintable(QString("Unknown bootloader command %1").arg(command, 0, 16)));
+            break;
+        }
+        m_input.remove(0, length);
+        return true;
+    }
+
+    void acknowledgeFrame()
+    {
+        if (m_pendingFrames > 0)
+        {
+            m_pendingFrames--;
+            reply(QByteArray());
+        }
+        if (m_pendingFrames == 0)
+        {
+            m_ackTimer.stop();
+        }
+    }
+
+    static QByteArray word(quint32 value)
+    {
+        QByteArray bytes;
+        bytes.append(static_cast<char>(value & 0xff));
+        bytes.append(static_cast<char>((value >> 8) & 0xff));
+        bytes.append(static_cast<char>((value >> 16) & 0xff));
+        bytes.append(static_cast<char>((value >> 24) & 0xff));
+        return bytes;
+    }
+
+    void reply(QByteArray bytes)
+    {
+        bytes.append(static_cast<char>(0x12));  // INSYNC
+        bytes.append(static_cast<char>(0x10));  // OK
+        if (::write(m_master, bytes.constData(), bytes.size()) != bytes.size())
+        {
+            QWARN("Bootloader emulator could not write reply");
+        }
+    }
+
+    int m_master;
+    int m_slave;
+    int m_bootloaderRev;
+    int m_pendingFrames;
+    QByteArray m_input;
+    QScopedPointer<QSocketNotifier> m_notifier;
+    QTimer m_ackTimer;
+};
+
+const int BootloaderEmulator::FlashSize;
+#endif
+}
+
+PX4FirmwareUploaderTest::PX4FirmwareUploaderTest()
+{
+}
+
+void PX4FirmwareUploaderTest::crc32_test()
+{
+    const QByteArray bytes = randomBytes(4096);
+    for (int offset = 0; offset < 9; offset++)
+    {
+        for (int length = 0; length < 300; length += 7)
+        {
+            const QByteArray part = bytes.mid(offset, length);
+            QCOMPARE(PX4FirmwareUploader::crc32(0x1234, part.constData(), part.size()), referenceCrc32(0x1234, part));
+        }
+    }
+
+    // Continuing a CRC over pieces gives the CRC of the whole
+    quint32 state = 0;
+    for (int offset = 0; offset < bytes.size(); offset += 252)
+    {
+        const QByteArray part = bytes.mid(offset, 252);
+        state = PX4FirmwareUploader::crc32(state, part.constData(), part.size());
+    }
+    QCOMPARE(state, referenceCrc32(0, bytes));
+}
+
+void PX4FirmwareUploaderTest::flash_test()
+{
+    flash(PX4FirmwareUploader::s_windowedBootloaderRev, PX4FirmwareUploader::s_progMultiMax,
+          PX4FirmwareUploader::s_sendWindow);
+}
+
+void PX4FirmwareUploaderTest::flashOldBootloader_test()
+{
+    // Older bootloaders get the small frames acknowledged one by one
+    flash(PX4FirmwareUploader::s_windowedBootloaderRev - 1, PX4FirmwareUploader::s_progMultiLegacy, 1);
+}
+
+void PX4FirmwareUploaderTest::flash(int bootloaderRev, int frameSize, int sendWindow)
+{
+#ifndef Q_OS_UNIX
+    Q_UNUSED(bootloaderRev)
+    Q_UNUSED(frameSize)
+    Q_UNUSED(sendWindow)
+    QSKIP("Needs a pseudo terminal");
+#else
+    BootloaderEmulator bootloader(bootloaderRev);
+    QVERIFY(bootloader.isOpen());
+
+    // Not a multiple of 4 or of the frame size, so padding and the short last frame are used
+    const QByteArray image = randomBytes(100 * 1024 + 3);
+    QTemporaryFile px4File;
+    QVERIFY(px4File.open());
+    px4File.write(QString("{\"board_id\": 9, \"image_size\": %1, \"description\": \"emulator\", \"image\": \"%2\"}")
+                  .arg(image.size()).arg(QString::fromLatin1(qCompress(image).mid(4).toBase64())).toLatin1());
+    px4File.close();
+
+    PX4FirmwareUploader uploader;
+    QSignalSpy completeSpy(&uploader, SIGNAL(complete()));
+    QSignalSpy errorSpy(&uploader, SIGNAL(error(QString)));
+    uploader.setPortName(bootloader.slaveName);
+    uploader.loadFile(px4File.fileName());
+
+    QVERIFY(completeSpy.wait(60000));
+    QCOMPARE(errorSpy.count(), 0);
+    QTRY_VERIFY(bootloader.rebooted);
+
+    QByteArray padded = image;
+    padded.append(QByteArray(1, static_cast<char>(0xFF)));
+    QCOMPARE(bootloader.flash, padded);
+    QCOMPARE(bootloader.maxFrameSize, frameSize);
+    QVERIFY(bootloader.maxPendingFrames <= sendWindow);
+    if (sendWindow > 1)
+    {
+        QVERIFY(bootloader.maxPendingFrames > 1);
+    }
+#endif
+}
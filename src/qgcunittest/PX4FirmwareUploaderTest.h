@@ -0,0 +1,36 @@
+#ifndef PX4FIRMWAREUPLOADERTEST_H
+#define PX4FIRMWAREUPLOADERTEST_H
+
+#include <QObject>
+#include <QtCore/QString>
+#include <QtTest/QtTest>
+
+#include "AutoTest.h"
+
+/**
+ * @brief Tests of the PX4 firmware uploader
+ *
+ * The flash test runs the uploader against a bootloader emulator on a
+ * pseudo terminal, so the whole protocol from sync to reboot is covered
+ * without hardware. The emulator acknowledges PROG_MULTI frames with a
+ * delay, which makes the uploader's send window observable. Frame size
+ * and window depend on the bootloader revision the emulator reports.
+ */
+class PX4FirmwareUploaderTest : public QObject
+{
+    Q_OBJECT
+public:
+    PX4FirmwareUploaderTest();
+
+private slots:
+    void crc32_test();
+    void flash_test();
+    void flashOldBootloader_test();
+
+private:
+    /** @brief Flashes an image through the emulator and checks the frames the uploader used */
+    void flash(int bootloaderRev, int frameSize, int sendWindow);
+};
+
+DECLARE_TEST(PX4FirmwareUploaderTest)
+#endif // PX4FIRMWAREUPLOADERTEST_H
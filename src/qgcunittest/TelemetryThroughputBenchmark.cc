@@ -0,0 +1,390 @@
+#include "TelemetryThroughputBenchmark.h"
+#include "LinkManager.h"
+#include "MAVLinkDecoder.h"
+#include "UASInterface.h"
+#include "UASObject.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QtEndian>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+
+#ifdef APM_COUNT_ALLOCATIONS
+// Counting allocations needs a replacement of the global operator new, which would affect
+// every test in the binary. It is only built on request (qmake DEFINES+=APM_COUNT_ALLOCATIONS)
+// and only counts on a thread inside an AllocationCounter scope.
+static thread_local quint64 *t_allocationCount = nullptr;
+
+void* operator new(std::size_t size)
+{
+    if (t_allocationCount)
+    {
+        ++*t_allocationCount;
+    }
+    if (void *ptr = std::malloc(size ? size : 1))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+#endif
+
+namespace
+{
+/** @brief Minimal link the benchmark hands to the receive path */
+class BenchmarkLink : public LinkInterface
+{
+public:
+    void disableTimeouts() override {}
+    void enableTimeouts() override {}
+    int getId() const override { return 99; }
+    QString getName() const override { return "BenchmarkLink"; }
+    QString getShortName() const override { return "Bench"; }
+    QString getDetail() const override { return "benchmark"; }
+    void requestReset() override {}
+    bool isConnected() const override { return true; }
+    qint64 getConnectionSpeed() const override { return 0; }
+    qint64 bytesAvailable() override { return 0; }
+    bool connect() override { return true; }
+    bool disconnect() override { return true; }
+    void writeBytes(const char *bytes, qint64 length) override { Q_UNUSED(bytes); Q_UNUSED(length); }
+};
+
+/** @brief Counts the heap allocations of the current thread while it exists */
+class AllocationCounter
+{
+public:
+    AllocationCounter() :
+        m_count(0)
+    {
+#ifdef APM_COUNT_ALLOCATIONS
+        m_outer = t_allocationCount;
+        t_allocationCount = &m_count;
+#endif
+    }
+
+    ~AllocationCounter()
+    {
+#ifdef APM_COUNT_ALLOCATIONS
+        t_allocationCount = m_outer;
+#endif
+    }
+
+    /** @brief false if the build does not count allocations */
+    static bool isAvailable()
+    {
+#ifdef APM_COUNT_ALLOCATIONS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    quint64 count() const { return m_count; }
+
+private:
+    Q_DISABLE_COPY(AllocationCounter)
+
+    quint64 m_count;
+#ifdef APM_COUNT_ALLOCATIONS
+    quint64 *m_outer;
+#endif
+};
+
+void appendRecord(QByteArray &log, quint64 timestamp, const mavlink_message_t &message)
+{
+    uchar stamp[8];
+    qToBigEndian(timestamp, stamp);
+    uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+    const int length = mavlink_msg_to_send_buffer(buffer, &message);
+    log.append(reinterpret_cast<const char*>(stamp), sizeof(stamp));
+    log.append(reinterpret_cast<const char*>(buffer), length);
+}
+}
+
+const int TelemetryThroughputBenchmark::LatencyHistogram::BucketCount;
+
+TelemetryThroughputBenchmark::LatencyHistogram::LatencyHistogram() :
+    m_count(0),
+    m_total(0),
+    m_max(0)
+{
+    memset(m_buckets, 0, sizeof(m_buckets));
+}
+
+void TelemetryThroughputBenchmark::LatencyHistogram::add(qint64 nsecs)
+{
+    int bucket = 0;
+    while (bucket < BucketCount - 1 && (Q_INT64_C(1) << (bucket + 1)) <= nsecs)
+    {
+        ++bucket;
+    }
+    ++m_buckets[bucket];
+    ++m_count;
+    m_total += nsecs;
+    m_max = qMax(m_max, nsecs);
+}
+
+qint64 TelemetryThroughputBenchmark::LatencyHistogram::percentile(double fraction) const
+{
+    const quint64 target = static_cast<quint64>(std::ceil(m_count * fraction));
+    quint64 seen = 0;
+    for (int bucket = 0; bucket < BucketCount; ++bucket)
+    {
+        seen += m_buckets[bucket];
+        if (seen >= target && seen > 0)
+        {
+            // Upper bound of the bucket
+            return qMin(Q_INT64_C(1) << (bucket + 1), m_max);
+        }
+    }
+    return m_max;
+}
+
+QString TelemetryThroughputBenchmark::LatencyHistogram::toString(const QString &stage) const
+{
+    QString result = QString("%1: %2 calls, mean %3 ns, p50 <= %4 ns, p90 <= %5 ns, p99 <= %6 ns, max %7 ns\n")
+            .arg(stage, -10).arg(m_count)
+            .arg(m_count ? m_total / static_cast<qint64>(m_count) : 0)
+            .arg(percentile(0.5)).arg(percentile(0.9)).arg(percentile(0.99)).arg(m_max);
+    for (int bucket = 0; bucket < BucketCount; ++bucket)
+    {
+        if (m_buckets[bucket] == 0)
+        {
+            continue;
+        }
+        const int width = static_cast<int>((50 * m_buckets[bucket]) / m_count);
+        result += QString("    < %1 ns %2 %3\n").arg(Q_INT64_C(1) << (bucket + 1), 10)
+                .arg(m_buckets[bucket], 9).arg(QString(qMax(width, 1), '#'));
+    }
+    return result;
+}
+
+TelemetryThroughputBenchmark::TelemetryThroughputBenchmark() :
+    m_messagePending(false)
+{
+    memset(&m_lastMessage, 0, sizeof(m_lastMessage));
+}
+
+void TelemetryThroughputBenchmark::initTestCase()
+{
+    // Too slow for every unit test run, the benchmark is opt-in
+    const QString fileName = QString::fromLocal8Bit(qgetenv("APM_BENCHMARK_TLOG"));
+    if (fileName.isEmpty() && !qEnvironmentVariableIsSet("APM_BENCHMARK"))
+    {
+        QSKIP("Set APM_BENCHMARK or APM_BENCHMARK_TLOG to run the telemetry benchmark");
+    }
+    if (!fileName.isEmpty())
+    {
+        QFile file(fileName);
+        QVERIFY2(file.open(QIODevice::ReadOnly), qPrintable("Can not open " + fileName));
+        m_log = file.readAll();
+        qDebug() << "Benchmarking" << fileName;
+    }
+    else
+    {
+        createSyntheticLog(200000);
+        qDebug() << "APM_BENCHMARK_TLOG not set, benchmarking a synthetic log";
+    }
+    QVERIFY(m_index.build(reinterpret_cast<const uchar*>(m_log.constData()), m_log.size()));
+}
+
+void TelemetryThroughputBenchmark::createSyntheticLog(int frameCount)
+{
+    m_log.clear();
+    m_log.reserve(frameCount * 48);
+    quint64 timestamp = Q_UINT64_C(1500000000000000);
+    mavlink_message_t message;
+
+    for (int i = 0; i < frameCount; ++i)
+    {
+        // Roughly the stream mix of a copter with SR rates of 10Hz
+        switch (i % 10)
+        {
+        case 0:
+        {
+            mavlink_heartbeat_t heartbeat;
+            memset(&heartbeat, 0, sizeof(heartbeat));
+            heartbeat.type = MAV_TYPE_QUADROTOR;
+            heartbeat.autopilot = MAV_AUTOPILOT_ARDUPILOTMEGA;
+            heartbeat.base_mode = MAV_MODE_FLAG_CUSTOM_MODE_ENABLED;
+            heartbeat.system_status = MAV_STATE_ACTIVE;
+            heartbeat.mavlink_version = 3;
+            mavlink_msg_heartbeat_encode_chan(1, 1, MAVLINK_COMM_3, &message, &heartbeat);
+            break;
+        }
+        case 1:
+        case 5:
+        {
+            mavlink_attitude_t attitude;
+            memset(&attitude, 0, sizeof(attitude));
+            attitude.time_boot_ms = i;
+            attitude.roll = std::sin(i * 0.001f);
+            attitude.pitch = std::cos(i * 0.001f);
+            attitude.yaw = 0.5f;
+            mavlink_msg_attitude_encode_chan(1, 1, MAVLINK_COMM_3, &message, &attitude);
+            break;
+        }
+        case 2:
+        {
+            mavlink_gps_raw_int_t gps;
+            memset(&gps, 0, sizeof(gps));
+            gps.time_usec = timestamp;
+            gps.fix_type = GPS_FIX_TYPE_3D_FIX;
+            gps.lat = -353632610 + i;
+            gps.lon = 1491652300 + i;
+            gps.alt = 584000;
+            gps.satellites_visible = 12;
+            mavlink_msg_gps_raw_int_encode_chan(1, 1, MAVLINK_COMM_3, &message, &gps);
+            break;
+        }
+        case 3:
+        case 7:
+        {
+            mavlink_vfr_hud_t hud;
+            memset(&hud, 0, sizeof(hud));
+            hud.groundspeed = 5.0f;
+            hud.alt = 100.0f;
+            hud.heading = i % 360;
+            mavlink_msg_vfr_hud_encode_chan(1, 1, MAVLINK_COMM_3, &message, &hud);
+            break;
+        }
+        case 4:
+        {
+            mavlink_sys_status_t status;
+            memset(&status, 0, sizeof(status));
+            status.voltage_battery = 12600;
+            status.current_battery = 1500;
+            status.battery_remaining = 80;
+            mavlink_msg_sys_status_encode_chan(1, 1, MAVLINK_COMM_3, &message, &status);
+            break;
+        }
+        default:
+        {
+            mavlink_raw_imu_t imu;
+            memset(&imu, 0, sizeof(imu));
+            imu.time_usec = timestamp;
+            imu.xacc = static_cast<qint16>(i % 100);
+            imu.zacc = -1000;
+            mavlink_msg_raw_imu_encode_chan(1, 1, MAVLINK_COMM_3, &message, &imu);
+            break;
+        }
+        }
+        appendRecord(m_log, timestamp, message);
+        timestamp += 10000;
+    }
+}
+
+void TelemetryThroughputBenchmark::messageReceived(LinkInterface *link, mavlink_message_t message)
+{
+    Q_UNUSED(link);
+    m_lastMessage = message;
+    m_messagePending = true;
+}
+
+void TelemetryThroughputBenchmark::receivePath_benchmark()
+{
+    BenchmarkLink link;
+    MAVLinkProtocol protocol;
+    protocol.setConnectionManager(LinkManager::instance());
+    MAVLinkDecoder decoder;
+    connect(&protocol, SIGNAL(messageReceived(LinkInterface*,mavlink_message_t)),
+            this, SLOT(messageReceived(LinkInterface*,mavlink_message_t)));
+
+    // UAS objects are created by the protocol on the first heartbeat and connected
+    // to it. They get detached again, so every stage can be timed on its own, and
+    // are removed before the stack protocol and link go away.
+    QHash<int, UASInterface*> systems;
+
+    LatencyHistogram protocolStage;
+    LatencyHistogram decoderStage;
+    LatencyHistogram uasStage;
+    quint64 messages = 0;
+
+    const char *data = m_log.constData();
+    QElapsedTimer total;
+    QElapsedTimer stage;
+    total.start();
+
+    AllocationCounter allocations;
+    for (int i = 0; i < m_index.size(); ++i)
+    {
+        const TLogIndex::Entry &entry = m_index.at(i);
+        const int length = TLogIndex::frameLength(reinterpret_cast<const uchar*>(data + entry.offset),
+                                                  m_log.size() - entry.offset);
+        const QByteArray frame = QByteArray::fromRawData(data + entry.offset, length);
+
+        m_messagePending = false;
+        stage.start();
+        protocol.receiveBytes(&link, frame);
+        protocolStage.add(stage.nsecsElapsed());
+
+        if (!m_messagePending)
+        {
+            continue;
+        }
+        ++messages;
+
+        stage.start();
+        decoder.receiveMessage(&link, m_lastMessage);
+        decoderStage.add(stage.nsecsElapsed());
+
+        UASInterface *uas = systems.value(m_lastMessage.sysid, nullptr);
+        if (uas)
+        {
+            stage.start();
+            uas->receiveMessage(&link, m_lastMessage);
+            UASObject *obj = LinkManager::instance()->getUasObject(m_lastMessage.sysid);
+            if (obj)
+            {
+                obj->messageReceived(&link, m_lastMessage);
+            }
+            uasStage.add(stage.nsecsElapsed());
+        }
+        else if ((uas = LinkManager::instance()->getUas(m_lastMessage.sysid)) != nullptr)
+        {
+            // Only the receivers created for this system are detached, everything else
+            // connected to the protocol stays untouched
+            systems.insert(m_lastMessage.sysid, uas);
+            disconnect(&protocol, SIGNAL(messageReceived(LinkInterface*,mavlink_message_t)), uas, nullptr);
+            UASObject *obj = LinkManager::instance()->getUasObject(m_lastMessage.sysid);
+            if (obj)
+            {
+                disconnect(&protocol, SIGNAL(messageReceived(LinkInterface*,mavlink_message_t)), obj, nullptr);
+            }
+        }
+    }
+
+    const qint64 elapsed = total.nsecsElapsed();
+    foreach (int sysid, systems.keys())
+    {
+        LinkManager::instance()->removeUAS(sysid);
+    }
+    QVERIFY(messages > 0);
+
+    QString report = QString("\n%1 frames, %2 messages in %3 ms: %4 messages/s, ")
+            .arg(m_index.size()).arg(messages).arg(elapsed / 1000000)
+            .arg(static_cast<quint64>(messages * 1e9 / qMax<qint64>(elapsed, 1)));
+    if (AllocationCounter::isAvailable())
+    {
+        report += QString("%1 allocations/message\n")
+                .arg(static_cast<double>(allocations.count()) / messages, 0, 'f', 2);
+    }
+    else
+    {
+        report += "allocations not counted, build with DEFINES+=APM_COUNT_ALLOCATIONS\n";
+    }
+    report += protocolStage.toString("protocol");
+    report += decoderStage.toString("decoder");
+    report += uasStage.toString("uas");
+    qDebug().noquote() << report;
+
+    QTest::setBenchmarkResult(messages * 1e9 / qMax<qint64>(elapsed, 1), QTest::Events);
+}
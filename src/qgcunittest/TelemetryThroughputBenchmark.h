@@ -0,0 +1,70 @@
+#ifndef TELEMETRYTHROUGHPUTBENCHMARK_H
+#define TELEMETRYTHROUGHPUTBENCHMARK_H
+
+#include <QObject>
+#include <QtCore/QString>
+#include <QtTest/QtTest>
+#include <QByteArray>
+
+#include "MAVLinkProtocol.h"
+#include "TLogIndex.h"
+#include "AutoTest.h"
+
+class UASInterface;
+
+/**
+ * @brief Headless benchmark of the telemetry receive path
+ *
+ * Feeds a tlog frame by frame through MAVLinkProtocol::receiveBytes,
+ * MAVLinkDecoder::receiveMessage and UAS::receiveMessage and reports
+ * messages per second, heap allocations per message and a latency
+ * histogram per stage. Allocations are only counted in builds with
+ * APM_COUNT_ALLOCATIONS defined, as that replaces the global operator new.
+ *
+ * The benchmark is skipped unless APM_BENCHMARK or APM_BENCHMARK_TLOG is
+ * set in the environment. The log is taken from APM_BENCHMARK_TLOG. Without
+ * it a synthetic log with a typical ArduPilot stream mix is generated, so
+ * results stay comparable between runs.
+ */
+class TelemetryThroughputBenchmark : public QObject
+{
+    Q_OBJECT
+public:
+    TelemetryThroughputBenchmark();
+
+    /** @brief Log2 bucketed latency histogram in nanoseconds */
+    class LatencyHistogram
+    {
+    public:
+        static const int BucketCount = 32;
+        LatencyHistogram();
+        void add(qint64 nsecs);
+        quint64 count() const { return m_count; }
+        qint64 total() const { return m_total; }
+        qint64 percentile(double fraction) const;
+        QString toString(const QString &stage) const;
+    private:
+        quint64 m_buckets[BucketCount];
+        quint64 m_count;
+        qint64 m_total;
+        qint64 m_max;
+    };
+
+public slots:
+    void messageReceived(LinkInterface *link, mavlink_message_t message);
+
+private slots:
+    void initTestCase();
+    void receivePath_benchmark();
+
+private:
+    void createSyntheticLog(int frameCount);
+
+    QByteArray m_log;
+    TLogIndex m_index;
+    bool m_messagePending;
+    mavlink_message_t m_lastMessage;
+};
+
+DECLARE_TEST(TelemetryThroughputBenchmark)
+#endif // TELEMETRYTHROUGHPUTBENCHMARK_H
@@ -1,6 +1,10 @@
 #include "UASUnitTest.h"
+#include "ImageStreamAssembler.h"
+#include "LogCompressor.h"
 #include <stdio.h>
 #include <QObject>
+#include <QTemporaryDir>
+#include <limits>
 UASUnitTest::UASUnitTest()
 {
 }
@@ -288,6 +292,256 @@ void UASUnitTest::signalWayPoint_test()
     delete wp2;
 }
 
+void UASUnitTest::saveLoadWaypoints_test()
+{
+    UASWaypointManager* wpm = uas->getWaypointManager();
+    wpm->addWaypointEditable(new Waypoint(0, 47.3977419, 8.5455938, 30.0, 1.0, 2.0, 3.0, 90.0, true, true, MAV_FRAME_GLOBAL_RELATIVE_ALT, MAV_CMD_NAV_WAYPOINT), false);
+    wpm->addWaypointEditable(new Waypoint(1, -33.8688197, 151.2092955, 120.5, 0.0, 0.0, 25.0, 0.0, false, false, MAV_FRAME_GLOBAL, MAV_CMD_NAV_LOITER_UNLIM), false);
+    wpm->addWaypointEditable(new Waypoint(2, 0.0, 0.0, 0.0, 5.0, 0.0, 0.0, 0.0, true, false, MAV_FRAME_MISSION, MAV_CMD_DO_JUMP), false);
+    const QList<Waypoint*> saved = wpm->getWaypointEditableList();
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QStringList files;
+    files << dir.path() + "/mission.txt" << dir.path() + "/mission.wpb";
+
+    // Saved once, then loaded into the other manager so the loaded list can be compared with the saved one
+    foreach (const QString &file, files)
+    {
+        wpm->saveWaypoints(file);
+        QCOMPARE(UASWaypointManager::isBinaryMissionFile(file), file.endsWith(".wpb"));
+
+        UAS uas2(mav, UASID + 1);
+        UASWaypointManager* loader = uas2.getWaypointManager();
+        loader->addWaypointEditable(new Waypoint(), false);
+        QSignalSpy listChanged(loader, SIGNAL(waypointEditableListChanged()));
+        loader->loadWaypoints(file);
+        QCOMPARE(listChanged.count(), 1);
+
+        const QList<Waypoint*> loaded = loader->getWaypointEditableList();
+        QCOMPARE(loaded.count(), saved.count());
+        for (int i = 0; i < saved.count(); i++)
+        {
+            QCOMPARE(loaded[i]->getId(), static_cast<quint16>(i));
+            QCOMPARE(loaded[i]->getFrame(), saved[i]->getFrame());
+            QCOMPARE(loaded[i]->getAction(), saved[i]->getAction());
+            QCOMPARE(loaded[i]->getCurrent(), saved[i]->getCurrent());
+            QCOMPARE(loaded[i]->getAutoContinue(), saved[i]->getAutoContinue());
+            QCOMPARE(loaded[i]->getParam1(), saved[i]->getParam1());
+            QCOMPARE(loaded[i]->getParam2(), saved[i]->getParam2());
+            QCOMPARE(loaded[i]->getParam3(), saved[i]->getParam3());
+            QCOMPARE(loaded[i]->getParam4(), saved[i]->getParam4());
+            QCOMPARE(loaded[i]->getX(), saved[i]->getX());
+            QCOMPARE(loaded[i]->getY(), saved[i]->getY());
+            QCOMPARE(loaded[i]->getZ(), saved[i]->getZ());
+        }
+    }
+
+    // A file which is no mission keeps the current list
+    QFile garbage(dir.path() + "/garbage.txt");
+    QVERIFY(garbage.open(QIODevice::WriteOnly));
+    garbage.write("not a mission\n");
+    garbage.close();
+    wpm->loadWaypoints(garbage.fileName());
+    QCOMPARE(wpm->getWaypointEditableList().count(), saved.count());
+}
+
+void UASUnitTest::missionStore_test()
+{
+    UASWaypointManager* wpm = uas->getWaypointManager();
+    wpm->addWaypointEditable(new Waypoint(0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, true, true, MAV_FRAME_GLOBAL, MAV_CMD_NAV_WAYPOINT), false);
+    wpm->addWaypointEditable(new Waypoint(1, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, true, false, MAV_FRAME_GLOBAL, MAV_CMD_DO_SET_ROI), false);
+    wpm->addWaypointEditable(new Waypoint(2, 0.0, 0.0, 0.0, 5.0, 0.0, 0.0, 0.0, true, false, MAV_FRAME_MISSION, MAV_CMD_DO_JUMP), false);
+    wpm->addWaypointEditable(new Waypoint(3, 1.0, 0.0, 50.0, 0.0, 0.0, 0.0, 0.0, true, false, MAV_FRAME_GLOBAL_RELATIVE_ALT, MAV_CMD_NAV_WAYPOINT), false);
+
+    const MissionStore &mission = wpm->getMissionStore();
+    QCOMPARE(mission.count(), 4);
+    QCOMPARE(mission.altitudes().at(3), 50.0);
+    QCOMPARE(mission.params(1).at(2), 5.0);
+    QCOMPARE(mission.commands().at(2), static_cast<quint16>(MAV_CMD_DO_JUMP));
+    QCOMPARE(mission.indices(MissionStore::GlobalFrameMapView), QVector<int>() << 0 << 1 << 3);
+    QCOMPARE(mission.indices(MissionStore::GlobalFramePathView), QVector<int>() << 0 << 3);
+    QCOMPARE(mission.indices(MissionStore::MissionFrameView), QVector<int>() << 2);
+    QCOMPARE(wpm->getGlobalFrameAndNavTypeWaypointList(true).count(), 2);
+    QCOMPARE(wpm->getMissionFrameIndexOf(wpm->getWaypointEditableList().at(2)), 0);
+    QCOMPARE(wpm->getGlobalFrameAndNavTypeIndexOf(wpm->getWaypointEditableList().at(1)), -1);
+
+    // One degree of latitude along the path
+    const QVector<double> &distances = mission.cumulativeDistances(MissionStore::GlobalFramePathView);
+    QCOMPARE(distances.count(), 2);
+    QCOMPARE(distances.at(0), 0.0);
+    QVERIFY(qAbs(distances.at(1) - 111195.0) < 1.0);
+
+    // Changing a waypoint is seen by the next request
+    const MissionStore before = wpm->getMissionStore();
+    QVERIFY(before.sameItems(wpm->getMissionStore()));
+    wpm->getWaypointEditableList().at(3)->setAltitude(80.0);
+    QCOMPARE(wpm->getMissionStore().altitudes().at(3), 80.0);
+    QVERIFY(!before.sameItems(wpm->getMissionStore()));
+    wpm->removeWaypoint(0);
+    QCOMPARE(wpm->getMissionStore().indices(MissionStore::GlobalFramePathView), QVector<int>() << 2);
+}
+
+void UASUnitTest::setEditableAltitudes_test()
+{
+    UASWaypointManager* wpm = uas->getWaypointManager();
+    wpm->addWaypointEditable(new Waypoint(0, 0.0, 0.0, 100.0, 0.0, 0.0, 0.0, 0.0, true, true, MAV_FRAME_GLOBAL, MAV_CMD_NAV_WAYPOINT), false);
+    wpm->addWaypointEditable(new Waypoint(1, 0.1, 0.0, 50.0, 0.0, 0.0, 0.0, 0.0, true, false, MAV_FRAME_GLOBAL_RELATIVE_ALT, MAV_CMD_NAV_WAYPOINT), false);
+    wpm->addWaypointEditable(new Waypoint(2, 0.2, 0.0, 50.0, 0.0, 0.0, 0.0, 0.0, true, false, MAV_FRAME_GLOBAL_RELATIVE_ALT, MAV_CMD_NAV_WAYPOINT), false);
+
+    QSignalSpy listSpy(wpm, SIGNAL(waypointEditableListChanged()));
+    QSignalSpy waypointSpy(wpm, SIGNAL(waypointEditableChanged(int,Waypoint*)));
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    QCOMPARE(wpm->setEditableAltitudes(QVector<int>() << 0 << 1 << 2 << 7,
+                                       QVector<double>() << nan << 80.0 << 90.0 << 10.0), 2);
+    QCOMPARE(listSpy.count(), 0);
+    QCOMPARE(waypointSpy.count(), 2);
+    QCOMPARE(waypointSpy.at(0).at(1).value<Waypoint*>(), wpm->getWaypointEditableList().at(1));
+    QCOMPARE(waypointSpy.at(1).at(1).value<Waypoint*>(), wpm->getWaypointEditableList().at(2));
+    QCOMPARE(wpm->getWaypointEditableList().at(0)->getAltitude(), 100.0);
+    QCOMPARE(wpm->getMissionStore().altitudes().at(1), 80.0);
+    QCOMPARE(wpm->getMissionStore().altitudes().at(2), 90.0);
+
+    // Nothing changed, nothing emitted
+    QCOMPARE(wpm->setEditableAltitudes(QVector<int>() << 1, QVector<double>() << 80.0), 0);
+    QCOMPARE(listSpy.count(), 0);
+    QCOMPARE(waypointSpy.count(), 2);
+}
+
+void UASUnitTest::imageStreamAssembler_test()
+{
+    // 4x2 grey image in fragments of 3 bytes
+    const uchar pixels[8] = { 0, 10, 20, 30, 40, 50, 60, 70 };
+    ImageStreamAssembler assembler;
+    QSignalSpy spy(&assembler, SIGNAL(frameReady()));
+
+    // An unfinished image is dropped by the next handshake
+    assembler.startImage(MAVLINK_DATA_STREAM_IMG_RAW8U, 8, 3, 3, 4, 2);
+    QVERIFY(!assembler.addFragment(1, pixels + 3, 3));
+    QVERIFY(assembler.isReceiving());
+    assembler.startImage(MAVLINK_DATA_STREAM_IMG_RAW8U, 8, 3, 3, 4, 2);
+    QCOMPARE(assembler.imagesDropped(), 1);
+
+    // Out of order, duplicated and out of range fragments
+    QVERIFY(!assembler.addFragment(2, pixels + 6, 3));
+    QVERIFY(!assembler.addFragment(0, pixels, 3));
+    QVERIFY(!assembler.addFragment(0, pixels, 3));
+    QVERIFY(!assembler.addFragment(5, pixels, 3));
+    QVERIFY(assembler.addFragment(1, pixels + 3, 3));
+    QVERIFY(!assembler.isReceiving());
+    QVERIFY(!assembler.addFragment(1, pixels + 3, 3));
+
+    QVERIFY(spy.count() > 0 || spy.wait(5000));
+    QImage frame;
+    QVERIFY(assembler.takeFrame(frame));
+    QCOMPARE(frame.size(), QSize(4, 2));
+    QCOMPARE(qGray(frame.pixel(0, 0)), 0);
+    QCOMPARE(qGray(frame.pixel(3, 0)), 30);
+    QCOMPARE(qGray(frame.pixel(3, 1)), 70);
+    QVERIFY(!assembler.takeFrame(frame));
+    QCOMPARE(frame.size(), QSize(4, 2));
+
+    // Handshake sizes whose pixel count overflows an int are rejected, not decoded
+    const QByteArray small(reinterpret_cast<const char*>(pixels), sizeof(pixels));
+    QVERIFY(ImageStreamAssembler::decode(MAVLINK_DATA_STREAM_IMG_RAW8U, 46341, 46341, small).isNull());
+    QVERIFY(ImageStreamAssembler::decode(MAVLINK_DATA_STREAM_IMG_RAW32U, 32768, 32768, small).isNull());
+}
+
+void UASUnitTest::linkStatisticsCrcErrors_test()
+{
+    mav->setConnectionManager(LinkManager::instance());
+    SerialLink link;
+
+    // No UAS exists for system 42, the frames are only parsed
+    mavlink_attitude_t attitude;
+    memset(&attitude, 0, sizeof(attitude));
+    attitude.time_boot_ms = 1000;
+    attitude.roll = 0.5f;
+    attitude.pitch = -0.25f;
+    attitude.yaw = 1.0f;
+    mavlink_message_t message;
+    mavlink_msg_attitude_encode_chan(42, 1, MAVLINK_COMM_3, &message, &attitude);
+    uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+    const int length = mavlink_msg_to_send_buffer(buffer, &message);
+    const QByteArray good(reinterpret_cast<const char*>(buffer), length);
+
+    mav->receiveBytes(&link, good);
+    const quint64 errors = mav->getLinkStatistics(link.getId()).crcErrors;
+
+    // Corrupt the payload, the CRC no longer matches
+    QByteArray bad = good;
+    bad[MAVLINK_NUM_HEADER_BYTES + 2] = static_cast<char>(bad.at(MAVLINK_NUM_HEADER_BYTES + 2) ^ 0x55);
+    mav->receiveBytes(&link, bad);
+    QCOMPARE(mav->getLinkStatistics(link.getId()).crcErrors, errors + 1);
+
+    // A good frame afterwards is not counted again
+    mav->receiveBytes(&link, good);
+    QCOMPARE(mav->getLinkStatistics(link.getId()).crcErrors, errors + 1);
+}
+
+void UASUnitTest::logCompressorColumnar_test()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QFile log(dir.path() + "/values.log");
+    QVERIFY(log.open(QIODevice::WriteOnly | QIODevice::Text));
+    for (int timestamp = 1; timestamp <= 200; timestamp++)
+    {
+        log.write(QString("%1\t1\ta\t%2\n").arg(timestamp).arg(timestamp * 0.5).toLatin1());
+        if (timestamp % 2 == 0)
+        {
+            log.write(QString("%1\t1\tb\t%1\n").arg(timestamp).toLatin1());
+        }
+    }
+    // Far outside the reorder window, must be merged into its row anyway
+    log.write("10\t1\tc\t7\n");
+    log.close();
+
+    LogCompressor compressor(log.fileName());
+    compressor.setOutputFormat(LogCompressor::ColumnarBinaryOutput);
+    QSignalSpy finished(&compressor, SIGNAL(finishedFile(QString)));
+    compressor.startCompression(false);
+    QVERIFY(finished.wait(10000));
+    compressor.wait();
+    const QString outFileName = finished.first().first().toString();
+    QVERIFY(outFileName.endsWith(".bin"));
+
+    QList<QByteArray> names;
+    QVector<quint64> timestamps;
+    QVector<QVector<double> > columns;
+    QVERIFY(LogCompressor::readColumnarFile(outFileName, names, timestamps, columns));
+    QCOMPARE(names, QList<QByteArray>() << "a" << "b" << "c");
+    QCOMPARE(columns.size(), 3);
+
+    // The first row only seeds the hole filling and is not written
+    QCOMPARE(timestamps.size(), 199);
+    for (int i = 0; i < timestamps.size(); i++)
+    {
+        const quint64 timestamp = static_cast<quint64>(i + 2);
+        QCOMPARE(timestamps[i], timestamp);
+        QCOMPARE(columns[0][i], timestamp * 0.5);
+        if (timestamp % 2 == 0)
+        {
+            QCOMPARE(columns[1][i], static_cast<double>(timestamp));
+        }
+        else
+        {
+            QVERIFY(qIsNaN(columns[1][i]));
+        }
+        if (timestamp == 10)
+        {
+            QCOMPARE(columns[2][i], 7.0);
+        }
+        else
+        {
+            QVERIFY(qIsNaN(columns[2][i]));
+        }
+    }
+
+    // Not a columnar file
+    QVERIFY(!LogCompressor::readColumnarFile(log.fileName(), names, timestamps, columns));
+}
+
 void UASUnitTest::signalUASLink_test()
 {
 
@@ -53,6 +53,12 @@ private slots:
   void getWaypointList_test();
   void signalWayPoint_test();
   void getWaypoint_test();
+  void saveLoadWaypoints_test();
+  void missionStore_test();
+  void setEditableAltitudes_test();
+  void imageStreamAssembler_test();
+  void linkStatisticsCrcErrors_test();
+  void logCompressorColumnar_test();
   void signalUASLink_test();
   void signalIdUASLink_test();
 };
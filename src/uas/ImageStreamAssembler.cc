@@ -0,0 +1,273 @@
+/*=====================================================================
+
+QGroundControl Open Source Ground Control Station
+
+(c) 2009-2012 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+This file is part of the QGROUNDCONTROL project
+
+    QGROUNDCONTROL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    QGROUNDCONTROL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Implementation of the image reassembly
+ *
+ */
+
+#include "logging.h"
+#include "ImageStreamAssembler.h"
+#include "QGCMAVLink.h"
+
+#include <cstring>
+#include <utility>
+
+static const int MaxImageSize = 16 * 1024 * 1024; // bytes
+
+ImageStreamAssembler::ImageStreamAssembler(QObject *parent) :
+    QThread(parent),
+    m_imagesDropped(0),
+    m_stop(false),
+    m_decodePending(false),
+    m_frameReady(false)
+{
+}
+
+ImageStreamAssembler::~ImageStreamAssembler()
+{
+    stop();
+}
+
+void ImageStreamAssembler::stop()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stop = true;
+        m_wake.wakeAll();
+    }
+    wait();
+}
+
+void ImageStreamAssembler::startImage(int type, int size, int packets, int payload, int width, int height)
+{
+    if (isReceiving())
+    {
+        QLOG_DEBUG() << "Image dropped," << m_receiving.packets - m_receiving.receivedPackets
+                     << "of" << m_receiving.packets << "fragments missing";
+        m_imagesDropped++;
+    }
+    recycleBuffer(m_receiving.buffer);
+    m_receiving.packets = 0;
+    m_receiving.receivedPackets = 0;
+
+    if (packets <= 0 || payload <= 0 || size <= 0 || size > MaxImageSize
+            || static_cast<qint64>(packets) * payload < size)
+    {
+        QLOG_DEBUG() << "Ignoring image handshake with size" << size << "packets" << packets << "payload" << payload;
+        return;
+    }
+
+    m_receiving.type = type;
+    m_receiving.width = width;
+    m_receiving.height = height;
+    m_receiving.packets = packets;
+    m_receiving.payload = payload;
+    m_receiving.received.fill(false, packets);
+    m_receiving.buffer = takeBuffer(size);
+}
+
+bool ImageStreamAssembler::addFragment(int sequence, const uchar *data, int length)
+{
+    Transfer &transfer = m_receiving;
+    if (transfer.packets == 0 || sequence < 0 || sequence >= transfer.packets
+            || transfer.received.testBit(sequence))
+    {
+        return false;
+    }
+
+    const int pos = sequence * transfer.payload;
+    const int count = qMin(qMin(length, transfer.payload), transfer.buffer.size() - pos);
+    if (count > 0)
+    {
+        memcpy(transfer.buffer.data() + pos, data, count);
+    }
+    transfer.received.setBit(sequence);
+    if (++transfer.receivedPackets < transfer.packets)
+    {
+        return false;
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_decodePending)
+        {
+            // The decoder is behind, the waiting image is replaced by this newer one
+            m_imagesDropped++;
+        }
+        std::swap(m_decoding, m_receiving);
+        m_decodePending = true;
+        m_wake.wakeOne();
+    }
+    if (!isRunning())
+    {
+        start(QThread::LowPriority);
+    }
+
+    // m_receiving now holds the replaced image, if any
+    recycleBuffer(m_receiving.buffer);
+    m_receiving.packets = 0;
+    m_receiving.receivedPackets = 0;
+    return true;
+}
+
+bool ImageStreamAssembler::isReceiving() const
+{
+    return m_receiving.packets > 0 && m_receiving.receivedPackets < m_receiving.packets;
+}
+
+bool ImageStreamAssembler::takeFrame(QImage &frame)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_frameReady)
+    {
+        return false;
+    }
+    frame.swap(m_frame);
+    m_frame = QImage();
+    m_frameReady = false;
+    return true;
+}
+
+QByteArray ImageStreamAssembler::takeBuffer(int size)
+{
+    QByteArray buffer;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (int i = 0; i < m_pool.size(); i++)
+        {
+            if (m_pool.at(i).capacity() >= size)
+            {
+                buffer = m_pool.takeAt(i);
+                break;
+            }
+        }
+    }
+    buffer.resize(size);
+    return buffer;
+}
+
+void ImageStreamAssembler::recycleBuffer(QByteArray &buffer)
+{
+    if (!buffer.isNull())
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_pool.size() < s_maxPooledBuffers)
+        {
+            m_pool.append(buffer);
+        }
+    }
+    buffer = QByteArray();
+}
+
+void ImageStreamAssembler::run()
+{
+    QMutexLocker locker(&m_mutex);
+    while (!m_stop)
+    {
+        if (!m_decodePending)
+        {
+            m_wake.wait(&m_mutex);
+            continue;
+        }
+        Transfer transfer;
+        std::swap(transfer, m_decoding);
+        m_decodePending = false;
+        locker.unlock();
+
+        QImage image = decode(transfer.type, transfer.width, transfer.height, transfer.buffer);
+
+        locker.relock();
+        if (m_pool.size() < s_maxPooledBuffers)
+        {
+            m_pool.append(transfer.buffer);
+        }
+        if (image.isNull())
+        {
+            QLOG_DEBUG() << "Could not decode image of type" << transfer.type << "and" << transfer.buffer.size() << "bytes";
+            continue;
+        }
+        m_frame.swap(image);
+        m_frameReady = true;
+
+        locker.unlock();
+        emit frameReady();
+        locker.relock();
+    }
+}
+
+QImage ImageStreamAssembler::decode(int type, int width, int height, const QByteArray &data)
+{
+    switch (type)
+    {
+    case MAVLINK_DATA_STREAM_IMG_RAW8U:
+    {
+        // The size comes from the handshake, the product does not fit an int for large values
+        if (width <= 0 || height <= 0 || data.size() < static_cast<qint64>(width) * height)
+        {
+            return QImage();
+        }
+        QImage image(width, height, QImage::Format_Indexed8);
+        if (image.isNull())
+        {
+            return QImage();
+        }
+        image.setColorCount(256);
+        for (int i = 0; i < 256; i++)
+        {
+            image.setColor(i, qRgb(i, i, i));
+        }
+        // Scan lines are 32 bit aligned, copy line by line
+        for (int y = 0; y < height; y++)
+        {
+            memcpy(image.scanLine(y), data.constData() + static_cast<qint64>(y) * width, width);
+        }
+        return image;
+    }
+    case MAVLINK_DATA_STREAM_IMG_RAW32U:
+    {
+        if (width <= 0 || height <= 0 || data.size() < static_cast<qint64>(width) * height * 4)
+        {
+            return QImage();
+        }
+        QImage image(width, height, QImage::Format_RGB32);
+        if (image.isNull())
+        {
+            return QImage();
+        }
+        for (int y = 0; y < height; y++)
+        {
+            memcpy(image.scanLine(y), data.constData() + static_cast<qint64>(y) * width * 4, static_cast<size_t>(width) * 4);
+        }
+        return image;
+    }
+    case MAVLINK_DATA_STREAM_IMG_JPEG:
+    case MAVLINK_DATA_STREAM_IMG_BMP:
+    case MAVLINK_DATA_STREAM_IMG_PGM:
+    case MAVLINK_DATA_STREAM_IMG_PNG:
+        return QImage::fromData(data);
+    default:
+        return QImage();
+    }
+}
@@ -0,0 +1,118 @@
+/*=====================================================================
+
+QGroundControl Open Source Ground Control Station
+
+(c) 2009-2012 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+This file is part of the QGROUNDCONTROL project
+
+    QGROUNDCONTROL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    QGROUNDCONTROL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Reassembly and decoding of images sent as ENCAPSULATED_DATA
+ *
+ *   A DATA_TRANSMISSION_HANDSHAKE announces an image, its bytes follow in
+ *   numbered fragments of a fixed payload size. Fragments are written straight
+ *   into a frame buffer taken from a pool and tracked in a bitmap, so they may
+ *   arrive in any order and duplicates are ignored. A complete buffer is handed
+ *   to the decoder thread by swapping it into the decode slot, the decoded
+ *   image is picked up with takeFrame(). If the decoder falls behind, the frame
+ *   waiting for it is replaced by the newer one.
+ *
+ *   startImage() and addFragment() are called from the thread receiving the
+ *   messages, takeFrame() from any thread.
+ */
+
+#ifndef IMAGESTREAMASSEMBLER_H
+#define IMAGESTREAMASSEMBLER_H
+
+#include <QBitArray>
+#include <QByteArray>
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+class ImageStreamAssembler : public QThread
+{
+    Q_OBJECT
+public:
+    explicit ImageStreamAssembler(QObject *parent = 0);
+    ~ImageStreamAssembler();
+
+    /** @brief Start receiving an image, an unfinished previous image is dropped */
+    void startImage(int type, int size, int packets, int payload, int width, int height);
+    /**
+     * @brief Store one fragment of the current image
+     * @return true if the fragment completed the image and it was queued for decoding
+     */
+    bool addFragment(int sequence, const uchar *data, int length);
+    /** @brief An image was announced and not all of its fragments arrived yet */
+    bool isReceiving() const;
+
+    /** @brief Swap the latest decoded image into frame, false if there is no new one */
+    bool takeFrame(QImage &frame);
+    /** @brief Stop the decoder thread, called by the destructor */
+    void stop();
+
+    int imagesDropped() const {
+        return m_imagesDropped;
+    }
+
+    /** @brief Decode a complete image of one of the MAVLINK_DATA_STREAM_TYPE types */
+    static QImage decode(int type, int width, int height, const QByteArray &data);
+
+signals:
+    /** @brief A decoded image is ready to be taken with takeFrame() */
+    void frameReady();
+
+protected:
+    void run();
+
+private:
+    struct Transfer
+    {
+        int type = -1;
+        int width = 0;
+        int height = 0;
+        int packets = 0;
+        int payload = 0;
+        int receivedPackets = 0;
+        QBitArray received;         ///< One bit per fragment
+        QByteArray buffer;          ///< Pooled frame buffer of the announced size
+    };
+
+    QByteArray takeBuffer(int size);
+    void recycleBuffer(QByteArray &buffer);
+
+    static const int s_maxPooledBuffers = 3;
+
+    Transfer m_receiving;           ///< Only used by the receiving thread
+    int m_imagesDropped;
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_wake;
+    bool m_stop;
+    bool m_decodePending;
+    Transfer m_decoding;            ///< Complete image waiting for the decoder
+    QList<QByteArray> m_pool;       ///< Frame buffers not in use
+    bool m_frameReady;
+    QImage m_frame;                 ///< Latest decoded image
+};
+
+#endif // IMAGESTREAMASSEMBLER_H
@@ -0,0 +1,194 @@
+/*=====================================================================
+
+QGroundControl Open Source Ground Control Station
+
+(c) 2009-2012 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+This file is part of the QGROUNDCONTROL project
+
+    QGROUNDCONTROL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    QGROUNDCONTROL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Implementation of the flat mission copy
+ *
+ */
+
+#include "MissionStore.h"
+#include "Waypoint.h"
+
+#include <qmath.h>
+
+void MissionStore::rebuild(const QList<Waypoint *> &waypoints)
+{
+    clear();
+    const int count = waypoints.count();
+    m_latitudes.reserve(count);
+    m_longitudes.reserve(count);
+    m_altitudes.reserve(count);
+    for (int p = 0; p < 4; p++)
+    {
+        m_params[p].reserve(count);
+    }
+    m_commands.reserve(count);
+    m_frames.reserve(count);
+    m_missionIndex.reserve(count);
+    for (int view = 0; view < ViewCount; view++)
+    {
+        m_viewIndex[view].fill(-1, count);
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        Waypoint *wp = waypoints.at(i);
+        m_latitudes.append(wp->getLatitude());
+        m_longitudes.append(wp->getLongitude());
+        m_altitudes.append(wp->getAltitude());
+        m_params[0].append(wp->getParam1());
+        m_params[1].append(wp->getParam2());
+        m_params[2].append(wp->getParam3());
+        m_params[3].append(wp->getParam4());
+        m_commands.append(wp->getAction());
+        m_frames.append(wp->getFrame());
+        m_missionIndex.insert(wp, i);
+
+        const bool global = wp->isGlobalFrame();
+        const bool navigation = wp->isNavigationType();
+        const bool mapOnly = wp->visibleOnMapWidget();
+        bool inView[ViewCount];
+        inView[GlobalFrameView] = global;
+        inView[GlobalFrameAndNavTypeView] = global && navigation;
+        inView[GlobalFrameMapView] = global && (navigation || mapOnly);
+        inView[GlobalFramePathView] = global && navigation && !mapOnly;
+        inView[NavTypeView] = navigation;
+        inView[LocalFrameView] = wp->getFrame() == MAV_FRAME_LOCAL_NED || wp->getFrame() == MAV_FRAME_LOCAL_ENU;
+        inView[MissionFrameView] = wp->getFrame() == MAV_FRAME_MISSION;
+
+        for (int view = 0; view < ViewCount; view++)
+        {
+            if (inView[view])
+            {
+                m_viewIndex[view][i] = m_indices[view].size();
+                m_indices[view].append(i);
+                m_waypoints[view].append(wp);
+            }
+        }
+    }
+
+    const View globalViews[] = { GlobalFrameView, GlobalFrameAndNavTypeView, GlobalFrameMapView, GlobalFramePathView };
+    for (View view : globalViews)
+    {
+        const QVector<int> &indices = m_indices[view];
+        QVector<double> &distances = m_distances[view];
+        distances.resize(indices.size());
+        double total = 0.0;
+        for (int i = 0; i < indices.size(); i++)
+        {
+            if (i > 0)
+            {
+                total += distanceBetween(m_latitudes[indices[i - 1]], m_longitudes[indices[i - 1]],
+                                         m_latitudes[indices[i]], m_longitudes[indices[i]]);
+            }
+            distances[i] = total;
+        }
+    }
+}
+
+void MissionStore::clear()
+{
+    m_latitudes.clear();
+    m_longitudes.clear();
+    m_altitudes.clear();
+    for (int p = 0; p < 4; p++)
+    {
+        m_params[p].clear();
+    }
+    m_commands.clear();
+    m_frames.clear();
+    m_missionIndex.clear();
+    for (int view = 0; view < ViewCount; view++)
+    {
+        m_indices[view].clear();
+        m_viewIndex[view].clear();
+        m_waypoints[view].clear();
+        m_distances[view].clear();
+    }
+}
+
+static bool sameValues(const QVector<double> &a, const QVector<double> &b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    for (int i = 0; i < a.size(); i++)
+    {
+        // Unused params are often NaN, which never compares equal
+        if (a[i] != b[i] && !(qIsNaN(a[i]) && qIsNaN(b[i])))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MissionStore::sameItems(const MissionStore &other) const
+{
+    if (m_commands != other.m_commands || m_frames != other.m_frames)
+    {
+        return false;
+    }
+    if (!sameValues(m_latitudes, other.m_latitudes) || !sameValues(m_longitudes, other.m_longitudes)
+            || !sameValues(m_altitudes, other.m_altitudes))
+    {
+        return false;
+    }
+    for (int p = 0; p < 4; p++)
+    {
+        if (!sameValues(m_params[p], other.m_params[p]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+const QVector<double> &MissionStore::params(int n) const
+{
+    Q_ASSERT(n >= 1 && n <= 4);
+    return m_params[n - 1];
+}
+
+int MissionStore::indexOf(Waypoint *wp) const
+{
+    return m_missionIndex.value(wp, -1);
+}
+
+int MissionStore::indexInView(View view, Waypoint *wp) const
+{
+    const int index = indexOf(wp);
+    return index < 0 ? -1 : m_viewIndex[view].at(index);
+}
+
+double MissionStore::distanceBetween(double lat1, double lon1, double lat2, double lon2)
+{
+    const double R = 6371000; // m
+    const double dLat = (lat2 - lat1) * (M_PI / 180);
+    const double dLon = (lon2 - lon1) * (M_PI / 180);
+    const double a = sin(dLat / 2) * sin(dLat / 2)
+            + cos(lat1 * (M_PI / 180)) * cos(lat2 * (M_PI / 180)) * sin(dLon / 2) * sin(dLon / 2);
+    return R * 2 * atan2(sqrt(a), sqrt(1 - a));
+}
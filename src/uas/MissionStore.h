@@ -0,0 +1,132 @@
+/*=====================================================================
+
+QGroundControl Open Source Ground Control Station
+
+(c) 2009-2012 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+This file is part of the QGROUNDCONTROL project
+
+    QGROUNDCONTROL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    QGROUNDCONTROL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Flat copy of a mission for views which only read it
+ *
+ *   The mission items are stored as one array per field, and the filtered
+ *   views (global frame, navigation items, flight path, ...) are computed once
+ *   when the mission is rebuilt, together with the distance along each global
+ *   view. Map, elevation display and distance calculations read these arrays
+ *   instead of filtering and measuring the waypoint list on every request.
+ *
+ */
+
+#ifndef MISSIONSTORE_H
+#define MISSIONSTORE_H
+
+#include <QHash>
+#include <QList>
+#include <QVector>
+
+class Waypoint;
+
+class MissionStore
+{
+public:
+    enum View {
+        GlobalFrameView = 0,        ///< Items in a global frame
+        GlobalFrameAndNavTypeView,  ///< Navigation items in a global frame
+        GlobalFrameMapView,         ///< Navigation items in a global frame and items only shown on the map, like ROIs
+        GlobalFramePathView,        ///< Navigation items in a global frame which are part of the flight path
+        NavTypeView,                ///< Navigation items in any frame
+        LocalFrameView,             ///< Items in a local frame
+        MissionFrameView,           ///< Items in the mission frame
+        ViewCount
+    };
+
+    /** @brief Copies the items of the mission, the views and distances are computed here */
+    void rebuild(const QList<Waypoint *> &waypoints);
+    void clear();
+    /** @brief True if both hold the same items with the same fields in the same order */
+    bool sameItems(const MissionStore &other) const;
+
+    int count() const {
+        return m_commands.size();
+    }
+
+    /** @name Item fields, indexed by the position of the item in the mission */
+    /*@{*/
+    const QVector<double> &latitudes() const {
+        return m_latitudes;
+    }
+    const QVector<double> &longitudes() const {
+        return m_longitudes;
+    }
+    const QVector<double> &altitudes() const {
+        return m_altitudes;
+    }
+    const QVector<double> &params(int n) const;     ///< param1 to param4
+    const QVector<quint16> &commands() const {
+        return m_commands;
+    }
+    const QVector<quint8> &frames() const {
+        return m_frames;
+    }
+    /*@}*/
+
+    /** @name Views */
+    /*@{*/
+    /** @brief Mission indices of the items in the view */
+    const QVector<int> &indices(View view) const {
+        return m_indices[view];
+    }
+    const QList<Waypoint *> &waypoints(View view) const {
+        return m_waypoints[view];
+    }
+    int viewCount(View view) const {
+        return m_indices[view].size();
+    }
+    int indexOf(Waypoint *wp) const;                ///< Mission index of wp, -1 if not in the mission
+    int indexInView(View view, Waypoint *wp) const; ///< Position of wp in the view, -1 if not in the view
+    /**
+     * @brief Distance in meters from the first item of a global view to each of its items
+     *
+     * Measured along the items of the view in order, one entry per item.
+     * Empty for views which are not in a global frame.
+     */
+    const QVector<double> &cumulativeDistances(View view) const {
+        return m_distances[view];
+    }
+    /*@}*/
+
+    /** @brief Great circle distance in meters */
+    static double distanceBetween(double lat1, double lon1, double lat2, double lon2);
+
+private:
+    QVector<double> m_latitudes;
+    QVector<double> m_longitudes;
+    QVector<double> m_altitudes;
+    QVector<double> m_params[4];
+    QVector<quint16> m_commands;
+    QVector<quint8> m_frames;
+
+    QHash<Waypoint *, int> m_missionIndex;
+    QVector<int> m_indices[ViewCount];
+    QVector<int> m_viewIndex[ViewCount];    ///< Position in the view per mission index, -1 if not in the view
+    QList<Waypoint *> m_waypoints[ViewCount];
+    QVector<double> m_distances[ViewCount];
+};
+
+#endif // MISSIONSTORE_H
@@ -17,6 +17,7 @@
 #include "GAudioOutput.h"
 #include "QGCMAVLink.h"
 #include "LinkManager.h"
+#include "ImageStreamAssembler.h"
 #include "MainWindow.h"
 #include"QGCJSBSimLink.h"
 
@@ -142,6 +143,7 @@ UAS::UAS(MAVLinkProtocol* protocol, int id) : UASInterface(),
     pitch(0.0),
     yaw(0.0),
 
+    imageAssembler(new ImageStreamAssembler(this)),
     blockHomePositionChanges(false),
     receivedMode(false),
 
@@ -172,6 +174,7 @@ UAS::UAS(MAVLinkProtocol* protocol, int id) : UASInterface(),
     setBatterySpecs(QString("9V,9.5V,12.6V"));
     connect(statusTimeout, SIGNAL(timeout()), this, SLOT(updateState()));
     connect(this, SIGNAL(systemSpecsChanged(int)), this, SLOT(writeSettings()));
+    connect(imageAssembler, SIGNAL(frameReady()), this, SLOT(imageDecoded()));
     statusTimeout->start(500);
     readSettings(); 
     // Initial signals
@@ -196,6 +199,7 @@ UAS::UAS(MAVLinkProtocol* protocol, int id) : UASInterface(),
 */
 UAS::~UAS()
 {
+    imageAssembler->stop();
     writeSettings();
     delete links;
     delete statusTimeout;
@@ -269,7 +273,7 @@ void UAS::updateState()
         connectionLost = true;
         receivedMode = false;
         QString audiostring = QString("Link lost to system %1").arg(this->getUASID());
-        GAudioOutput::instance()->say(audiostring.toLower());
+        GAudioOutput::instance()->say(audiostring.toLower(), MAV_SEVERITY_CRITICAL);
     }
 
     // Update connection loss time on each iteration
@@ -283,7 +287,7 @@ void UAS::updateState()
     if (connectionLost && (heartbeatInterval < timeoutIntervalHeartbeat))
     {
         QString audiostring = QString("Link regained to system %1 after %2 seconds").arg(this->getUASID()).arg((int)(connectionLossTime/1000000));
-        GAudioOutput::instance()->say(audiostring.toLower());
+        GAudioOutput::instance()->say(audiostring.toLower(), MAV_SEVERITY_CRITICAL);
         connectionLost = false;
         connectionLossTime = 0;
         emit heartbeatTimeout(false, 0);
@@ -568,7 +572,7 @@ void UAS::receiveMessage(LinkInterface* link, mavlink_message_t message)
                     /* warn only every 12 seconds */
                     && (QGC::groundTimeUsecs() - lastVoltageWarning) > 12000000)
             {
-                GAudioOutput::instance()->say(QString("voltage warning: %1 volts").arg(lpVoltage, 0, 'f', 1, QChar(' ')));
+                GAudioOutput::instance()->say(QString("voltage warning: %1 volts").arg(lpVoltage, 0, 'f', 1, QChar(' ')), MAV_SEVERITY_CRITICAL);
                 lastVoltageWarning = QGC::groundTimeUsecs();
                 lastTickVoltageValue = tickLowpassVoltage;
             }
@@ -1177,16 +1181,7 @@ void UAS::receiveMessage(LinkInterface* link, mavlink_message_t message)
         {
             mavlink_data_transmission_handshake_t p;
             mavlink_msg_data_transmission_handshake_decode(&message, &p);
-            imageSize = p.size;
-            imagePackets = p.packets;
-            imagePayload = p.payload;
-            imageQuality = p.jpg_quality;
-            imageType = p.type;
-            imageWidth = p.width;
-            imageHeight = p.height;
-            imageStart = QGC::groundTimeMilliseconds();
-            imagePacketsArrived = 0;
-
+            imageAssembler->startImage(p.type, p.size, p.packets, p.payload, p.width, p.height);
         }
             break;
 
@@ -1194,34 +1189,8 @@ void UAS::receiveMessage(LinkInterface* link, mavlink_message_t message)
         {
             mavlink_encapsulated_data_t img;
             mavlink_msg_encapsulated_data_decode(&message, &img);
-            int seq = img.seqnr;
-            int pos = seq * imagePayload;
-
-            // Check if we have a valid transaction
-            if (imagePackets == 0)
-            {
-                // NO VALID TRANSACTION - ABORT
-                // Restart statemachine
-                imagePacketsArrived = 0;
-            }
-
-            for (int i = 0; i < imagePayload; ++i)
-            {
-                if (pos <= imageSize) {
-                    imageRecBuffer[pos] = img.data[i];
-                }
-                ++pos;
-            }
-
-            ++imagePacketsArrived;
-
-            // emit signal if all packets arrived
-            if ((imagePacketsArrived >= imagePackets))
-            {
-                // Restart statemachine
-                emit imageReady(this);
-                //QLOG_DEBUG() << "imageReady emitted. all packets arrived";
-            }
+            // Decoding happens on the assembler thread, imageReady() follows from imageDecoded()
+            imageAssembler->addFragment(img.seqnr, img.data, sizeof(img.data));
         }
             break;
 
@@ -2080,6 +2049,7 @@ void UAS::sendMessage(LinkInterface* link, mavlink_message_t message)
     {
         // Send the portion of the buffer now occupied by the message
         link->writeBytes((const char*)buffer, len);
+        LinkManager::instance()->getProtocol()->recordTransmit(link, len);
     }
     else
     {
@@ -2170,56 +2140,14 @@ void UAS::getStatusForCode(int statusCode, QString& uasState, QString& stateDesc
 
 QImage UAS::getImage()
 {
-#ifdef MAVLINK_ENABLED_PIXHAWK
-
-//    QLOG_DEBUG() << "IMAGE TYPE:" << imageType;
-
-    // RAW greyscale
-    if (imageType == MAVLINK_DATA_STREAM_IMG_RAW8U)
-    {
-        int imgColors = 255;
-
-        // Construct PGM header
-        QString header("P5\n%1 %2\n%3\n");
-        header = header.arg(imageWidth).arg(imageHeight).arg(imgColors);
-
-        QByteArray tmpImage(header.toStdString().c_str(), header.toStdString().size());
-        tmpImage.append(imageRecBuffer);
-
-        //QLOG_DEBUG() << "IMAGE SIZE:" << tmpImage.size() << "HEADER SIZE: (15):" << header.size() << "HEADER: " << header;
-
-        if (imageRecBuffer.isNull())
-        {
-            QLOG_DEBUG()<< "could not convertToPGM()";
-            return QImage();
-        }
-
-        if (!image.loadFromData(tmpImage, "PGM"))
-        {
-            QLOG_DEBUG()<< __FILE__ << __LINE__ << "could not create extracted image";
-            return QImage();
-        }
-
-    }
-    // BMP with header
-    else if (imageType == MAVLINK_DATA_STREAM_IMG_BMP ||
-             imageType == MAVLINK_DATA_STREAM_IMG_JPEG ||
-             imageType == MAVLINK_DATA_STREAM_IMG_PGM ||
-             imageType == MAVLINK_DATA_STREAM_IMG_PNG)
-    {
-        if (!image.loadFromData(imageRecBuffer))
-        {
-            QLOG_DEBUG() << __FILE__ << __LINE__ << "Loading data from image buffer failed!";
-        }
-    }
-    // Restart statemachine
-    imagePacketsArrived = 0;
-    //imageRecBuffer.clear();
+    // Swaps in the newest decoded image, the previous one is kept if there is none
+    imageAssembler->takeFrame(image);
     return image;
-#else
-    return QImage();
-#endif
+}
 
+void UAS::imageDecoded()
+{
+    emit imageReady(this);
 }
 
 void UAS::requestImage()
@@ -2228,7 +2156,7 @@ void UAS::requestImage()
     QLOG_DEBUG() << "trying to get an image from the uas...";
 
     // check if there is already an image transmission going on
-    if (imagePacketsArrived == 0)
+    if (!imageAssembler->isReceiving())
     {
         mavlink_message_t msg;
         mavlink_msg_data_transmission_handshake_pack(systemId, componentId, &msg, MAVLINK_DATA_STREAM_IMG_JPEG, 0, 0, 0, 0, 0, 50);
@@ -38,6 +38,8 @@ This file is part of the QGROUNDCONTROL project
 
 #include <QVector3D>
 
+class ImageStreamAssembler;
+
 /**
  * @brief A generic MAVLINK-connected MAV/UAV
  *
@@ -535,19 +537,9 @@ protected: //COMMENTS FOR TEST UNIT
     double pitch;
     double yaw;
 
-    // dongfang: This looks like a candidate for being moved off to a separate class.
     /// IMAGING
-    int imageSize;              ///< Image size being transmitted (bytes)
-    int imagePackets;           ///< Number of data packets being sent for this image
-    int imagePacketsArrived;    ///< Number of data packets recieved
-    int imagePayload;           ///< Payload size per transmitted packet (bytes). Standard is 254, and decreases when image resolution increases.
-    int imageQuality;           ///< Quality of the transmitted image (percentage)
-    int imageType;              ///< Type of the transmitted image (BMP, PNG, JPEG, RAW 8 bit, RAW 32 bit)
-    int imageWidth;             ///< Width of the image stream
-    int imageHeight;            ///< Width of the image stream
-    QByteArray imageRecBuffer;  ///< Buffer for the incoming bytestream
+    ImageStreamAssembler* imageAssembler;   ///< Reassembles and decodes the transmitted images
     QImage image;               ///< Image data of last completely transmitted image
-    quint64 imageStart;
     bool blockHomePositionChanges;   ///< Block changes to the home position
     bool receivedMode;          ///< True if mode was retrieved from current conenction to UAS
 
@@ -1071,6 +1063,8 @@ protected:
 
 protected slots:
     void requestNextParamFromQueue();
+    /** @brief The image assembler decoded an image */
+    void imageDecoded();
 
     /** @brief Write settings to disk */
     void writeSettings();
@@ -35,12 +35,39 @@ This file is part of the QGROUNDCONTROL project
 #include "configuration.h"
 #include "MainWindow.h"
 
+#include <QtEndian>
+#include <cstring>
+
 #define PROTOCOL_TIMEOUT_MS 2000    ///< maximum time to wait for pending messages until timeout
+#define PROTOCOL_MIN_TIMEOUT_MS 250 ///< lower bound of the timeout adapted to the measured round trip time
 #define PROTOCOL_DELAY_MS 20        ///< minimum delay between sent messages
 #define PROTOCOL_MAX_RETRIES 5      ///< maximum number of send retries (after timeout)
+#define PARTIAL_WRITE_MERGE_GAP 8   ///< unchanged items sent along to join two changed ranges into one partial write
 
 static const QString DEFAULT_REL_ALT = "defaultRelAltitude";
 
+// Binary mission file: a 16 byte header (magic, version, record size, item count)
+// followed by one fixed size little endian record per item
+static const char MISSION_BINARY_MAGIC[] = "QWPB";
+static const int MISSION_BINARY_MAGIC_SIZE = 4;
+static const quint16 MISSION_BINARY_VERSION = 1;
+static const int MISSION_BINARY_HEADER_SIZE = 16;
+static const int MISSION_BINARY_RECORD_SIZE = 64;   ///< param1-4, x, y, z as doubles, command, frame, flags
+
+static const quint64 FNV_OFFSET_BASIS = 14695981039346656037ULL;
+static const quint64 FNV_PRIME = 1099511628211ULL;
+
+template <typename T>
+static void fnvAppend(quint64 &hash, const T &value)
+{
+    const uchar *bytes = reinterpret_cast<const uchar *>(&value);
+    for (size_t i = 0; i < sizeof(T); ++i)
+    {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+}
+
 UASWaypointManager::UASWaypointManager(UAS* _uas)
     : uas(_uas),
       current_retries(0),
@@ -51,12 +78,24 @@ UASWaypointManager::UASWaypointManager(UAS* _uas)
       current_partner_compid(MAV_COMP_ID_PRIMARY),
       read_to_edit(false),
       currentWaypointEditable(NULL),
+      mission_store_valid(false),
       protocol_timer(this),
       standalone(false),
       uasid(0),
       m_defaultAcceptanceRadius(5.0),
       m_defaultRelativeAlt(0.0),
-      waypointIDHandled(65534) // nobody will have a waypoint list with 65534 waypoints.
+      waypointIDHandled(65534), // nobody will have a waypoint list with 65534 waypoints.
+      vehicle_mission_known(false),
+      vehicle_mission_read_back(false),
+      vehicle_mission_hash(0),
+      partial_write(false),
+      partial_write_rejected(false),
+      upload_first(0),
+      upload_last(0),
+      round_trip_pending(false),
+      smoothed_rtt(-1.0),
+      rtt_variance(0.0),
+      protocol_timeout(PROTOCOL_TIMEOUT_MS)
 {
     if (uas)
     {
@@ -64,6 +103,9 @@ UASWaypointManager::UASWaypointManager(UAS* _uas)
         connect(&protocol_timer, SIGNAL(timeout()), this, SLOT(timeout()));
         connect(uas, SIGNAL(localPositionChanged(UASInterface*,double,double,double,quint64)), this, SLOT(handleLocalPositionChanged(UASInterface*,double,double,double,quint64)));
         connect(uas, SIGNAL(globalPositionChanged(UASInterface*,double,double,double,quint64)), this, SLOT(handleGlobalPositionChanged(UASInterface*,double,double,double,quint64)));
+        connect(uas, SIGNAL(heartbeatTimeout(bool,unsigned int)), this, SLOT(handleHeartbeatTimeout(bool,unsigned int)));
+        connect(uas, SIGNAL(connected()), this, SLOT(handleLinkChanged()));
+        connect(uas, SIGNAL(disconnected()), this, SLOT(handleLinkChanged()));
     }
     else
     {
@@ -73,6 +115,10 @@ UASWaypointManager::UASWaypointManager(UAS* _uas)
     m_defaultRelativeAlt = readSetting(DEFAULT_REL_ALT, 20.0f).toDouble();
 
     m_waypointComponentID = QGC::ComponentID();
+
+    // Connected first, so the store is already invalid in every other slot of these signals
+    connect(this, SIGNAL(waypointEditableListChanged()), this, SLOT(invalidateMissionStore()));
+    connect(this, SIGNAL(waypointEditableChanged(int,Waypoint*)), this, SLOT(invalidateMissionStore()));
 }
 
 UASWaypointManager::~UASWaypointManager()
@@ -83,7 +129,9 @@ UASWaypointManager::~UASWaypointManager()
 void UASWaypointManager::timeout()
 {
     if (current_retries > 0) {
-        protocol_timer.start(PROTOCOL_TIMEOUT_MS);
+        // Back off, the link is slower than the round trip estimate
+        protocol_timeout = qMin(protocol_timeout * 2, PROTOCOL_TIMEOUT_MS);
+        protocol_timer.start(protocol_timeout);
         current_retries--;
         emit updateStatusString(tr("Timeout, retrying (retries left: %1)").arg(current_retries));
 
@@ -93,6 +141,9 @@ void UASWaypointManager::timeout()
         } else if (current_state == WP_GETLIST_GETWPS) {
             QLOG_WARN() << "Timeout requesting waypoints - retrying.";
             sendWaypointRequest(current_wp_id);
+        } else if (current_state == WP_SENDLIST && partial_write) {
+            QLOG_WARN() << "Timeout sending partial waypoint list - retrying.";
+            sendWaypointWritePartialList();
         } else if (current_state == WP_SENDLIST) {
             QLOG_WARN() << "Timeout sending waypoint count - retrying.";
             sendWaypointCount();
@@ -106,19 +157,55 @@ void UASWaypointManager::timeout()
             QLOG_WARN() << "Timeout sending set current waypoint - retrying.";
             sendWaypointSetCurrent(current_wp_id);
         }
+        // A reply can not be told apart from a reply to the lost message
+        round_trip_pending = false;
     } else {
         protocol_timer.stop();
         QLOG_WARN() << "Finally timed out - going to idle. Current state was:" << current_state;
         emit updateStatusString("Operation timed out.");
 
+        const bool wasPartialWrite = partial_write;
+        if (current_state == WP_SENDLIST || current_state == WP_SENDLIST_SENDWPSINT || current_state == WP_SENDLIST_SENDWPSFLOAT
+                || current_state == WP_CLEARLIST) {
+            // Part of the list may have been written
+            vehicle_mission_known = false;
+        }
+        partial_write = false;
+        partial_ranges.clear();
+
         current_state = WP_IDLE;
         current_count = 0;
         current_wp_id = 0;
         current_partner_systemid = 0;
         current_partner_compid = MAV_COMP_ID_PRIMARY;
+
+        if (wasPartialWrite) {
+            // The MAV ignores MISSION_WRITE_PARTIAL_LIST, send the whole list instead
+            QLOG_WARN() << "Partial waypoint write timed out - sending the full list.";
+            partial_write_rejected = true;
+            writeWaypoints();
+        }
+    }
+}
+
+void UASWaypointManager::handleHeartbeatTimeout(bool timeout, unsigned int ms)
+{
+    Q_UNUSED(ms);
+    if (timeout) {
+        // The vehicle may reboot or get a new mission from another GCS meanwhile
+        vehicle_mission_known = false;
+        vehicle_mission_read_back = false;
     }
 }
 
+void UASWaypointManager::handleLinkChanged()
+{
+    vehicle_mission_known = false;
+    vehicle_mission_read_back = false;
+    // The vehicle on the other end may be a different one
+    partial_write_rejected = false;
+}
+
 void UASWaypointManager::handleLocalPositionChanged(UASInterface* mav, double x, double y, double z, quint64 time)
 {
     Q_UNUSED(mav);
@@ -151,8 +238,11 @@ void UASWaypointManager::handleGlobalPositionChanged(UASInterface* mav, double l
 void UASWaypointManager::handleWaypointCount(quint8 systemId, quint8 compId, quint16 count)
 {
     if (current_state == WP_GETLIST && systemId == current_partner_systemid) {
-        protocol_timer.start(PROTOCOL_TIMEOUT_MS);
+        finishRoundTrip();
+        protocol_timer.start(protocol_timeout);
         current_retries = PROTOCOL_MAX_RETRIES;
+        transfer_item_hashes.clear();
+        transfer_item_hashes.reserve(count);
 
         //Clear the old edit-list before receiving the new one
         if (read_to_edit == true){
@@ -168,6 +258,7 @@ void UASWaypointManager::handleWaypointCount(quint8 systemId, quint8 compId, qui
             sendWaypointRequest(current_wp_id);
         } else {
             protocol_timer.stop();
+            setVehicleMission(transfer_item_hashes, true);
             emit updateStatusString("done.");
             current_state = WP_IDLE;
             current_count = 0;
@@ -196,8 +287,10 @@ void UASWaypointManager::handleWaypoint(quint8 systemId, quint8 compId, mavlink_
 
         if(wp->seq == current_wp_id) {
 
-            protocol_timer.start(PROTOCOL_TIMEOUT_MS);
+            finishRoundTrip();
+            protocol_timer.start(protocol_timeout);
             current_retries = PROTOCOL_MAX_RETRIES;
+            transfer_item_hashes.append(missionItemHash(*wp));
 
             // convert x and y value of waypoints from int32_t to double
             double wp_x = wp->x / (double) 1E7;
@@ -231,6 +324,7 @@ void UASWaypointManager::handleWaypoint(quint8 systemId, quint8 compId, mavlink_
                 waypointIDHandled = 65534;  // Set to invalid value.
 
                 protocol_timer.stop();
+                setVehicleMission(transfer_item_hashes, true);
                 emit readGlobalWPFromUAS(false);
 
                 QTime time = QTime::currentTime();
@@ -256,16 +350,40 @@ void UASWaypointManager::handleWaypoint(quint8 systemId, quint8 compId, mavlink_
 void UASWaypointManager::handleWaypointAck(quint8 systemId, quint8 compId, mavlink_mission_ack_t *wpa)
 {
     if (systemId == current_partner_systemid && (compId == current_partner_compid || compId == MAV_COMP_ID_PRIMARY)) {
-        if((current_state == WP_SENDLIST || current_state == WP_SENDLIST_SENDWPSINT || current_state == WP_SENDLIST_SENDWPSFLOAT)
-           && (current_wp_id == waypoint_buffer.count()-1 && wpa->type == 0)) {
+        const bool sending = (current_state == WP_SENDLIST || current_state == WP_SENDLIST_SENDWPSINT || current_state == WP_SENDLIST_SENDWPSFLOAT);
+        if(sending && (current_wp_id == upload_last && wpa->type == MAV_MISSION_ACCEPTED)) {
+            finishRoundTrip();
+            if (!partial_ranges.isEmpty()) {
+                startNextPartialWrite();
+                return;
+            }
             //all waypoints sent and ack received
             protocol_timer.stop();
             current_state = WP_IDLE;
-            readWaypoints(false); //Update "Onboard Waypoints"-tab immidiately after the waypoint list has been sent.
+            // Only a read back confirms what the vehicle stores, a full write is read back below
+            setVehicleMission(transfer_item_hashes, false);
+            if (partial_write) {
+                // Only the changed items went over the link, do not read everything back
+                partial_write = false;
+                setViewOnlyFromBuffer();
+            } else {
+                readWaypoints(false); //Update "Onboard Waypoints"-tab immidiately after the waypoint list has been sent.
+            }
             emit updateStatusString("done.");
+        } else if (sending && partial_write && wpa->type != MAV_MISSION_ACCEPTED) {
+            QLOG_WARN() << "Partial waypoint write rejected with result" << wpa->type << "- sending the full list.";
+            protocol_timer.stop();
+            current_state = WP_IDLE;
+            partial_write = false;
+            partial_write_rejected = true;
+            partial_ranges.clear();
+            vehicle_mission_known = false;
+            writeWaypoints();
         } else if(current_state == WP_CLEARLIST) {
+            finishRoundTrip();
             protocol_timer.stop();
             current_state = WP_IDLE;
+            vehicle_mission_known = false;
             emit updateStatusString("done.");
         }
     }
@@ -284,11 +402,12 @@ void UASWaypointManager::handleWaypointRequest(quint8 systemId, quint8 compId, m
 void UASWaypointManager::handleWaypointRequest(quint8 systemId, quint8 compId, quint16 wpRequestId, MissionItemEncoding wpEncoding)
 {
     if (systemId == current_partner_systemid
-        && ((current_state == WP_SENDLIST && wpRequestId == 0)
+        && ((current_state == WP_SENDLIST && wpRequestId == upload_first)
             || ((current_state == WP_SENDLIST_SENDWPSINT || current_state == WP_SENDLIST_SENDWPSFLOAT)
                 && (wpRequestId == current_wp_id || wpRequestId == current_wp_id + 1)))
        ) {
-        protocol_timer.start(PROTOCOL_TIMEOUT_MS);
+        finishRoundTrip();
+        protocol_timer.start(protocol_timeout);
         current_retries = PROTOCOL_MAX_RETRIES;
 
         if (wpRequestId < waypoint_buffer.count()) {
@@ -325,6 +444,7 @@ void UASWaypointManager::handleWaypointCurrent(quint8 systemId, quint8 compId, m
     if (systemId == uasid) {
         // FIXME Petri
         if (current_state == WP_SETCURRENT) {
+            finishRoundTrip();
             protocol_timer.stop();
             current_state = WP_IDLE;
 
@@ -350,6 +470,31 @@ void UASWaypointManager::handleWaypointCurrent(quint8 systemId, quint8 compId, m
     }
 }
 
+int UASWaypointManager::setEditableAltitudes(const QVector<int> &indices, const QVector<double> &altitudes)
+{
+    Q_ASSERT(indices.size() == altitudes.size());
+    QList<Waypoint *> changed;
+    for (int i = 0; i < indices.size(); i++) {
+        const int index = indices.at(i);
+        if (index < 0 || index >= waypointsEditable.count() || qIsNaN(altitudes.at(i)))
+            continue;
+        // Listeners are told once all altitudes are set, so none sees a half updated mission
+        Waypoint *wp = waypointsEditable.at(index);
+        const bool blocked = wp->blockSignals(true);
+        const double before = wp->getAltitude();
+        wp->setAltitude(altitudes.at(i));
+        wp->blockSignals(blocked);
+        if (wp->getAltitude() != before)
+            changed.append(wp);
+    }
+    // The list itself is unchanged. Views like the map only refresh the
+    // values of an item on its own change signal.
+    foreach (Waypoint *wp, changed) {
+        emit waypointEditableChanged(uasid, wp);
+    }
+    return changed.count();
+}
+
 void UASWaypointManager::notifyOfChangeEditable(Waypoint* wp)
 {
     // If only one waypoint was changed, emit only WP signal
@@ -378,7 +523,7 @@ int UASWaypointManager::setCurrentWaypoint(quint16 seq)
         if(current_state == WP_IDLE) {
 
             //send change to UAS - important to note: if the transmission fails, we have inconsistencies
-            protocol_timer.start(PROTOCOL_TIMEOUT_MS);
+            protocol_timer.start(protocol_timeout);
             current_retries = PROTOCOL_MAX_RETRIES;
 
             current_state = WP_SETCURRENT;
@@ -546,6 +691,15 @@ void UASWaypointManager::moveWaypoint(quint16 cur_seq, quint16 new_seq)
 void UASWaypointManager::saveWaypoints(const QString &saveFile)
 {
     QFile file(saveFile);
+    if (isBinaryMissionFile(saveFile))
+    {
+        if (!file.open(QIODevice::WriteOnly) || !saveWaypointsBinary(file))
+        {
+            emit updateStatusString(tr("Could not write waypoint file %1").arg(saveFile));
+        }
+        return;
+    }
+
     if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
         return;
 
@@ -565,22 +719,144 @@ void UASWaypointManager::saveWaypoints(const QString &saveFile)
 void UASWaypointManager::loadWaypoints(const QString &loadFile)
 {
     QFile file(loadFile);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    if (!file.open(QIODevice::ReadOnly))
         return;
 
+    // Both formats are parsed into a new list, the editable list changes once when it is complete
+    QList<Waypoint *> waypoints;
+    bool loaded;
+    QByteArray magic = file.peek(MISSION_BINARY_MAGIC_SIZE);
+    if (magic == QByteArray(MISSION_BINARY_MAGIC, MISSION_BINARY_MAGIC_SIZE))
+    {
+        const qint64 size = file.size();
+        const uchar *data = file.map(0, size);
+        if (data)
+        {
+            loaded = loadWaypointsBinary(data, size, waypoints);
+            file.unmap(const_cast<uchar *>(data));
+        }
+        else
+        {
+            const QByteArray bytes = file.readAll();
+            loaded = loadWaypointsBinary(reinterpret_cast<const uchar *>(bytes.constData()), bytes.size(), waypoints);
+        }
+    }
+    else
+    {
+        file.close();
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+            return;
+        loaded = loadWaypointsText(file, waypoints);
+    }
+    file.close();
+
+    if (!loaded && waypoints.isEmpty())
+    {
+        // Nothing usable in the file, keep the current mission
+        return;
+    }
+
     qDeleteAll(waypointsEditable);
-    waypointsEditable.clear();
+    waypointsEditable.swap(waypoints);
+    foreach (Waypoint *wp, waypointsEditable)
+    {
+        connect(wp, SIGNAL(changed(Waypoint*)), this, SLOT(notifyOfChangeEditable(Waypoint*)));
+    }
 
+    emit loadWPFile();
     emit waypointEditableListChanged();
     emit waypointEditableListChanged(uasid);
+}
+
+bool UASWaypointManager::isBinaryMissionFile(const QString &fileName)
+{
+    return fileName.endsWith(".wpb", Qt::CaseInsensitive);
+}
+
+bool UASWaypointManager::saveWaypointsBinary(QFile &file)
+{
+    QByteArray bytes(MISSION_BINARY_HEADER_SIZE + waypointsEditable.count() * MISSION_BINARY_RECORD_SIZE, 0);
+    uchar *out = reinterpret_cast<uchar *>(bytes.data());
+
+    memcpy(out, MISSION_BINARY_MAGIC, MISSION_BINARY_MAGIC_SIZE);
+    qToLittleEndian<quint16>(MISSION_BINARY_VERSION, out + 4);
+    qToLittleEndian<quint16>(MISSION_BINARY_RECORD_SIZE, out + 6);
+    qToLittleEndian<quint32>(waypointsEditable.count(), out + 8);
+    out += MISSION_BINARY_HEADER_SIZE;
+
+    for (int i = 0; i < waypointsEditable.count(); i++)
+    {
+        Waypoint *wp = waypointsEditable[i];
+        wp->setId(i);
+        const double params[7] = { wp->getParam1(), wp->getParam2(), wp->getParam3(), wp->getParam4(),
+                                   wp->getX(), wp->getY(), wp->getZ() };
+        for (int p = 0; p < 7; p++)
+        {
+            quint64 bits;
+            memcpy(&bits, &params[p], sizeof(bits));
+            qToLittleEndian<quint64>(bits, out + p * 8);
+        }
+        qToLittleEndian<quint16>(wp->getAction(), out + 56);
+        out[58] = static_cast<uchar>(wp->getFrame());
+        out[59] = (wp->getCurrent() ? 0x01 : 0) | (wp->getAutoContinue() ? 0x02 : 0);
+        out += MISSION_BINARY_RECORD_SIZE;
+    }
+    return file.write(bytes) == bytes.size();
+}
+
+bool UASWaypointManager::loadWaypointsBinary(const uchar *data, qint64 size, QList<Waypoint *> &waypoints)
+{
+    if (size < MISSION_BINARY_HEADER_SIZE)
+    {
+        emit updateStatusString(tr("Waypoint file is corrupt. Version not detectable"));
+        return false;
+    }
+    const quint16 version = qFromLittleEndian<quint16>(data + 4);
+    const quint16 recordSize = qFromLittleEndian<quint16>(data + 6);
+    const quint32 count = qFromLittleEndian<quint32>(data + 8);
+    if (version != MISSION_BINARY_VERSION || recordSize < MISSION_BINARY_RECORD_SIZE)
+    {
+        emit updateStatusString(tr("The waypoint file is version %1 and is not compatible").arg(version));
+        return false;
+    }
 
+    // A truncated file still gives the complete records it contains
+    const qint64 available = (size - MISSION_BINARY_HEADER_SIZE) / recordSize;
+    const int records = static_cast<int>(qMin<qint64>(count, available));
+    waypoints.reserve(records);
+
+    const uchar *in = data + MISSION_BINARY_HEADER_SIZE;
+    for (int i = 0; i < records; i++, in += recordSize)
+    {
+        double params[7];
+        for (int p = 0; p < 7; p++)
+        {
+            const quint64 bits = qFromLittleEndian<quint64>(in + p * 8);
+            memcpy(&params[p], &bits, sizeof(bits));
+        }
+        const MAV_CMD action = static_cast<MAV_CMD>(qFromLittleEndian<quint16>(in + 56));
+        const MAV_FRAME frame = static_cast<MAV_FRAME>(in[58]);
+        waypoints.append(new Waypoint(i, params[4], params[5], params[6], params[0], params[1], params[2], params[3],
+                                      in[59] & 0x02, in[59] & 0x01, frame, action));
+    }
+
+    if (records < static_cast<qint64>(count))
+    {
+        emit updateStatusString(tr("The waypoint file is corrupted. Load operation only partly succesful."));
+        return false;
+    }
+    return true;
+}
+
+bool UASWaypointManager::loadWaypointsText(QFile &file, QList<Waypoint *> &waypoints)
+{
     QTextStream in(&file);
 
     const QStringList &version = in.readLine().split(" ");
 
-    if (version.length() < 2){
+    if (version.length() < 3){
         emit updateStatusString(tr("Waypoint file is corrupt. Version not detectable"));
-        return;
+        return false;
     }
 
     int versionInt = version[2].toInt();
@@ -588,37 +864,32 @@ void UASWaypointManager::loadWaypoints(const QString &loadFile)
     if (!(version.size() == 3 && version[0] == "QGC" && version[1] == "WPL" && versionInt >= 110))
     {
         emit updateStatusString(tr("The waypoint file is version %1 and is not compatible").arg(versionInt));
+        return false;
     }
-    else
+
+    while (!in.atEnd())
     {
-        while (!in.atEnd())
+        Waypoint *t = new Waypoint();
+        if(t->load(in))
         {
-            Waypoint *t = new Waypoint();
-            if(t->load(in))
-            {
-                t->setId(waypointsEditable.count());
-                waypointsEditable.insert(waypointsEditable.count(), t);
-            }
-            else
-            {
-                emit updateStatusString(tr("The waypoint file is corrupted. Load operation only partly succesful."));
-                break;
-            }
+            t->setId(waypoints.count());
+            waypoints.append(t);
+        }
+        else
+        {
+            delete t;
+            emit updateStatusString(tr("The waypoint file is corrupted. Load operation only partly succesful."));
+            return false;
         }
     }
-
-    file.close();
-
-    emit loadWPFile();
-    emit waypointEditableListChanged();
-    emit waypointEditableListChanged(uasid);
+    return true;
 }
 
 void UASWaypointManager::clearWaypointList()
 {
     if (current_state == WP_IDLE)
     {
-        protocol_timer.start(PROTOCOL_TIMEOUT_MS);
+        protocol_timer.start(protocol_timeout);
         current_retries = PROTOCOL_MAX_RETRIES;
 
         current_state = WP_CLEARLIST;
@@ -630,54 +901,36 @@ void UASWaypointManager::clearWaypointList()
     }
 }
 
-const QList<Waypoint *> UASWaypointManager::getGlobalFrameWaypointList()
+void UASWaypointManager::invalidateMissionStore()
 {
-    // TODO Keep this global frame list up to date
-    // with complete waypoint list
-    // instead of filtering on each request
-    QList<Waypoint*> wps;
-    foreach (Waypoint* wp, waypointsEditable)
-    {
-        if (wp->isGlobalFrame())
-        {
-            wps.append(wp);
-        }
-    }
-    return wps;
+    mission_store_valid = false;
 }
 
-const QList<Waypoint *> UASWaypointManager::getGlobalFrameAndNavTypeWaypointList(bool onlypath)
+const MissionStore &UASWaypointManager::getMissionStore()
 {
-    // TODO Keep this global frame list up to date
-    // with complete waypoint list
-    // instead of filtering on each request
-    QList<Waypoint*> wps;
-    foreach (Waypoint* wp, waypointsEditable)
+    // The count check also catches list changes which are not announced yet
+    if (!mission_store_valid || mission_store.count() != waypointsEditable.count())
     {
-        if ((wp->isGlobalFrame()) && (wp->isNavigationType() || (wp->visibleOnMapWidget())))
-        {
-            if(wp->visibleOnMapWidget() && onlypath) // we need waypoints only to draw the path on map
-                continue;
-            wps.append(wp);
-        }
+        mission_store.rebuild(waypointsEditable);
+        mission_store_valid = true;
     }
-    return wps;
+    return mission_store;
 }
 
-const QList<Waypoint *> UASWaypointManager::getNavTypeWaypointList()
+const QList<Waypoint *> &UASWaypointManager::getGlobalFrameWaypointList()
 {
-    // TODO Keep this global frame list up to date
-    // with complete waypoint list
-    // instead of filtering on each request
-    QList<Waypoint*> wps;
-    foreach (Waypoint* wp, waypointsEditable)
-    {
-        if (wp->isNavigationType())
-        {
-            wps.append(wp);
-        }
-    }
-    return wps;
+    return getMissionStore().waypoints(MissionStore::GlobalFrameView);
+}
+
+const QList<Waypoint *> &UASWaypointManager::getGlobalFrameAndNavTypeWaypointList(bool onlypath)
+{
+    // The path leaves out items which are only shown on the map
+    return getMissionStore().waypoints(onlypath ? MissionStore::GlobalFramePathView : MissionStore::GlobalFrameMapView);
+}
+
+const QList<Waypoint *> &UASWaypointManager::getNavTypeWaypointList()
+{
+    return getMissionStore().waypoints(MissionStore::NavTypeView);
 }
 
 int UASWaypointManager::getIndexOf(Waypoint* wp)
@@ -687,161 +940,47 @@ int UASWaypointManager::getIndexOf(Waypoint* wp)
 
 int UASWaypointManager::getGlobalFrameIndexOf(Waypoint* wp)
 {
-    // Search through all waypointsEditable,
-    // counting only those in global frame
-    int i = 0;
-    foreach (Waypoint* p, waypointsEditable) {
-        if (p->isGlobalFrame())
-        {
-            if (p == wp)
-            {
-                return i;
-            }
-            i++;
-        }
-    }
-
-    return -1;
+    return getMissionStore().indexInView(MissionStore::GlobalFrameView, wp);
 }
 
 int UASWaypointManager::getGlobalFrameAndNavTypeIndexOf(Waypoint* wp)
 {
-    // Search through all waypointsEditable,
-    // counting only those in global frame
-    int i = 0;
-    foreach (Waypoint* p, waypointsEditable) {
-        if (p->isGlobalFrame() && p->isNavigationType())
-        {
-            if (p == wp)
-            {
-                return i;
-            }
-            i++;
-        }
-    }
-
-    return -1;
+    return getMissionStore().indexInView(MissionStore::GlobalFrameAndNavTypeView, wp);
 }
 
 int UASWaypointManager::getNavTypeIndexOf(Waypoint* wp)
 {
-    // Search through all waypointsEditable,
-    // counting only those in global frame
-    int i = 0;
-    foreach (Waypoint* p, waypointsEditable)
-    {
-        if (p->isNavigationType())
-        {
-            if (p == wp)
-            {
-                return i;
-            }
-            i++;
-        }
-    }
-
-    return -1;
+    return getMissionStore().indexInView(MissionStore::NavTypeView, wp);
 }
 
 int UASWaypointManager::getGlobalFrameCount()
 {
-    // Search through all waypointsEditable,
-    // counting only those in global frame
-    int i = 0;
-    foreach (Waypoint* p, waypointsEditable)
-    {
-        if (p->isGlobalFrame())
-        {
-            i++;
-        }
-    }
-
-    return i;
+    return getMissionStore().viewCount(MissionStore::GlobalFrameView);
 }
 
 int UASWaypointManager::getGlobalFrameAndNavTypeCount()
 {
-    // Search through all waypointsEditable,
-    // counting only those in global frame
-    int i = 0;
-    foreach (Waypoint* p, waypointsEditable) {
-        if (p->isGlobalFrame() && p->isNavigationType())
-        {
-            i++;
-        }
-    }
-
-    return i;
+    return getMissionStore().viewCount(MissionStore::GlobalFrameAndNavTypeView);
 }
 
 int UASWaypointManager::getNavTypeCount()
 {
-    // Search through all waypointsEditable,
-    // counting only those in global frame
-    int i = 0;
-    foreach (Waypoint* p, waypointsEditable) {
-        if (p->isNavigationType()) {
-            i++;
-        }
-    }
-
-    return i;
+    return getMissionStore().viewCount(MissionStore::NavTypeView);
 }
 
 int UASWaypointManager::getLocalFrameCount()
 {
-    // Search through all waypointsEditable,
-    // counting only those in global frame
-    int i = 0;
-    foreach (Waypoint* p, waypointsEditable)
-    {
-        if (p->getFrame() == MAV_FRAME_LOCAL_NED || p->getFrame() == MAV_FRAME_LOCAL_ENU)
-        {
-            i++;
-        }
-    }
-
-    return i;
+    return getMissionStore().viewCount(MissionStore::LocalFrameView);
 }
 
 int UASWaypointManager::getLocalFrameIndexOf(Waypoint* wp)
 {
-    // Search through all waypointsEditable,
-    // counting only those in local frame
-    int i = 0;
-    foreach (Waypoint* p, waypointsEditable)
-    {
-        if (p->getFrame() == MAV_FRAME_LOCAL_NED || p->getFrame() == MAV_FRAME_LOCAL_ENU)
-        {
-            if (p == wp)
-            {
-                return i;
-            }
-            i++;
-        }
-    }
-
-    return -1;
+    return getMissionStore().indexInView(MissionStore::LocalFrameView, wp);
 }
 
 int UASWaypointManager::getMissionFrameIndexOf(Waypoint* wp)
 {
-    // Search through all waypointsEditable,
-    // counting only those in mission frame
-    int i = 0;
-    foreach (Waypoint* p, waypointsEditable)
-    {
-        if (p->getFrame() == MAV_FRAME_MISSION)
-        {
-            if (p == wp)
-            {
-                return i;
-            }
-            i++;
-        }
-    }
-
-    return -1;
+    return getMissionStore().indexInView(MissionStore::MissionFrameView, wp);
 }
 
 
@@ -870,7 +1009,7 @@ void UASWaypointManager::readWaypoints(bool readToEdit)
             emit waypointEditableListChanged();
         }
         */
-        protocol_timer.start(PROTOCOL_TIMEOUT_MS);
+        protocol_timer.start(protocol_timeout);
         current_retries = PROTOCOL_MAX_RETRIES;
 
         current_state = WP_GETLIST;
@@ -924,16 +1063,12 @@ void UASWaypointManager::goToWaypoint(Waypoint *wp)
 }
 
 // change mavlink_mission_item_t to mavlink_mission_item_int_t
-void UASWaypointManager::writeWaypoints()
+void UASWaypointManager::writeWaypoints(bool forceFullWrite)
 {
     if (current_state == WP_IDLE) {
         // Send clear all if count == 0
         if (waypointsEditable.count() > 0) {
-            protocol_timer.start(PROTOCOL_TIMEOUT_MS);
-            current_retries = PROTOCOL_MAX_RETRIES;
-
             current_count = waypointsEditable.count();
-            current_state = WP_SENDLIST;
             current_wp_id = 0;
             current_partner_systemid = uasid;
             current_partner_compid = m_waypointComponentID;
@@ -946,6 +1081,8 @@ void UASWaypointManager::writeWaypoints()
                 delete waypoint_buffer.back();
                 waypoint_buffer.pop_back();
             }
+            transfer_item_hashes.clear();
+            transfer_item_hashes.reserve(current_count);
 
             bool noCurrent = true;
 
@@ -965,24 +1102,62 @@ void UASWaypointManager::writeWaypoints()
                 cur_d->frame = cur_s->getFrame();
                 cur_d->command = cur_s->getAction();
                 cur_d->seq = i;     // don't read out the sequence number of the waypoint class
-                // convert fromt double to int32_t
-                cur_d->x = (int32_t) (cur_s->getX() * 1E7);
-                cur_d->y = (int32_t) (cur_s->getY() * 1E7);
+                // convert fromt double to int32_t, rounding so that positions
+                // read from the MAV convert back to the same value
+                cur_d->x = (int32_t) qRound64(cur_s->getX() * 1E7);
+                cur_d->y = (int32_t) qRound64(cur_s->getY() * 1E7);
                 cur_d->z = cur_s->getZ();
 
                 if (cur_s->getCurrent() && noCurrent)
                     noCurrent = false;
                 if (i == (current_count - 1) && noCurrent == true) //not a single waypoint was set as "current"
                     cur_d->current = true; // set the last waypoint as current. Or should it better be the first waypoint ?
+
+                transfer_item_hashes.append(missionItemHash(*cur_d));
             }
 
+            const bool sameCount = !forceFullWrite && vehicle_mission_known && vehicle_item_hashes.count() == current_count;
+            if (sameCount && vehicle_mission_read_back && missionHash(transfer_item_hashes) == vehicle_mission_hash) {
+                QLOG_DEBUG() << "writeWaypoints() - Mission unchanged on the MAV, nothing to send";
+                emit updateStatusString(tr("Mission unchanged on the vehicle, nothing to send. Hold Shift to send it anyway."));
+                current_count = 0;
+                current_partner_systemid = 0;
+                current_partner_compid = MAV_COMP_ID_PRIMARY;
+                return;
+            }
 
+            // The MAV only allows partial writes of items it already has, so
+            // the count must not change. ArduPilot implements them.
+            int changedItems = 0;
+            partial_ranges.clear();
+            if (sameCount && !partial_write_rejected && uas && uas->getAutopilotType() == MAV_AUTOPILOT_ARDUPILOTMEGA) {
+                partial_ranges = changedRanges(&changedItems);
+                if (changedItems * 2 > current_count) {
+                    // Most of the list changed, the full write is cheaper
+                    partial_ranges.clear();
+                }
+            }
+
+            if (!partial_ranges.isEmpty()) {
+                QLOG_DEBUG() << "writeWaypoints() - Writing" << changedItems << "of" << current_count
+                             << "waypoints in" << partial_ranges.count() << "partial writes";
+                partial_write = true;
+                startNextPartialWrite();
+                return;
+            }
 
+            protocol_timer.start(protocol_timeout);
+            current_retries = PROTOCOL_MAX_RETRIES;
+            current_state = WP_SENDLIST;
+            partial_write = false;
+            upload_first = 0;
+            upload_last = current_count - 1;
 
             //send the waypoint count to UAS (this starts the send transaction)
             sendWaypointCount();
         } else if (waypointsEditable.count() == 0)
         {
+            vehicle_mission_known = false;
             sendWaypointClearAll();
         }
     }
@@ -993,6 +1168,130 @@ void UASWaypointManager::writeWaypoints()
     }
 }
 
+quint64 UASWaypointManager::missionItemHash(const mavlink_mission_item_int_t &item)
+{
+    quint64 hash = FNV_OFFSET_BASIS;
+    fnvAppend(hash, item.param1);
+    fnvAppend(hash, item.param2);
+    fnvAppend(hash, item.param3);
+    fnvAppend(hash, item.param4);
+    fnvAppend(hash, item.x);
+    fnvAppend(hash, item.y);
+    fnvAppend(hash, item.z);
+    fnvAppend(hash, item.command);
+    fnvAppend(hash, item.frame);
+    fnvAppend(hash, item.autocontinue);
+    fnvAppend(hash, item.mission_type);
+    return hash;
+}
+
+quint64 UASWaypointManager::missionHash(const QVector<quint64> &itemHashes)
+{
+    quint64 hash = FNV_OFFSET_BASIS;
+    fnvAppend(hash, itemHashes.count());
+    foreach (quint64 itemHash, itemHashes)
+    {
+        fnvAppend(hash, itemHash);
+    }
+    return hash;
+}
+
+QList<QPair<quint16, quint16> > UASWaypointManager::changedRanges(int *changedItems) const
+{
+    QList<QPair<quint16, quint16> > ranges;
+    int changed = 0;
+    for (int i = 0; i < transfer_item_hashes.count() && i < vehicle_item_hashes.count(); i++)
+    {
+        if (transfer_item_hashes.at(i) == vehicle_item_hashes.at(i))
+        {
+            continue;
+        }
+        if (!ranges.isEmpty() && i - ranges.last().second <= PARTIAL_WRITE_MERGE_GAP + 1)
+        {
+            // Sending a few unchanged items is cheaper than another handshake
+            changed += i - ranges.last().second;
+            ranges.last().second = i;
+        }
+        else
+        {
+            ranges.append(qMakePair(quint16(i), quint16(i)));
+            changed++;
+        }
+    }
+    if (changedItems)
+    {
+        *changedItems = changed;
+    }
+    return ranges;
+}
+
+void UASWaypointManager::startNextPartialWrite()
+{
+    const QPair<quint16, quint16> range = partial_ranges.takeFirst();
+    upload_first = range.first;
+    upload_last = range.second;
+
+    protocol_timer.start(protocol_timeout);
+    current_retries = PROTOCOL_MAX_RETRIES;
+    current_state = WP_SENDLIST;
+    current_wp_id = upload_first;
+
+    sendWaypointWritePartialList();
+}
+
+void UASWaypointManager::setVehicleMission(const QVector<quint64> &itemHashes, bool readBack)
+{
+    vehicle_item_hashes = itemHashes;
+    vehicle_mission_hash = missionHash(itemHashes);
+    vehicle_mission_known = true;
+    vehicle_mission_read_back = readBack;
+}
+
+void UASWaypointManager::setViewOnlyFromBuffer()
+{
+    qDeleteAll(waypointsViewOnly);
+    waypointsViewOnly.clear();
+    foreach (const mavlink_mission_item_int_t *item, waypoint_buffer)
+    {
+        Waypoint *wp = new Waypoint(item->seq, item->x / (double) 1E7, item->y / (double) 1E7, item->z,
+                                    item->param1, item->param2, item->param3, item->param4,
+                                    item->autocontinue, item->current, (MAV_FRAME) item->frame, (MAV_CMD) item->command);
+        waypointsViewOnly.append(wp);
+        connect(wp, SIGNAL(changed(Waypoint*)), this, SLOT(notifyOfChangeViewOnly(Waypoint*)));
+    }
+    emit waypointViewOnlyListChanged();
+    emit waypointViewOnlyListChanged(uasid);
+}
+
+void UASWaypointManager::startRoundTrip()
+{
+    round_trip_pending = true;
+    round_trip_clock.start();
+}
+
+void UASWaypointManager::finishRoundTrip()
+{
+    if (!round_trip_pending)
+    {
+        return;
+    }
+    round_trip_pending = false;
+
+    // Smoothed round trip time and deviation as in TCP (RFC 6298)
+    const double sample = round_trip_clock.elapsed();
+    if (smoothed_rtt < 0.0)
+    {
+        smoothed_rtt = sample;
+        rtt_variance = sample / 2.0;
+    }
+    else
+    {
+        rtt_variance = 0.75 * rtt_variance + 0.25 * qAbs(smoothed_rtt - sample);
+        smoothed_rtt = 0.875 * smoothed_rtt + 0.125 * sample;
+    }
+    protocol_timeout = qBound(PROTOCOL_MIN_TIMEOUT_MS, qRound(smoothed_rtt + 4.0 * rtt_variance), PROTOCOL_TIMEOUT_MS);
+}
+
 void UASWaypointManager::sendWaypointClearAll()
 {
     if (!uas) return;
@@ -1007,6 +1306,7 @@ void UASWaypointManager::sendWaypointClearAll()
     mavlink_msg_mission_clear_all_encode(uas->getSystemId(), uas->getComponentId(), &message, &wpca);
 
     uas->sendMessage(message);
+    startRoundTrip();
     QGC::SLEEP::msleep(PROTOCOL_DELAY_MS);
 }
 
@@ -1024,6 +1324,7 @@ void UASWaypointManager::sendWaypointSetCurrent(quint16 seq)
 
     mavlink_msg_mission_set_current_encode(uas->getSystemId(), uas->getComponentId(), &message, &wpsc);
     uas->sendMessage(message);
+    startRoundTrip();
     QGC::SLEEP::msleep(PROTOCOL_DELAY_MS);
 }
 
@@ -1042,6 +1343,7 @@ void UASWaypointManager::sendWaypointCount()
 
     mavlink_msg_mission_count_encode(uas->getSystemId(), uas->getComponentId(), &message, &wpc);
     uas->sendMessage(message);
+    startRoundTrip();
     QGC::SLEEP::msleep(PROTOCOL_DELAY_MS);
 }
 
@@ -1058,6 +1360,7 @@ void UASWaypointManager::sendWaypointRequestList()
 
     mavlink_msg_mission_request_list_encode(uas->getSystemId(), uas->getComponentId(), &message, &wprl);
     uas->sendMessage(message);
+    startRoundTrip();
     QGC::SLEEP::msleep(PROTOCOL_DELAY_MS);
 }
 
@@ -1078,6 +1381,7 @@ void UASWaypointManager::sendWaypointRequest(quint16 seq)
     //using mavlink_msg_mission_request_int_encode to encode mavlink_mission_request_int_t type message
     mavlink_msg_mission_request_int_encode(uas->getSystemId(), uas->getComponentId(), &message, &wpr);
     uas->sendMessage(message);
+    startRoundTrip();
     QGC::SLEEP::msleep(PROTOCOL_DELAY_MS);
 }
 
@@ -1110,10 +1414,31 @@ void UASWaypointManager::sendWaypoint(quint16 seq)
 
         emit updateStatusString(QString("Sending waypoint ID %1 of %2 total").arg(wp->seq).arg(current_count));
         uas->sendMessage(message);
+        startRoundTrip();
         QGC::SLEEP::msleep(PROTOCOL_DELAY_MS);
     }
 }
 
+void UASWaypointManager::sendWaypointWritePartialList()
+{
+    if (!uas) return;
+    mavlink_message_t message;
+    mavlink_mission_write_partial_list_t wpwp;
+
+    wpwp.target_system = uasid;
+    wpwp.target_component = m_waypointComponentID;
+    wpwp.start_index = upload_first;
+    wpwp.end_index = upload_last;
+    wpwp.mission_type = MAV_MISSION_TYPE_MISSION;
+
+    emit updateStatusString(QString("Starting to transmit changed waypoints %1 to %2...").arg(upload_first).arg(upload_last));
+
+    mavlink_msg_mission_write_partial_list_encode(uas->getSystemId(), uas->getComponentId(), &message, &wpwp);
+    uas->sendMessage(message);
+    startRoundTrip();
+    QGC::SLEEP::msleep(PROTOCOL_DELAY_MS);
+}
+
 void UASWaypointManager::sendWaypointAck(quint8 type)
 {
     if (!uas) return;
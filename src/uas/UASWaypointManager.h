@@ -33,9 +33,14 @@ This file is part of the QGROUNDCONTROL project
 #define UASWAYPOINTMANAGER_H
 
 #include <QObject>
+#include <QElapsedTimer>
+#include <QFile>
 #include <QList>
+#include <QPair>
 #include <QTimer>
+#include <QVector>
 #include "Waypoint.h"
+#include "MissionStore.h"
 #include "QGCMAVLink.h"
 class UAS;
 class UASInterface;
@@ -91,7 +96,7 @@ public:
     void clearWaypointList();                       ///< Sends the waypoint clear all message to the MAV
 
     void readWaypoints(bool read_to_edit=false);    ///< Requests the MAV's current waypoint list.
-    void writeWaypoints();                          ///< Sends the waypoint list to the MAV
+    void writeWaypoints(bool forceFullWrite=false); ///< Sends the waypoint list to the MAV, only the changes unless forceFullWrite is set
     int setCurrentWaypoint(quint16 seq);            ///< Sends the sequence number of the waypoint that should get the new target waypoint to the UAS
     int setCurrentEditable(quint16 seq);          ///< Changes the current waypoint in edit tab
     /*@}*/
@@ -104,9 +109,10 @@ public:
     const QList<Waypoint *> &getWaypointViewOnlyList(void) {
         return waypointsViewOnly;    ///< Returns a const reference to the waypoint list.
     }
-    const QList<Waypoint *> getGlobalFrameWaypointList();  ///< Returns a global waypoint list
-    const QList<Waypoint *> getGlobalFrameAndNavTypeWaypointList(bool onlypath); ///< Returns a global waypoint list containing only waypoints suitable for navigation. Actions and other mission items are filtered out.
-    const QList<Waypoint *> getNavTypeWaypointList(); ///< Returns a waypoint list containing only waypoints suitable for navigation. Actions and other mission items are filtered out.
+    const MissionStore &getMissionStore();          ///< Returns the editable list as flat arrays with cached views and distances
+    const QList<Waypoint *> &getGlobalFrameWaypointList();  ///< Returns a global waypoint list
+    const QList<Waypoint *> &getGlobalFrameAndNavTypeWaypointList(bool onlypath); ///< Returns a global waypoint list containing only waypoints suitable for navigation. Actions and other mission items are filtered out.
+    const QList<Waypoint *> &getNavTypeWaypointList(); ///< Returns a waypoint list containing only waypoints suitable for navigation. Actions and other mission items are filtered out.
     const Waypoint* getWaypoint(int index);     ///< Returns the waypoint at index, or NULL if not valid.
     int getIndexOf(Waypoint* wp);                   ///< Get the index of a waypoint in the list
     int getGlobalFrameIndexOf(Waypoint* wp);    ///< Get the index of a waypoint in the list, counting only global waypoints
@@ -127,6 +133,9 @@ public:
 
     double getDefaultRelAltitude();
 
+    /** @brief True if saveWaypoints() writes fileName in the binary mission format */
+    static bool isBinaryMissionFile(const QString &fileName);
+
 private:
     void convertMavlinkMissionItem(mavlink_mission_item_int_t *from, mavlink_mission_item_t *to);
     void handleWaypointRequest(quint8 systemId, quint8 compId, quint16 wpRequestId, MissionItemEncoding wpEncoding); ///< Handles received waypoint request messages (int and float)
@@ -140,6 +149,30 @@ private:
     void sendWaypointRequest(quint16 seq);          ///< Requests a waypoint with sequence number seq
     void sendWaypoint(quint16 seq);                 ///< Sends a waypoint with sequence number seq
     void sendWaypointAck(quint8 type);              ///< Sends a waypoint ack
+    void sendWaypointWritePartialList();            ///< Starts writing the items upload_first..upload_last
+    /*@}*/
+
+    /** @name Delta upload */
+    /*@{*/
+    static quint64 missionItemHash(const mavlink_mission_item_int_t &item);  ///< Hash of the content of an item, ignoring seq, target and current
+    static quint64 missionHash(const QVector<quint64> &itemHashes);          ///< Hash of a whole mission from its item hashes
+    QList<QPair<quint16, quint16> > changedRanges(int *changedItems) const;  ///< Index ranges of waypoint_buffer that differ from the vehicle's mission
+    void startNextPartialWrite();                   ///< Starts the write of the next range in partial_ranges
+    void setVehicleMission(const QVector<quint64> &itemHashes, bool readBack); ///< Remembers the mission now on the vehicle
+    void setViewOnlyFromBuffer();                   ///< Replaces the view-only list with the mission just written
+    /*@}*/
+
+    /** @name Mission files */
+    /*@{*/
+    bool saveWaypointsBinary(QFile &file);          ///< Writes all editable waypoints as one block of fixed size records
+    bool loadWaypointsBinary(const uchar *data, qint64 size, QList<Waypoint *> &waypoints);  ///< Parses a binary mission from memory
+    bool loadWaypointsText(QFile &file, QList<Waypoint *> &waypoints);                      ///< Parses a QGC WPL text mission
+    /*@}*/
+
+    /** @name Adaptive timeout */
+    /*@{*/
+    void startRoundTrip();                          ///< A message expecting a reply was sent
+    void finishRoundTrip();                         ///< The expected reply arrived, update the timeout from the round trip time
     /*@}*/
 
     const QVariant readSetting(const QString& key, const QVariant& value);
@@ -154,16 +187,22 @@ public slots:
     Waypoint* createWaypoint(bool enforceFirstActive=true);     ///< Creates a waypoint
     int removeWaypoint(quint16 seq);                       ///< locally remove the specified waypoint from the storage
     void moveWaypoint(quint16 cur_seq, quint16 new_seq);   ///< locally move a waypoint from its current position cur_seq to a new position new_seq
-    void saveWaypoints(const QString &saveFile);           ///< saves the local waypoint list to saveFile
-    void loadWaypoints(const QString &loadFile);           ///< loads a waypoint list from loadFile
+    void saveWaypoints(const QString &saveFile);           ///< saves the local waypoint list to saveFile, binary if it ends in .wpb
+    void loadWaypoints(const QString &loadFile);           ///< loads a waypoint list from loadFile, text or binary
+    int setEditableAltitudes(const QVector<int> &indices, const QVector<double> &altitudes); ///< Sets the altitudes of the editable waypoints at indices, NaN keeps one. Emits the changes after setting all
     void notifyOfChangeEditable(Waypoint* wp);             ///< Notifies manager to changes to an editable waypoint
     void notifyOfChangeViewOnly(Waypoint* wp);             ///< Notifies manager to changes to a viewonly waypoint, e.g. some widget wants to change "current"
     /*@}*/
     void handleLocalPositionChanged(UASInterface* mav, double x, double y, double z, quint64 time);
     void handleGlobalPositionChanged(UASInterface* mav, double lat, double lon, double alt, quint64 time);
+    void handleHeartbeatTimeout(bool timeout, unsigned int ms);  ///< The vehicle may have rebooted or been changed by another GCS
+    void handleLinkChanged();                                    ///< A link of the vehicle connected or disconnected
 
     void setDefaultRelAltitude(double alt);
 
+private slots:
+    void invalidateMissionStore();                  ///< The editable list or one of its waypoints changed
+
 signals:
     void waypointEditableListChanged(void);                 ///< emits signal that the list of editable waypoints has been changed
     void waypointEditableListChanged(int uasid);            ///< emits signal that the list of editable waypoints has been changed
@@ -190,6 +229,8 @@ private:
 
     QList<Waypoint *> waypointsViewOnly;                  ///< local copy of current waypoint list on MAV
     QList<Waypoint *> waypointsEditable;                  ///< local editable waypoint list
+    MissionStore mission_store;                     ///< Flat copy of waypointsEditable, rebuilt on the first request after a change
+    bool mission_store_valid;                       ///< False if waypointsEditable changed since mission_store was built
     Waypoint* currentWaypointEditable;                      ///< The currently used waypoint
     // change from mavlink_mission_item_t to mavlink_mission_item_int_t
     QList<mavlink_mission_item_int_t *> waypoint_buffer;  ///< buffer for waypoints during communication
@@ -203,6 +244,23 @@ private:
     double m_defaultRelativeAlt;                      ///< Default relative alt in meters
 
     quint16 waypointIDHandled;
+
+    bool vehicle_mission_known;                     ///< True if vehicle_item_hashes describes the mission on the MAV
+    bool vehicle_mission_read_back;                 ///< True if vehicle_item_hashes was read from the MAV since the connection was last lost
+    QVector<quint64> vehicle_item_hashes;           ///< Item hashes of the mission on the MAV
+    quint64 vehicle_mission_hash;                   ///< Hash of the mission on the MAV
+    QVector<quint64> transfer_item_hashes;          ///< Item hashes of the list being read or written
+    QList<QPair<quint16, quint16> > partial_ranges; ///< Ranges still to write with MISSION_WRITE_PARTIAL_LIST
+    bool partial_write;                             ///< The current write only sends the range upload_first..upload_last
+    bool partial_write_rejected;                    ///< The MAV does not support partial writes on this link, always send the full list
+    quint16 upload_first;                           ///< First item of the current write
+    quint16 upload_last;                            ///< Last item of the current write, acked when received
+
+    QElapsedTimer round_trip_clock;                 ///< Started when a message expecting a reply is sent
+    bool round_trip_pending;                        ///< False for retransmissions, their replies are ambiguous
+    double smoothed_rtt;                            ///< Smoothed round trip time in ms, negative until measured
+    double rtt_variance;                            ///< Mean deviation of the round trip time in ms
+    int protocol_timeout;                           ///< Current retransmission timeout in ms
 };
 
 #endif // UASWAYPOINTMANAGER_H
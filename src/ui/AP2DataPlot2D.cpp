@@ -49,6 +49,12 @@ This file is part of the APM_PLANNER project
 
 #define ROW_HEIGHT_PADDING 3 //Number of additional pixels over font height for each row for the table/excel view.
 
+namespace
+{
+// Live values are added to the graphs at about 30 Hz
+const int LiveSampleIntervalMsecs = 33;
+}
+
 AP2DataPlot2D::AP2DataPlot2D(QWidget *parent) : QWidget(parent),
     m_updateTimer(nullptr),
     m_graphCount(0),
@@ -127,6 +133,10 @@ AP2DataPlot2D::AP2DataPlot2D(QWidget *parent) : QWidget(parent),
     ui.horizontalSplitter->setStretchFactor(0,20);
     ui.horizontalSplitter->setStretchFactor(1,1);
 
+    // Live values are collected by the value bus and added in one batch per frame
+    connect(&m_liveSampleTimer, SIGNAL(timeout()), this, SLOT(processLiveSamples()));
+    m_liveSampleTimer.start(LiveSampleIntervalMsecs);
+
     loadSettings();
 }
 
@@ -429,7 +439,6 @@ void AP2DataPlot2D::activeUASSet(UASInterface* uas)
     }
     if (m_uas)
     {
-        disconnect(m_uas,SIGNAL(valueChanged(int,QString,QString,QVariant,quint64)),this,SLOT(valueChanged(int,QString,QString,QVariant,quint64)));
         disconnect(m_uas,SIGNAL(navModeChanged(int,int,QString)),this,SLOT(navModeChanged(int,int,QString)));
         disconnect(m_uas,SIGNAL(connected()),this,SLOT(connected()));
         disconnect(m_uas,SIGNAL(disconnected()),this,SLOT(disconnected()));
@@ -442,7 +451,6 @@ void AP2DataPlot2D::activeUASSet(UASInterface* uas)
     ui.horizontalScrollBar->blockSignals(false);
     m_uas = uas;
 
-    connect(m_uas,SIGNAL(valueChanged(int,QString,QString,QVariant,quint64)),this,SLOT(valueChanged(int,QString,QString,QVariant,quint64)));
     connect(m_uas,SIGNAL(navModeChanged(int,int,QString)),this,SLOT(navModeChanged(int,int,QString)));
 
     //textMessageReceived(uasId, message.compid, severity, text);
@@ -499,31 +507,53 @@ void AP2DataPlot2D::navModeChanged(int uasid, int mode, const QString& text)
     plotTextArrow(index, text, ModeMessage::TypeName, QColor(50,125,0), ui.modeDisplayCheckBox);
 }
 
-void AP2DataPlot2D::updateValue(const int uasId, const QString& name, const QString& unit, const double value, const quint64 msec,bool integer)
+void AP2DataPlot2D::processLiveSamples()
 {
-    Q_UNUSED(msec)
-    Q_UNUSED(unit)
-    if (m_uas->getUASID() != uasId)
+    m_liveSamples.clear();
+    if (MAVLinkValueBus::instance()->drain(m_liveSamples) == 0 || !m_uas)
     {
         return;
     }
+    const int uasId = m_uas->getUASID();
+    MAVLinkValueBus *bus = MAVLinkValueBus::instance();
 
-    QString propername;
-    QStringList parts = name.split(':');
-    if(parts.size() == 2)
+    // Sort the batch into the series, values arrive interleaved
+    qint64 newmsec = 0;
+    bool received = false;
+    for (const MAVLinkValueBus::Sample &sample : qAsConst(m_liveSamples))
     {
-        // name looks like M1:ATTITUDE.Pitch or M1:BATTERY_STATUS.voltages.0
-        propername  = parts[1];
+        if (sample.uasId != uasId)
+        {
+            continue;
+        }
+        if (sample.series >= m_onlineSeries.size())
+        {
+            m_onlineSeries.resize(sample.series + 1);
+        }
+        OnlineSeries &series = m_onlineSeries[sample.series];
+        if (series.name.isEmpty())
+        {
+            series.name = bus->seriesName(sample.series);
+            m_onlineSeriesIds.insert(series.name, sample.series);
+            ui.dataSelectionScreen->addItem(series.name);
+        }
+        if (series.batchStart < 0)
+        {
+            series.batchStart = series.keys.size();
+            m_liveBatchSeries.append(sample.series);
+        }
+        received = true;
+        newmsec = sample.msecs - m_startIndex;
+        series.keys.append(newmsec / 1000.0);
+        series.values.append(sample.value);
+        series.integer = sample.integer;
     }
-
-    if (!m_onlineValueMap.contains(propername))
+    if (!received)
     {
-        ui.dataSelectionScreen->addItem(propername);
+        return;
     }
 
-    qint64 msec_current = QDateTime::currentMSecsSinceEpoch();
-    m_currentIndex = msec_current;
-    qint64 newmsec = (msec_current - m_startIndex);// + m_timeDiff;
+    m_currentIndex = m_startIndex + newmsec;
     if (m_graphCount > 0 && ui.autoScrollCheckBox->isChecked())
     {
         double diff = (newmsec / 1000.0) - m_wideAxisRect->axis(QCPAxis::atBottom,0)->range().upper;
@@ -534,77 +564,72 @@ void AP2DataPlot2D::updateValue(const int uasId, const QString& name, const QStr
         }
     }
 
-    if (m_graphClassMap.contains(propername))
+    bool graphUpdated = false;
+    for (int seriesId : qAsConst(m_liveBatchSeries))
     {
-        m_graphClassMap[propername].axisIndex = newmsec / 1000.0;// + 18000000;
-        m_graphClassMap.value(propername).graph->addData(m_graphClassMap.value(propername).axisIndex,value);
-        m_scrollEndIndex = newmsec /  1000.0;
-        //ui.horizontalScrollBar->setMinimum(m_startIndex);
-        ui.horizontalScrollBar->setMaximum(m_scrollEndIndex);
-        //Set a timeout for 30 minutes from now, 1800 seconds.
-        qint64 current = QDateTime::currentMSecsSinceEpoch();
-        //This is 30 minutes
-        m_onlineValueTimeoutList.append(QPair<qint64,double>(current + 1800000,msec));
-        //This is 1 minute
-        //m_onlineValueTimeoutList.append(QPair<qint64,double>(current + 60000,m_currentIndex));
-        if (m_onlineValueTimeoutList[0].first <= current)
+        OnlineSeries &series = m_onlineSeries[seriesId];
+        const int start = series.batchStart;
+        series.batchStart = -1;
+
+        QMap<QString,Graph>::iterator graph = m_graphClassMap.find(series.name);
+        if (graph == m_graphClassMap.end())
         {
-            for (QMap<QString,Graph>::const_iterator i = m_graphClassMap.constBegin();i!=m_graphClassMap.constEnd();i++)
-            {
-//                i.value().graph->removeData(0,m_onlineValueTimeoutList[0].second);
-            }
-            m_onlineValueTimeoutList.removeAt(0);
+            continue;
         }
-        if (m_graphClassMap.value(propername).groupName != "" && m_graphClassMap.value(propername).groupName != "MANUAL")
+        graphUpdated = true;
+
+        const QVector<double> keys = series.keys.mid(start);
+        const QVector<double> values = series.values.mid(start);
+        graph->axisIndex = keys.last();
+        graph->graph->addData(keys, values);
+
+        double min = values.first();
+        double max = values.first();
+        for (double value : values)
+        {
+            min = qMin(min, value);
+            max = qMax(max, value);
+        }
+
+        if (graph->groupName != "" && graph->groupName != "MANUAL")
         {
             //Current graph is in a group
-            if (!m_graphGroupRanges[m_graphClassMap.value(propername).groupName].contains(value))
+            QCPRange &groupRange = m_graphGroupRanges[graph->groupName];
+            if (!groupRange.contains(min) || !groupRange.contains(max))
             {
                 //It's out of scale for the group, expand it.
-                if (m_graphGroupRanges[m_graphClassMap.value(propername).groupName].lower > value)
+                groupRange.lower = qMin(groupRange.lower, min);
+                groupRange.upper = qMax(groupRange.upper, max);
+                const QList<QString> &group = m_graphGrouping[graph->groupName];
+                for (int i=0;i<group.size();i++)
                 {
-                    m_graphGroupRanges[m_graphClassMap.value(propername).groupName].lower = value;
-                }
-                else if (m_graphGroupRanges[m_graphClassMap.value(propername).groupName].upper < value)
-                {
-                    m_graphGroupRanges[m_graphClassMap.value(propername).groupName].upper = value;
-                }
-                for (int i=0;i<m_graphGrouping[m_graphClassMap.value(propername).groupName].size();i++)
-                {
-                    m_graphClassMap.value(m_graphGrouping[m_graphClassMap.value(propername).groupName][i]).axis->setRange(m_graphGroupRanges[m_graphClassMap.value(propername).groupName]);
+                    m_graphClassMap.value(group[i]).axis->setRange(groupRange);
                 }
                 if (m_axisGroupingDialog)
                 {
-                    m_axisGroupingDialog->updateAxis(propername,m_graphClassMap.value(propername).axis->range().lower,m_graphClassMap.value(propername).axis->range().upper);
+                    m_axisGroupingDialog->updateAxis(series.name,graph->axis->range().lower,graph->axis->range().upper);
                 }
             }
         }
-        else if (!m_graphClassMap.value(propername).graph->keyAxis()->range().contains(value) && !m_graphClassMap.value(propername).isManualRange)
+        else if (!graph->isManualRange && (!graph->axis->range().contains(min) || !graph->axis->range().contains(max)))
         {
-            m_graphClassMap.value(propername).graph->rescaleValueAxis();
+            graph->graph->rescaleValueAxis();
             if (m_axisGroupingDialog)
             {
-                m_axisGroupingDialog->updateAxis(propername,m_graphClassMap.value(propername).axis->range().lower,m_graphClassMap.value(propername).axis->range().upper);
+                m_axisGroupingDialog->updateAxis(series.name,graph->axis->range().lower,graph->axis->range().upper);
             }
         }
-        if (integer)
+        if (series.integer)
         {
-            m_graphClassMap.value(propername).axis->setNumberPrecision(0);
+            graph->axis->setNumberPrecision(0);
         }
     }
-    m_onlineValueMap[propername].append(QPair<double,double>(newmsec / 1000.0,value));
-}
+    m_liveBatchSeries.clear();
 
-void AP2DataPlot2D::valueChanged(const int uasId, const QString& name, const QString& unit, const QVariant& value,const quint64 msec)
-{
-    QMetaType::Type metaType(static_cast<QMetaType::Type>(value.type()));
-    if (metaType == QMetaType::Double || metaType == QMetaType::Float)
+    if (graphUpdated)
     {
-        updateValue(uasId,name,unit,value.toDouble(),msec,false);
-    }
-    else
-    {
-        updateValue(uasId,name,unit,static_cast<double>(value.toInt()),msec);
+        m_scrollEndIndex = newmsec / 1000.0;
+        ui.horizontalScrollBar->setMaximum(m_scrollEndIndex);
     }
 }
 
@@ -663,27 +688,12 @@ AP2DataPlot2D::~AP2DataPlot2D()
 
 void AP2DataPlot2D::itemEnabled(QString name)
 {
-    if (m_onlineValueMap.contains(name))
+    if (m_onlineSeriesIds.contains(name))
     {
-        QVector<double> xlist;
-        QVector<double> ylist;
+        const OnlineSeries &series = m_onlineSeries.at(m_onlineSeriesIds.value(name));
+        QVector<double> xlist = series.keys;
+        QVector<double> ylist = series.values;
 
-        double min = m_onlineValueMap[name][0].second;
-        double max = m_onlineValueMap[name][0].second;
-        for (int j=0;j<m_onlineValueMap[name].size();j++)
-        {
-            xlist.append(m_onlineValueMap[name][j].first);
-            double val = m_onlineValueMap[name][j].second;
-            if (val > max)
-            {
-                max = val;
-            }
-            if (val < min)
-            {
-                min = val;
-            }
-            ylist.append(val);
-        }
         QCPAxis *axis = m_wideAxisRect->addAxis(QCPAxis::atLeft);
         axis->setLabel(name);
         QColor color = QColor::fromRgb(rand()%255,rand()%255,rand()%255);
@@ -772,7 +782,8 @@ void AP2DataPlot2D::clearGraph()
 
     m_currentIndex = QDateTime::currentMSecsSinceEpoch();
     m_startIndex = m_currentIndex;
-    m_onlineValueMap.clear();
+    m_onlineSeries.clear();
+    m_onlineSeriesIds.clear();
     m_plot->replot();
 }
 
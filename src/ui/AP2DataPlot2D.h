@@ -32,6 +32,7 @@ This file is part of the APM_PLANNER project
 
 #include "UASInterface.h"
 #include "MAVLinkDecoder.h"
+#include "MAVLinkValueBus.h"
 #include "kmlcreator.h"
 #include "qcustomplot.h"
 
@@ -46,6 +47,7 @@ This file is part of the APM_PLANNER project
 #include <QTextBrowser>
 #include <QSqlDatabase>
 #include <QStandardItemModel>
+#include <QTimer>
 
 #include "Loghandling/LogdataStorage.h"
 
@@ -85,10 +87,8 @@ private slots:
     //Called to add an item to the graph
     void itemEnabled(QString name);
 
-    //ValueChanged functions for getting mavlink values
-    void valueChanged(const int uasid, const QString& name, const QString& unit, const QVariant& value,const quint64 msecs);
-    //Called by every valueChanged function to actually save the value/graph it.
-    void updateValue(const int uasId, const QString& name, const QString& unit, const double value, const quint64 msec,bool integer = true);
+    //Drains the value bus and adds all live values of the active UAS in one batch per series
+    void processLiveSamples();
 
     void navModeChanged(int uasid, int mode, const QString& text);
 
@@ -156,13 +156,25 @@ private:
     QMap<QString,QList<QString> > m_graphGrouping;
     //Map from group titles to the value axis range.
     QMap<QString,QCPRange> m_graphGroupRanges;
-    //Graph name to list of values for "online" mode
-    QMap<QString,QList<QPair<double,double> > > m_onlineValueMap;
+    struct OnlineSeries
+    {
+        QString name;             // empty until the series was seen for the active UAS
+        QVector<double> keys;
+        QVector<double> values;
+        int batchStart {-1};      // first value added by the current batch, -1 if untouched
+        bool integer   {true};
+    };
+    //Values for "online" mode, indexed by MAVLinkValueBus series id
+    QVector<OnlineSeries> m_onlineSeries;
+    //Graph name to series id of the online values
+    QHash<QString,int> m_onlineSeriesIds;
+    //Reused batch buffers
+    QVector<MAVLinkValueBus::Sample> m_liveSamples;
+    QVector<int> m_liveBatchSeries;
+    QTimer m_liveSampleTimer;
     // Child windows which were opened by open log
     QList<QWidget*> m_childGraphList;
 
-    QList<QPair<qint64,double> > m_onlineValueTimeoutList;
-
     //List of graph names, used in m_axisList, m_graphMap,m_graphToGroupMap and the like as the graph name
     QList<QString> m_graphNameList;
     // number of active graphs
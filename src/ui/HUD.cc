@@ -1345,14 +1345,16 @@ void HUD::copyImage()
     UAS* u = dynamic_cast<UAS*>(this->uas);
     if (u)
     {
+        // Already decoded off the GUI thread, this only takes over the image
         this->glImage = u->getImage();
 
         // Save to directory if logging is enabled
         if (imageLoggingEnabled)
         {
-            u->getImage().save(QString("%1/%2.png").arg(imageLogDirectory).arg(imageLogCounter));
+            glImage.save(QString("%1/%2.png").arg(imageLogDirectory).arg(imageLogCounter));
             imageLogCounter++;
         }
+        update();
     }
 }
 
@@ -34,6 +34,8 @@ This file is part of the APM_PLANNER project
 #include "Loghandling/LogExporter.h"
 #include "Loghandling/PresetManager.h"
 
+#include <algorithm>
+
 
 LogAnalysisCursor::LogAnalysisCursor(QCustomPlot *parentPlot, double xPosition, CursorType type) :
     QCPItemStraightLine(parentPlot),
@@ -231,7 +233,8 @@ LogAnalysis::LogAnalysis(QWidget *parent) :
     m_cursorXAxisRange(0.0),
     mp_cursorSimple(nullptr),
     mp_cursorLeft(nullptr),
-    mp_cursorRight(nullptr)
+    mp_cursorRight(nullptr),
+    m_presetPending(false)
 {
     QLOG_DEBUG() << "LogAnalysis::LogAnalysis - CTOR";
     ui.setupUi(this);
@@ -446,25 +449,8 @@ void LogAnalysis::setTablePos(double xPosition)
         else
         {
             //search for previous event (remember the table may be filtered)
-            QModelIndex sourceIndex = m_dataStoragePtr->index(static_cast<int>(position - min), 0);
-            QModelIndex index = mp_tableFilterProxyModel->mapFromSource(sourceIndex);
-            while ( sourceIndex.row() >= static_cast<int>(min) && !index.isValid() )
-            {
-                sourceIndex = m_dataStoragePtr->index(sourceIndex.row() - 1, 0);
-                index = mp_tableFilterProxyModel->mapFromSource(sourceIndex);
-            }
-
-            if ( !index.isValid() )
-            {
-                //couldn't find filtered index by looking back, try forward...
-                sourceIndex = m_dataStoragePtr->index(static_cast<int>(position - min), 0);
-                index = mp_tableFilterProxyModel->mapFromSource(sourceIndex);
-                while ( sourceIndex.row() <= static_cast<int>(max) && !index.isValid() )
-                {
-                    sourceIndex = m_dataStoragePtr->index(sourceIndex.row() + 1, 0);
-                    index = mp_tableFilterProxyModel->mapFromSource(sourceIndex);
-                }
-            }
+            int row = mp_tableFilterProxyModel->nearestRow(static_cast<int>(position - min));
+            QModelIndex index = mp_tableFilterProxyModel->index(row, 0);
             ui.tableWidget->setCurrentIndex(index);
             ui.tableWidget->scrollTo(index);
 
@@ -506,8 +492,8 @@ void LogAnalysis::cursorRangeChange()
             QSharedPointer<QCPGraphDataContainer> dataPtr = iter->p_graph->data();
             RangeValues rangeVals;
 
-            int rangeStartIndex = iter->p_graph->findBegin(leftPos);
-            int rangeEndIndex   = iter->p_graph->findBegin(rightPos);
+            int rangeStartIndex = graphIndexOf(*iter, leftPos);
+            int rangeEndIndex   = graphIndexOf(*iter, rightPos);
             rangeVals.m_measurements = rangeEndIndex - rangeStartIndex;
 
             for(int i = rangeStartIndex; i < rangeEndIndex; ++i)
@@ -523,6 +509,13 @@ void LogAnalysis::cursorRangeChange()
     }
 }
 
+int LogAnalysis::graphIndexOf(const GraphElements &graph, double key) const
+{
+    // same result as QCPGraph::findBegin(key) - the data point before key
+    const int index = graph.m_xIndex.lowerBound(key);
+    return index > 0 ? index - 1 : 0;
+}
+
 void LogAnalysis::setupXAxisAndScroller()
 {
     // Setup X-Axis for time or index formatting
@@ -616,12 +609,7 @@ void LogAnalysis::plotTextArrow(double index, const QString &text, const QString
 
 void LogAnalysis::disableTableFilter()
 {
-    // The order of the statements is important to be fast on huge logs (15MB)
-    // It does not really disable the filter but sets the rules to get a fast
-    // result without any filtering
-    mp_tableFilterProxyModel->setFilterKeyColumn(0);
-    mp_tableFilterProxyModel->setFilterRole(Qt::DisplayRole);
-    mp_tableFilterProxyModel->setFilterFixedString("");
+    mp_tableFilterProxyModel->clearTypeFilter();
 }
 
 void LogAnalysis::loadSettings()
@@ -705,6 +693,20 @@ QList<AP2DataPlotAxisDialog::GraphRange> LogAnalysis::presetToRangeConverter(con
     return graphRanges;
 }
 
+void LogAnalysis::applyPresetWhenPlotted(const PresetManager::presetElementVec &preset)
+{
+    if (m_pendingFetches.isEmpty())
+    {
+        m_presetPending = false;
+        graphGroupingChanged(presetToRangeConverter(preset));
+    }
+    else
+    {
+        m_pendingPreset = preset;
+        m_presetPending = true;
+    }
+}
+
 void LogAnalysis::hideTableView(bool hide)
 {
     if (hide)
@@ -809,6 +811,8 @@ void LogAnalysis::logLoadingDone(AP2DataPlotStatus status)
     // and connect the signals for enabling and disabling
     connect(ui.dataSelectionScreen, SIGNAL(itemEnabled(QString)), this, SLOT(itemEnabled(QString)));
     connect(ui.dataSelectionScreen, SIGNAL(itemDisabled(QString)), this, SLOT(itemDisabled(QString)));
+    connect(m_dataStoragePtr.data(), SIGNAL(valuesFetched(quint64,QString,bool,bool,QVector<double>,QVector<double>)),
+            this, SLOT(valuesFetched(quint64,QString,bool,bool,QVector<double>,QVector<double>)));
 
     // Insert data into filter window including all measurements with string data
     fmtMap.clear();
@@ -849,7 +853,7 @@ void LogAnalysis::logLoadingDone(AP2DataPlotStatus status)
     ui.verticalScrollBar->setValue(ui.verticalScrollBar->maximum());
 
     // Set up proxy for table filtering
-    mp_tableFilterProxyModel = new QSortFilterProxyModel(this);     // will be deleted upon destruction of "this"
+    mp_tableFilterProxyModel = new LogdataFilterModel(this);        // will be deleted upon destruction of "this"
     mp_tableFilterProxyModel->setSourceModel(m_dataStoragePtr.data());
     ui.tableWidget->setModel(mp_tableFilterProxyModel);
     connect(ui.tableWidget->selectionModel(), SIGNAL(currentRowChanged(QModelIndex, QModelIndex)), this, SLOT(selectedRowChanged(QModelIndex, QModelIndex)));
@@ -955,17 +959,42 @@ void LogAnalysis::xAxisChanged(QCPRange range)
 
 void LogAnalysis::itemEnabled(QString name)
 {
-    QVector<double> xlist;
-    QVector<double> ylist;
+    if (m_activeGraphs.contains(name) || m_pendingFetches.contains(name))
+    {
+        return;
+    }
+    // The data is extracted in background, the graph is added in valuesFetched()
+    m_pendingFetches.insert(name, m_dataStoragePtr->fetchValuesAsync(name, m_useTimeOnXAxis));
+}
+
+void LogAnalysis::valuesFetched(quint64 requestId, const QString &name, bool useTimeAsIndex, bool found,
+                                const QVector<double> &xValues, const QVector<double> &yValues)
+{
+    if ((m_pendingFetches.value(name) != requestId) || (useTimeAsIndex != m_useTimeOnXAxis))
+    {
+        return;     // not our request or outdated
+    }
+    m_pendingFetches.remove(name);
 
-    if (!m_dataStoragePtr->getValues(name, m_useTimeOnXAxis, xlist, ylist))
+    if (!found)
     {
         //No values!
         QLOG_WARN() << "No values in datamodel for " << name;
         ui.dataSelectionScreen->disableItem(name);
-        return;
+    }
+    else
+    {
+        addGraph(name, xValues, yValues);
     }
 
+    if (m_presetPending && m_pendingFetches.isEmpty())
+    {
+        applyPresetWhenPlotted(m_pendingPreset);
+    }
+}
+
+void LogAnalysis::addGraph(const QString &name, QVector<double> xlist, QVector<double> ylist)
+{
     // HACK - a graph with only one value is not plottet. So we add a second point with same value
     // which forces the graph to plot a short line. Moreover the mouse over which is handeled by
     // the plotMouseMove(QMouseEvent *evt) method delivers always NONE for a graph with only one point.
@@ -999,6 +1028,12 @@ void LogAnalysis::itemEnabled(QString name)
     newPlot.p_graph = m_plotPtr->addGraph(axisRect->axis(QCPAxis::atBottom), newPlot.p_yAxis);
     newPlot.p_graph->setPen(QPen(color, 1));
     newPlot.p_graph->setData(xlist, ylist);
+    // the graph sorts its data by key - the search index needs the same order
+    if (!std::is_sorted(xlist.constBegin(), xlist.constEnd()))
+    {
+        std::sort(xlist.begin(), xlist.end());
+    }
+    newPlot.m_xIndex.build(xlist);
     newPlot.p_graph->rescaleValueAxis();
 
     m_activeGraphs[name] = newPlot;     // store the plot by name
@@ -1028,6 +1063,16 @@ void LogAnalysis::itemEnabled(QString name)
 
 void LogAnalysis::itemDisabled(QString name)
 {
+    if (m_pendingFetches.contains(name))
+    {
+        m_dataStoragePtr->cancelFetch(m_pendingFetches.take(name));
+        if (m_presetPending && m_pendingFetches.isEmpty())
+        {
+            applyPresetWhenPlotted(m_pendingPreset);
+        }
+        return;
+    }
+
     if (m_activeGraphs.contains(name)) // only enabled items can be disabled
     {
         // remove axis, graph and stored info from m_activeGraphs
@@ -1126,17 +1171,10 @@ void LogAnalysis::filterAcceptClicked()
     {
         disableTableFilter();
     }
-    // one or more elements selected -> RegEx must be used
+    // one or more elements selected -> show only rows of these types
     else
     {
-        // It is VERY important to disable the filtering prior to set up a new one
-        // If this is not done the regex filter gets terribly slow!!!
-        disableTableFilter();
-        QString regex = m_tableFilterList.join("\\b|");  // Create regex like val1\b|val2\b|val3
-        regex.append("\\b");                             // append the final \b
-        mp_tableFilterProxyModel->setFilterRegExp(regex);
-        mp_tableFilterProxyModel->setFilterRole(Qt::DisplayRole);
-        mp_tableFilterProxyModel->setFilterKeyColumn(1);
+        mp_tableFilterProxyModel->setTypeFilter(m_tableFilterList);
     }
 
     ui.tableFilterGroupBox->setVisible(false);
@@ -1254,11 +1292,22 @@ void LogAnalysis::exportKmlClicked()
 
 void LogAnalysis::doExport(bool kmlExport, double iconInterval)
 {
-    QString exportExtension = kmlExport ? "kml" : "log";
+    static const QString KmzFilter("Compressed KML (*.kmz)");
+    static const QString KmlFilter("KML (*.kml)");
+
+    QString exportExtension = kmlExport ? "kmz" : "log";
     // for exporting use the name of the loaded log and replace any extension by the export extension
     QString exportFilename = m_filename.replace(QRegularExpression("\\w+$"), exportExtension);
 
-    QFileDialog dialog(this, "Save Log File", QGC::logDirectory(), "Logformat (*.kml *.kmz *.log)");
+    QFileDialog dialog(this, "Save Log File", QGC::logDirectory());
+    if(kmlExport)
+    {
+        dialog.setNameFilters(QStringList() << KmzFilter << KmlFilter);
+    }
+    else
+    {
+        dialog.setNameFilter("Logformat (*.log)");
+    }
     dialog.setAcceptMode(QFileDialog::AcceptSave);
     dialog.selectFile(exportFilename);
     QLOG_DEBUG() << "Suggested Export Filename: " << exportFilename;
@@ -1272,9 +1321,23 @@ void LogAnalysis::doExport(bool kmlExport, double iconInterval)
 
         if(kmlExport)
         {
-            QLOG_DEBUG() << "iconInterval: " << iconInterval;
+            // the extension typed by the user wins over the selected filter
+            bool createKmz = dialog.selectedNameFilter() != KmlFilter;
+            if(outputFileName.endsWith(".kml", Qt::CaseInsensitive))
+            {
+                createKmz = false;
+            }
+            else if(outputFileName.endsWith(".kmz", Qt::CaseInsensitive))
+            {
+                createKmz = true;
+            }
+            else if(!createKmz)
+            {
+                outputFileName += ".kml";   // the kmz writer adds its extension itself
+            }
+            QLOG_DEBUG() << "iconInterval: " << iconInterval << " createKmz: " << createKmz;
 
-            KmlLogExporter kmlExporter(this, m_loadedLogMavType, iconInterval);
+            KmlLogExporter kmlExporter(this, m_loadedLogMavType, iconInterval, createKmz);
             result = kmlExporter.exportToFile(outputFileName, m_dataStoragePtr);
         }
         else
@@ -1425,7 +1488,7 @@ void LogAnalysis::plotMouseMove(QMouseEvent *evt)
     {
         outStream.setRealNumberPrecision(3);
         double key   = iter->p_graph->keyAxis()->pixelToCoord(evt->x());
-        int keyIndex = iter->p_graph->findBegin(key);
+        int keyIndex = graphIndexOf(*iter, key);
 
         outStream << "\n" << iter.key();
 
@@ -1646,9 +1709,7 @@ void LogAnalysis::applyGraphSettingsPressed()
     ui.dataSelectionScreen->enableItemList(enabledGraphList);
 
     // convert preset to ranges and use grouping changed method to scale the graph
-    QList<AP2DataPlotAxisDialog::GraphRange> graphRanges;
-    graphRanges = presetToRangeConverter(preset);
-    graphGroupingChanged(graphRanges);
+    applyPresetWhenPlotted(preset);
 }
 
 void LogAnalysis::analysisPresetSelected(PresetManager::presetElementVec preset)
@@ -1667,9 +1728,7 @@ void LogAnalysis::analysisPresetSelected(PresetManager::presetElementVec preset)
 
     // now set range and color
     // convert preset to ranges and use grouping changed method to scale the graph
-    QList<AP2DataPlotAxisDialog::GraphRange> graphRanges;
-    graphRanges = presetToRangeConverter(preset);
-    graphGroupingChanged(graphRanges);
+    applyPresetWhenPlotted(preset);
 }
 
 void LogAnalysis::addCurrentViewToPreset()
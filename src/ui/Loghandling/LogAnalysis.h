@@ -40,6 +40,7 @@ This file is part of the APM_PLANNER project
 #include "qcustomplot.h"
 
 #include "LogdataStorage.h"
+#include "LogdataTimeIndex.h"
 #include "AP2DataPlotThread.h"
 #include "AP2DataPlotStatus.h"
 #include "AP2DataPlotAxisDialog.h"
@@ -241,6 +242,7 @@ private:
         QString m_groupName;   ///< name of the group the plot belongs to.
         bool m_manualRange;    ///< has user defined scaling
         bool m_inGroup;        ///< has group scaling
+        LogdataTimeIndex m_xIndex; ///< search index over the X-Values of the graph
 
         GraphElements() : p_yAxis(nullptr), p_graph(nullptr), m_manualRange(false), m_inGroup(false) {}
     };
@@ -297,7 +299,7 @@ private:
 
     QStringList m_tableFilterList;   ///< Used to create regex filter pattern for table view.
 
-    QSortFilterProxyModel *mp_tableFilterProxyModel;    ///< Filter model for table view.
+    LogdataFilterModel *mp_tableFilterProxyModel;       ///< Filter model for table view.
 
     QString m_filename;              ///< Filename of the loaded Log - mainly used for export
 
@@ -317,6 +319,10 @@ private:
 
     QPointer<LogAnalysisMap> mp_logAnalysisMap;
 
+    QHash<QString, quint64> m_pendingFetches;       ///< Graphs enabled but still waiting for their data, name to fetch request id
+    PresetManager::presetElementVec m_pendingPreset;///< Preset to be applied as soon as all pending graphs are plotted
+    bool m_presetPending;                           ///< true if m_pendingPreset has to be applied
+
     /**
      * @brief setupXAxisAndScroller sets up x axis and the horizontal scroller
      *        to use the normal index (the artifical) or the time index regarding
@@ -341,7 +347,7 @@ private:
     void plotTextArrow(double index, const QString &text, const QString &layerName, const QColor &color);
 
     /**
-     * @brief This method disables the filtering of m_tableFilterProxyModel
+     * @brief This method disables the filtering of mp_tableFilterProxyModel
      *        After a call the table model will show all rows again.
      */
     void disableTableFilter();
@@ -367,6 +373,30 @@ private:
      */
     QList<AP2DataPlotAxisDialog::GraphRange> presetToRangeConverter(const PresetManager::presetElementVec &preset);
 
+    /**
+     * @brief applyPresetWhenPlotted - applies colors and ranges of a preset. As the graphs are
+     *        fetched asynchronously the preset is stored and applied when all pending graphs are plotted.
+     * @param preset - the preset vector containing the preset data
+     */
+    void applyPresetWhenPlotted(const PresetManager::presetElementVec &preset);
+
+    /**
+     * @brief addGraph - adds a graph with its own y axis to the plot area.
+     * @param name - the name of the data to be plotted.
+     * @param xlist - X-Values of the graph
+     * @param ylist - Y-Values of the graph
+     */
+    void addGraph(const QString &name, QVector<double> xlist, QVector<double> ylist);
+
+    /**
+     * @brief graphIndexOf - delivers the index of the data point of a graph at or before key.
+     *        Uses the search index of the graph instead of searching the QCustomPlot data.
+     * @param graph - the graph to search in
+     * @param key - X-Value to search for
+     * @return - the data index, 0 if key is before the first data point
+     */
+    int graphIndexOf(const GraphElements &graph, double key) const;
+
 private slots:
 
     /**
@@ -474,6 +504,13 @@ private slots:
      */
     void itemDisabled(QString name);
 
+    /**
+     * @brief valuesFetched - plots the data fetched for an enabled item.
+     * @see LogdataStorage::valuesFetched()
+     */
+    void valuesFetched(quint64 requestId, const QString &name, bool useTimeAsIndex, bool found,
+                       const QVector<double> &xValues, const QVector<double> &yValues);
+
     /**
      * @brief indexTypeCheckBoxClicked - shall be called when the "use time on x-axis" checkbox
      *        is pressed. It changes the x axis scaling from index to time
@@ -71,34 +71,45 @@ void LogAnalysisMap::setDataStorage(LogdataStorage::Ptr dataPtr)
 
 void LogAnalysisMap::paintUAVTrail()
 {
-    // fetch data
-    m_dataStoragePtr->getValues(m_latName, false, m_xValues, m_latValues);
-    m_dataStoragePtr->getValues(m_lonName, false, m_xValues, m_lonValues);
-
-    m_dataStoragePtr->getValues(m_headingName, false, m_xValuesHeading, m_headingValues);
-
-    if (!m_latValues.empty() && !m_lonValues.empty())
+    // fetch data - the series are shared with all other users of the storage
+    const auto latSeries = m_dataStoragePtr->getSeries(m_latName, false);
+    const auto lonSeries = m_dataStoragePtr->getSeries(m_lonName, false);
+    const auto headingSeries = m_dataStoragePtr->getSeries(m_headingName, false);
+    const QVector<double> &xValues = latSeries->m_xValues;
+    const QVector<double> &latValues = latSeries->m_yValues;
+    const QVector<double> &lonValues = lonSeries->m_yValues;
+
+    if (!latValues.empty() && (latValues.size() == lonValues.size()))
     {
-        scaleData();
-
-        // setup trail
-        mapcontrol::GPSItem *p_uav = mp_Ui->map->AddTrail();
-        p_uav->SetTrailDistance(0);
-        p_uav->ShowUavPic(false);
+        scaleData(*latSeries, *lonSeries);
+        if (m_validIndex >= latValues.size())
+        {
+            QLOG_INFO() << "LogAnalysisMap: No valid GPS data - no trail";
+            return;
+        }
 
-        // set position of map
-        internals::PointLatLng pos(m_latValues.at(m_validIndex), m_lonValues.at(m_validIndex));
-        mp_Ui->map->SetCurrentPosition(pos);
+        // The whole log is one track item - keys are the X-axis values of the graph
+        QVector<double> keys;
+        QVector<internals::PointLatLng> points;
+        keys.reserve(latValues.size() - m_validIndex);
+        points.reserve(latValues.size() - m_validIndex);
+        for (auto i = m_validIndex; i < latValues.size(); ++i)
+        {
+            keys.append(xValues.at(i));
+            points.append(internals::PointLatLng(latValues.at(i) / m_gpsScaling, lonValues.at(i) / m_gpsScaling));
+        }
+        matchHeading(*latSeries, *headingSeries);
 
-        // add all GPS positions to the trail
-        for (auto i = m_validIndex; i < m_latValues.size(); ++i)
+        if (mp_track == nullptr)
         {
-            internals::PointLatLng pos(m_latValues.at(i), m_lonValues.at(i));
-            p_uav->SetUAVPos(pos, 10);
+            mp_track = mp_Ui->map->AddTrack();
         }
+        mp_track->SetTrack(keys, points);
+        m_trackIndex.build(keys);
 
-        p_uav->SetShowTrail(false);
-        p_uav->RefreshPos();
+        // set position of map
+        internals::PointLatLng pos(points.first());
+        mp_Ui->map->SetCurrentPosition(pos);
 
         // create UAV icon as cursor
         if (mp_trailCursor == nullptr)
@@ -117,12 +128,17 @@ void LogAnalysisMap::paintUAVTrail()
 
 void LogAnalysisMap::setUavCursor(int index)
 {
-    auto bestGpsIndex = findBestIndexMatch(index, m_xValues);
-    auto bestHeadingIndex = findBestIndexMatch(index, m_xValuesHeading);
+    if ((mp_track == nullptr) || (mp_trailCursor == nullptr) || (mp_track->Count() == 0))
+    {
+        return;
+    }
 
-    internals::PointLatLng pos(m_latValues.at(bestGpsIndex), m_lonValues.at(bestGpsIndex));
-    mp_trailCursor->SetUAVPos(pos, 10);
-    mp_trailCursor->SetUAVHeading(m_headingValues.at(bestHeadingIndex));
+    auto trackIndex = m_trackIndex.nearest(index);
+    mp_trailCursor->SetUAVPos(mp_track->PointAt(trackIndex), 10);
+    if (trackIndex < m_trackHeading.size())
+    {
+        mp_trailCursor->SetUAVHeading(m_trackHeading.at(trackIndex));
+    }
     mp_trailCursor->RefreshPos();
 }
 
@@ -233,54 +249,46 @@ void LogAnalysisMap::findDataNames()
     QLOG_DEBUG() << "LogAnalysisMap: datamodel name for heading:" << m_headingName;
 }
 
-int LogAnalysisMap::findBestIndexMatch(int index, const QVector<double> &data)
+void LogAnalysisMap::matchHeading(const LogdataSeriesCache::Series &gps, const LogdataSeriesCache::Series &heading)
 {
-    int intervalSize = data.size();
-    int intervalStart = 0;
-    int middle = 0;
-
-    if (index <= 0.0)
+    m_trackHeading.clear();
+    const QVector<double> &xValuesHeading = heading.m_xValues;
+    const QVector<double> &headingValues = heading.m_yValues;
+    if (headingValues.empty())
     {
-        middle = 0;
-    }
-    else if (index >= data.back())
-    {
-        middle = data.size() - 1;
+        return;
     }
-    else
+
+    m_trackHeading.reserve(gps.m_xValues.size() - m_validIndex);
+    int headingIndex = 0;
+    for (auto i = m_validIndex; i < gps.m_xValues.size(); ++i)
     {
-        while (intervalSize > 1)
+        const double xValue = gps.m_xValues.at(i);
+        // advance while the next heading sample is at least as near as the current one
+        while ((headingIndex + 1 < xValuesHeading.size()) &&
+               (qAbs(xValuesHeading.at(headingIndex + 1) - xValue) <= qAbs(xValuesHeading.at(headingIndex) - xValue)))
         {
-            middle = intervalStart + intervalSize / 2;
-            auto temp = static_cast<int>(data.at(middle) + 0.5);
-            if (index > temp)
-            {
-                intervalStart = middle;
-            }
-            else if (index == temp)
-            {
-                break;
-            }
-            intervalSize = intervalSize / 2;
+            ++headingIndex;
         }
+        m_trackHeading.append(headingValues.at(headingIndex));
     }
-
-    return middle;
 }
 
-void LogAnalysisMap::scaleData()
+void LogAnalysisMap::scaleData(const LogdataSeriesCache::Series &lat, const LogdataSeriesCache::Series &lon)
 {
+    const QVector<double> &latValues = lat.m_yValues;
+    const QVector<double> &lonValues = lon.m_yValues;
     double latVal = 0.0;
     double lonVal = 0.0;
     double scaling = 1.0;
 
     // first find value which is not 0 for lat and lon and store its index
-    for (m_validIndex = 0; m_validIndex < m_latValues.size(); ++m_validIndex)
+    for (m_validIndex = 0; m_validIndex < latValues.size(); ++m_validIndex)
     {
-        if ((m_latValues.at(m_validIndex) != 0.0) && (m_lonValues.at(m_validIndex) != 0.0))
+        if ((latValues.at(m_validIndex) != 0.0) && (lonValues.at(m_validIndex) != 0.0))
         {
-            latVal = m_latValues.at(m_validIndex);
-            lonVal = m_lonValues.at(m_validIndex);
+            latVal = latValues.at(m_validIndex);
+            lonVal = lonValues.at(m_validIndex);
             break;
         }
     }
@@ -295,20 +303,12 @@ void LogAnalysisMap::scaleData()
         scaling *= 10.0;
     }
 
-    // ...then scale the whole data arrays
+    // ...the data itself is shared, it is scaled when the track is built
     if (scaling > 1.0)
     {
         QLOG_INFO() << "LogAnalysisMap: Scale the GPS-Values by " << scaling;
-        for(double &val: m_latValues)
-        {
-            val /= scaling;
-        }
-
-        for(double &val: m_lonValues)
-        {
-            val /= scaling;
-        }
     }
+    m_gpsScaling = scaling;
 }
 
 void LogAnalysisMap::setMapZoom(int value)
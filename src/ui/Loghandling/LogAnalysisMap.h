@@ -33,7 +33,9 @@ This file is part of the APM_PLANNER project
 #include <QWidget>
 
 #include "LogdataStorage.h"
+#include "LogdataTimeIndex.h"
 #include "gpsitem.h"
+#include "trackitem.h"
 
 namespace Ui {
     class LogAnalysisMap;
@@ -98,14 +100,13 @@ private:
     QString                      m_headingName;        ///< Datamodel name to fetch heading from data storage
 
     mapcontrol::GPSItem         *mp_trailCursor {nullptr};  ///< Pointer to the UAV icon (mapwidget is owner)
+    mapcontrol::TrackItem       *mp_track {nullptr};        ///< Pointer to the GPS track (mapwidget is owner)
 
-    QVector<double>              m_xValues;            ///< X-axis values of the gps data
-    QVector<double>              m_latValues;          ///< latitude data
-    QVector<double>              m_lonValues;          ///< longitude data
     int                          m_validIndex {0};     ///< first index where lat and lon values are valid (sometimes values start with 0)
+    double                       m_gpsScaling {1.0};   ///< lat and lon values have to be divided by this to get degrees
 
-    QVector<double>              m_xValuesHeading;     ///< X-axis values of the ATT data
-    QVector<double>              m_headingValues;      ///< The heading data of the UAV
+    QVector<double>              m_trackHeading;       ///< Heading of the UAV at every point of mp_track
+    LogdataTimeIndex             m_trackIndex;         ///< Search index over the X-axis values of the points of mp_track
 
     /**
      * @brief loadSettings loads the default / last used settings.
@@ -124,23 +125,23 @@ private:
     void findDataNames();
 
     /**
-     * @brief findBestIndexMatch finds the nearest index for the selected X-data (by the cursor).
-     *        All data types can have a different amount of values for the flight (sampling rate). Therefore we have
-     *        find the nearest match for the selected x-Value. As the X-Data and the Y-Data are coupled by the
-     *        vector index the method returns the index which can be used to fetch the best Y-Data for the given
-     *        X-Data.
-     *
-     * @param index - The selected X-Axis value we want to find the match for.
-     * @param data - The data vector to search for the X-Axis value.
-     * @return The index which represents the best match for the x-Axis value
+     * @brief matchHeading assigns the nearest heading value to every GPS position of the track.
+     *        GPS and ATT data have different sampling rates but both are sorted by their X-Axis
+     *        values, so a single merge pass is enough. Afterwards the cursor only needs one
+     *        lookup in the track for position and heading.
+     * @param gps - latitude or longitude series, only the X-Values are used
+     * @param heading - heading series
      */
-    int findBestIndexMatch(int index, const QVector<double> &data);
+    void matchHeading(const LogdataSeriesCache::Series &gps, const LogdataSeriesCache::Series &heading);
 
     /**
-     * @brief scaleData scales the GPS data into to 180° / -180° interval as some data comes alread scaled
-     *        while other data is not.
+     * @brief scaleData finds the scaling of the GPS data into the 180° / -180° interval as some data comes
+     *        already scaled while other data is not. The shared series are not modified, the scaling is
+     *        stored in m_gpsScaling and applied when the track is built.
+     * @param lat - latitude series
+     * @param lon - longitude series
      */
-    void scaleData();
+    void scaleData(const LogdataSeriesCache::Series &lat, const LogdataSeriesCache::Series &lon);
 
 private slots:
 
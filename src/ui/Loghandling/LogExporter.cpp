@@ -34,6 +34,7 @@ This file is part of the APM_PLANNER project
 #include <QApplication>
 #include <QProgressDialog>
 #include <QScopedPointer>
+#include <QtNumeric>
 
 LogExporterBase::LogExporterBase(QWidget *parent) : mp_parent(parent)
 {
@@ -197,8 +198,41 @@ void AsciiLogExporter::endExport()
 
 //***********************************************************************
 
-KmlLogExporter::KmlLogExporter(QWidget *parent, MAV_TYPE mav_type, double iconInterval) :
-    LogExporterBase (parent), m_kmlExporter(mav_type, iconInterval)
+namespace
+{
+// Column order of the types fetched for the kml export
+enum GpsColumn  { GpsLat, GpsLng, GpsAlt, GpsSpd, GpsCrs, GpsVZ, GpsHDop, GpsGMS, GpsTimeMS, GpsGWk, GpsWeek };
+enum PosColumn  { PosLat, PosLng, PosAlt };
+enum AttColumn  { AttRoll, AttPitch, AttYaw, AttDesRoll, AttDesPitch, AttDesYaw, AttRollIn, AttPitchIn, AttYawIn, AttNavYaw };
+enum QuatColumn { QuatQ1, QuatQ2, QuatQ3, QuatQ4 };
+enum CmdColumn  { CmdId, CmdLat, CmdLng, CmdAlt };
+enum ModeColumn { ModeMode, ModeModeNum };
+enum Source     { GpsSource, PosSource, AttSource, XKQ1Source, NKQ1Source, CmdSource, ModeSource, SourceCount };
+
+// older logs use other names for some values - the missing one is NaN
+double valueOr(double value, double alternative)
+{
+    return qIsNaN(value) ? alternative : value;
+}
+
+bool quatValid(const LogdataStorage::TypeColumns &quat, int row)
+{
+    return !qIsNaN(quat.m_values[QuatQ1].at(row)) && !qIsNaN(quat.m_values[QuatQ2].at(row)) &&
+           !qIsNaN(quat.m_values[QuatQ3].at(row)) && !qIsNaN(quat.m_values[QuatQ4].at(row));
+}
+
+kml::TrackAttitude quatAttitude(const LogdataStorage::TypeColumns &quat, int row)
+{
+    kml::TrackAttitude att;
+    kml::quatToKmlEuler(static_cast<float>(quat.m_values[QuatQ1].at(row)), static_cast<float>(quat.m_values[QuatQ2].at(row)),
+                        static_cast<float>(quat.m_values[QuatQ3].at(row)), static_cast<float>(quat.m_values[QuatQ4].at(row)),
+                        att.roll, att.pitch, att.yaw);
+    return att;
+}
+}
+
+KmlLogExporter::KmlLogExporter(QWidget *parent, MAV_TYPE mav_type, double iconInterval, bool createKmz) :
+    mp_parent(parent), m_trackWriter(mav_type, iconInterval, s_SimplifyTolerance), m_createKmz(createKmz)
 {
     QLOG_DEBUG() << "KmlLogExporter::KmlLogExporter()";
 }
@@ -208,26 +242,207 @@ KmlLogExporter::~KmlLogExporter()
     QLOG_DEBUG() << "KmlLogExporter::~KmlLogExporter()";
 }
 
-bool KmlLogExporter::startExport(const QString &fileName)
+QString KmlLogExporter::exportToFile(const QString &fileName, LogdataStorage::Ptr dataStoragePtr)
 {
-    QString tempName(fileName);
-    m_kmlExporter.start(tempName);
-    return true;
-}
+    typedef QScopedPointer<QProgressDialog, QScopedPointerDeleteLater> scopedDelLaterPtr;
 
-void KmlLogExporter::writeLine(QString &line)
-{
-    if (line.size() > 0)
+    QLOG_DEBUG() << "KmlLogExporter::exportToFile() Filename:" << fileName;
+
+    // Fetch all needed columns typed and scaled - one pass per type
+    LogdataStorage::TypeColumns columns[SourceCount];
+    dataStoragePtr->getColumns("GPS",  {"Lat", "Lng", "Alt", "Spd", "GCrs", "VZ", "HDop", "GMS", "GPSTimeMS", "GWk", "Week"}, 0, columns[GpsSource]);
+    dataStoragePtr->getColumns("POS",  {"Lat", "Lng", "Alt"}, 0, columns[PosSource]);
+    dataStoragePtr->getColumns("ATT",  {"Roll", "Pitch", "Yaw", "DesRoll", "DesPitch", "DesYaw", "RollIn", "PitchIn", "YawIn", "NavYaw"}, 0, columns[AttSource]);
+    dataStoragePtr->getColumns("XKQ1", {"Q1", "Q2", "Q3", "Q4"}, 0, columns[XKQ1Source]);
+    dataStoragePtr->getColumns("NKQ1", {"Q1", "Q2", "Q3", "Q4"}, 0, columns[NKQ1Source]);
+    dataStoragePtr->getColumns("CMD",  {"CId", "Lat", "Lng", "Alt"}, 0, columns[CmdSource]);
+    dataStoragePtr->getColumns("MODE", {"Mode", "ModeNum"}, 0, columns[ModeSource]);
+
+    int totalRows = 0;
+    for (const auto &source : columns)
     {
-        line.append("\r\n");
-        m_kmlExporter.processLine(line);
+        totalRows += source.m_indexes.size();
     }
-}
 
-void KmlLogExporter::endExport()
-{
-    QString generated = m_kmlExporter.finish(true);
-    m_ExportResult.append("Successfull exported to ");
-    m_ExportResult.append(generated);
-    QLOG_DEBUG() << m_ExportResult;
+    // create progress dialog
+    scopedDelLaterPtr progressDialogPtr(new QProgressDialog("Exporting File", "Cancel", 0, 100, mp_parent));
+    progressDialogPtr->setWindowModality(Qt::WindowModal);
+    progressDialogPtr->show();
+    QApplication::processEvents();
+
+    const auto &gps  = columns[GpsSource];
+    const auto &pos  = columns[PosSource];
+    const auto &att  = columns[AttSource];
+    const auto &cmd  = columns[CmdSource];
+    const auto &mode = columns[ModeSource];
+
+    qint64 gpsOffset = 0;       // offset from log time to UTC in usec, known after the first GPS fix
+    bool hasAtt = false;
+    int xkq1Row = -1;           // row of an EKF attitude which was not yet used by a POS
+    int nkq1Row = -1;
+    kml::TrackAttitude lastAtt;
+
+    // Walk through the rows of all types in the order they were logged
+    int positions[SourceCount] = {};
+    for (int processed = 1; ; ++processed)
+    {
+        int next = -1;
+        for (int source = 0; source < SourceCount; ++source)
+        {
+            if ((positions[source] < columns[source].m_indexes.size()) &&
+                ((next == -1) || (columns[source].m_indexes.at(positions[source]) < columns[next].m_indexes.at(positions[next]))))
+            {
+                next = source;
+            }
+        }
+        if (next == -1)
+        {
+            break;
+        }
+        const int row = positions[next]++;
+
+        switch (next)
+        {
+        case GpsSource:
+        {
+            const double week   = valueOr(gps.m_values[GpsGWk].at(row), gps.m_values[GpsWeek].at(row));
+            const double weekMs = valueOr(gps.m_values[GpsGMS].at(row), gps.m_values[GpsTimeMS].at(row));
+            if (qIsNaN(week) || (week <= 0))
+            {
+                break;  // no fix yet
+            }
+            kml::TrackPoint point;
+            point.lat     = gps.m_values[GpsLat].at(row);
+            point.lng     = gps.m_values[GpsLng].at(row);
+            point.alt     = gps.m_values[GpsAlt].at(row);
+            point.speed   = static_cast<float>(gps.m_values[GpsSpd].at(row));
+            point.course  = static_cast<float>(gps.m_values[GpsCrs].at(row));
+            point.vz      = static_cast<float>(gps.m_values[GpsVZ].at(row));
+            point.hdop    = static_cast<float>(gps.m_values[GpsHDop].at(row));
+            point.timeSec = gps.m_timeStamps.at(row);
+            // this is the offset as defined in ardupilot/libraries/AP_GPS/AP_GPS.h
+            point.utcMs   = static_cast<qint64>(UNIX_OFFSET_SEC * 1000LL) + static_cast<qint64>(week) * static_cast<qint64>(SEC_PER_WEEK * 1000LL)
+                            + static_cast<qint64>(weekMs);
+            gpsOffset = point.utcMs * 1000LL - static_cast<qint64>(point.timeSec * 1e6);
+            m_trackWriter.addGps(point);
+            break;
+        }
+        case PosSource:
+        {
+            // POS, ATT, NKQ1 and XKQ1 are all logged at 25Hz - POS takes the latest attitudes
+            if (gpsOffset > 0)
+            {
+                kml::TrackPoint point;
+                point.lat     = pos.m_values[PosLat].at(row);
+                point.lng     = pos.m_values[PosLng].at(row);
+                point.alt     = pos.m_values[PosAlt].at(row);
+                point.timeSec = pos.m_timeStamps.at(row);
+                point.utcMs   = (static_cast<qint64>(point.timeSec * 1e6) + gpsOffset) / 1000LL;
+                if (const kml::TrackPoint *lastGps = m_trackWriter.lastGps())
+                {
+                    point.speed  = lastGps->speed;
+                    point.course = lastGps->course;
+                    point.vz     = lastGps->vz;
+                    point.hdop   = lastGps->hdop;
+                }
+                point.hasAttitude = hasAtt;
+                point.attitude = lastAtt;
+                // use last read quaternion with highest priority: EKF3, EKF2
+                if (xkq1Row != -1)
+                {
+                    point.hasQuatAttitude = true;
+                    point.quatAttitude = quatAttitude(columns[XKQ1Source], xkq1Row);
+                }
+                else if (nkq1Row != -1)
+                {
+                    point.hasQuatAttitude = true;
+                    point.quatAttitude = quatAttitude(columns[NKQ1Source], nkq1Row);
+                }
+                m_trackWriter.addPoint(point);
+            }
+            xkq1Row = -1;
+            nkq1Row = -1;
+            break;
+        }
+        case AttSource:
+            if (!qIsNaN(att.m_values[AttRoll].at(row)))
+            {
+                lastAtt.roll    = static_cast<float>(att.m_values[AttRoll].at(row));
+                lastAtt.pitch   = static_cast<float>(att.m_values[AttPitch].at(row));
+                lastAtt.yaw     = static_cast<float>(att.m_values[AttYaw].at(row));
+                lastAtt.rollIn  = static_cast<float>(valueOr(att.m_values[AttRollIn].at(row), att.m_values[AttDesRoll].at(row)));
+                lastAtt.pitchIn = static_cast<float>(valueOr(att.m_values[AttPitchIn].at(row), att.m_values[AttDesPitch].at(row)));
+                lastAtt.yawIn   = static_cast<float>(valueOr(att.m_values[AttYawIn].at(row), att.m_values[AttDesYaw].at(row)));
+                lastAtt.navYaw  = static_cast<float>(valueOr(att.m_values[AttNavYaw].at(row), att.m_values[AttYaw].at(row)));
+                hasAtt = true;
+            }
+            break;
+        case XKQ1Source:
+            if (quatValid(columns[XKQ1Source], row))
+            {
+                xkq1Row = row;
+            }
+            break;
+        case NKQ1Source:
+            if (quatValid(columns[NKQ1Source], row))
+            {
+                nkq1Row = row;
+            }
+            break;
+        case CmdSource:
+        {
+            // Only navigation commands with a valid position are part of the waypoint path
+            const double lat = cmd.m_values[CmdLat].at(row);
+            const double lng = cmd.m_values[CmdLng].at(row);
+            if ((cmd.m_values[CmdId].at(row) < MAV_CMD_NAV_LAST) && (lat != 0.0) && (lng != 0.0) && !qIsNaN(lat) && !qIsNaN(lng))
+            {
+                m_trackWriter.addWaypoint(lat, lng, cmd.m_values[CmdAlt].at(row));
+            }
+            break;
+        }
+        case ModeSource:
+        {
+            const double modeNum = valueOr(mode.m_values[ModeModeNum].at(row), mode.m_values[ModeMode].at(row));
+            if (!qIsNaN(modeNum))
+            {
+                m_trackWriter.startSegment(static_cast<int>(modeNum));   // Time for a new placemark
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+        if (!(processed % 10000))
+        {
+            progressDialogPtr->setValue(static_cast<int>(90.0 * (static_cast<double>(processed) / static_cast<double>(totalRows))));
+            QApplication::processEvents();
+            if (progressDialogPtr->wasCanceled())
+            {
+                progressDialogPtr->close();
+                QString result("Export was canceled by user");
+                QLOG_DEBUG() << result;
+                return result;
+            }
+        }
+    }
+
+    progressDialogPtr->setValue(90);
+    QApplication::processEvents();
+
+    QString result;
+    QString generated = m_trackWriter.finish(fileName, m_createKmz);
+    if (generated.isEmpty())
+    {
+        result.append("Unable to write output file ");
+        result.append(fileName);
+    }
+    else
+    {
+        result.append("Successfull exported to ");
+        result.append(generated);
+    }
+    progressDialogPtr->close();
+    QLOG_DEBUG() << result;
+    return result;
 }
@@ -152,9 +152,12 @@ private:
 
 /**
  * @brief The KmlLogExporter class is used to export kml files which can be used
- *        with google earth.
+ *        with google earth. Other than the line oriented exporters it fetches the
+ *        needed GPS, POS, ATT, CMD and MODE columns directly from the LogdataStorage
+ *        and hands them to a kml::KMLTrackWriter, so no log line is formatted and
+ *        parsed again.
  */
-class KmlLogExporter : public LogExporterBase
+class KmlLogExporter
 {
 public:
 
@@ -166,37 +169,33 @@ public:
     /**
      * @brief KmlLogExporter - CTOR
      * @param parent - Parent widget needed for progress and info windows.
+     * @param mav_type - MAV type of the log, used to name the flight modes
+     * @param iconInterval - minimum distance in meters between two EKF attitude icons
+     * @param createKmz - true creates a compressed kmz file, false a plain kml file
      */
-    KmlLogExporter(QWidget *parent, MAV_TYPE mav_type, double iconInterval);
+    KmlLogExporter(QWidget *parent, MAV_TYPE mav_type, double iconInterval, bool createKmz = true);
 
     /**
      * @brief ~KmlLogExporter - DTOR
      */
     virtual ~KmlLogExporter();
 
-private:
-
-    kml::KMLCreator m_kmlExporter;      /// KML export object
-
     /**
-     * @brief startExport - sets up the kmlExporter.
-     * @param fileName - file name to be used by the kmlExporter
-     * @return
+     * @brief exportToFile - exports the flight stored in the LogdataStorage pointed by
+     *        dataStoragePtr to a file with name fileName.
+     * @param fileName - filename for the export
+     * @param dataStoragePtr - shared pointer to a filled LogdataStorage
+     * @return QString with information about the export. Can be shown to the user.
      */
-    virtual bool startExport(const QString &fileName);
+    QString exportToFile(const QString &fileName, LogdataStorage::Ptr dataStoragePtr);
 
-    /**
-     * @brief writeLine - gives the line to kmlExporter which extracts the
-     *        neede data.
-     * @param line - data to be analyzed
-     */
-    virtual void writeLine(QString &line);
+private:
 
-    /**
-     * @brief endExport - exports the data collected by the kmlExporter to
-     *        the file.
-     */
-    virtual void endExport();
+    constexpr static double s_SimplifyTolerance = 0.2;  /// Max deviation in meters when simplifying line strings
+
+    QWidget *mp_parent;                 /// pointer to parent widget - do not delete
+    kml::KMLTrackWriter m_trackWriter;  /// KML writer object
+    bool m_createKmz;                   /// true if a kmz file shall be created
 };
 
 
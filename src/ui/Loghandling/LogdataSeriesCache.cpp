@@ -0,0 +1,139 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2017 APM_PLANNER PROJECT <http://www.ardupilot.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file LogdataSeriesCache.cpp
+ * @brief File providing implementation for the cache of series extracted from log data storages
+ */
+
+#include "LogdataSeriesCache.h"
+#include "logging.h"
+
+#include <QMutexLocker>
+
+LogdataSeriesCache *LogdataSeriesCache::instance()
+{
+    static LogdataSeriesCache cache;
+    return &cache;
+}
+
+LogdataSeriesCache::SeriesPtr LogdataSeriesCache::find(const void *storage, const QString &name, bool useTimeAsIndex)
+{
+    QMutexLocker locker(&m_mutex);
+    auto iter = m_entries.find(Key{storage, name, useTimeAsIndex});
+    if (iter == m_entries.end())
+    {
+        return SeriesPtr();
+    }
+    // move to front of LRU list - splice keeps the iterator valid
+    m_lruList.splice(m_lruList.begin(), m_lruList, iter->m_lruPosition);
+    return iter->m_series;
+}
+
+LogdataSeriesCache::SeriesPtr LogdataSeriesCache::insert(const void *storage, const QString &name, bool useTimeAsIndex, Series series)
+{
+    // the vectors are reserved for the worst case - they will never grow again
+    series.m_xValues.squeeze();
+    series.m_yValues.squeeze();
+
+    QMutexLocker locker(&m_mutex);
+    const Key key{storage, name, useTimeAsIndex};
+    auto iter = m_entries.find(key);
+    if (iter != m_entries.end())
+    {
+        m_lruList.splice(m_lruList.begin(), m_lruList, iter->m_lruPosition);
+        return iter->m_series;
+    }
+
+    Entry entry;
+    entry.m_bytes = static_cast<qint64>(series.m_xValues.capacity() + series.m_yValues.capacity()) * static_cast<qint64>(sizeof(double));
+    entry.m_series = std::make_shared<const Series>(std::move(series));
+    m_lruList.push_front(key);
+    entry.m_lruPosition = m_lruList.begin();
+
+    const SeriesPtr result = entry.m_series;   // keeps the new series out of the eviction below
+    m_memoryUsage += entry.m_bytes;
+    m_entries.insert(key, entry);
+    evict();
+    return result;
+}
+
+void LogdataSeriesCache::removeStorage(const void *storage)
+{
+    QMutexLocker locker(&m_mutex);
+    for (auto iter = m_entries.begin(); iter != m_entries.end(); )
+    {
+        if (iter.key().m_storage == storage)
+        {
+            m_memoryUsage -= iter->m_bytes;
+            m_lruList.erase(iter->m_lruPosition);
+            iter = m_entries.erase(iter);
+        }
+        else
+        {
+            ++iter;
+        }
+    }
+}
+
+void LogdataSeriesCache::setMemoryLimit(qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_memoryLimit = bytes;
+    evict();
+}
+
+qint64 LogdataSeriesCache::memoryUsage() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_memoryUsage;
+}
+
+bool LogdataSeriesCache::isHeld(const Entry &entry)
+{
+    // QVector copies handed out by the fetch signals share the buffers with the cached series
+    // and keep them alive even if nobody holds the shared pointer anymore. Empty vectors use
+    // the static shared null and never count as shared.
+    const auto isShared = [](const QVector<double> &values)
+    {
+        return !values.isEmpty() && !values.isDetached();
+    };
+    return (entry.m_series.use_count() > 1) || isShared(entry.m_series->m_xValues) ||
+           isShared(entry.m_series->m_yValues);
+}
+
+void LogdataSeriesCache::evict()
+{
+    // walk from the least recently used end. Series held by someone else are skipped
+    auto lruIter = m_lruList.end();
+    while ((m_memoryUsage > m_memoryLimit) && (lruIter != m_lruList.begin()))
+    {
+        --lruIter;
+        auto entryIter = m_entries.find(*lruIter);
+        if (!isHeld(*entryIter))
+        {
+            QLOG_DEBUG() << "LogdataSeriesCache: evicting" << lruIter->m_name;
+            m_memoryUsage -= entryIter->m_bytes;
+            m_entries.erase(entryIter);
+            lruIter = m_lruList.erase(lruIter);
+        }
+    }
+}
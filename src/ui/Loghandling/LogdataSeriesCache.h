@@ -0,0 +1,174 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2017 APM_PLANNER PROJECT <http://www.ardupilot.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file LogdataSeriesCache.h
+ * @brief File providing header for the cache of series extracted from log data storages
+ */
+
+#ifndef LOGDATASERIESCACHE_H
+#define LOGDATASERIESCACHE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+#include <list>
+#include <memory>
+
+/**
+ * @brief The LogdataSeriesCache class holds the series extracted from LogdataStorage instances.
+ *        There is one cache for the whole application, so all windows showing the same storage
+ *        (analysis window, map) share one copy of every series instead of extracting their own.
+ *
+ *        Series are handed out as shared pointers to immutable data. The cache has a memory
+ *        limit, when it is exceeded the least recently used series nobody holds anymore are
+ *        dropped. A series counts as held as long as a shared pointer to it exists or one of its
+ *        vectors is still shared by an implicitly shared QVector copy (like the time index of a
+ *        graph). Held series are never dropped as that would not free any memory.
+ *
+ *        The cache only deduplicates the extraction. The memory limit bounds the data held by the
+ *        cache and says nothing about the resident memory of its users: QCustomPlot::setData()
+ *        for example copies the values into its own data map, which is not accounted here.
+ *
+ *        All methods are thread safe.
+ */
+class LogdataSeriesCache
+{
+public:
+
+    /**
+     * @brief The Series struct holds one extracted series like delivered by LogdataStorage::getValues()
+     */
+    struct Series
+    {
+        bool m_found{false};            /// true if the storage had data for the series
+        QVector<double> m_xValues;      /// X-Values of the series
+        QVector<double> m_yValues;      /// Y-Values of the series
+    };
+
+    using SeriesPtr = std::shared_ptr<const Series>;   /// Type for handing out series
+
+    /**
+     * @brief instance - delivers the cache of the application
+     * @return - pointer to the cache
+     */
+    static LogdataSeriesCache *instance();
+
+    /**
+     * @brief find - looks up a series and marks it as recently used
+     * @param storage - the storage the series was extracted from
+     * @param name - name of the series like "IMU.GyrX"
+     * @param useTimeAsIndex - true if the X-Values are time stamps
+     * @return - the series or a null pointer if it is not cached
+     */
+    SeriesPtr find(const void *storage, const QString &name, bool useTimeAsIndex);
+
+    /**
+     * @brief insert - adds a series to the cache. If the series was inserted meanwhile the
+     *        cached one is kept and delivered, so all users share the same data.
+     * @param storage - the storage the series was extracted from
+     * @param name - name of the series like "IMU.GyrX"
+     * @param useTimeAsIndex - true if the X-Values are time stamps
+     * @param series - the extracted series
+     * @return - the cached series
+     */
+    SeriesPtr insert(const void *storage, const QString &name, bool useTimeAsIndex, Series series);
+
+    /**
+     * @brief removeStorage - drops all series of a storage. Must be called when the storage is deleted.
+     * @param storage - the deleted storage
+     */
+    void removeStorage(const void *storage);
+
+    /**
+     * @brief setMemoryLimit - sets the number of bytes the cached series may use
+     * @param bytes - the limit
+     */
+    void setMemoryLimit(qint64 bytes);
+
+    /**
+     * @brief memoryUsage - delivers the number of bytes used by the cached series
+     * @return - used bytes
+     */
+    qint64 memoryUsage() const;
+
+private:
+
+    constexpr static qint64 s_DefaultMemoryLimit = 256 * 1024 * 1024;   /// Default memory limit in bytes
+
+    /**
+     * @brief The Key struct identifies one series
+     */
+    struct Key
+    {
+        const void *m_storage;          /// The storage the series was extracted from
+        QString m_name;                 /// Name of the series
+        bool m_useTimeAsIndex;          /// true if the X-Values are time stamps
+
+        bool operator==(const Key &other) const
+        {
+            return (m_storage == other.m_storage) && (m_useTimeAsIndex == other.m_useTimeAsIndex) &&
+                   (m_name == other.m_name);
+        }
+
+        friend uint qHash(const Key &key, uint seed = 0)
+        {
+            return qHash(key.m_name, seed) ^ qHash(key.m_storage, seed) ^ static_cast<uint>(key.m_useTimeAsIndex);
+        }
+    };
+
+    using LruList = std::list<Key>;     /// Keys ordered by use, most recently used first
+
+    /**
+     * @brief The Entry struct holds one cached series
+     */
+    struct Entry
+    {
+        SeriesPtr m_series;                 /// The series
+        qint64 m_bytes{0};                  /// Memory used by the series
+        LruList::iterator m_lruPosition;    /// Position of the key in m_lruList
+    };
+
+    LogdataSeriesCache() = default;
+
+    /**
+     * @brief isHeld - checks whether a series is used outside of the cache. m_mutex must be locked.
+     * @param entry - the entry to check
+     * @return - true if dropping the entry would not free its memory
+     */
+    static bool isHeld(const Entry &entry);
+
+    /**
+     * @brief evict - drops least recently used series nobody holds until the memory limit is met.
+     *        m_mutex must be locked.
+     */
+    void evict();
+
+    mutable QMutex m_mutex;             /// Protects all members
+    QHash<Key, Entry> m_entries;        /// The cached series
+    LruList m_lruList;                  /// Keys of m_entries ordered by use
+    qint64 m_memoryUsage{0};            /// Bytes used by all cached series
+    qint64 m_memoryLimit{s_DefaultMemoryLimit}; /// Bytes the cached series may use
+};
+
+#endif // LOGDATASERIESCACHE_H
@@ -29,7 +29,10 @@ This file is part of the APM_PLANNER project
 
 #include "LogdataStorage.h"
 #include "logging.h"
+#include <QRunnable>
 #include <algorithm>
+#include <functional>
+#include <queue>
 
 /**
  * @brief The TimeStampToIndexPairComparer class is a functor for sorting the
@@ -47,6 +50,42 @@ public:
 
 //****************************************************
 
+/**
+ * @brief The LogdataFetchTask class extracts one series for LogdataStorage::fetchValuesAsync()
+ *        on the thread pool of the storage and reports back with a queued call.
+ */
+class LogdataFetchTask : public QRunnable
+{
+public:
+    LogdataFetchTask(LogdataStorage *storage, quint64 requestId, QSharedPointer<LogdataStorage::FetchRequest> request) :
+        mp_storage(storage),
+        m_requestId(requestId),
+        m_request(std::move(request))
+    {}
+
+    void run() override
+    {
+        if (m_request->m_canceled.loadAcquire())
+        {
+            return;
+        }
+        LogdataSeriesCache::Series &series = m_request->m_series;
+        series.m_found = mp_storage->extractValues(m_request->m_name, m_request->m_useTimeAsIndex,
+                                                   series.m_xValues, series.m_yValues, &m_request->m_canceled);
+        if (!m_request->m_canceled.loadAcquire())
+        {
+            QMetaObject::invokeMethod(mp_storage, "fetchDone", Qt::QueuedConnection, Q_ARG(quint64, m_requestId));
+        }
+    }
+
+private:
+    LogdataStorage *mp_storage;                             /// The storage the data is extracted from
+    quint64 m_requestId;                                    /// Id of the request
+    QSharedPointer<LogdataStorage::FetchRequest> m_request; /// Request shared with the storage
+};
+
+//****************************************************
+
 LogdataStorage::LogdataStorage()
 {
     QLOG_DEBUG() << "LogdataStorage::LogdataStorage()";
@@ -65,6 +104,10 @@ LogdataStorage::LogdataStorage()
 LogdataStorage::~LogdataStorage()
 {
     QLOG_DEBUG() << "LogdataStorage::~LogdataStorage()";
+    // fetch tasks work on our data - stop them before it is gone
+    cancelAllFetches();
+    m_fetchPool.waitForDone();
+    LogdataSeriesCache::instance()->removeStorage(this);
 }
 
 int LogdataStorage::rowCount(const QModelIndex &parent) const
@@ -259,6 +302,15 @@ void LogdataStorage::setTimeStamp(const QString &timeStampName, double divisor)
     // As this method is called at the End of the parsing we should use the chance to sort the time index by
     // time - just to be sure...
     std::stable_sort(m_TimeToIndexList.begin(), m_TimeToIndexList.end(), TimeStampToIndexPairComparer());
+
+    // and to build the search index over the time stamps
+    QVector<double> timeStamps;
+    timeStamps.reserve(m_TimeToIndexList.size());
+    for (const auto &timeIndex : m_TimeToIndexList)
+    {
+        timeStamps.push_back(static_cast<double>(timeIndex.first));
+    }
+    m_timeIndex.build(timeStamps);
 }
 
 double LogdataStorage::getTimeDivisor() const
@@ -327,6 +379,84 @@ QVector<LogdataStorage::dataType> LogdataStorage::getAllDataTypes() const
 
 
 bool LogdataStorage::getValues(const QString &name, bool useTimeAsIndex, QVector<double> &xValues, QVector<double> &yValues) const
+{
+    return extractValues(name, useTimeAsIndex, xValues, yValues, nullptr);
+}
+
+LogdataSeriesCache::SeriesPtr LogdataStorage::getSeries(const QString &name, bool useTimeAsIndex) const
+{
+    LogdataSeriesCache *cache = LogdataSeriesCache::instance();
+    auto series = cache->find(this, name, useTimeAsIndex);
+    if (!series)
+    {
+        LogdataSeriesCache::Series extracted;
+        extracted.m_found = extractValues(name, useTimeAsIndex, extracted.m_xValues, extracted.m_yValues, nullptr);
+        series = cache->insert(this, name, useTimeAsIndex, std::move(extracted));
+    }
+    return series;
+}
+
+quint64 LogdataStorage::fetchValuesAsync(const QString &name, bool useTimeAsIndex)
+{
+    const quint64 requestId = m_nextFetchId++;
+    QSharedPointer<FetchRequest> request(new FetchRequest);
+    request->m_name = name;
+    request->m_useTimeAsIndex = useTimeAsIndex;
+    request->m_cached = LogdataSeriesCache::instance()->find(this, name, useTimeAsIndex);
+    m_fetchRequests.insert(requestId, request);
+
+    if (request->m_cached)
+    {
+        // Answer from cache but still asynchronous, so callers see the same behavior in both cases
+        QMetaObject::invokeMethod(this, "fetchDone", Qt::QueuedConnection, Q_ARG(quint64, requestId));
+    }
+    else
+    {
+        m_fetchPool.start(new LogdataFetchTask(this, requestId, request));
+    }
+    return requestId;
+}
+
+void LogdataStorage::cancelFetch(quint64 requestId)
+{
+    const auto request = m_fetchRequests.take(requestId);
+    if (request)
+    {
+        request->m_canceled.storeRelease(1);
+    }
+}
+
+void LogdataStorage::cancelAllFetches()
+{
+    foreach(const QSharedPointer<FetchRequest> &request, m_fetchRequests)
+    {
+        request->m_canceled.storeRelease(1);
+    }
+    m_fetchRequests.clear();
+}
+
+void LogdataStorage::fetchDone(quint64 requestId)
+{
+    const auto request = m_fetchRequests.take(requestId);
+    if (!request)
+    {
+        return;     // canceled meanwhile
+    }
+
+    auto series = request->m_cached;
+    if (!series)
+    {
+        series = LogdataSeriesCache::instance()->insert(this, request->m_name, request->m_useTimeAsIndex,
+                                                        std::move(request->m_series));
+    }
+
+    // The vectors are implicitly shared with the cache - receivers storing them do not copy the data
+    emit valuesFetched(requestId, request->m_name, request->m_useTimeAsIndex, series->m_found,
+                       series->m_xValues, series->m_yValues);
+}
+
+bool LogdataStorage::extractValues(const QString &name, bool useTimeAsIndex, QVector<double> &xValues,
+                                   QVector<double> &yValues, const QAtomicInt *canceled) const
 {
     // we expect a name like groupName.indexName:idx.valueName or groupName.valueName
 
@@ -379,10 +509,19 @@ bool LogdataStorage::getValues(const QString &name, bool useTimeAsIndex, QVector
     yValues.reserve((data.size() / (datalines)) + 2 );
 
     // copy the requested data
+    int rowsSinceCancelCheck {};
     if (canHaveMultipleDatalines && (datalines > 1))    // only if we really have more than one dataline.
     {
         for (const auto &valueRow: data)
         {
+            if (canceled && (++rowsSinceCancelCheck == s_CancelCheckInterval))
+            {
+                rowsSinceCancelCheck = 0;
+                if (canceled->loadAcquire())
+                {
+                    return false;
+                }
+            }
             if (valueRow.m_values.at(type.m_indexFieldIndex).toInt() == reqDataline)    // only if its the requested dataline
             {
                 xValues.push_back((useTimeAsIndex ? valueRow.m_values.at(timeStampIndex).toDouble() / m_timeDivisor : valueRow.m_index));
@@ -401,6 +540,14 @@ bool LogdataStorage::getValues(const QString &name, bool useTimeAsIndex, QVector
     {
         for (const auto &valueRow: data)
         {
+            if (canceled && (++rowsSinceCancelCheck == s_CancelCheckInterval))
+            {
+                rowsSinceCancelCheck = 0;
+                if (canceled->loadAcquire())
+                {
+                    return false;
+                }
+            }
             xValues.push_back((useTimeAsIndex ? valueRow.m_values.at(timeStampIndex).toDouble() / m_timeDivisor : valueRow.m_index));
             if(!qIsNaN(multiplier))
             {
@@ -431,6 +578,106 @@ void LogdataStorage::getRawDataRow(int index, QString &name, QVector<QVariant> &
     }
 }
 
+QVector<int> LogdataStorage::getRowIndexesOfTypes(const QStringList &typeNames) const
+{
+    QVector<const ValueTable *> tables;
+    int rowCount = 0;
+    for (const auto &typeName : typeNames)
+    {
+        auto iter = m_dataStorage.constFind(typeName);
+        if ((iter != m_dataStorage.constEnd()) && !iter->empty() && !tables.contains(&iter.value()))
+        {
+            tables.push_back(&iter.value());
+            rowCount += iter->size();
+        }
+    }
+
+    // The rows of every type are stored in ascending global index order. So a k-way merge
+    // of the selected tables delivers the sorted result without touching any other row.
+    using IndexTablePair = QPair<int, int>;     // global index and table
+    std::priority_queue<IndexTablePair, std::vector<IndexTablePair>, std::greater<IndexTablePair> > heads;
+    QVector<int> positions(tables.size(), 0);
+    for (int i = 0; i < tables.size(); ++i)
+    {
+        heads.push(IndexTablePair(tables.at(i)->at(0).m_index, i));
+    }
+
+    QVector<int> rows;
+    rows.reserve(rowCount);
+    while (!heads.empty())
+    {
+        const IndexTablePair head = heads.top();
+        heads.pop();
+        rows.push_back(head.first);
+
+        const ValueTable &table = *tables.at(head.second);
+        int &position = positions[head.second];
+        if (++position < table.size())
+        {
+            heads.push(IndexTablePair(table.at(position).m_index, head.second));
+        }
+    }
+    return rows;
+}
+
+bool LogdataStorage::getColumns(const QString &typeName, const QStringList &labels, int instance, TypeColumns &columns) const
+{
+    columns.m_indexes.clear();
+    columns.m_timeStamps.clear();
+    columns.m_values.clear();
+    columns.m_values.resize(labels.size());
+
+    auto dataIter = m_dataStorage.constFind(typeName);
+    if (!m_typeStorage.contains(typeName) || (dataIter == m_dataStorage.constEnd()))
+    {
+        return false;    // don't have this type or no data for this type
+    }
+
+    const dataType &type = m_typeStorage[typeName];
+    const ValueTable &data = dataIter.value();
+
+    QVector<int> valueIndexes;
+    QVector<double> multipliers;
+    valueIndexes.reserve(labels.size());
+    multipliers.reserve(labels.size());
+    for (const auto &label : labels)
+    {
+        const int valueIndex = type.m_labels.indexOf(label);
+        valueIndexes.push_back(valueIndex);
+        multipliers.push_back(((valueIndex != -1) && (valueIndex < type.m_multipliers.size())) ? type.m_multipliers.at(valueIndex) : qQNaN());
+    }
+
+    const bool filterInstance = type.m_maxIndex > 0;
+    columns.m_indexes.reserve(data.size());
+    columns.m_timeStamps.reserve(data.size());
+    for (auto &column : columns.m_values)
+    {
+        column.reserve(data.size());
+    }
+
+    for (const auto &valueRow : data)
+    {
+        if (filterInstance && (valueRow.m_values.at(type.m_indexFieldIndex).toInt() != instance))
+        {
+            continue;
+        }
+        columns.m_indexes.push_back(valueRow.m_index);
+        columns.m_timeStamps.push_back(valueRow.m_values.at(type.m_timeStampIndex).toDouble() / m_timeDivisor);
+        for (int i = 0; i < valueIndexes.size(); ++i)
+        {
+            const int valueIndex = valueIndexes.at(i);
+            if ((valueIndex == -1) || (valueIndex >= valueRow.m_values.size()))
+            {
+                columns.m_values[i].push_back(qQNaN());
+                continue;
+            }
+            const double value = valueRow.m_values.at(valueIndex).toDouble();
+            columns.m_values[i].push_back(qIsNaN(multipliers.at(i)) ? value : value * multipliers.at(i));
+        }
+    }
+    return true;
+}
+
 QHash<quint8, QString> LogdataStorage::getUnitData() const
 {
     return m_unitStorage;
@@ -462,40 +709,20 @@ double LogdataStorage::getMaxTimeStamp() const
 
 int LogdataStorage::getNearestIndexForTimestamp(double timevalue) const
 {
-    auto timeToFind   = static_cast<quint64>(m_timeDivisor * timevalue);
-    auto intervalSize = static_cast<float>(m_TimeToIndexList.size());
-    float intervalStart = 0;
-    float middle = 0;
-    int   index = 0;
+    const double timeToFind = m_timeDivisor * timevalue;
 
     // first check if timevalue is within our range
-    if(m_TimeToIndexList.first().first > timeToFind)
+    if (m_timeIndex.isEmpty() || (m_timeIndex.keyAt(0) > timeToFind))
     {
         return 0;   // timevalue too small deliver index 0
     }
 
-    if(m_TimeToIndexList.last().first < timeToFind)
+    if (m_timeIndex.keyAt(m_timeIndex.size() - 1) < timeToFind)
     {
         return m_TimeToIndexList.size();    // timevalue too big deliver last index.
     }
 
-    while (intervalSize > 1)
-    {
-        middle = intervalStart + intervalSize / 2;
-        index = qRound(middle);
-        quint64 tempTime = m_TimeToIndexList[index].first;
-        if (timeToFind > tempTime)
-        {
-            intervalStart = middle;
-        }
-        else if (timeToFind == tempTime)
-        {
-            break;
-        }
-        intervalSize = intervalSize / 2;
-    }
-
-    return m_TimeToIndexList[index].second;
+    return m_TimeToIndexList[m_timeIndex.nearest(timeToFind)].second;
 }
 
 void LogdataStorage::getMessagesOfType(const QString &type, QMap<quint64, MessageBase::Ptr> &indexToMessageMap) const
@@ -634,3 +861,177 @@ QString LogdataStorage::getLabelName(int index, const dataType & type)
     return label;
 }
 
+
+//****************************************************
+
+LogdataFilterModel::LogdataFilterModel(QObject *parent) :
+    QAbstractProxyModel(parent)
+{}
+
+void LogdataFilterModel::setSourceModel(QAbstractItemModel *sourceModel)
+{
+    beginResetModel();
+    if (mp_storage)
+    {
+        disconnect(mp_storage, nullptr, this, nullptr);
+    }
+    mp_storage = qobject_cast<LogdataStorage *>(sourceModel);
+    if (sourceModel && !mp_storage)
+    {
+        QLOG_ERROR() << "LogdataFilterModel can only be used with a LogdataStorage as source model!";
+    }
+    m_filteredRows.clear();
+    m_filterActive = false;
+    QAbstractProxyModel::setSourceModel(mp_storage);
+
+    if (mp_storage)
+    {
+        connect(mp_storage, SIGNAL(headerDataChanged(Qt::Orientation, int, int)),
+                this, SIGNAL(headerDataChanged(Qt::Orientation, int, int)));
+        connect(mp_storage, SIGNAL(modelAboutToBeReset()), this, SLOT(sourceModelAboutToBeReset()));
+        connect(mp_storage, SIGNAL(modelReset()), this, SLOT(sourceModelReset()));
+    }
+    endResetModel();
+}
+
+void LogdataFilterModel::setTypeFilter(const QStringList &typeNames)
+{
+    if (!mp_storage)
+    {
+        return;
+    }
+    beginResetModel();
+    m_filteredRows = mp_storage->getRowIndexesOfTypes(typeNames);
+    m_filterActive = true;
+    endResetModel();
+}
+
+void LogdataFilterModel::clearTypeFilter()
+{
+    if (!m_filterActive)
+    {
+        return;
+    }
+    beginResetModel();
+    m_filteredRows.clear();
+    m_filterActive = false;
+    endResetModel();
+}
+
+int LogdataFilterModel::nearestRow(int sourceRow) const
+{
+    const int rows = rowCount();
+    if (rows == 0)
+    {
+        return -1;
+    }
+    if (!m_filterActive)
+    {
+        return qBound(0, sourceRow, rows - 1);
+    }
+
+    // first shown row behind sourceRow - step one back to get the previous one
+    auto iter = std::upper_bound(m_filteredRows.constBegin(), m_filteredRows.constEnd(), sourceRow);
+    if (iter == m_filteredRows.constBegin())
+    {
+        return 0;   // nothing in front - take the next one
+    }
+    return static_cast<int>(iter - m_filteredRows.constBegin()) - 1;
+}
+
+QModelIndex LogdataFilterModel::mapToSource(const QModelIndex &proxyIndex) const
+{
+    if (!mp_storage || !proxyIndex.isValid())
+    {
+        return {};
+    }
+    return mp_storage->index(sourceRow(proxyIndex.row()), proxyIndex.column());
+}
+
+QModelIndex LogdataFilterModel::mapFromSource(const QModelIndex &sourceIndex) const
+{
+    if (!sourceIndex.isValid())
+    {
+        return {};
+    }
+    if (!m_filterActive)
+    {
+        return index(sourceIndex.row(), sourceIndex.column());
+    }
+
+    auto iter = std::lower_bound(m_filteredRows.constBegin(), m_filteredRows.constEnd(), sourceIndex.row());
+    if ((iter == m_filteredRows.constEnd()) || (*iter != sourceIndex.row()))
+    {
+        return {};  // row is filtered out
+    }
+    return index(static_cast<int>(iter - m_filteredRows.constBegin()), sourceIndex.column());
+}
+
+QModelIndex LogdataFilterModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (parent.isValid() || (row < 0) || (column < 0) || (row >= rowCount()) || (column >= columnCount()))
+    {
+        return {};
+    }
+    return createIndex(row, column);
+}
+
+QModelIndex LogdataFilterModel::parent(const QModelIndex &child) const
+{
+    Q_UNUSED(child)
+    return {};
+}
+
+int LogdataFilterModel::rowCount(const QModelIndex &parent) const
+{
+    if (!mp_storage || parent.isValid())
+    {
+        return 0;
+    }
+    return m_filterActive ? m_filteredRows.size() : mp_storage->rowCount();
+}
+
+int LogdataFilterModel::columnCount(const QModelIndex &parent) const
+{
+    if (!mp_storage || parent.isValid())
+    {
+        return 0;
+    }
+    return mp_storage->columnCount();
+}
+
+QVariant LogdataFilterModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (!mp_storage)
+    {
+        return {};
+    }
+    if (orientation == Qt::Vertical)
+    {
+        section = sourceRow(section);
+    }
+    // The horizontal header does not depend on filtering - the storage delivers
+    // the labels of the selected row.
+    return mp_storage->headerData(section, orientation, role);
+}
+
+void LogdataFilterModel::sourceModelAboutToBeReset()
+{
+    beginResetModel();
+}
+
+void LogdataFilterModel::sourceModelReset()
+{
+    m_filteredRows.clear();
+    m_filterActive = false;
+    endResetModel();
+}
+
+int LogdataFilterModel::sourceRow(int row) const
+{
+    if (!m_filterActive)
+    {
+        return row;
+    }
+    return ((row >= 0) && (row < m_filteredRows.size())) ? m_filteredRows.at(row) : -1;
+}
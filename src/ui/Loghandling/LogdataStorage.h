@@ -31,7 +31,13 @@ This file is part of the APM_PLANNER project
 
 #include <QObject>
 #include <QAbstractTableModel>
+#include <QAbstractProxyModel>
+#include <QAtomicInt>
+#include <QSharedPointer>
+#include <QThreadPool>
 #include <ArduPilotMegaMAV.h>
+#include "LogdataSeriesCache.h"
+#include "LogdataTimeIndex.h"
 
 /**
  * @brief The LogdataStorage class is used to store the data parsed from logfiles.
@@ -79,6 +85,16 @@ public:
         {}
     };
 
+    /**
+     * @brief The TypeColumns struct holds some columns of one type as doubles
+     */
+    struct TypeColumns
+    {
+        QVector<int> m_indexes;                 /// Global index of every row
+        QVector<double> m_timeStamps;           /// Time stamp of every row scaled to seconds
+        QVector<QVector<double> > m_values;     /// One vector per requested label. Missing labels hold NaNs
+    };
+
     /**
      * @brief LogdataStorage - CTOR
      */
@@ -214,6 +230,40 @@ public:
      */
     virtual bool getValues(const QString &name, bool useTimeAsIndex, QVector<double> &xValues, QVector<double> &yValues) const;
 
+    /**
+     * @brief getSeries - delivers the same data as getValues() as a shared series. The series is
+     *        taken from the LogdataSeriesCache, so all users of this storage share one copy
+     *        and the data is only extracted once.
+     * @param name - The name of the measurement, see getValues()
+     * @param useTimeAsIndex - true - use time in index
+     * @return - the series, never null. Check m_found of the series to see if there was data.
+     */
+    virtual LogdataSeriesCache::SeriesPtr getSeries(const QString &name, bool useTimeAsIndex) const;
+
+    /**
+     * @brief fetchValuesAsync - delivers the same data as getValues() but the extraction runs on a
+     *        thread pool. The result is delivered with the valuesFetched() signal in the thread of
+     *        the storage. Extracted series are kept in the LogdataSeriesCache, so a second fetch of
+     *        the same series is answered from the cache. Must not be called while the log is still
+     *        being loaded.
+     * @param name - The name of the measurement, see getValues()
+     * @param useTimeAsIndex - true - use time in index
+     * @return - id of this request. Used by valuesFetched() and cancelFetch().
+     */
+    virtual quint64 fetchValuesAsync(const QString &name, bool useTimeAsIndex);
+
+    /**
+     * @brief cancelFetch - cancels a request started by fetchValuesAsync(). A running extraction
+     *        stops early and valuesFetched() is not emitted for this request.
+     * @param requestId - id returned by fetchValuesAsync()
+     */
+    virtual void cancelFetch(quint64 requestId);
+
+    /**
+     * @brief cancelAllFetches - cancels all requests started by fetchValuesAsync().
+     */
+    virtual void cancelAllFetches();
+
     /**
      * @brief getRawDataRow - gets a whole data row like it was written into the model. Even if the Model
      *        supports scaling the data is NOT scaled. Used for Ascii Log exporting.
@@ -223,6 +273,28 @@ public:
      */
     virtual void getRawDataRow(int index, QString &name, QVector<QVariant> &measurements) const;
 
+    /**
+     * @brief getRowIndexesOfTypes delivers the global row indexes of all rows belonging to one
+     *        of the given types in ascending order. Only the rows of the requested types are
+     *        touched, so the cost depends on the number of selected rows and not on the log size.
+     * @param typeNames - names of the types like "ATT" or "GPS". Unknown names are ignored.
+     * @return - ascending vector of global row indexes.
+     */
+    virtual QVector<int> getRowIndexesOfTypes(const QStringList &typeNames) const;
+
+    /**
+     * @brief getColumns - delivers several columns of one type in a single pass over its rows. If the
+     *        model supports scaling the values are scaled like in getValues(). Meant for exporters which
+     *        need many values of the same row without going through strings.
+     * @param typeName - name of the type like "GPS"
+     * @param labels - labels of the columns to be fetched like "Lat" or "Lng". Labels the type does
+     *        not have deliver NaNs, so alternative names of old logs can be requested too.
+     * @param instance - for indexed types only rows of this instance are delivered. Ignored otherwise.
+     * @param columns - contains the fetched data after the call
+     * @return true - type has data, false otherwise
+     */
+    virtual bool getColumns(const QString &typeName, const QStringList &labels, int instance, TypeColumns &columns) const;
+
     /**
      * @brief getUnitData - returns the unit data stored in model. Can be empty if no unit data
      *        available. Used for exporting.
@@ -305,8 +377,32 @@ public:
      */
     virtual bool ModelIsScaled() const;
 
+signals:
+
+    /**
+     * @brief valuesFetched is emitted when a request of fetchValuesAsync() is done.
+     * @param requestId - id returned by fetchValuesAsync()
+     * @param name - name of the measurement
+     * @param useTimeAsIndex - true if the X-Values are time stamps
+     * @param found - true data found, false otherwise. Like the return value of getValues()
+     * @param xValues - the X-Values
+     * @param yValues - the Y-Values
+     */
+    void valuesFetched(quint64 requestId, const QString &name, bool useTimeAsIndex, bool found,
+                       const QVector<double> &xValues, const QVector<double> &yValues);
+
+private slots:
+
+    /**
+     * @brief fetchDone - called queued by the fetch tasks when an extraction is done.
+     * @param requestId - id of the finished request
+     */
+    void fetchDone(quint64 requestId);
+
 private:
 
+    friend class LogdataFetchTask;
+
     constexpr static int s_ColumnOffset  = 2;           /// Offset for columns cause model adds index and name column
     constexpr static char s_UnitParOpen  = '[';         /// Unit names are surrounded by this parenthesis
     constexpr static char s_UnitParClose = ']';         /// Unit names are surrounded by this parenthesis
@@ -327,6 +423,21 @@ private:
 
     using ValueTable = QVector<IndexValueRow>;          /// Type holding all data rows of a specific type
 
+    /**
+     * @brief The FetchRequest struct holds one request of fetchValuesAsync(). It is shared
+     *        with the fetch task which stores its result here.
+     */
+    struct FetchRequest
+    {
+        QString m_name;                 /// Name of the measurement
+        bool m_useTimeAsIndex{false};   /// true if X-Values shall be time stamps
+        QAtomicInt m_canceled{0};       /// Set to 1 to stop the extraction
+        LogdataSeriesCache::Series m_series;    /// Result of the extraction
+        LogdataSeriesCache::SeriesPtr m_cached; /// Set if the result was found in the cache
+    };
+
+    constexpr static int s_CancelCheckInterval = 4096;  /// Rows extracted between two checks for cancellation
+
     int m_columnCount{};           /// Holds the maximum column count of all rows
     int m_currentRow{};            /// The current selected row in table
 
@@ -336,6 +447,7 @@ private:
     quint64 m_maxTimeStamp{};          /// the max time stamp in data
 
     QVector<TimeStampToIndexPair> m_TimeToIndexList;    /// List holding pairs of time stamp and table row index
+    LogdataTimeIndex m_timeIndex;                       /// Search index over the time stamps of m_TimeToIndexList
 
     QHash<QString, dataType> m_typeStorage;     /// Holds all known types
     QVector<QString>         m_indexToTypeRow;  /// Holds the Type name in the order they were added
@@ -350,6 +462,17 @@ private:
     QHash<quint32, QByteArray> m_typeIDToUnitFieldInfo;       /// Holds Unit IDs for every type
     QHash<quint32, QByteArray> m_typeIDToMultiplierFieldInfo; /// Holds Multiplier IDs for every type
 
+    quint64 m_nextFetchId{1};                                   /// Id of the next fetch request
+    QHash<quint64, QSharedPointer<FetchRequest> > m_fetchRequests; /// Running fetch requests by id
+    QThreadPool m_fetchPool;                                    /// Runs the fetch tasks
+
+    /**
+     * @brief extractValues - implementation of getValues() which can be canceled.
+     * @param canceled - if not null the extraction stops and returns false as soon as it is set
+     * @see getValues()
+     */
+    bool extractValues(const QString &name, bool useTimeAsIndex, QVector<double> &xValues,
+                       QVector<double> &yValues, const QAtomicInt *canceled) const;
 
     /**
      * @brief getLabelName - Constructs and delivers the Label name for the dataType at a given index.
@@ -361,4 +484,105 @@ private:
     static QString getLabelName(int index, const dataType &type);
 };
 
+/**
+ * @brief The LogdataFilterModel class is a proxy for the LogdataStorage which shows only
+ *        the rows of some message types. Other than a QSortFilterProxyModel it never calls
+ *        data() to decide if a row is accepted but takes the row indexes the storage
+ *        already holds per type. Applying a filter and mapping rows in both directions
+ *        is therefore cheap even on huge logs.
+ */
+class LogdataFilterModel : public QAbstractProxyModel
+{
+    Q_OBJECT
+public:
+
+    /**
+     * @brief LogdataFilterModel - CTOR
+     * @param parent - parent object
+     */
+    explicit LogdataFilterModel(QObject *parent = nullptr);
+
+    /**
+     * @brief setSourceModel - sets the source model. Must be a LogdataStorage.
+     * @see help of QAbstractProxyModel::setSourceModel
+     */
+    void setSourceModel(QAbstractItemModel *sourceModel) override;
+
+    /**
+     * @brief setTypeFilter - shows only the rows of the given message types.
+     * @param typeNames - names of the types to be shown like "ATT" or "GPS"
+     */
+    void setTypeFilter(const QStringList &typeNames);
+
+    /**
+     * @brief clearTypeFilter - disables the filtering. All rows are shown again.
+     */
+    void clearTypeFilter();
+
+    /**
+     * @brief nearestRow - delivers the row of this model showing the given source row.
+     *        If the source row is filtered out the previous shown row is delivered and
+     *        if there is none the next one.
+     * @param sourceRow - row in the LogdataStorage
+     * @return - row in this model, -1 if this model has no rows.
+     */
+    int nearestRow(int sourceRow) const;
+
+    /**
+     * @see help of QAbstractProxyModel::mapToSource
+     */
+    QModelIndex mapToSource(const QModelIndex &proxyIndex) const override;
+
+    /**
+     * @see help of QAbstractProxyModel::mapFromSource
+     */
+    QModelIndex mapFromSource(const QModelIndex &sourceIndex) const override;
+
+    /**
+     * @see help of QAbstractItemModel::index
+     */
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+
+    /**
+     * @see help of QAbstractItemModel::parent
+     */
+    QModelIndex parent(const QModelIndex &child) const override;
+
+    /**
+     * @see help of QAbstractItemModel::rowCount
+     */
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+
+    /**
+     * @see help of QAbstractItemModel::columnCount
+     */
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+
+    /**
+     * @see help of QAbstractItemModel::headerData
+     */
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private slots:
+
+    /**
+     * @brief sourceModelAboutToBeReset - forwards the reset of the source model.
+     */
+    void sourceModelAboutToBeReset();
+
+    /**
+     * @brief sourceModelReset - drops the filter when the source model is reset
+     *        as the stored row indexes are not valid anymore.
+     */
+    void sourceModelReset();
+
+private:
+
+    int sourceRow(int row) const;
+
+    LogdataStorage *mp_storage{nullptr};    /// The source model
+    QVector<int> m_filteredRows;            /// Ascending source rows shown if filter is active
+    bool m_filterActive{false};             /// True if only m_filteredRows are shown
+};
+
 #endif // LOGDATASTORAGE_H
@@ -0,0 +1,176 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2017 APM_PLANNER PROJECT <http://www.ardupilot.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file LogdataTimeIndex.cpp
+ * @brief File providing implementation for the search index over sorted time stamps / X-Values
+ */
+
+#include "LogdataTimeIndex.h"
+
+#include <algorithm>
+#include <cmath>
+
+void LogdataTimeIndex::build(const QVector<double> &keys)
+{
+    clear();
+    m_keys = keys;
+    const int count = m_keys.size();
+    if (count == 0)
+    {
+        return;
+    }
+
+    // sample the first key of every block and store the samples as Eytzinger tree
+    const int blocks = (count + s_BlockSize - 1) / s_BlockSize;
+    QVector<double> samples;
+    samples.reserve(blocks);
+    for (int block = 0; block < blocks; ++block)
+    {
+        samples.push_back(m_keys.at(block * s_BlockSize));
+    }
+    m_tree.resize(blocks + 1);
+    m_treeBlock.resize(blocks + 1);
+    fillTree(samples, 0, 1);
+
+    // check if the keys are uniform enough for interpolation
+    const double range = m_keys.last() - m_keys.first();
+    if ((count > s_BlockSize) && (range > 0.0))
+    {
+        m_firstKey = m_keys.first();
+        m_slope = static_cast<double>(count - 1) / range;
+        m_maxError = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            const int error = std::abs(guessIndex(m_keys.at(i)) - i);
+            if (error > m_maxError)
+            {
+                m_maxError = error;
+                if (m_maxError > s_MaxInterpolationError)
+                {
+                    break;
+                }
+            }
+        }
+        m_interpolate = m_maxError <= s_MaxInterpolationError;
+    }
+}
+
+void LogdataTimeIndex::clear()
+{
+    m_keys.clear();
+    m_tree.clear();
+    m_treeBlock.clear();
+    m_interpolate = false;
+    m_firstKey = 0.0;
+    m_slope = 0.0;
+    m_maxError = 0;
+}
+
+int LogdataTimeIndex::fillTree(const QVector<double> &samples, int sampleIndex, int treeIndex)
+{
+    // in order walk of the implicit tree - node k has its children at 2k and 2k+1
+    if (treeIndex < m_tree.size())
+    {
+        sampleIndex = fillTree(samples, sampleIndex, 2 * treeIndex);
+        m_tree[treeIndex] = samples.at(sampleIndex);
+        m_treeBlock[treeIndex] = sampleIndex;
+        ++sampleIndex;
+        sampleIndex = fillTree(samples, sampleIndex, 2 * treeIndex + 1);
+    }
+    return sampleIndex;
+}
+
+int LogdataTimeIndex::guessIndex(double key) const
+{
+    // bounded before the cast, so keys far outside (or NaN) can not overflow
+    const double guess = std::floor((key - m_firstKey) * m_slope);
+    return static_cast<int>(qBound(-1.0, guess, static_cast<double>(m_keys.size())));
+}
+
+int LogdataTimeIndex::lowerBound(double key) const
+{
+    const int count = m_keys.size();
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    const double *keys = m_keys.constData();
+    if (m_interpolate)
+    {
+        // The searched index is at most m_maxError (+1 for rounding) away from the guess
+        const int guess = guessIndex(key);
+        const int begin = qBound(0, guess - m_maxError, count);
+        const int end   = qBound(0, guess + m_maxError + 2, count);
+        return static_cast<int>(std::lower_bound(keys + begin, keys + end, key) - keys);
+    }
+
+    // Branch free descent in the Eytzinger tree - finds the first block starting at or after key
+    const int treeSize = m_tree.size();
+    const double *tree = m_tree.constData();
+    int node = 1;
+    while (node < treeSize)
+    {
+        node = 2 * node + (tree[node] < key ? 1 : 0);
+    }
+    // strip the right turns taken after the last left turn - the remaining node is the result
+    while (node & 1)
+    {
+        node >>= 1;
+    }
+    node >>= 1;
+
+    const int block = (node == 0) ? (treeSize - 1) : m_treeBlock.at(node);
+    if (block == 0)
+    {
+        return 0;   // even the first key is not less than key
+    }
+    // the result is within the block before, or the first key of the found block
+    const int begin = (block - 1) * s_BlockSize;
+    const int end   = qMin(block * s_BlockSize, count);
+    int index = begin;
+    while ((index < end) && (keys[index] < key))
+    {
+        ++index;
+    }
+    return index;
+}
+
+int LogdataTimeIndex::nearest(double key) const
+{
+    const int count = m_keys.size();
+    if (count == 0)
+    {
+        return -1;
+    }
+
+    int index = lowerBound(key);
+    if (index == count)
+    {
+        return count - 1;
+    }
+    if ((index > 0) && ((key - m_keys.at(index - 1)) < (m_keys.at(index) - key)))
+    {
+        --index;
+    }
+    return index;
+}
@@ -0,0 +1,117 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2017 APM_PLANNER PROJECT <http://www.ardupilot.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file LogdataTimeIndex.h
+ * @brief File providing header for the search index over sorted time stamps / X-Values
+ */
+
+#ifndef LOGDATATIMEINDEX_H
+#define LOGDATATIMEINDEX_H
+
+#include <QVector>
+
+/**
+ * @brief The LogdataTimeIndex class answers "where is this key" for an ascending vector of keys like
+ *        the time stamps of a log or the X-Values of a graph. It is used by the table, the plot
+ *        cursors and the map which all do such lookups on every mouse move.
+ *
+ *        The keys are kept in a plain array. For searching every s_BlockSize-th key is sampled into
+ *        a small tree stored in Eytzinger (BFS) order, so the top levels of the search stay in cache
+ *        and a lookup touches only a few cache lines. Logs are mostly sampled at a near constant rate,
+ *        in that case the position is interpolated and only a small window around it is searched.
+ */
+class LogdataTimeIndex
+{
+public:
+
+    /**
+     * @brief LogdataTimeIndex - CTOR creates an empty index
+     */
+    LogdataTimeIndex() = default;
+
+    /**
+     * @brief build - (re)builds the index.
+     * @param keys - ascending keys. The vector is implicitly shared, not copied.
+     */
+    void build(const QVector<double> &keys);
+
+    /**
+     * @brief clear - removes all keys
+     */
+    void clear();
+
+    /**
+     * @brief size - delivers the number of keys
+     */
+    int size() const { return m_keys.size(); }
+
+    /**
+     * @brief isEmpty - true if there are no keys
+     */
+    bool isEmpty() const { return m_keys.isEmpty(); }
+
+    /**
+     * @brief keyAt - delivers the key at an index
+     */
+    double keyAt(int index) const { return m_keys.at(index); }
+
+    /**
+     * @brief lowerBound - delivers the index of the first key which is not less than key.
+     *        Same result as std::lower_bound.
+     * @param key - the key to search for
+     * @return - index of the key, size() if all keys are less.
+     */
+    int lowerBound(double key) const;
+
+    /**
+     * @brief nearest - delivers the index of the key with the smallest distance to key.
+     * @param key - the key to search for
+     * @return - index of the key, -1 if the index is empty.
+     */
+    int nearest(double key) const;
+
+private:
+
+    constexpr static int s_BlockSize = 16;          /// Keys per sampled block, 2 cache lines of doubles
+    constexpr static int s_MaxInterpolationError = 32; /// Interpolation is used if no key is further away from its guessed index
+
+    QVector<double> m_keys;         /// The keys in ascending order
+    QVector<double> m_tree;         /// First key of every block in Eytzinger order, 1 based
+    QVector<int>    m_treeBlock;    /// Block number of every element of m_tree
+
+    bool   m_interpolate{false};    /// true if the keys are near uniform
+    double m_firstKey{0.0};         /// First key - for interpolation
+    double m_slope{0.0};            /// Indexes per key unit - for interpolation
+    int    m_maxError{0};           /// Max distance of a key from its interpolated index
+
+    /**
+     * @brief fillTree - fills m_tree in Eytzinger order from the sorted block samples
+     */
+    int fillTree(const QVector<double> &samples, int sampleIndex, int treeIndex);
+
+    /**
+     * @brief guessIndex - delivers the interpolated index of key
+     */
+    int guessIndex(double key) const;
+};
+
+#endif // LOGDATATIMEINDEX_H
@@ -26,12 +26,19 @@ This file is part of the APM_PLANNER project
 #include "UAS.h"
 #include "UASManager.h"
 #include "GoogleElevationData.h"
+#include "SrtmElevationData.h"
+#include "SrtmTileCache.h"
+#include "TerrainFollowingPlanner.h"
+#include "MissionStore.h"
 
 #include "MissionElevationDisplay.h"
 #include "ui_MissionElevationDisplay.h"
 
+#include <QFileDialog>
 #include <QInputDialog>
 #include <QMessageBox>
+#include <QSettings>
+#include <QTimer>
 
 static const double ElevationDefaultAltMin = 0.0; //m
 static const double ElevationDefaultAltMax = 25.0; //m
@@ -40,6 +47,12 @@ static const double ElevationDefaultDistanceMax = 50.0; //m
 static const int ElevationGraphMissionId = 0; //m
 static const int ElevationGraphElevationId = 1; //m
 
+static const int ElevationSourceGoogle = 0;
+static const int ElevationSourceSrtm = 1;
+static const QString ElevationSourceKey = "ELEVATION_DISPLAY_SOURCE";
+static const QString TerrainClearanceKey = "ELEVATION_DISPLAY_TERRAIN_CLEARANCE";
+static const double TerrainSampleSpacing = 30.0; //m, about the SRTM1 post spacing
+
 MissionElevationDisplay::MissionElevationDisplay(QWidget *parent) :
     QWidget(parent),
     ui(new Ui::MissionElevationDisplay),
@@ -47,13 +60,18 @@ MissionElevationDisplay::MissionElevationDisplay(QWidget *parent) :
     m_uasWaypointMgr(NULL),
     m_totalDistance(0),
     m_elevationData(NULL),
+    m_terrainData(NULL),
+    m_terrainPlanner(NULL),
+    m_terrainPlannerMgr(NULL),
     m_useHomeAltOffset(false),
     m_homeAltOffset(0.0),
-    m_elevationShown(false)
+    m_elevationShown(false),
+    m_displayUpdatePending(false)
 {
     ui->setupUi(this);
 
     ui->sampleSpinBox->setEnabled(false);
+    ui->sourceComboBox->setCurrentIndex(QSettings().value(ElevationSourceKey, ElevationSourceGoogle).toInt());
 
     QCustomPlot* customPlot = ui->customPlot;
     customPlot->addGraph(); // Mission Elevation Graph (ElevationGraphMissionId)
@@ -86,10 +104,14 @@ MissionElevationDisplay::MissionElevationDisplay(QWidget *parent) :
     activeUASSet(UASManager::instance()->getActiveUAS());
 
     connect(ui->infoButton, SIGNAL(clicked()), this, SLOT(showInfoBox()));
+    connect(ui->sourceComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(sourceChanged(int)));
+    connect(ui->terrainFollowButton, SIGNAL(clicked()), this, SLOT(planTerrainFollowing()));
 }
 
 MissionElevationDisplay::~MissionElevationDisplay()
 {
+    delete m_terrainPlanner;
+    qDeleteAll(m_waypointList);
     delete ui;
 }
 
@@ -110,6 +132,9 @@ void MissionElevationDisplay::activeUASSet(UASInterface *uas)
         disconnect(ui->sampleSpinBox, SIGNAL(valueChanged(int)), this, SLOT(sampleValueChanged()));
     }
 
+    if (m_terrainPlanner)
+        m_terrainPlanner->cancel(); // The result belongs to the previous vehicle
+
     m_uasWaypointMgr = NULL;
     m_uasInterface = uas;
 
@@ -140,7 +165,8 @@ void MissionElevationDisplay::updateWaypoint(int uasId, Waypoint *waypoint)
 
     if(m_waypointList.count() >= 2){
         Waypoint* oldWp = m_waypointList.value(waypoint->getId());
-        if (m_elevationShown && ((oldWp->getLatitude() != waypoint->getLatitude())
+        // The copies are only refreshed by the deferred updateDisplay()
+        if (m_elevationShown && oldWp && ((oldWp->getLatitude() != waypoint->getLatitude())
            || (oldWp->getLongitude() != waypoint->getLongitude()))){
             // Waypoint Moved, so need to refresh elevation.
             ui->refreshButton->setText("Refresh Elevation");
@@ -148,7 +174,11 @@ void MissionElevationDisplay::updateWaypoint(int uasId, Waypoint *waypoint)
         }
     }
 
-    updateDisplay();
+    // Several waypoints may change at once, e.g. by terrain following, plot them once
+    if (!m_displayUpdatePending){
+        m_displayUpdatePending = true;
+        QTimer::singleShot(0, this, SLOT(updateDisplay()));
+    }
 }
 
 void MissionElevationDisplay::sampleValueChanged()
@@ -159,6 +189,125 @@ void MissionElevationDisplay::sampleValueChanged()
     }
 }
 
+void MissionElevationDisplay::sourceChanged(int index)
+{
+    QSettings().setValue(ElevationSourceKey, index);
+    sampleValueChanged();
+}
+
+void MissionElevationDisplay::terrainTilesMissing(const QStringList &tileNames, const QString &directory)
+{
+    // Areas without tiles like open water report the same tiles on every refresh, ask only once
+    QStringList sortedNames = tileNames;
+    sortedNames.sort();
+    if (sortedNames == m_askedMissingTiles && directory == m_askedTileDirectory)
+        return;
+    m_askedMissingTiles = sortedNames;
+    m_askedTileDirectory = directory;
+
+    QMessageBox::StandardButton button = QMessageBox::question(this, "Elevation Display",
+                            "The SRTM tiles " + tileNames.join(", ") + " are not in " + directory
+                            + "\nThe elevation will not be shown for those areas."
+                            "\nDo you want to choose another tile directory?",
+                            QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
+    if (button != QMessageBox::Yes)
+        return;
+
+    QString newDirectory = QFileDialog::getExistingDirectory(this, "Terrain Tile Directory", directory);
+    if (!newDirectory.isEmpty()){
+        SrtmTileCache::instance()->setTileDirectory(newDirectory);
+        // Sample again once the current request has finished
+        QTimer::singleShot(0, this, SLOT(updateElevationData()));
+    }
+}
+
+void MissionElevationDisplay::planTerrainFollowing()
+{
+    if (m_uasWaypointMgr == NULL || m_terrainPlanner != NULL)
+        return;
+
+    const MissionStore &mission = m_uasWaypointMgr->getMissionStore();
+    if (mission.viewCount(MissionStore::GlobalFramePathView) < 2){
+        QMessageBox::information(this, "Follow Terrain", "The mission needs at least two waypoints.", QMessageBox::Ok);
+        return;
+    }
+
+    bool ok;
+    double clearance = QInputDialog::getDouble(this, "Follow Terrain", "Clearance above terrain (m)",
+                                               QSettings().value(TerrainClearanceKey, 50.0).toDouble(),
+                                               0.0, 10000.0, 1, &ok);
+    if (!ok)
+        return;
+    QSettings().setValue(TerrainClearanceKey, clearance);
+
+    m_terrainPlannerMgr = m_uasWaypointMgr;
+    m_terrainPlanner = new TerrainFollowingPlanner(m_uasWaypointMgr->getMissionStore(), clearance,
+                                                   TerrainSampleSpacing);
+    connect(m_terrainPlanner, SIGNAL(progress(int,int)), this, SLOT(terrainPlanningProgress(int,int)));
+    connect(m_terrainPlanner, SIGNAL(planningFinished(bool)), this, SLOT(terrainPlanningFinished(bool)));
+    ui->terrainFollowButton->setEnabled(false);
+    m_terrainPlanner->start(QThread::LowPriority);
+}
+
+void MissionElevationDisplay::terrainPlanningProgress(int legsDone, int legCount)
+{
+    if (legCount > 0)
+        ui->terrainFollowButton->setText(QString("Planning %1%").arg(legsDone * 100 / legCount));
+}
+
+void MissionElevationDisplay::terrainPlanningFinished(bool completed)
+{
+    TerrainFollowingPlanner* planner = m_terrainPlanner;
+    UASWaypointManager* plannedMgr = m_terrainPlannerMgr;
+    m_terrainPlanner = NULL;
+    m_terrainPlannerMgr = NULL;
+    planner->wait();
+    planner->deleteLater();
+    ui->terrainFollowButton->setText("Follow Terrain");
+    ui->terrainFollowButton->setEnabled(true);
+
+    // A result queued before the vehicle changed belongs to the previous one
+    if (!completed || m_uasWaypointMgr == NULL || m_uasWaypointMgr != plannedMgr)
+        return;
+
+    const double lowest = planner->minClearance();
+    if (qIsNaN(lowest)){
+        QMessageBox::information(this, "Follow Terrain", "There are no SRTM tiles for the mission in "
+                                 + SrtmTileCache::instance()->tileDirectory(), QMessageBox::Ok);
+        return;
+    }
+
+    const TerrainFollowingPlanner::LegClearance* lowestLeg = NULL;
+    foreach (const TerrainFollowingPlanner::LegClearance& leg, planner->legs()){
+        if (leg.minClearance == lowest)
+            lowestLeg = &leg;
+    }
+    int noData = 0;
+    foreach (const TerrainFollowingPlanner::LegClearance& leg, planner->legs()){
+        if (leg.samples == 0)
+            noData++;
+    }
+
+    QString text = QString("The lowest clearance of the mission is %1m between WP%2 and WP%3.")
+            .arg(lowest, 0, 'f', 1).arg(lowestLeg->from).arg(lowestLeg->to);
+    if (noData > 0)
+        text += QString("\n%1 legs have no terrain data and keep their altitudes.").arg(noData);
+    text += "\nSet the waypoint altitudes to follow the terrain?";
+    if (QMessageBox::question(this, "Follow Terrain", text, QMessageBox::Yes | QMessageBox::No,
+                              QMessageBox::No) != QMessageBox::Yes)
+        return;
+
+    // The altitudes are only valid for the planned items, frames and order.
+    // Check again after the question, the vehicle may have changed meanwhile.
+    if (m_uasWaypointMgr != plannedMgr
+            || !m_uasWaypointMgr->getMissionStore().sameItems(planner->mission())){
+        QMessageBox::warning(this, "Follow Terrain", "The mission changed while planning, please try again.");
+        return;
+    }
+    int changed = m_uasWaypointMgr->setEditableAltitudes(planner->waypointIndices(), planner->followingAltitudes());
+    QLOG_INFO() << "Terrain following changed the altitude of" << changed << "waypoints";
+}
+
 void MissionElevationDisplay::currentWaypointChanged(quint16 waypointId)
 {
     QLOG_TRACE() << "Elevation current waypount update: " << waypointId;
@@ -167,10 +316,14 @@ void MissionElevationDisplay::currentWaypointChanged(quint16 waypointId)
 void MissionElevationDisplay::updateDisplay()
 {
     QLOG_DEBUG() << "updateElevationDisplay";
+    m_displayUpdatePending = false;
+    if (m_uasWaypointMgr == NULL)
+        return;
 
-    QList<Waypoint*> list = m_uasWaypointMgr->getGlobalFrameAndNavTypeWaypointList(false);
+    const MissionStore &mission = m_uasWaypointMgr->getMissionStore();
+    qDeleteAll(m_waypointList);
     m_waypointList.clear();
-    foreach (Waypoint* wp, list) {
+    foreach (Waypoint* wp, mission.waypoints(MissionStore::GlobalFrameMapView)) {
         // Create a copy
         m_waypointList.insert(wp->getId(), new Waypoint(*wp));
     }
@@ -178,20 +331,51 @@ void MissionElevationDisplay::updateDisplay()
     if (m_waypointList.count() == 0)
         return;
 
-    m_totalDistance = plotElevationGraph(m_waypointList.values(), ElevationGraphMissionId, m_homeAltOffset);
-    addWaypointLabels();
+    m_totalDistance = plotMissionGraph(mission, m_homeAltOffset);
+    addWaypointLabels(mission);
 }
 
 void MissionElevationDisplay::updateElevationGraph(QList<Waypoint *> waypointList, double averageResolution)
 {
-    if (m_waypointList.count() == 0)
+    if (m_waypointList.count() == 0){
+        qDeleteAll(waypointList);
         return;
+    }
     int distance = plotElevationGraph(waypointList, ElevationGraphElevationId, 0.0);
-    ui->resolutionLabel->setText(QString::number(averageResolution)+"(m)");
+    qDeleteAll(waypointList);
+    ui->resolutionLabel->setText(QString::number(averageResolution, 'f', 1)+"(m)");
     if (distance > m_totalDistance)
         m_totalDistance = distance;
 }
 
+int MissionElevationDisplay::plotMissionGraph(const MissionStore &mission, double homeAltOffset)
+{
+    const QVector<int> &indices = mission.indices(MissionStore::GlobalFrameMapView);
+    const QVector<double> &distances = mission.cumulativeDistances(MissionStore::GlobalFrameMapView);
+    double homeAlt = 0.0;
+
+    QVector<double> altitudes(indices.size());
+    for (int i = 0; i < indices.size(); i++){
+        const double alt = mission.altitudes().at(indices.at(i));
+        if (indices.at(i) == 0){
+            // Waypoint 0 is HOME, the base of relative altitudes
+            homeAlt = alt;
+            altitudes[i] = homeAlt + homeAltOffset;
+        } else if (mission.frames().at(indices.at(i)) == MAV_FRAME_GLOBAL_RELATIVE_ALT){
+            altitudes[i] = alt + homeAlt + homeAltOffset;
+        } else {
+            altitudes[i] = alt;
+        }
+    }
+
+    QCustomPlot* customplot = ui->customPlot;
+    customplot->graph(ElevationGraphMissionId)->setData(distances, altitudes, true);
+    customplot->rescaleAxes();
+    customplot->replot();
+
+    return distances.isEmpty() ? 0 : distances.last();
+}
+
 int MissionElevationDisplay::plotElevationGraph(QList<Waypoint *> waypointList, int graphId, double homeAltOffset)
 {
     Waypoint* previousWp = NULL;
@@ -223,8 +407,8 @@ int MissionElevationDisplay::plotElevationGraph(QList<Waypoint *> waypointList,
 
         } else {
             // calculate the distance and plot against alt
-            double distance = distanceBetweenLatLng(previousWp->getLatitude(), previousWp->getLongitude(),
-                                                    wp->getLatitude(), wp->getLongitude());
+            double distance = MissionStore::distanceBetween(previousWp->getLatitude(), previousWp->getLongitude(),
+                                                            wp->getLatitude(), wp->getLongitude());
             totalDistance += distance;
             if ( totalDistance > xRange.upper ){
                 customplot->xAxis->setRange(0, totalDistance + 10);
@@ -247,44 +431,48 @@ int MissionElevationDisplay::plotElevationGraph(QList<Waypoint *> waypointList,
     return totalDistance;
 }
 
-void MissionElevationDisplay::addWaypointLabels()
+void MissionElevationDisplay::addWaypointLabels(const MissionStore &mission)
 {
     QCustomPlot* customPlot = ui->customPlot;
     customPlot->clearItems();
-    double totalDistance = 0.0;
-    double distance = 0.0;
-    Waypoint* previousWp = NULL;
-
-    foreach(Waypoint* wp, m_waypointList){
-        if(previousWp != NULL) {
-            distance = distanceBetweenLatLng(previousWp->getLatitude(), previousWp->getLongitude(),
-                                                wp->getLatitude(), wp->getLongitude());
-        }
+    const QVector<int> &indices = mission.indices(MissionStore::GlobalFrameMapView);
+    const QVector<double> &distances = mission.cumulativeDistances(MissionStore::GlobalFrameMapView);
 
-        totalDistance += distance;
+    for (int i = 0; i < indices.size(); i++){
+        const double distance = i > 0 ? distances.at(i) - distances.at(i - 1) : 0.0;
         QCPItemTracer *itemTracer = new QCPItemTracer(customPlot);
         itemTracer->setGraph(customPlot->graph(ElevationGraphMissionId));
         itemTracer->setStyle(QCPItemTracer::tsNone);
-        itemTracer->setGraphKey(totalDistance);
+        itemTracer->setGraphKey(distances.at(i));
 
         QCPItemText *itemText = new QCPItemText(customPlot);
-        itemText->setText("WP" + (QString::number(wp->getId())) + " (+" + (QString::number(distance,'f', 1)) +"m)");
+        itemText->setText("WP" + (QString::number(indices.at(i))) + " (+" + (QString::number(distance,'f', 1)) +"m)");
         itemText->position->setParentAnchor(itemTracer->position);
-
-        previousWp = wp;
     }
 }
 
 void MissionElevationDisplay::updateElevationData()
 {
-    if(m_elevationData == NULL){
-        m_elevationData = new GoogleElevationData();
-        connect(m_elevationData, SIGNAL(elevationDataReady(QList<Waypoint*>,double)),
-                this, SLOT(updateElevationGraph(QList<Waypoint*>,double)));
-        m_elevationShown = true;
-    }
     int samples = m_waypointList.count()*ui->sampleSpinBox->value();
-    m_elevationData->requestElevationData(m_waypointList.values(), m_totalDistance, samples); // 5 samples between waypoints
+    m_elevationShown = true;
+
+    if (ui->sourceComboBox->currentIndex() == ElevationSourceSrtm){
+        if(m_terrainData == NULL){
+            m_terrainData = new SrtmElevationData(this);
+            connect(m_terrainData, SIGNAL(elevationDataReady(QList<Waypoint*>,double)),
+                    this, SLOT(updateElevationGraph(QList<Waypoint*>,double)));
+            connect(m_terrainData, SIGNAL(tilesMissing(QStringList,QString)),
+                    this, SLOT(terrainTilesMissing(QStringList,QString)));
+        }
+        m_terrainData->requestElevationData(m_waypointList.values(), m_totalDistance, samples);
+    } else {
+        if(m_elevationData == NULL){
+            m_elevationData = new GoogleElevationData(this);
+            connect(m_elevationData, SIGNAL(elevationDataReady(QList<Waypoint*>,double)),
+                    this, SLOT(updateElevationGraph(QList<Waypoint*>,double)));
+        }
+        m_elevationData->requestElevationData(m_waypointList.values(), m_totalDistance, samples); // 5 samples between waypoints
+    }
     if (m_elevationShown == true) {
         ui->refreshButton->setEnabled(false);
         ui->refreshButton->setText("Updated");
@@ -292,18 +480,6 @@ void MissionElevationDisplay::updateElevationData()
     ui->sampleSpinBox->setEnabled(true);
 }
 
-// When we move to QT5 the below should use QGeoLocation.
-double MissionElevationDisplay::distanceBetweenLatLng(double lat1, double lon1, double lat2, double lon2)
-{
-     double R = 6371000; // m
-     double dLat = (lat2-lat1)* (M_PI / 180);
-     double dLon = (lon2-lon1)* (M_PI / 180);
-     double a = sin(dLat/2) * sin(dLat/2) + cos(lat1* (M_PI / 180)) * cos(lat2* (M_PI / 180)) * sin(dLon/2) * sin(dLon/2);
-     double c = 2 * atan2(sqrt(a), sqrt(1-a));
-     double d = R * c;
-     return d;
-}
-
 void MissionElevationDisplay::useHomeAltOffset(bool checked)
 {
     m_useHomeAltOffset = checked;
@@ -328,6 +504,8 @@ void MissionElevationDisplay::setHomeAltOffset()
 
 void MissionElevationDisplay::showInfoBox()
 {
-    QMessageBox::information(this, "Elevation Display", "The Elevation Display will show your mission elevation (blue) against Google's elevation data for that area (red)"
+    QMessageBox::information(this, "Elevation Display", "The Elevation Display will show your mission elevation (blue) against the terrain elevation for that area (red)"
+                             "\nThe terrain comes from Google's elevation service or, offline, from SRTM .hgt tiles in "
+                             + SrtmTileCache::instance()->tileDirectory() +
                              "\nWARNING: The datas resolution can be reduced in some areas, so please use caution.",QMessageBox::Ok);
 }
@@ -25,12 +25,16 @@ This file is part of the APM_PLANNER project
 
 #include <QWidget>
 #include <QMap>
+#include <QStringList>
 
 class QCustomPlot;
 class UASInterface;
 class UASWaypointManager;
 class Waypoint;
+class MissionStore;
 class GoogleElevationData;
+class SrtmElevationData;
+class TerrainFollowingPlanner;
 
 namespace Ui {
 class MissionElevationDisplay;
@@ -57,12 +61,17 @@ private slots:
     void useHomeAltOffset(bool state);
     void showInfoBox();
     void sampleValueChanged();
+    void sourceChanged(int index);
+    void terrainTilesMissing(const QStringList &tileNames, const QString &directory);
+    void planTerrainFollowing();
+    void terrainPlanningProgress(int legsDone, int legCount);
+    void terrainPlanningFinished(bool completed);
 
 private:
+    int plotMissionGraph(const MissionStore &mission, double homeAltOffset);
     int plotElevationGraph(QList<Waypoint *> waypointList, int graphId, double homeAltOffset);
-    double distanceBetweenLatLng(double lat1, double lon1, double lat2, double lon2);
     double getHomeAlt(Waypoint* wp);
-    void addWaypointLabels();
+    void addWaypointLabels(const MissionStore &mission);
 
 private:
     Ui::MissionElevationDisplay *ui;
@@ -73,9 +82,15 @@ private:
     int m_totalDistance;
 
     GoogleElevationData* m_elevationData;
+    SrtmElevationData* m_terrainData;
+    TerrainFollowingPlanner* m_terrainPlanner;
+    UASWaypointManager* m_terrainPlannerMgr; // The waypoint manager whose mission is being planned
     bool m_useHomeAltOffset;
     double m_homeAltOffset;
     bool m_elevationShown;
+    bool m_displayUpdatePending;
+    QStringList m_askedMissingTiles; // Missing tiles the user was last asked about
+    QString m_askedTileDirectory;
 };
 
 #endif // MISSONELEVATIONDISPLAY_H
@@ -5,8 +5,10 @@
 #include <QTreeWidget>
 #include <QMap>
 #include <QTimer>
+#include <QElapsedTimer>
 
 #include "MAVLinkProtocol.h"
+#include "MAVLinkMessageSlotTable.h"
 
 namespace Ui {
     class QGCMAVLinkInspector;
@@ -14,7 +16,15 @@ namespace Ui {
 
 class QTreeWidgetItem;
 class UASInterface;
-
+class QGCMAVLinkInspectorModel;
+
+/**
+ * @brief Shows the latest value of every MAVLink message field received
+ *
+ * receiveMessage() only stores the message in a lock free slot table and is
+ * called directly from the protocol thread. The tree is a model/view over
+ * that table, refreshed at 1 Hz, which formats fields of expanded messages only.
+ */
 class QGCMAVLinkInspector : public QWidget
 {
     Q_OBJECT
@@ -24,6 +34,7 @@ public:
     ~QGCMAVLinkInspector() override;
 
 public slots:
+    /** @brief Store a message, thread safe */
     void receiveMessage(LinkInterface* link,mavlink_message_t message);
     /** @brief Clear all messages */
     void clearView();
@@ -40,58 +51,34 @@ public slots:
 
     void rateTreeItemChanged(QTreeWidgetItem* paramItem, int column);
 
+private slots:
+    void messageRowsInserted(const QModelIndex &parent, int first, int last);
+    void messageRowsReset();
+
 private:
     MAVLinkProtocol *_protocol {nullptr};     ///< MAVLink instance
     int selectedSystemID {0};           ///< Currently selected system
     int selectedComponentID {0};        ///< Currently selected component
 
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
     QMap<int, int> systems;         ///< Already observed systems
     QMap<int, int> components;      ///< Already observed components
     QMap<int, float> onboardMessageInterval; ///< Stores the onboard selected data rate
     QMap<int, QTreeWidgetItem*> rateTreeWidgetItems; ///< Available rate tree widget items
     QTimer updateTimer; ///< Only update at 1 Hz to not overload the GUI
+    QElapsedTimer lastRefresh; ///< Time base of the message rates
     QHash<quint32, mavlink_message_info_t> messageInfo; ///< Meta information about all messages
 
+    MAVLinkMessageSlotTable messageTable;   ///< Latest message of every (sysid, compid, msgid)
+    QGCMAVLinkInspectorModel *messageModel {nullptr};
 
-    QMap<int, QTreeWidgetItem* > uasTreeWidgetItems; ///< Tree of available uas with their widget
-
-
-    QMap<int, QMultiMap<int, QTreeWidgetItem*>* > uasMsgTreeItems; ///< Stores the widget of the received message for each UAS
-
-    QMultiMap<int, mavlink_message_t* > uasMessageStorage; ///< Stores the messages for every UAS
-
-    QMultiMap<int, QMap<int, float>* > uasMessageHz; ///< Stores the frequency of each message of each UAS
-    QMultiMap<int, QMap<int, unsigned int>* > uasMessageCount; ///< Stores the message count of each message of each UAS
-
-    QMultiMap<int, QMap<int, quint64>* > uasLastMessageUpdate; ///< Stores the time of the last message for each message of each UAS
-
-    /* @brief Update one message field */
-    void updateField(int sysid, int msgid, int fieldid, QTreeWidgetItem* item);
     /** @brief Rebuild the list of components */
     void rebuildComponentList();
     /** @brief Change the stream interval */
     void changeStreamInterval(int msgid, int interval);
-    /* @brief Create a new tree for a new UAS */
-    void addUAStoTree(int sysId);
+    /** @brief Apply the system and component selection */
+    void selectionChanged();
 
     static constexpr unsigned int updateInterval {1000}; ///< The update interval of the refresh function
-    static constexpr float updateHzLowpass {0.2f}; ///< The low-pass filter value for the frequency of each message
-
 
     Ui::QGCMAVLinkInspector *mp_Ui;
 };
@@ -0,0 +1,490 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2014 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+#include "QGCMAVLinkInspectorModel.h"
+#include "UASManager.h"
+
+#include <QStringList>
+#include <cstring>
+
+namespace
+{
+// internalId of an index: 0 for system rows, systemRow + 1 for message rows
+// and FieldTag + slot for field rows. Systems are only ever appended and
+// slots never move, so these ids stay valid while rows get inserted.
+const quintptr FieldTag = 0x10000;
+
+template <typename T>
+T fieldValue(const char *payload, const mavlink_field_info_t &field, unsigned int element)
+{
+    T value;
+    memcpy(&value, payload + field.wire_offset + element * sizeof(T), sizeof(T));
+    return value;
+}
+
+template <typename T>
+QString formatField(const char *payload, const mavlink_field_info_t &field)
+{
+    if (field.array_length == 0)
+    {
+        return QString::number(fieldValue<T>(payload, field, 0));
+    }
+    QStringList values;
+    values.reserve(static_cast<int>(field.array_length));
+    for (unsigned int i = 0; i < field.array_length; ++i)
+    {
+        values << QString::number(fieldValue<T>(payload, field, i));
+    }
+    return values.join(", ");
+}
+
+const char *typeName(mavlink_message_type_t type)
+{
+    switch (type)
+    {
+    case MAVLINK_TYPE_CHAR:     return "char";
+    case MAVLINK_TYPE_UINT8_T:  return "uint8_t";
+    case MAVLINK_TYPE_INT8_T:   return "int8_t";
+    case MAVLINK_TYPE_UINT16_T: return "uint16_t";
+    case MAVLINK_TYPE_INT16_T:  return "int16_t";
+    case MAVLINK_TYPE_UINT32_T: return "uint32_t";
+    case MAVLINK_TYPE_INT32_T:  return "int32_t";
+    case MAVLINK_TYPE_UINT64_T: return "uint64_t";
+    case MAVLINK_TYPE_INT64_T:  return "int64_t";
+    case MAVLINK_TYPE_FLOAT:    return "float";
+    case MAVLINK_TYPE_DOUBLE:   return "double";
+    }
+    return "";
+}
+}
+
+QGCMAVLinkInspectorModel::QGCMAVLinkInspectorModel(const MAVLinkMessageSlotTable &table, QObject *parent) :
+    QAbstractItemModel(parent),
+    m_table(table)
+{
+    // Store metadata for all MAVLink messages.
+    QVector<mavlink_message_info_t> mavlinkMsg = MAVLINK_MESSAGE_INFO;
+    for(const auto &typeInfo : mavlinkMsg)
+    {
+        if(!m_messageInfo.contains(typeInfo.msgid))
+        {
+            m_messageInfo.insert(typeInfo.msgid, typeInfo);
+        }
+    }
+}
+
+QModelIndex QGCMAVLinkInspectorModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (!hasIndex(row, column, parent))
+    {
+        return QModelIndex();
+    }
+    if (!parent.isValid())
+    {
+        return createIndex(row, column, quintptr(0));
+    }
+    const quintptr parentId = parent.internalId();
+    if (parentId == 0)
+    {
+        return createIndex(row, column, quintptr(parent.row() + 1));
+    }
+    if (parentId < FieldTag)
+    {
+        const int slot = m_systems.at(static_cast<int>(parentId - 1)).messageSlots.at(parent.row());
+        return createIndex(row, column, FieldTag + slot);
+    }
+    return QModelIndex();
+}
+
+QModelIndex QGCMAVLinkInspectorModel::parent(const QModelIndex &child) const
+{
+    if (!child.isValid())
+    {
+        return QModelIndex();
+    }
+    const quintptr id = child.internalId();
+    if (id == 0)
+    {
+        return QModelIndex();
+    }
+    if (id < FieldTag)
+    {
+        return createIndex(static_cast<int>(id - 1), 0, quintptr(0));
+    }
+    const SlotState &state = m_slotStates.at(static_cast<int>(id - FieldTag));
+    return createIndex(state.row, 0, quintptr(state.systemRow + 1));
+}
+
+int QGCMAVLinkInspectorModel::rowCount(const QModelIndex &parent) const
+{
+    if (!parent.isValid())
+    {
+        return m_systems.size();
+    }
+    if (parent.column() > 0)
+    {
+        return 0;
+    }
+    const quintptr id = parent.internalId();
+    if (id == 0)
+    {
+        return m_systems.at(parent.row()).messageSlots.size();
+    }
+    if (id < FieldTag)
+    {
+        const int slot = m_systems.at(static_cast<int>(id - 1)).messageSlots.at(parent.row());
+        return static_cast<int>(m_messageInfo.value(m_table.messageId(slot)).num_fields);
+    }
+    return 0;
+}
+
+int QGCMAVLinkInspectorModel::columnCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent)
+    return ColumnCount;
+}
+
+QVariant QGCMAVLinkInspectorModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+    {
+        return QVariant();
+    }
+    switch (section)
+    {
+    case NameColumn:  return tr("Name");
+    case ValueColumn: return tr("Value");
+    case TypeColumn:  return tr("Type");
+    }
+    return QVariant();
+}
+
+bool QGCMAVLinkInspectorModel::isGroupRow(const QModelIndex &index) const
+{
+    return index.isValid() && index.internalId() < FieldTag;
+}
+
+QVariant QGCMAVLinkInspectorModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || role != Qt::DisplayRole)
+    {
+        return QVariant();
+    }
+    const quintptr id = index.internalId();
+    if (id == 0)
+    {
+        if (index.column() != NameColumn)
+        {
+            return QVariant();
+        }
+        const int sysid = m_systems.at(index.row()).sysid;
+        UASInterface* uas = UASManager::instance()->getUASForId(sysid);
+        if (uas && !uas->getUASName().isEmpty())
+        {
+            return uas->getUASName();
+        }
+        return tr("UAS ") + QString::number(sysid);
+    }
+    if (id < FieldTag)
+    {
+        if (index.column() != NameColumn)
+        {
+            return QVariant();
+        }
+        return messageLabel(m_systems.at(static_cast<int>(id - 1)).messageSlots.at(index.row()));
+    }
+    return fieldData(static_cast<int>(id - FieldTag), index.row(), index.column());
+}
+
+QString QGCMAVLinkInspectorModel::messageName(quint32 msgid) const
+{
+    const auto info = m_messageInfo.constFind(msgid);
+    return info != m_messageInfo.constEnd() ? QString(info->name) : tr("UNKNOWN");
+}
+
+QString QGCMAVLinkInspectorModel::messageLabel(int slot) const
+{
+    const quint32 msgid = m_table.messageId(slot);
+    return QString("%1 (%2 Hz, #%3, comp %4)").arg(messageName(msgid))
+            .arg(m_slotStates.at(slot).hz, 3, 'f', 1).arg(msgid).arg(m_table.componentId(slot));
+}
+
+QVariant QGCMAVLinkInspectorModel::fieldData(int slot, int field, int column) const
+{
+    const auto info = m_messageInfo.constFind(m_table.messageId(slot));
+    if (info == m_messageInfo.constEnd() || field >= static_cast<int>(info->num_fields))
+    {
+        return QVariant();
+    }
+    const mavlink_field_info_t &fieldInfo = info->fields[field];
+
+    switch (column)
+    {
+    case NameColumn:
+        return QString(fieldInfo.name);
+    case TypeColumn:
+        if (fieldInfo.array_length > 0)
+        {
+            return QString("%1[%2]").arg(typeName(fieldInfo.type)).arg(fieldInfo.array_length);
+        }
+        return QString(typeName(fieldInfo.type));
+    case ValueColumn:
+        break;
+    default:
+        return QVariant();
+    }
+
+    // Values are formatted here, so only fields the view actually paints cost anything
+    const auto snapshot = m_snapshots.constFind(slot);
+    if (snapshot == m_snapshots.constEnd())
+    {
+        return QVariant();
+    }
+    const char *payload = _MAV_PAYLOAD(&snapshot.value());
+
+    switch (fieldInfo.type)
+    {
+    case MAVLINK_TYPE_CHAR:
+        if (fieldInfo.array_length > 0)
+        {
+            const char *str = payload + fieldInfo.wire_offset;
+            return QString::fromLatin1(str, static_cast<int>(qstrnlen(str, fieldInfo.array_length)));
+        }
+        return QString(QChar::fromLatin1(payload[fieldInfo.wire_offset]));
+    case MAVLINK_TYPE_UINT8_T:  return formatField<uint8_t>(payload, fieldInfo);
+    case MAVLINK_TYPE_INT8_T:   return formatField<int8_t>(payload, fieldInfo);
+    case MAVLINK_TYPE_UINT16_T: return formatField<uint16_t>(payload, fieldInfo);
+    case MAVLINK_TYPE_INT16_T:  return formatField<int16_t>(payload, fieldInfo);
+    case MAVLINK_TYPE_UINT32_T: return formatField<uint32_t>(payload, fieldInfo);
+    case MAVLINK_TYPE_INT32_T:  return formatField<int32_t>(payload, fieldInfo);
+    case MAVLINK_TYPE_UINT64_T: return formatField<quint64>(payload, fieldInfo);
+    case MAVLINK_TYPE_INT64_T:  return formatField<qint64>(payload, fieldInfo);
+    case MAVLINK_TYPE_FLOAT:    return formatField<float>(payload, fieldInfo);
+    case MAVLINK_TYPE_DOUBLE:   return formatField<double>(payload, fieldInfo);
+    }
+    return QVariant();
+}
+
+bool QGCMAVLinkInspectorModel::acceptsSlot(int slot) const
+{
+    if (m_table.count(slot) <= m_slotStates.at(slot).clearedCount)
+    {
+        return false;
+    }
+    if (m_filterSysid != 0 && m_filterSysid != m_table.systemId(slot))
+    {
+        return false;
+    }
+    return m_filterCompid == 0 || m_filterCompid == m_table.componentId(slot);
+}
+
+int QGCMAVLinkInspectorModel::systemRowFor(int sysid)
+{
+    for (int row = 0; row < m_systems.size(); ++row)
+    {
+        if (m_systems.at(row).sysid == sysid)
+        {
+            return row;
+        }
+    }
+    // Appended only, message row ids encode the system row
+    beginInsertRows(QModelIndex(), m_systems.size(), m_systems.size());
+    SystemNode node;
+    node.sysid = sysid;
+    m_systems.append(node);
+    endInsertRows();
+    return m_systems.size() - 1;
+}
+
+void QGCMAVLinkInspectorModel::insertSlot(int slot)
+{
+    const int systemRow = systemRowFor(m_table.systemId(slot));
+    QVector<int> &messageSlots = m_systems[systemRow].messageSlots;
+
+    // Keep the messages of a system sorted by id, then component
+    const quint64 key = (static_cast<quint64>(m_table.messageId(slot)) << 8) | m_table.componentId(slot);
+    int position = 0;
+    while (position < messageSlots.size()
+           && ((static_cast<quint64>(m_table.messageId(messageSlots.at(position))) << 8)
+               | m_table.componentId(messageSlots.at(position))) < key)
+    {
+        ++position;
+    }
+
+    beginInsertRows(index(systemRow, 0), position, position);
+    messageSlots.insert(position, slot);
+    for (int row = position; row < messageSlots.size(); ++row)
+    {
+        m_slotStates[messageSlots.at(row)].row = row;
+    }
+    m_slotStates[slot].systemRow = systemRow;
+    endInsertRows();
+}
+
+void QGCMAVLinkInspectorModel::updateSnapshot(int slot)
+{
+    mavlink_message_t message;
+    if (m_table.read(slot, message))
+    {
+        m_snapshots.insert(slot, message);
+    }
+}
+
+void QGCMAVLinkInspectorModel::refresh(int intervalMsecs)
+{
+    const int used = m_table.size();
+    if (m_slotStates.size() < used)
+    {
+        m_slotStates.resize(used);
+    }
+    const float seconds = qMax(intervalMsecs, 1) / 1000.0f;
+    QVector<bool> labelChanged(used, false);
+
+    for (int slot = 0; slot < used; ++slot)
+    {
+        SlotState &state = m_slotStates[slot];
+        const quint64 count = m_table.count(slot);
+        const quint64 delta = count - state.lastCount;
+        state.lastCount = count;
+
+        // Compute the new low-pass filtered frequency
+        const float hz = (1.0f - updateHzLowpass) * state.hz + updateHzLowpass * delta / seconds;
+        // The label shows one decimal, smaller changes do not need a repaint
+        labelChanged[slot] = qAbs(hz - state.hz) >= 0.05f;
+        state.hz = hz;
+
+        if (state.systemRow < 0)
+        {
+            if (acceptsSlot(slot))
+            {
+                insertSlot(slot);
+            }
+            continue;
+        }
+
+        if (state.expanded && delta > 0)
+        {
+            updateSnapshot(slot);
+            const QModelIndex message = index(state.row, 0, index(state.systemRow, 0));
+            const int fields = rowCount(message);
+            if (fields > 0)
+            {
+                emit dataChanged(index(0, ValueColumn, message), index(fields - 1, ValueColumn, message),
+                                 QVector<int>() << Qt::DisplayRole);
+            }
+        }
+    }
+
+    // One signal per system covering all message labels that changed
+    for (int systemRow = 0; systemRow < m_systems.size(); ++systemRow)
+    {
+        const QVector<int> &messageSlots = m_systems.at(systemRow).messageSlots;
+        int first = -1;
+        int last = -1;
+        for (int row = 0; row < messageSlots.size(); ++row)
+        {
+            if (labelChanged.value(messageSlots.at(row)))
+            {
+                if (first < 0)
+                {
+                    first = row;
+                }
+                last = row;
+            }
+        }
+        if (first >= 0)
+        {
+            const QModelIndex system = index(systemRow, 0);
+            emit dataChanged(index(first, NameColumn, system), index(last, NameColumn, system),
+                             QVector<int>() << Qt::DisplayRole);
+        }
+    }
+}
+
+void QGCMAVLinkInspectorModel::setFilter(int sysid, int compid)
+{
+    if (sysid == m_filterSysid && compid == m_filterCompid)
+    {
+        return;
+    }
+    beginResetModel();
+    m_filterSysid = sysid;
+    m_filterCompid = compid;
+    m_systems.clear();
+    m_snapshots.clear();
+    for (SlotState &state : m_slotStates)
+    {
+        state.systemRow = -1;
+        state.row = -1;
+        state.expanded = false;
+    }
+    endResetModel();
+
+    for (int slot = 0; slot < m_slotStates.size(); ++slot)
+    {
+        if (acceptsSlot(slot))
+        {
+            insertSlot(slot);
+        }
+    }
+}
+
+void QGCMAVLinkInspectorModel::clear()
+{
+    beginResetModel();
+    m_systems.clear();
+    m_snapshots.clear();
+    for (int slot = 0; slot < m_slotStates.size(); ++slot)
+    {
+        SlotState &state = m_slotStates[slot];
+        state.clearedCount = m_table.count(slot);
+        state.lastCount = state.clearedCount;
+        state.hz = 0.0f;
+        state.systemRow = -1;
+        state.row = -1;
+        state.expanded = false;
+    }
+    endResetModel();
+}
+
+void QGCMAVLinkInspectorModel::setExpanded(const QModelIndex &index, bool expanded)
+{
+    if (!index.isValid() || index.internalId() == 0 || index.internalId() >= FieldTag)
+    {
+        return;
+    }
+    const int slot = m_systems.at(static_cast<int>(index.internalId() - 1)).messageSlots.at(index.row());
+    m_slotStates[slot].expanded = expanded;
+    if (!expanded)
+    {
+        m_snapshots.remove(slot);
+        return;
+    }
+    updateSnapshot(slot);
+    const QModelIndex message = index.sibling(index.row(), 0);
+    const int fields = rowCount(message);
+    if (fields > 0)
+    {
+        emit dataChanged(this->index(0, ValueColumn, message), this->index(fields - 1, ValueColumn, message),
+                         QVector<int>() << Qt::DisplayRole);
+    }
+}
@@ -0,0 +1,117 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2014 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief QGCMAVLinkInspectorModel
+ *          Tree model (system / message / field) over a MAVLinkMessageSlotTable.
+ *          The table is polled by refresh(), which only signals rows whose
+ *          counters changed. Field values are copied and formatted only for
+ *          expanded messages, and only when the view asks for them.
+ */
+
+#ifndef QGCMAVLINKINSPECTORMODEL_H
+#define QGCMAVLINKINSPECTORMODEL_H
+
+#include "MAVLinkMessageSlotTable.h"
+
+#include <QAbstractItemModel>
+#include <QHash>
+#include <QVector>
+
+class QGCMAVLinkInspectorModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    enum Column
+    {
+        NameColumn = 0,
+        ValueColumn,
+        TypeColumn,
+        ColumnCount
+    };
+
+    explicit QGCMAVLinkInspectorModel(const MAVLinkMessageSlotTable &table, QObject *parent = nullptr);
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    /** @brief True if index is a system or message row, whose first column spans the row */
+    bool isGroupRow(const QModelIndex &index) const;
+
+public slots:
+    /**
+     * @brief refresh - Polls the slot table. New messages are inserted, the
+     *        rate of changed messages and the fields of changed expanded
+     *        messages are signalled with one dataChanged() per range.
+     * @param intervalMsecs Time since the last refresh, used for the rates
+     */
+    void refresh(int intervalMsecs);
+    /** @brief Only show messages of sysid / compid, 0 shows all */
+    void setFilter(int sysid, int compid);
+    /** @brief Hide all messages received so far */
+    void clear();
+    /** @brief Track the expand state of message rows, only their fields get updated */
+    void setExpanded(const QModelIndex &index, bool expanded);
+
+private:
+    struct SlotState
+    {
+        quint64 lastCount = 0;
+        quint64 clearedCount = 0;   ///< Count at the last clear(), the slot is hidden until it grows
+        float hz = 0.0f;
+        int systemRow = -1;         ///< -1 while the slot is not shown
+        int row = -1;
+        bool expanded = false;
+    };
+
+    struct SystemNode
+    {
+        int sysid = 0;
+        QVector<int> messageSlots;  ///< Slot indices sorted by message id
+    };
+
+    bool acceptsSlot(int slot) const;
+    int systemRowFor(int sysid);
+    void insertSlot(int slot);
+    void updateSnapshot(int slot);
+    QString messageName(quint32 msgid) const;
+    QString messageLabel(int slot) const;
+    QVariant fieldData(int slot, int field, int column) const;
+
+    const MAVLinkMessageSlotTable &m_table;
+    QHash<quint32, mavlink_message_info_t> m_messageInfo;
+    QVector<SlotState> m_slotStates;
+    QVector<SystemNode> m_systems;
+    QHash<int, mavlink_message_t> m_snapshots;  ///< Latest copies of the expanded messages
+    int m_filterSysid = 0;
+    int m_filterCompid = 0;
+
+    static constexpr float updateHzLowpass {0.2f}; ///< The low-pass filter value for the frequency of each message
+};
+
+#endif // QGCMAVLINKINSPECTORMODEL_H
@@ -7,6 +7,7 @@
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QDesktopServices>
+#include <QTime>
 
 QGCMAVLinkLogPlayer::QGCMAVLinkLogPlayer(QWidget *parent):
     QWidget(parent),
@@ -15,88 +16,51 @@ QGCMAVLinkLogPlayer::QGCMAVLinkLogPlayer(QWidget *parent):
     ui(new Ui::QGCMAVLinkLogPlayer),
     m_logLink(NULL),
     m_logLoaded(false),
+    m_logDuration(0),
+    m_speedButtonGroup(NULL),
     m_mavlinkDecoder(NULL),
     m_mavlinkInspector(NULL)
 {
     ui->setupUi(this);
     ui->horizontalLayout->setAlignment(Qt::AlignTop);
+    // Slider position is in per mille of the log duration
+    ui->positionSlider->setRange(0, 1000);
 
     connect(ui->selectFileButton, SIGNAL(clicked()), this, SLOT(loadLogButtonClicked()));
     connect(ui->playButton, SIGNAL(clicked()), this, SLOT(playButtonClicked()));
     connect(ui->positionSlider,SIGNAL(sliderReleased()),this,SLOT(positionSliderReleased()));
     connect(ui->positionSlider,SIGNAL(sliderPressed()),this,SLOT(positionSliderPressed()));
 
-    connect(ui->speedButton75,SIGNAL(clicked()),this,SLOT(speed75Clicked()));
-    connect(ui->speedButton100,SIGNAL(clicked()),this,SLOT(speed100Clicked()));
-    connect(ui->speedButton150,SIGNAL(clicked()),this,SLOT(speed150Clicked()));
-    connect(ui->speedButton200,SIGNAL(clicked()),this,SLOT(speed200Clicked()));
-    connect(ui->speedButton500,SIGNAL(clicked()),this,SLOT(speed500Clicked()));
-    connect(ui->speedButton1000,SIGNAL(clicked()),this,SLOT(speed1000Clicked()));
+    // Button ids are the replay speed in percent, 0 replays as fast as possible
+    m_speedButtonGroup = new QButtonGroup(this);
+    m_speedButtonGroup->setExclusive(true);
+    m_speedButtonGroup->addButton(ui->speedButton10, TLogReplayLink::MinSpeed);
+    m_speedButtonGroup->addButton(ui->speedButton75, 75);
+    m_speedButtonGroup->addButton(ui->speedButton100, 100);
+    m_speedButtonGroup->addButton(ui->speedButton150, 150);
+    m_speedButtonGroup->addButton(ui->speedButton200, 200);
+    m_speedButtonGroup->addButton(ui->speedButton500, 500);
+    m_speedButtonGroup->addButton(ui->speedButton1000, 1000);
+    m_speedButtonGroup->addButton(ui->speedButtonMax, 0);
+    connect(m_speedButtonGroup, SIGNAL(buttonClicked(int)), this, SLOT(speedButtonClicked(int)));
 
-    ui->speedButton75->setEnabled(false);
-    ui->speedButton100->setEnabled(false);
-    ui->speedButton150->setEnabled(false);
-    ui->speedButton200->setEnabled(false);
-    ui->speedButton500->setEnabled(false);
-    ui->speedButton1000->setEnabled(false);
-}
-void QGCMAVLinkLogPlayer::speed75Clicked()
-{
-    m_logLink->setSpeed(75);
-    ui->speedButton100->setChecked(false);
-    ui->speedButton150->setChecked(false);
-    ui->speedButton200->setChecked(false);
-    ui->speedButton500->setChecked(false);
-    ui->speedButton1000->setChecked(false);
-}
-
-void QGCMAVLinkLogPlayer::speed100Clicked()
-{
-    ui->speedButton75->setChecked(false);
-    m_logLink->setSpeed(100);
-    ui->speedButton150->setChecked(false);
-    ui->speedButton200->setChecked(false);
-    ui->speedButton500->setChecked(false);
-    ui->speedButton1000->setChecked(false);
+    setSpeedButtonsEnabled(false);
 }
 
-void QGCMAVLinkLogPlayer::speed150Clicked()
+void QGCMAVLinkLogPlayer::setSpeedButtonsEnabled(bool enabled)
 {
-    ui->speedButton75->setChecked(false);
-    ui->speedButton100->setChecked(false);
-    m_logLink->setSpeed(150);
-    ui->speedButton200->setChecked(false);
-    ui->speedButton500->setChecked(false);
-    ui->speedButton1000->setChecked(false);
-}
-
-void QGCMAVLinkLogPlayer::speed200Clicked()
-{
-    ui->speedButton75->setChecked(false);
-    ui->speedButton100->setChecked(false);
-    ui->speedButton150->setChecked(false);
-    m_logLink->setSpeed(200);
-    ui->speedButton500->setChecked(false);
-    ui->speedButton1000->setChecked(false);
+    foreach (QAbstractButton *button, m_speedButtonGroup->buttons())
+    {
+        button->setEnabled(enabled);
+    }
 }
 
-void QGCMAVLinkLogPlayer::speed500Clicked()
-{
-    ui->speedButton75->setChecked(false);
-    ui->speedButton100->setChecked(false);
-    ui->speedButton150->setChecked(false);
-    ui->speedButton200->setChecked(false);
-    m_logLink->setSpeed(500);
-    ui->speedButton1000->setChecked(false);
-}
-void QGCMAVLinkLogPlayer::speed1000Clicked()
+void QGCMAVLinkLogPlayer::speedButtonClicked(int speed)
 {
-    ui->speedButton75->setChecked(false);
-    ui->speedButton100->setChecked(false);
-    ui->speedButton150->setChecked(false);
-    ui->speedButton200->setChecked(false);
-    ui->speedButton500->setChecked(false);
-    m_logLink->setSpeed(1000);
+    if (m_logLink)
+    {
+        m_logLink->setSpeed(speed);
+    }
 }
 
 void QGCMAVLinkLogPlayer::positionSliderReleased()
@@ -104,7 +68,7 @@ void QGCMAVLinkLogPlayer::positionSliderReleased()
     m_sliderDown = false;
     if (m_logLink)
     {
-        m_logLink->setPosition(ui->positionSlider->value());
+        m_logLink->seekToTime((m_logDuration * ui->positionSlider->value()) / 1000);
     }
 }
 
@@ -151,11 +115,7 @@ void QGCMAVLinkLogPlayer::loadLogButtonClicked()
                 m_logLink->deleteLater();
                 m_logLink = 0;
                 m_logLoaded = false;
-                ui->speedButton75->setEnabled(false);
-                ui->speedButton100->setEnabled(false);
-                ui->speedButton150->setEnabled(false);
-                ui->speedButton200->setEnabled(false);
-                ui->speedButton500->setEnabled(false);
+                setSpeedButtonsEnabled(false);
             }
         }
         else
@@ -194,25 +154,29 @@ void QGCMAVLinkLogPlayer::loadLogDialogAccepted()
     connect(m_logLink,SIGNAL(finished()),this,SLOT(logLinkTerminated()));
 
     m_logLink->setLog(fileName);
+    if (m_speedButtonGroup->checkedId() != -1)
+    {
+        m_logLink->setSpeed(m_speedButtonGroup->checkedId());
+    }
     m_logLink->connect();
+    m_isPlaying = true;
+
+    MainWindow::instance()->toolBar().disableConnectWidget(true);
+    MainWindow::instance()->toolBar().overrideDisableConnectWidget(true);
 
    ui->logStatsLabel->setText(fileName.mid(fileName.lastIndexOf("/")+1));
     ui->playButton->setIcon(QIcon(":/files/images/actions/media-playback-stop.svg"));
-    ui->speedButton75->setEnabled(true);
-    ui->speedButton100->setEnabled(true);
-    ui->speedButton150->setEnabled(true);
-    ui->speedButton200->setEnabled(true);
-    ui->speedButton500->setEnabled(true);
-    ui->speedButton1000->setEnabled(true);
+    setSpeedButtonsEnabled(true);
 }
 void QGCMAVLinkLogPlayer::logProgress(qint64 pos,qint64 total)
 {
-    //ui->positionSlider->setValue(((double)pos / (double)total) * 100);
+    m_logDuration = total;
     if (!m_sliderDown)
     {
-        //ui->positionProgressBar->setValue(((double)pos / (double)total) * 100);
-        ui->positionLabel->setText(QString::number(pos) + "/" + QString::number(total));
-        ui->positionSlider->setValue(((double)pos / (double)total) * 100);
+        const QString format = total >= 3600000 ? "h:mm:ss" : "mm:ss";
+        ui->positionLabel->setText(QTime(0, 0).addMSecs(pos).toString(format) + "/"
+                                   + QTime(0, 0).addMSecs(total).toString(format));
+        ui->positionSlider->setValue(total > 0 ? static_cast<int>((pos * 1000) / total) : 0);
     }
 }
 void QGCMAVLinkLogPlayer::setMavlinkDecoder(MAVLinkDecoder *decoder)
@@ -243,17 +207,15 @@ void QGCMAVLinkLogPlayer::playButtonClicked()
 void QGCMAVLinkLogPlayer::logLinkTerminated()
 {
     m_isPlaying = false;
+    MainWindow::instance()->toolBar().overrideDisableConnectWidget(false);
+    MainWindow::instance()->toolBar().disableConnectWidget(false);
     if (m_logLink->toBeDeleted())
     {
         //Log loop has terminated with the intention of unloading the sim link
         m_logLink->deleteLater();
         m_logLink = 0;
         m_logLoaded = false;
-        ui->speedButton75->setEnabled(false);
-        ui->speedButton100->setEnabled(false);
-        ui->speedButton150->setEnabled(false);
-        ui->speedButton200->setEnabled(false);
-        ui->speedButton500->setEnabled(false);
+        setSpeedButtonsEnabled(false);
         emit logFinished();
     }
 }
@@ -5,6 +5,7 @@
 #include "MAVLinkDecoder.h"
 #include "QGCMAVLinkInspector.h"
 
+#include <QButtonGroup>
 #include <QFile>
 #include <QWidget>
 namespace Ui
@@ -46,12 +47,7 @@ public slots:
     void playButtonClicked();
     void logLinkTerminated();
     void speedSliderValueChanged(int value);
-    void speed75Clicked();
-    void speed100Clicked();
-    void speed150Clicked();
-    void speed200Clicked();
-    void speed500Clicked();
-    void speed1000Clicked();
+    void speedButtonClicked(int speed);
 private slots:
     void logProgress(qint64 pos,qint64 total);
     void positionSliderReleased();
@@ -63,11 +59,14 @@ protected:
     void changeEvent(QEvent *e);
 
     void storeSettings();
+    void setSpeedButtonsEnabled(bool enabled);
 
 private:
     Ui::QGCMAVLinkLogPlayer *ui;
     TLogReplayLink *m_logLink;
     bool m_logLoaded;
+    qint64 m_logDuration;
+    QButtonGroup *m_speedButtonGroup;
     MAVLinkDecoder *m_mavlinkDecoder;
     QGCMAVLinkInspector *m_mavlinkInspector;
 signals:
@@ -23,6 +23,7 @@ This file is part of the QGROUNDCONTROL project
 
 #include "QGCStatusBar.h"
 #include "UASManager.h"
+#include "LinkManager.h"
 #include "MainWindow.h"
 
 #include <QLabel>
@@ -37,11 +38,58 @@ QGCStatusBar::QGCStatusBar(QWidget *parent) :
     player(NULL),
     changed(true),
     lastLogDirectory(QGC::MAVLinkLogDirectory()),
-    m_uas(NULL)
+    m_uas(NULL),
+    m_linkStatsLabel(new QLabel(this)),
+    m_lastRxBytes(0),
+    m_lastTxBytes(0),
+    m_lastRxFrames(0),
+    m_lastSequenceGaps(0)
 {
     setObjectName("QGC_STATUSBAR");
 
     connect(UASManager::instance(),SIGNAL(activeUASSet(UASInterface*)),this,SLOT(activeUASSet(UASInterface*)));
+
+    addWidget(m_linkStatsLabel);
+    connect(&m_linkStatsTimer, SIGNAL(timeout()), this, SLOT(updateLinkStatistics()));
+    m_linkStatsTimer.start(1000);
+}
+
+void QGCStatusBar::updateLinkStatistics()
+{
+    MAVLinkProtocol *protocol = LinkManager::instance()->getProtocol();
+    if (!protocol)
+    {
+        return;
+    }
+
+    LinkStatistics sum;
+    foreach (const LinkStatistics &stats, protocol->getLinkStatistics())
+    {
+        sum.rxBytes += stats.rxBytes;
+        sum.txBytes += stats.txBytes;
+        sum.rxFrames += stats.rxFrames;
+        sum.crcErrors += stats.crcErrors;
+        sum.sequenceGaps += stats.sequenceGaps;
+    }
+    if (sum.rxFrames == 0)
+    {
+        m_linkStatsLabel->clear();
+        return;
+    }
+
+    // Timer runs at 1Hz, so the deltas are per second
+    const quint64 frames = sum.rxFrames - qMin(m_lastRxFrames, sum.rxFrames);
+    const quint64 gaps = sum.sequenceGaps - qMin(m_lastSequenceGaps, sum.sequenceGaps);
+    const double loss = (frames + gaps) > 0 ? (100.0 * gaps) / (frames + gaps) : 0.0;
+    m_linkStatsLabel->setText(tr("RX %1 kB/s  TX %2 kB/s  Loss %3%  CRC errors %4")
+                              .arg((sum.rxBytes - qMin(m_lastRxBytes, sum.rxBytes)) / 1024.0, 0, 'f', 1)
+                              .arg((sum.txBytes - qMin(m_lastTxBytes, sum.txBytes)) / 1024.0, 0, 'f', 1)
+                              .arg(loss, 0, 'f', 1)
+                              .arg(sum.crcErrors));
+    m_lastRxBytes = sum.rxBytes;
+    m_lastTxBytes = sum.txBytes;
+    m_lastRxFrames = sum.rxFrames;
+    m_lastSequenceGaps = sum.sequenceGaps;
 }
 
 void QGCStatusBar::uasConnected()
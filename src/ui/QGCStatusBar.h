@@ -30,6 +30,7 @@ This file is part of the QGROUNDCONTROL project
 #include <QPushButton>
 #include <QLabel>
 #include <QProgressBar>
+#include <QTimer>
 #include "UASInterface.h"
 #include "QGCMAVLinkLogPlayer.h"
 #include "MAVLinkDecoder.h"
@@ -55,6 +56,7 @@ private slots:
         void activeUASSet(UASInterface* uas);
         void uasConnected();
         void uasDisconnected();
+        void updateLinkStatistics();
 protected:
     void storeSettings();
     void loadSettings();
@@ -65,6 +67,12 @@ protected:
     QString lastLogDirectory;
 private:
     UASInterface *m_uas;
+    QLabel *m_linkStatsLabel;
+    QTimer m_linkStatsTimer;
+    quint64 m_lastRxBytes;
+    quint64 m_lastTxBytes;
+    quint64 m_lastRxFrames;
+    quint64 m_lastSequenceGaps;
 };
 
 #endif // QGCSTATUSBAR_H
@@ -0,0 +1,112 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2014 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+#include "logging.h"
+#include "SrtmElevationData.h"
+#include "SrtmTileCache.h"
+#include "MissionStore.h"
+#include "Waypoint.h"
+
+SrtmElevationData::SrtmElevationData(QObject *parent) :
+    QObject(parent),
+    m_tileCache(SrtmTileCache::instance())
+{
+}
+
+void SrtmElevationData::requestElevationData(const QList<Waypoint *> &waypointList, int distance, int samples)
+{
+    Q_UNUSED(distance)
+
+    if (waypointList.count() < 2){
+        QLOG_ERROR() << "Not enough waypoints to request elevation data.";
+        emit waypointCountToLow();
+        return;
+    }
+
+    if ((waypointList.at(0)->getLatitude() == 0.0)
+       &&(waypointList.at(0)->getLongitude() == 0.0)){
+       QLOG_ERROR() << "Need valid home location.";
+       emit invalidHomeLocation();
+    }
+
+    QVector<double> latitudes;
+    QVector<double> longitudes;
+    densifyPath(waypointList, qMax(samples, 2), latitudes, longitudes);
+
+    const QStringList missing = m_tileCache->missingTiles(latitudes, longitudes);
+    if (!missing.isEmpty()){
+        QLOG_WARN() << "Missing terrain tiles" << missing;
+        emit tilesMissing(missing, m_tileCache->tileDirectory());
+    }
+
+    const QVector<double> heights = m_tileCache->elevations(latitudes, longitudes);
+
+    QList<Waypoint*> elevationWaypoints;
+    double averageResolution = 0.0;
+    for (int i = 0; i < heights.size(); i++){
+        if (qIsNaN(heights.at(i))){
+            continue;
+        }
+        Waypoint* wp = new Waypoint(elevationWaypoints.count(), latitudes.at(i), longitudes.at(i), heights.at(i),
+                                    0.0,0.0,0.0,0.0,true,false,MAV_FRAME_GLOBAL);
+        elevationWaypoints.append(wp);
+        averageResolution += m_tileCache->resolution(latitudes.at(i), longitudes.at(i));
+    }
+    if (elevationWaypoints.isEmpty()){
+        return;
+    }
+    averageResolution = averageResolution/elevationWaypoints.count();
+    emit elevationDataReady(elevationWaypoints, averageResolution);
+}
+
+void SrtmElevationData::densifyPath(const QList<Waypoint *> &waypointList, int samples,
+                                    QVector<double> &latitudes, QVector<double> &longitudes)
+{
+    latitudes.clear();
+    longitudes.clear();
+    if (waypointList.isEmpty() || samples < 2){
+        return;
+    }
+
+    QVector<double> legEnds(waypointList.count(), 0.0);
+    for (int i = 1; i < waypointList.count(); i++){
+        legEnds[i] = legEnds[i - 1] + MissionStore::distanceBetween(
+                    waypointList.at(i - 1)->getLatitude(), waypointList.at(i - 1)->getLongitude(),
+                    waypointList.at(i)->getLatitude(), waypointList.at(i)->getLongitude());
+    }
+
+    latitudes.reserve(samples);
+    longitudes.reserve(samples);
+    const double step = legEnds.last() / (samples - 1);
+    int leg = 1;
+    for (int i = 0; i < samples; i++){
+        const double along = (i == samples - 1) ? legEnds.last() : i * step;
+        while (leg < waypointList.count() - 1 && along > legEnds.at(leg)){
+            leg++;
+        }
+        const Waypoint* from = waypointList.at(qMax(leg - 1, 0));
+        const Waypoint* to = waypointList.at(qMin(leg, waypointList.count() - 1));
+        const double legLength = legEnds.at(qMin(leg, waypointList.count() - 1)) - legEnds.at(qMax(leg - 1, 0));
+        const double fraction = legLength > 0.0 ? (along - legEnds.at(qMax(leg - 1, 0))) / legLength : 0.0;
+        latitudes.append(from->getLatitude() + fraction * (to->getLatitude() - from->getLatitude()));
+        longitudes.append(from->getLongitude() + fraction * (to->getLongitude() - from->getLongitude()));
+    }
+}
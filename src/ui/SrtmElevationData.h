@@ -0,0 +1,62 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2014 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+#ifndef SRTMELEVATIONDATA_H
+#define SRTMELEVATIONDATA_H
+
+#include <QObject>
+#include <QStringList>
+#include <QVector>
+
+class Waypoint;
+class SrtmTileCache;
+
+/**
+ * @brief Elevation profile of a mission from local SRTM tiles
+ *
+ * Offline replacement of GoogleElevationData with the same request and
+ * signals. The path is sampled at equal distances in one call to the
+ * tile cache, the result is emitted before requestElevationData() returns.
+ */
+class SrtmElevationData : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SrtmElevationData(QObject *parent = 0);
+
+    void requestElevationData(const QList<Waypoint *> &waypointList, int distance, int samples);
+
+    /** @brief Points at equal distances along a path, the first and last point are the ends of the path */
+    static void densifyPath(const QList<Waypoint *> &waypointList, int samples,
+                            QVector<double> &latitudes, QVector<double> &longitudes);
+
+signals:
+    void elevationDataReady(const QList<Waypoint *> waypointList, double averageResolution);
+    void tilesMissing(const QStringList &tileNames, const QString &directory);
+
+    void waypointCountToLow();
+    void invalidHomeLocation();
+
+private:
+    SrtmTileCache *m_tileCache;
+};
+
+#endif // SRTMELEVATIONDATA_H
@@ -0,0 +1,266 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2014 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+#include "logging.h"
+#include "configuration.h"
+#include "SrtmTileCache.h"
+
+#include <QDir>
+#include <QSet>
+#include <QSettings>
+#include <QtEndian>
+#include <qmath.h>
+#include <limits>
+
+static const QString TerrainDirectoryKey = "TERRAIN_TILE_DIRECTORY";
+static const qint16 SrtmVoid = -32768;
+static const double MetersPerDegree = 111195.0; // of latitude
+
+SrtmTileCache *SrtmTileCache::instance()
+{
+    static SrtmTileCache cache(QSettings().value(TerrainDirectoryKey,
+                                                 QGC::appDataDirectory() + "/terrain").toString());
+    return &cache;
+}
+
+SrtmTileCache::SrtmTileCache(const QString &directory) :
+    m_directory(directory),
+    m_useCounter(0)
+{
+}
+
+QString SrtmTileCache::tileDirectory() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_directory;
+}
+
+void SrtmTileCache::setTileDirectory(const QString &directory)
+{
+    QMutexLocker locker(&m_mutex);
+    if (directory == m_directory)
+    {
+        // Tiles may have been copied into the directory meanwhile, look for them again
+        for (QHash<qint32, QSharedPointer<Tile> >::iterator i = m_tiles.begin(); i != m_tiles.end(); )
+        {
+            if (i.value())
+            {
+                ++i;
+            }
+            else
+            {
+                i = m_tiles.erase(i);
+            }
+        }
+        return;
+    }
+    m_directory = directory;
+    m_tiles.clear();
+    if (this == instance())
+    {
+        QSettings().setValue(TerrainDirectoryKey, directory);
+    }
+}
+
+double SrtmTileCache::elevation(double latitude, double longitude)
+{
+    QSharedPointer<const Tile> found = tile(latitude, longitude);
+    return found ? found->sample(latitude, longitude) : std::numeric_limits<double>::quiet_NaN();
+}
+
+QVector<double> SrtmTileCache::elevations(const QVector<double> &latitudes, const QVector<double> &longitudes)
+{
+    Q_ASSERT(latitudes.size() == longitudes.size());
+    QVector<double> heights(latitudes.size(), std::numeric_limits<double>::quiet_NaN());
+
+    QSharedPointer<const Tile> current;
+    qint32 currentKey = -1;
+    for (int i = 0; i < latitudes.size(); i++)
+    {
+        const double latitude = latitudes.at(i);
+        const double longitude = longitudes.at(i);
+        if (!(latitude >= -90.0 && latitude < 90.0 && longitude >= -180.0 && longitude < 180.0))
+        {
+            continue;
+        }
+        const qint32 key = tileKey(qFloor(latitude), qFloor(longitude));
+        if (key != currentKey)
+        {
+            current = tile(latitude, longitude);
+            currentKey = key;
+        }
+        if (current)
+        {
+            heights[i] = current->sample(latitude, longitude);
+        }
+    }
+    return heights;
+}
+
+double SrtmTileCache::resolution(double latitude, double longitude)
+{
+    QSharedPointer<const Tile> found = tile(latitude, longitude);
+    return found ? MetersPerDegree / (found->size - 1) : 0.0;
+}
+
+QStringList SrtmTileCache::missingTiles(const QVector<double> &latitudes, const QVector<double> &longitudes)
+{
+    QStringList missing;
+    QSet<qint32> checked;
+    for (int i = 0; i < latitudes.size(); i++)
+    {
+        const int south = qFloor(latitudes.at(i));
+        const int west = qFloor(longitudes.at(i));
+        if (checked.contains(tileKey(south, west)))
+        {
+            continue;
+        }
+        checked.insert(tileKey(south, west));
+        if (!tile(latitudes.at(i), longitudes.at(i)))
+        {
+            missing.append(tileName(south, west));
+        }
+    }
+    return missing;
+}
+
+QString SrtmTileCache::tileName(int latitude, int longitude)
+{
+    return QString("%1%2%3%4.hgt").arg(latitude < 0 ? 'S' : 'N').arg(qAbs(latitude), 2, 10, QChar('0'))
+            .arg(longitude < 0 ? 'W' : 'E').arg(qAbs(longitude), 3, 10, QChar('0'));
+}
+
+qint32 SrtmTileCache::tileKey(int latitude, int longitude)
+{
+    return (latitude + 90) * 360 + (longitude + 180);
+}
+
+QSharedPointer<const SrtmTileCache::Tile> SrtmTileCache::tile(double latitude, double longitude)
+{
+    const int south = qFloor(latitude);
+    const int west = qFloor(longitude);
+    const qint32 key = tileKey(south, west);
+
+    QMutexLocker locker(&m_mutex);
+    QHash<qint32, QSharedPointer<Tile> >::iterator cached = m_tiles.find(key);
+    if (cached != m_tiles.end())
+    {
+        if (cached.value())
+        {
+            cached.value()->lastUse = ++m_useCounter;
+        }
+        return cached.value();
+    }
+
+    QSharedPointer<Tile> loaded(new Tile);
+    loaded->south = south;
+    loaded->west = west;
+    const QString name = tileName(south, west);
+    loaded->file.setFileName(QDir(m_directory).filePath(name));
+    if (!loaded->file.exists())
+    {
+        loaded->file.setFileName(QDir(m_directory).filePath(name.toLower()));
+    }
+
+    const qint64 fileSize = loaded->file.size();
+    const int size = qRound(qSqrt(fileSize / 2));
+    if (!loaded->file.exists())
+    {
+        loaded.clear();
+    }
+    else if (size < 2 || static_cast<qint64>(size) * size * 2 != fileSize)
+    {
+        QLOG_WARN() << "Terrain tile" << loaded->file.fileName() << "has an unknown size of" << fileSize << "bytes";
+        loaded.clear();
+    }
+    else if (!loaded->file.open(QIODevice::ReadOnly)
+             || !(loaded->heights = loaded->file.map(0, fileSize)))
+    {
+        QLOG_WARN() << "Cannot map terrain tile" << loaded->file.fileName() << loaded->file.errorString();
+        loaded.clear();
+    }
+    else
+    {
+        loaded->size = size;
+        loaded->lastUse = ++m_useCounter;
+        QLOG_DEBUG() << "Mapped terrain tile" << loaded->file.fileName() << size << "posts";
+    }
+    m_tiles.insert(key, loaded);
+
+    // Unmap the least recently used tile, it stays valid for samplers still holding it
+    int mapped = 0;
+    QHash<qint32, QSharedPointer<Tile> >::iterator oldest = m_tiles.end();
+    for (QHash<qint32, QSharedPointer<Tile> >::iterator i = m_tiles.begin(); i != m_tiles.end(); ++i)
+    {
+        if (!i.value())
+        {
+            continue;
+        }
+        mapped++;
+        if (oldest == m_tiles.end() || i.value()->lastUse < oldest.value()->lastUse)
+        {
+            oldest = i;
+        }
+    }
+    if (mapped > s_maxMappedTiles)
+    {
+        m_tiles.erase(oldest);
+    }
+    return loaded;
+}
+
+SrtmTileCache::Tile::~Tile()
+{
+    if (heights)
+    {
+        file.unmap(const_cast<uchar *>(heights));
+    }
+}
+
+double SrtmTileCache::Tile::sample(double latitude, double longitude) const
+{
+    // Rows run from north to south, columns from west to east
+    const double row = (south + 1 - latitude) * (size - 1);
+    const double column = (longitude - west) * (size - 1);
+    const int row0 = qBound(0, static_cast<int>(row), size - 2);
+    const int column0 = qBound(0, static_cast<int>(column), size - 2);
+    const double rowFraction = row - row0;
+    const double columnFraction = column - column0;
+
+    // Bilinear between the four surrounding posts, voids are left out of the weighting
+    double sum = 0.0;
+    double weights = 0.0;
+    for (int r = 0; r < 2; r++)
+    {
+        for (int c = 0; c < 2; c++)
+        {
+            const qint16 height = qFromBigEndian<qint16>(heights + 2 * ((row0 + r) * size + column0 + c));
+            if (height == SrtmVoid)
+            {
+                continue;
+            }
+            const double weight = (r ? rowFraction : 1.0 - rowFraction) * (c ? columnFraction : 1.0 - columnFraction);
+            sum += weight * height;
+            weights += weight;
+        }
+    }
+    return weights > 0.0 ? sum / weights : std::numeric_limits<double>::quiet_NaN();
+}
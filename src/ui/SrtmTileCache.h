@@ -0,0 +1,110 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2014 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Terrain elevation from SRTM .hgt tiles on disk
+ *
+ *   A tile covers one degree of latitude and longitude and is named after its
+ *   south west corner, e.g. N47E008.hgt. It holds a square grid of big endian
+ *   16 bit heights in meters, rows from north to south, 1201 posts per side for
+ *   SRTM3 (3 arc seconds) and 3601 for SRTM1. Tiles are memory mapped when first
+ *   sampled and kept mapped, least recently used tiles are unmapped when more
+ *   than s_maxMappedTiles are in use.
+ *
+ *   The cache may be used from several threads at once.
+ */
+
+#ifndef SRTMTILECACHE_H
+#define SRTMTILECACHE_H
+
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVector>
+
+class SrtmTileCache
+{
+public:
+    /** @brief The cache of the tiles in the terrain directory of the settings */
+    static SrtmTileCache *instance();
+
+    explicit SrtmTileCache(const QString &directory);
+
+    QString tileDirectory() const;
+    /**
+     * @brief Change the directory tiles are read from, unmaps all tiles
+     *
+     * Setting the current directory again keeps the mapped tiles but forgets
+     * which tiles were missing, so tiles copied there meanwhile are found.
+     */
+    void setTileDirectory(const QString &directory);
+
+    /** @brief Terrain height in meters above mean sea level, NaN if there is no data */
+    double elevation(double latitude, double longitude);
+
+    /**
+     * @brief Terrain heights of many points in one call
+     *
+     * Consecutive points on the same tile share one tile lookup, so sampling a
+     * path costs about one cache access per tile crossed.
+     */
+    QVector<double> elevations(const QVector<double> &latitudes, const QVector<double> &longitudes);
+
+    /** @brief Distance between height posts in meters at a location, 0 if there is no tile */
+    double resolution(double latitude, double longitude);
+
+    /** @brief Names of the tiles needed for the points which are not in the tile directory */
+    QStringList missingTiles(const QVector<double> &latitudes, const QVector<double> &longitudes);
+
+    static QString tileName(int latitude, int longitude);
+
+private:
+    static const int s_maxMappedTiles = 16;
+
+    class Tile
+    {
+    public:
+        ~Tile();
+        double sample(double latitude, double longitude) const;
+
+        QFile file;
+        const uchar *heights = nullptr;
+        int size = 0;           ///< Posts per side
+        int south = 0;          ///< Latitude of the southern edge
+        int west = 0;           ///< Longitude of the western edge
+        quint64 lastUse = 0;
+    };
+
+    static qint32 tileKey(int latitude, int longitude);
+    /** @brief The mapped tile containing a point, null if it is not available */
+    QSharedPointer<const Tile> tile(double latitude, double longitude);
+
+    mutable QMutex m_mutex;
+    QString m_directory;
+    QHash<qint32, QSharedPointer<Tile> > m_tiles;   ///< Tiles not on disk are kept as null
+    quint64 m_useCounter;
+};
+
+#endif // SRTMTILECACHE_H
@@ -0,0 +1,229 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2014 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+#include "logging.h"
+#include "TerrainFollowingPlanner.h"
+#include "SrtmTileCache.h"
+#include "QGCMAVLink.h"
+
+#include <QRunnable>
+#include <QThreadPool>
+#include <qmath.h>
+#include <limits>
+
+static const int ProgressInterval = 100; // ms
+static const int MaxSamplesPerLeg = 100000;
+
+/**
+ * @brief LegSampler - Samples a range of consecutive legs. Each leg is written
+ *        to its own slot of the planner, so the samplers need no locking.
+ */
+class LegSampler : public QRunnable
+{
+public:
+    LegSampler(TerrainFollowingPlanner *planner, int first, int last) :
+        mp_planner(planner),
+        m_first(first),
+        m_last(last)
+    {
+        setAutoDelete(true);
+    }
+
+    void run() override
+    {
+        for (int leg = m_first; leg < m_last; ++leg) {
+            if (mp_planner->m_cancelled.loadAcquire())
+                return;
+            mp_planner->sampleLeg(leg);
+            mp_planner->m_legsDone.fetchAndAddRelease(1);
+        }
+    }
+
+private:
+    TerrainFollowingPlanner *mp_planner;
+    int m_first;
+    int m_last;
+};
+
+TerrainFollowingPlanner::TerrainFollowingPlanner(const MissionStore &mission, double clearance,
+                                                 double sampleSpacing, QObject *parent) :
+    QThread(parent),
+    m_mission(mission),
+    m_clearance(clearance),
+    m_sampleSpacing(qMax(sampleSpacing, 1.0)),
+    m_homeAltitude(mission.count() > 0 ? mission.altitudes().at(0) : 0.0),
+    m_pathIndices(mission.indices(MissionStore::GlobalFramePathView)),
+    m_legsDone(0),
+    m_cancelled(0)
+{
+    m_legs.resize(qMax(m_pathIndices.size() - 1, 0));
+    for (int leg = 0; leg < m_legs.size(); ++leg) {
+        m_legs[leg].from = m_pathIndices.at(leg);
+        m_legs[leg].to = m_pathIndices.at(leg + 1);
+    }
+}
+
+TerrainFollowingPlanner::~TerrainFollowingPlanner()
+{
+    cancel();
+    wait();
+}
+
+void TerrainFollowingPlanner::cancel()
+{
+    m_cancelled.storeRelease(1);
+}
+
+double TerrainFollowingPlanner::minClearance() const
+{
+    double lowest = std::numeric_limits<double>::quiet_NaN();
+    foreach (const LegClearance &leg, m_legs) {
+        if (!qIsNaN(leg.minClearance) && (qIsNaN(lowest) || leg.minClearance < lowest))
+            lowest = leg.minClearance;
+    }
+    return lowest;
+}
+
+double TerrainFollowingPlanner::altitudeAmsl(int index, double terrain) const
+{
+    const double altitude = m_mission.altitudes().at(index);
+    if (index == 0)
+        return altitude; // Waypoint 0 is HOME, the base of relative altitudes
+
+    switch (m_mission.frames().at(index)) {
+    case MAV_FRAME_GLOBAL_RELATIVE_ALT:
+    case MAV_FRAME_GLOBAL_RELATIVE_ALT_INT:
+        return altitude + m_homeAltitude;
+    case MAV_FRAME_GLOBAL_TERRAIN_ALT:
+    case MAV_FRAME_GLOBAL_TERRAIN_ALT_INT:
+        return altitude + terrain;
+    default:
+        return altitude;
+    }
+}
+
+void TerrainFollowingPlanner::sampleLeg(int leg)
+{
+    LegClearance &result = m_legs[leg];
+    const int from = result.from;
+    const int to = result.to;
+    const double fromLat = m_mission.latitudes().at(from);
+    const double fromLon = m_mission.longitudes().at(from);
+    const double toLat = m_mission.latitudes().at(to);
+    const double toLon = m_mission.longitudes().at(to);
+    const double fromAlt = altitudeAmsl(from, m_waypointTerrain.at(leg));
+    const double toAlt = altitudeAmsl(to, m_waypointTerrain.at(leg + 1));
+
+    const double length = MissionStore::distanceBetween(fromLat, fromLon, toLat, toLon);
+    const int samples = qBound(2, qCeil(length / m_sampleSpacing) + 1, MaxSamplesPerLeg);
+    QVector<double> latitudes(samples);
+    QVector<double> longitudes(samples);
+    for (int i = 0; i < samples; ++i) {
+        const double fraction = static_cast<double>(i) / (samples - 1);
+        latitudes[i] = fromLat + fraction * (toLat - fromLat);
+        longitudes[i] = fromLon + fraction * (toLon - fromLon);
+    }
+    const QVector<double> terrain = SrtmTileCache::instance()->elevations(latitudes, longitudes);
+
+    result.samples = 0;
+    result.maxTerrain = std::numeric_limits<double>::quiet_NaN();
+    result.minClearance = std::numeric_limits<double>::quiet_NaN();
+    for (int i = 0; i < samples; ++i) {
+        if (qIsNaN(terrain.at(i)))
+            continue;
+        const double fraction = static_cast<double>(i) / (samples - 1);
+        const double clearance = fromAlt + fraction * (toAlt - fromAlt) - terrain.at(i);
+        if (result.samples == 0 || terrain.at(i) > result.maxTerrain)
+            result.maxTerrain = terrain.at(i);
+        if (result.samples == 0 || clearance < result.minClearance)
+            result.minClearance = clearance;
+        result.samples++;
+    }
+}
+
+void TerrainFollowingPlanner::run()
+{
+    const int legCount = m_legs.size();
+    m_legsDone.storeRelease(0);
+    m_followingAltitudes.fill(std::numeric_limits<double>::quiet_NaN(), m_pathIndices.size());
+
+    // Terrain under the waypoints, needed for terrain relative frames
+    QVector<double> latitudes;
+    QVector<double> longitudes;
+    latitudes.reserve(m_pathIndices.size());
+    longitudes.reserve(m_pathIndices.size());
+    foreach (int index, m_pathIndices) {
+        latitudes.append(m_mission.latitudes().at(index));
+        longitudes.append(m_mission.longitudes().at(index));
+    }
+    m_waypointTerrain = SrtmTileCache::instance()->elevations(latitudes, longitudes);
+
+    // Several batches per thread keep the threads busy when legs differ in length
+    QThreadPool pool;
+    const int batchSize = qMax(1, legCount / (qMax(1, QThread::idealThreadCount()) * 8));
+    for (int first = 0; first < legCount; first += batchSize) {
+        pool.start(new LegSampler(this, first, qMin(first + batchSize, legCount)));
+    }
+    while (!pool.waitForDone(ProgressInterval)) {
+        emit progress(m_legsDone.loadAcquire(), legCount);
+    }
+    emit progress(m_legsDone.loadAcquire(), legCount);
+
+    if (m_cancelled.loadAcquire()) {
+        QLOG_DEBUG() << "Terrain following planning cancelled";
+        emit planningFinished(false);
+        return;
+    }
+
+    for (int i = 0; i < m_pathIndices.size(); ++i) {
+        const int index = m_pathIndices.at(i);
+        if (index == 0)
+            continue; // HOME keeps its altitude
+
+        double highest = std::numeric_limits<double>::quiet_NaN();
+        if (i > 0 && !qIsNaN(m_legs.at(i - 1).maxTerrain))
+            highest = m_legs.at(i - 1).maxTerrain;
+        if (i < legCount && !qIsNaN(m_legs.at(i).maxTerrain)
+                && (qIsNaN(highest) || m_legs.at(i).maxTerrain > highest))
+            highest = m_legs.at(i).maxTerrain;
+        if (qIsNaN(highest))
+            continue;
+
+        const double amsl = highest + m_clearance;
+        switch (m_mission.frames().at(index)) {
+        case MAV_FRAME_GLOBAL_RELATIVE_ALT:
+        case MAV_FRAME_GLOBAL_RELATIVE_ALT_INT:
+            m_followingAltitudes[i] = amsl - m_homeAltitude;
+            break;
+        case MAV_FRAME_GLOBAL_TERRAIN_ALT:
+        case MAV_FRAME_GLOBAL_TERRAIN_ALT_INT:
+            if (!qIsNaN(m_waypointTerrain.at(i)))
+                m_followingAltitudes[i] = amsl - m_waypointTerrain.at(i);
+            break;
+        default:
+            m_followingAltitudes[i] = amsl;
+            break;
+        }
+    }
+
+    QLOG_DEBUG() << "Terrain following planned" << legCount << "legs, lowest clearance" << minClearance();
+    emit planningFinished(true);
+}
@@ -0,0 +1,108 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2014 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+#ifndef TERRAINFOLLOWINGPLANNER_H
+#define TERRAINFOLLOWINGPLANNER_H
+
+#include "MissionStore.h"
+
+#include <QAtomicInt>
+#include <QThread>
+#include <QVector>
+
+/**
+ * @brief Terrain clearance and terrain following altitudes of a mission
+ *
+ * Every leg of the flight path is sampled against the local SRTM tiles at
+ * sampleSpacing meters, so ridges between waypoints are not missed. The legs
+ * are spread over a thread pool, the planner thread itself only reports the
+ * progress. Results are read after planningFinished() was emitted.
+ *
+ * The following altitude of a waypoint keeps the clearance above the highest
+ * terrain of both legs it ends or starts, so the straight legs between the new
+ * altitudes never come closer to the ground than the clearance.
+ */
+class TerrainFollowingPlanner : public QThread
+{
+    Q_OBJECT
+public:
+    struct LegClearance
+    {
+        int from = -1;              ///< Mission index of the start of the leg
+        int to = -1;                ///< Mission index of the end of the leg
+        int samples = 0;            ///< Terrain samples with data along the leg
+        double maxTerrain = 0.0;    ///< Highest terrain under the leg in meters AMSL, NaN without data
+        double minClearance = 0.0;  ///< Lowest height of the planned path above the terrain, NaN without data
+    };
+
+    TerrainFollowingPlanner(const MissionStore &mission, double clearance, double sampleSpacing,
+                            QObject *parent = 0);
+    ~TerrainFollowingPlanner();
+
+    /** @brief Stop after the legs in progress, planningFinished() reports false */
+    void cancel();
+
+    const QVector<LegClearance> &legs() const {
+        return m_legs;
+    }
+    /** @brief The copy of the mission that was planned */
+    const MissionStore &mission() const {
+        return m_mission;
+    }
+    /** @brief Mission indices of the items on the flight path */
+    const QVector<int> &waypointIndices() const {
+        return m_pathIndices;
+    }
+    /** @brief New altitude of every path item in its own frame, NaN to keep the current one */
+    const QVector<double> &followingAltitudes() const {
+        return m_followingAltitudes;
+    }
+    /** @brief Lowest clearance of the whole path, NaN without terrain data */
+    double minClearance() const;
+
+signals:
+    void progress(int legsDone, int legCount);
+    void planningFinished(bool completed);
+
+protected:
+    void run();
+
+private:
+    friend class LegSampler;
+
+    double altitudeAmsl(int index, double terrain) const;
+    void sampleLeg(int leg);
+
+    MissionStore m_mission;
+    double m_clearance;
+    double m_sampleSpacing;
+    double m_homeAltitude;
+
+    QVector<int> m_pathIndices;
+    QVector<LegClearance> m_legs;
+    QVector<double> m_waypointTerrain;      ///< Terrain under each path item, NaN without data
+    QVector<double> m_followingAltitudes;
+
+    QAtomicInt m_legsDone;
+    QAtomicInt m_cancelled;
+};
+
+#endif // TERRAINFOLLOWINGPLANNER_H
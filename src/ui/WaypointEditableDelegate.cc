@@ -0,0 +1,119 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2014 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+#include "WaypointEditableDelegate.h"
+#include "WaypointEditableModel.h"
+
+#include <QComboBox>
+#include <QDoubleSpinBox>
+
+WaypointEditableDelegate::WaypointEditableDelegate(QObject *parent) :
+    QStyledItemDelegate(parent)
+{
+}
+
+QWidget *WaypointEditableDelegate::createEditor(QWidget *parent, const QStyleOptionViewItem &option,
+                                                const QModelIndex &index) const
+{
+    switch (index.column())
+    {
+    case WaypointEditableModel::CommandColumn:
+    case WaypointEditableModel::FrameColumn:
+    {
+        const QList<WaypointEditableModel::Choice> &choices =
+                (index.column() == WaypointEditableModel::CommandColumn)
+                ? WaypointEditableModel::commandChoices() : WaypointEditableModel::frameChoices();
+        QComboBox *combo = new QComboBox(parent);
+        for (const WaypointEditableModel::Choice &choice : choices)
+        {
+            combo->addItem(choice.first, choice.second);
+        }
+        return combo;
+    }
+    case WaypointEditableModel::Param1Column:
+    case WaypointEditableModel::Param2Column:
+    case WaypointEditableModel::Param3Column:
+    case WaypointEditableModel::Param4Column:
+    case WaypointEditableModel::LatitudeColumn:
+    case WaypointEditableModel::LongitudeColumn:
+    case WaypointEditableModel::AltitudeColumn:
+    {
+        QDoubleSpinBox *spin = new QDoubleSpinBox(parent);
+        spin->setFrame(false);
+        spin->setRange(-1e7, 1e7);
+        if (index.column() == WaypointEditableModel::LatitudeColumn
+                || index.column() == WaypointEditableModel::LongitudeColumn)
+        {
+            spin->setDecimals(7);
+        }
+        else
+        {
+            spin->setDecimals(4);
+        }
+        return spin;
+    }
+    default:
+        return QStyledItemDelegate::createEditor(parent, option, index);
+    }
+}
+
+void WaypointEditableDelegate::setEditorData(QWidget *editor, const QModelIndex &index) const
+{
+    const QVariant value = index.data(Qt::EditRole);
+    if (QComboBox *combo = qobject_cast<QComboBox*>(editor))
+    {
+        int item = combo->findData(value.toInt());
+        if (item < 0)
+        {
+            // A command loaded from a file that the editor does not offer
+            combo->addItem(QString::number(value.toInt()), value.toInt());
+            item = combo->count() - 1;
+        }
+        combo->setCurrentIndex(item);
+    }
+    else if (QDoubleSpinBox *spin = qobject_cast<QDoubleSpinBox*>(editor))
+    {
+        spin->setValue(value.toDouble());
+    }
+    else
+    {
+        QStyledItemDelegate::setEditorData(editor, index);
+    }
+}
+
+void WaypointEditableDelegate::setModelData(QWidget *editor, QAbstractItemModel *model,
+                                            const QModelIndex &index) const
+{
+    if (QComboBox *combo = qobject_cast<QComboBox*>(editor))
+    {
+        model->setData(index, combo->currentData(), Qt::EditRole);
+    }
+    else if (QDoubleSpinBox *spin = qobject_cast<QDoubleSpinBox*>(editor))
+    {
+        spin->interpretText();
+        model->setData(index, spin->value(), Qt::EditRole);
+    }
+    else
+    {
+        QStyledItemDelegate::setModelData(editor, model, index);
+    }
+}
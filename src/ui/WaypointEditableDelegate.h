@@ -0,0 +1,49 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2014 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief WaypointEditableDelegate
+ *          Editors for the cells of a WaypointEditableModel. Only the cell
+ *          being edited gets a widget, combo boxes for command and frame and
+ *          spin boxes for the parameters.
+ */
+
+#ifndef WAYPOINTEDITABLEDELEGATE_H
+#define WAYPOINTEDITABLEDELEGATE_H
+
+#include <QStyledItemDelegate>
+
+class WaypointEditableDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+
+public:
+    explicit WaypointEditableDelegate(QObject *parent = nullptr);
+
+    QWidget *createEditor(QWidget *parent, const QStyleOptionViewItem &option,
+                          const QModelIndex &index) const override;
+    void setEditorData(QWidget *editor, const QModelIndex &index) const override;
+    void setModelData(QWidget *editor, QAbstractItemModel *model, const QModelIndex &index) const override;
+};
+
+#endif // WAYPOINTEDITABLEDELEGATE_H
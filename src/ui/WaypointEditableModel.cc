@@ -0,0 +1,459 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2014 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+#include "WaypointEditableModel.h"
+#include "UASWaypointManager.h"
+#include "Waypoint.h"
+
+WaypointEditableModel::WaypointEditableModel(QObject *parent) :
+    QAbstractTableModel(parent)
+{
+}
+
+void WaypointEditableModel::setWaypointManager(UASWaypointManager *wpm)
+{
+    if (m_wpm == wpm)
+    {
+        return;
+    }
+
+    beginResetModel();
+    if (m_wpm)
+    {
+        disconnect(m_wpm, SIGNAL(waypointEditableListChanged(void)), this, SLOT(waypointListChanged()));
+        disconnect(m_wpm, SIGNAL(waypointEditableChanged(int,Waypoint*)), this, SLOT(waypointChanged(int,Waypoint*)));
+    }
+    m_wpm = wpm;
+    m_rows.clear();
+    if (m_wpm)
+    {
+        m_rows = m_wpm->getWaypointEditableList().toVector();
+        connect(m_wpm, SIGNAL(waypointEditableListChanged(void)), this, SLOT(waypointListChanged()));
+        connect(m_wpm, SIGNAL(waypointEditableChanged(int,Waypoint*)), this, SLOT(waypointChanged(int,Waypoint*)));
+    }
+    endResetModel();
+}
+
+Waypoint *WaypointEditableModel::waypointAt(int row) const
+{
+    if (row < 0 || row >= m_rows.size())
+    {
+        return nullptr;
+    }
+    return m_rows.at(row);
+}
+
+int WaypointEditableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rows.size();
+}
+
+int WaypointEditableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant WaypointEditableModel::data(const QModelIndex &index, int role) const
+{
+    Waypoint *wp = waypointAt(index.row());
+    if (!wp)
+    {
+        return QVariant();
+    }
+
+    const int column = index.column();
+    if (role == Qt::CheckStateRole)
+    {
+        if (column == CurrentColumn)
+        {
+            return wp->getCurrent() ? Qt::Checked : Qt::Unchecked;
+        }
+        if (column == AutoContinueColumn)
+        {
+            return wp->getAutoContinue() ? Qt::Checked : Qt::Unchecked;
+        }
+        return QVariant();
+    }
+
+    if (role == Qt::TextAlignmentRole)
+    {
+        if (column >= Param1Column && column <= AltitudeColumn)
+        {
+            return int(Qt::AlignRight | Qt::AlignVCenter);
+        }
+        return QVariant();
+    }
+
+    if (role == Qt::ToolTipRole && column == CommandColumn)
+    {
+        return wp->getDescription().isEmpty() ? QVariant() : wp->getDescription();
+    }
+
+    if (role != Qt::DisplayRole && role != Qt::EditRole)
+    {
+        return QVariant();
+    }
+
+    const bool edit = (role == Qt::EditRole);
+    switch (column)
+    {
+    case SeqColumn:
+        return wp->getId();
+    case CommandColumn:
+        if (edit)
+        {
+            return static_cast<int>(wp->getAction());
+        }
+        // For APM WP0 is the home location
+        if (index.row() == 0)
+        {
+            return tr("HOME");
+        }
+        return choiceName(commandChoices(), wp->getAction());
+    case FrameColumn:
+        if (edit)
+        {
+            return static_cast<int>(wp->getFrame());
+        }
+        return choiceName(frameChoices(), wp->getFrame());
+    case Param1Column:
+        return edit ? QVariant(wp->getParam1()) : QVariant(QString::number(wp->getParam1(), 'g', 7));
+    case Param2Column:
+        return edit ? QVariant(wp->getParam2()) : QVariant(QString::number(wp->getParam2(), 'g', 7));
+    case Param3Column:
+        return edit ? QVariant(wp->getParam3()) : QVariant(QString::number(wp->getParam3(), 'g', 7));
+    case Param4Column:
+        return edit ? QVariant(wp->getParam4()) : QVariant(QString::number(wp->getParam4(), 'g', 7));
+    case LatitudeColumn:
+        return edit ? QVariant(wp->getParam5()) : QVariant(QString::number(wp->getParam5(), 'f', 7));
+    case LongitudeColumn:
+        return edit ? QVariant(wp->getParam6()) : QVariant(QString::number(wp->getParam6(), 'f', 7));
+    case AltitudeColumn:
+        return edit ? QVariant(wp->getParam7()) : QVariant(QString::number(wp->getParam7(), 'f', 2));
+    default:
+        return QVariant();
+    }
+}
+
+bool WaypointEditableModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    Waypoint *wp = waypointAt(index.row());
+    if (!wp || !(flags(index) & (Qt::ItemIsEditable | Qt::ItemIsUserCheckable)))
+    {
+        return false;
+    }
+
+    // The waypoint setters emit changed(), which comes back through the
+    // manager as waypointEditableChanged() and repaints the row.
+    const int column = index.column();
+    if (role == Qt::CheckStateRole)
+    {
+        const bool checked = (value.toInt() == Qt::Checked);
+        if (column == CurrentColumn)
+        {
+            if (checked && m_wpm)
+            {
+                m_wpm->setCurrentEditable(wp->getId());
+            }
+            return checked;
+        }
+        if (column == AutoContinueColumn)
+        {
+            wp->setAutocontinue(checked);
+            return true;
+        }
+        return false;
+    }
+
+    if (role != Qt::EditRole)
+    {
+        return false;
+    }
+
+    bool ok = true;
+    const double number = value.toDouble(&ok);
+    if (!ok)
+    {
+        return false;
+    }
+
+    switch (column)
+    {
+    case CommandColumn:
+        wp->setAction(value.toInt());
+        break;
+    case FrameColumn:
+        wp->setFrame(static_cast<MAV_FRAME>(value.toInt()));
+        break;
+    case Param1Column:
+        wp->setParam1(number);
+        break;
+    case Param2Column:
+        wp->setParam2(number);
+        break;
+    case Param3Column:
+        wp->setParam3(number);
+        break;
+    case Param4Column:
+        wp->setParam4(number);
+        break;
+    case LatitudeColumn:
+        wp->setParam5(number);
+        break;
+    case LongitudeColumn:
+        wp->setParam6(number);
+        break;
+    case AltitudeColumn:
+        wp->setParam7(number);
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+Qt::ItemFlags WaypointEditableModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid())
+    {
+        return Qt::NoItemFlags;
+    }
+
+    Qt::ItemFlags itemFlags = Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+    // For APM WP0 is the home location and is not edited here
+    if (index.row() == 0)
+    {
+        return itemFlags;
+    }
+
+    switch (index.column())
+    {
+    case SeqColumn:
+        break;
+    case CurrentColumn:
+    case AutoContinueColumn:
+        itemFlags |= Qt::ItemIsUserCheckable;
+        break;
+    default:
+        itemFlags |= Qt::ItemIsEditable;
+        break;
+    }
+    return itemFlags;
+}
+
+QVariant WaypointEditableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole || orientation != Qt::Horizontal)
+    {
+        return QVariant();
+    }
+
+    switch (section)
+    {
+    case SeqColumn:
+        return tr("#");
+    case CurrentColumn:
+        return tr("Current");
+    case CommandColumn:
+        return tr("Command");
+    case FrameColumn:
+        return tr("Frame");
+    case Param1Column:
+        return tr("Param 1");
+    case Param2Column:
+        return tr("Param 2");
+    case Param3Column:
+        return tr("Param 3");
+    case Param4Column:
+        return tr("Param 4");
+    case LatitudeColumn:
+        return tr("Lat / X");
+    case LongitudeColumn:
+        return tr("Lon / Y");
+    case AltitudeColumn:
+        return tr("Alt / Z");
+    case AutoContinueColumn:
+        return tr("Auto Cont.");
+    default:
+        return QVariant();
+    }
+}
+
+const QList<WaypointEditableModel::Choice> &WaypointEditableModel::commandChoices()
+{
+    static const QList<Choice> choices = {
+        Choice(tr("Waypoint"), MAV_CMD_NAV_WAYPOINT),
+        Choice(tr("Spline Waypoint"), MAV_CMD_NAV_SPLINE_WAYPOINT),
+        Choice(tr("TakeOff"), MAV_CMD_NAV_TAKEOFF),
+        Choice(tr("Loiter Unlim."), MAV_CMD_NAV_LOITER_UNLIM),
+        Choice(tr("Loiter Time"), MAV_CMD_NAV_LOITER_TIME),
+        Choice(tr("Loiter Turns"), MAV_CMD_NAV_LOITER_TURNS),
+        Choice(tr("Ret. to Launch"), MAV_CMD_NAV_RETURN_TO_LAUNCH),
+        Choice(tr("Land"), MAV_CMD_NAV_LAND),
+        Choice(tr("Change Alt & cont."), MAV_CMD_NAV_CONTINUE_AND_CHANGE_ALT),
+        Choice(tr("Loiter to Alt."), MAV_CMD_NAV_LOITER_TO_ALT),
+        Choice(tr("Condition Delay"), MAV_CMD_CONDITION_DELAY),
+        Choice(tr("Condition Yaw"), MAV_CMD_CONDITION_YAW),
+        Choice(tr("Condition Distance"), MAV_CMD_CONDITION_DISTANCE),
+        Choice(tr("Jump to Index"), MAV_CMD_DO_JUMP),
+        Choice(tr("Set Reverse"), MAV_CMD_DO_SET_REVERSE),
+        Choice(tr("Set Servo"), MAV_CMD_DO_SET_SERVO),
+        Choice(tr("Repeat Servo"), MAV_CMD_DO_REPEAT_SERVO),
+        Choice(tr("Digicam Control"), MAV_CMD_DO_DIGICAM_CONTROL),
+        Choice(tr("Set Relay"), MAV_CMD_DO_SET_RELAY),
+        Choice(tr("Repeat Relay"), MAV_CMD_DO_REPEAT_RELAY),
+        Choice(tr("Set Cam Trigg Dist"), MAV_CMD_DO_SET_CAM_TRIGG_DIST),
+        Choice(tr("Change Speed"), MAV_CMD_DO_CHANGE_SPEED),
+        Choice(tr("Set Home"), MAV_CMD_DO_SET_HOME),
+        Choice(tr("Mount Control"), MAV_CMD_DO_MOUNT_CONTROL),
+        Choice(tr("Set ROI"), MAV_CMD_DO_SET_ROI)
+    };
+    return choices;
+}
+
+const QList<WaypointEditableModel::Choice> &WaypointEditableModel::frameChoices()
+{
+    static const QList<Choice> choices = {
+        Choice(tr("Abs.Alt"), MAV_FRAME_GLOBAL),
+        Choice(tr("Rel.Alt"), MAV_FRAME_GLOBAL_RELATIVE_ALT),
+        Choice(tr("Ter.Alt"), MAV_FRAME_GLOBAL_TERRAIN_ALT), // A relative alt above terrain.
+        Choice(tr("Mission"), MAV_FRAME_MISSION)
+    };
+    return choices;
+}
+
+QString WaypointEditableModel::choiceName(const QList<Choice> &choices, int value)
+{
+    for (const Choice &choice : choices)
+    {
+        if (choice.second == value)
+        {
+            return choice.first;
+        }
+    }
+    return QString::number(value);
+}
+
+int WaypointEditableModel::rowOf(Waypoint *wp) const
+{
+    // The manager keeps the id of an editable waypoint equal to its index
+    const int id = wp->getId();
+    if (id < m_rows.size() && m_rows.at(id) == wp)
+    {
+        return id;
+    }
+    return m_rows.indexOf(wp);
+}
+
+void WaypointEditableModel::waypointChanged(int uasid, Waypoint *wp)
+{
+    Q_UNUSED(uasid);
+    const int row = rowOf(wp);
+    if (row >= 0)
+    {
+        emit dataChanged(index(row, 0), index(row, ColumnCount - 1));
+    }
+}
+
+void WaypointEditableModel::waypointListChanged()
+{
+    static const QList<Waypoint*> empty;
+    const QList<Waypoint*> &waypoints = m_wpm ? m_wpm->getWaypointEditableList() : empty;
+
+    // Compare the old and the new order, the manager changes the list by
+    // appending, removing or moving a single waypoint at a time. Removed
+    // waypoints may already be deleted, their pointers are only compared.
+    const int oldCount = m_rows.size();
+    const int newCount = waypoints.size();
+    int prefix = 0;
+    while (prefix < oldCount && prefix < newCount && m_rows.at(prefix) == waypoints.at(prefix))
+    {
+        ++prefix;
+    }
+    if (prefix == oldCount && prefix == newCount)
+    {
+        // Same order, something inside the waypoints changed
+        if (newCount > 0)
+        {
+            emit dataChanged(index(0, 0), index(newCount - 1, ColumnCount - 1));
+        }
+        return;
+    }
+
+    int suffix = 0;
+    while (suffix < oldCount - prefix && suffix < newCount - prefix
+           && m_rows.at(oldCount - 1 - suffix) == waypoints.at(newCount - 1 - suffix))
+    {
+        ++suffix;
+    }
+    const int oldMiddle = oldCount - prefix - suffix;
+    const int newMiddle = newCount - prefix - suffix;
+
+    // A single move rotates the middle part by one
+    bool movedDown = (oldMiddle == newMiddle && oldMiddle > 1
+                      && m_rows.at(prefix) == waypoints.at(prefix + newMiddle - 1));
+    bool movedUp = (oldMiddle == newMiddle && oldMiddle > 1
+                    && m_rows.at(prefix + oldMiddle - 1) == waypoints.at(prefix));
+    for (int i = 0; (movedDown || movedUp) && i < oldMiddle - 1; ++i)
+    {
+        movedDown = movedDown && m_rows.at(prefix + 1 + i) == waypoints.at(prefix + i);
+        movedUp = movedUp && m_rows.at(prefix + i) == waypoints.at(prefix + 1 + i);
+    }
+
+    if (oldMiddle == 0)
+    {
+        beginInsertRows(QModelIndex(), prefix, prefix + newMiddle - 1);
+        m_rows = waypoints.toVector();
+        endInsertRows();
+    }
+    else if (newMiddle == 0)
+    {
+        beginRemoveRows(QModelIndex(), prefix, prefix + oldMiddle - 1);
+        m_rows = waypoints.toVector();
+        endRemoveRows();
+    }
+    else if (movedDown)
+    {
+        beginMoveRows(QModelIndex(), prefix, prefix, QModelIndex(), prefix + oldMiddle);
+        m_rows = waypoints.toVector();
+        endMoveRows();
+    }
+    else if (movedUp)
+    {
+        beginMoveRows(QModelIndex(), prefix + oldMiddle - 1, prefix + oldMiddle - 1, QModelIndex(), prefix);
+        m_rows = waypoints.toVector();
+        endMoveRows();
+    }
+    else
+    {
+        beginResetModel();
+        m_rows = waypoints.toVector();
+        endResetModel();
+        return;
+    }
+
+    // Sequence numbers behind the change got renumbered
+    if (prefix < newCount)
+    {
+        emit dataChanged(index(prefix, SeqColumn), index(newCount - 1, SeqColumn));
+    }
+}
@@ -0,0 +1,96 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2014 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief WaypointEditableModel
+ *          Table model over the editable waypoint list of a UASWaypointManager.
+ *          The model keeps a copy of the list order and turns every list change
+ *          into the smallest insert / remove / move it can find, single
+ *          waypoint changes become a dataChanged() of their row.
+ */
+
+#ifndef WAYPOINTEDITABLEMODEL_H
+#define WAYPOINTEDITABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QPair>
+#include <QPointer>
+#include <QVector>
+
+class UASWaypointManager;
+class Waypoint;
+
+class WaypointEditableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column
+    {
+        SeqColumn = 0,
+        CurrentColumn,
+        CommandColumn,
+        FrameColumn,
+        Param1Column,
+        Param2Column,
+        Param3Column,
+        Param4Column,
+        LatitudeColumn,     ///< param5 / x
+        LongitudeColumn,    ///< param6 / y
+        AltitudeColumn,     ///< param7 / z
+        AutoContinueColumn,
+        ColumnCount
+    };
+
+    typedef QPair<QString, int> Choice;
+
+    explicit WaypointEditableModel(QObject *parent = nullptr);
+
+    void setWaypointManager(UASWaypointManager *wpm);
+    Waypoint *waypointAt(int row) const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    /** @brief Commands offered by the editor, as (name, MAV_CMD) */
+    static const QList<Choice> &commandChoices();
+    /** @brief Frames offered by the editor, as (name, MAV_FRAME) */
+    static const QList<Choice> &frameChoices();
+
+private slots:
+    void waypointListChanged();
+    void waypointChanged(int uasid, Waypoint *wp);
+
+private:
+    int rowOf(Waypoint *wp) const;
+    static QString choiceName(const QList<Choice> &choices, int value);
+
+    QPointer<UASWaypointManager> m_wpm;
+    QVector<Waypoint*> m_rows;      ///< Order of the list as last signalled to the views
+};
+
+#endif // WAYPOINTEDITABLEMODEL_H
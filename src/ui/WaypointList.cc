@@ -33,11 +33,17 @@ This file is part of the PIXHAWK project
 
 #include "WaypointList.h"
 #include "ui_WaypointList.h"
+#include "WaypointEditableModel.h"
+#include "WaypointEditableDelegate.h"
 #include <UASInterface.h>
 #include <UAS.h>
 #include <UASManager.h>
 
+#include <QAction>
+#include <QApplication>
 #include <QFileDialog>
+#include <QFileInfo>
+#include <QHeaderView>
 #include <QMessageBox>
 #include <QMouseEvent>
 #include "LinkManager.h"
@@ -51,6 +57,7 @@ WaypointList::WaypointList(QWidget *parent, UASWaypointManager* wpm) :
     mavZ(0.0),
     mavYaw(0.0),
     showOfflineWarning(false),
+    editableModel(new WaypointEditableModel(this)),
     m_ui(new Ui::WaypointList)
 {
 
@@ -58,11 +65,33 @@ WaypointList::WaypointList(QWidget *parent, UASWaypointManager* wpm) :
 
     //EDIT TAB
 
-    editableListLayout = new QVBoxLayout(m_ui->editableListWidget);
-    editableListLayout->setSpacing(0);
-    editableListLayout->setMargin(0);
-    editableListLayout->setAlignment(Qt::AlignTop);
-    m_ui->editableListWidget->setLayout(editableListLayout);
+    // Only the visible rows of the table are painted and only the edited
+    // cell gets an editor widget
+    m_ui->editableListView->setModel(editableModel);
+    m_ui->editableListView->setItemDelegate(new WaypointEditableDelegate(this));
+    m_ui->editableListView->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    m_ui->editableListView->horizontalHeader()->setSectionResizeMode(WaypointEditableModel::CommandColumn, QHeaderView::Stretch);
+    m_ui->editableListView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    m_ui->editableListView->setContextMenuPolicy(Qt::ActionsContextMenu);
+
+    QAction *action = new QAction(tr("Move Up"), m_ui->editableListView);
+    connect(action, SIGNAL(triggered()), this, SLOT(moveSelectedUp()));
+    m_ui->editableListView->addAction(action);
+    action = new QAction(tr("Move Down"), m_ui->editableListView);
+    connect(action, SIGNAL(triggered()), this, SLOT(moveSelectedDown()));
+    m_ui->editableListView->addAction(action);
+    action = new QAction(tr("Move to Top"), m_ui->editableListView);
+    connect(action, SIGNAL(triggered()), this, SLOT(moveSelectedTop()));
+    m_ui->editableListView->addAction(action);
+    action = new QAction(tr("Move to Bottom"), m_ui->editableListView);
+    connect(action, SIGNAL(triggered()), this, SLOT(moveSelectedBottom()));
+    m_ui->editableListView->addAction(action);
+    action = new QAction(tr("Remove"), m_ui->editableListView);
+    action->setShortcut(QKeySequence::Delete);
+    action->setShortcutContext(Qt::WidgetShortcut);
+    connect(action, SIGNAL(triggered()), this, SLOT(removeSelected()));
+    m_ui->editableListView->addAction(action);
+
     m_ui->wpRadiusSpinBox->setEnabled(false);
 
     // ADD WAYPOINT
@@ -125,6 +154,7 @@ WaypointList::WaypointList(QWidget *parent, UASWaypointManager* wpm) :
         connect(WPM, SIGNAL(waypointViewOnlyChanged(int,Waypoint*)), this, SLOT(updateWaypointViewOnly(int,Waypoint*)));
         connect(WPM, SIGNAL(currentWaypointChanged(quint16)),            this, SLOT(currentWaypointViewOnlyChanged(quint16)));
 
+        editableModel->setWaypointManager(WPM);
         m_ui->altSpinBox->setValue(WPM->getDefaultRelAltitude());
         connect(m_ui->altSpinBox, SIGNAL(valueChanged(double)), WPM, SLOT(setDefaultRelAltitude(double)));
 
@@ -204,6 +234,7 @@ void WaypointList::setUAS(UASInterface* uas)
     if (!uas)
         return;
     WPM = uas->getWaypointManager();
+    editableModel->setWaypointManager(WPM);
 
     connect(WPM, SIGNAL(updateStatusString(const QString &)),
             this, SLOT(updateStatusLabel(const QString &)));
@@ -235,7 +266,7 @@ void WaypointList::saveWaypoints()
 {
     QFileDialog *dialog = new QFileDialog(this,tr("Save File"), QGC::missionDirectory());
     dialog->setAcceptMode(QFileDialog::AcceptSave);
-    dialog->setNameFilter("*.txt");
+    dialog->setNameFilters(QStringList() << "*.txt" << tr("Binary Waypoint File (*.wpb)"));
     dialog->selectFile("mission.txt");
     dialog->open(this, SLOT(saveDialogAccepted()));
     dialog->setFileMode(QFileDialog::AnyFile);
@@ -254,12 +285,17 @@ void WaypointList::saveWaypointsDialogAccepted()
         //No file selected/cancel clicked
         return;
     }
-    WPM->saveWaypoints(dialog->selectedFiles().at(0));
+    QString fileName = dialog->selectedFiles().at(0);
+    if (dialog->selectedNameFilter().contains("*.wpb") && !UASWaypointManager::isBinaryMissionFile(fileName))
+    {
+        fileName = QFileInfo(fileName).path() + "/" + QFileInfo(fileName).completeBaseName() + ".wpb";
+    }
+    WPM->saveWaypoints(fileName);
 }
 
 void WaypointList::loadWaypoints()
 {
-    QFileDialog *dialog = new QFileDialog(this, tr("Load File"), QGC::missionDirectory(), tr("Waypoint File (*.txt)"));
+    QFileDialog *dialog = new QFileDialog(this, tr("Load File"), QGC::missionDirectory(), tr("Waypoint File (*.txt *.wpb)"));
     dialog->setFileMode(QFileDialog::ExistingFile);
     connect(dialog,SIGNAL(accepted()),this,SLOT(loadWaypointsDialogAccepted()));
     dialog->show();
@@ -283,7 +319,8 @@ void WaypointList::transmit()
 {
     if (m_uas)
     {
-        WPM->writeWaypoints();
+        // Shift sends the whole list, even if it looks unchanged on the vehicle
+        WPM->writeWaypoints(QApplication::keyboardModifiers() & Qt::ShiftModifier);
     }
 }
 
@@ -440,31 +477,8 @@ void WaypointList::changeCurrentWaypoint(quint16 seq)
 // Request UASWaypointManager to set the new "current" and make sure all other waypoints are not "current"
 void WaypointList::currentWaypointEditableChanged(quint16 seq)
 {
+    // The table follows through the waypoints' changed() signals
     WPM->setCurrentEditable(seq);
-    const QList<Waypoint *> &waypoints = WPM->getWaypointEditableList();
-
-    if (seq < waypoints.count())
-    {
-        for(int i = 0; i < waypoints.count(); i++)
-        {
-            QMap<Waypoint*, WaypointEditableView*>::ConstIterator iter = wpEditableViews.find(waypoints[i]);
-            if (iter != wpEditableViews.end())
-            {
-                WaypointEditableView* widget = iter.value();
-                if (widget)
-                {
-                    if (waypoints[i]->getId() == seq)
-                    {
-                        widget->setCurrent(true);
-                    }
-                    else
-                    {
-                        widget->setCurrent(false);
-                    }
-                }
-            }
-        }
-    }
 }
 
 
@@ -503,8 +517,8 @@ void WaypointList::currentWaypointViewOnlyChanged(quint16 seq)
 void WaypointList::updateWaypointEditable(int uas, Waypoint* wp)
 {
     Q_UNUSED(uas);
-    WaypointEditableView *wpv = wpEditableViews.value(wp);
-    wpv->updateValues();
+    Q_UNUSED(wp);
+    // The row itself is updated by the model
     m_ui->tabWidget->setCurrentIndex(0); // XXX magic number
 }
 
@@ -571,59 +585,8 @@ void WaypointList::waypointViewOnlyListChanged()
 
 void WaypointList::waypointEditableListChanged()
 {
-    // Prevent updates to prevent visual flicker
-    setUpdatesEnabled(false);
-    const QList<Waypoint *> &waypoints = WPM->getWaypointEditableList();
-
-    if (!wpEditableViews.empty()) {
-        QMapIterator<Waypoint*,WaypointEditableView*> viewIt(wpEditableViews);
-        viewIt.toFront();
-        while(viewIt.hasNext()) {
-            viewIt.next();
-            Waypoint *cur = viewIt.key();
-            int i;
-            for (i = 0; i < waypoints.count(); i++) {
-                if (waypoints[i] == cur) {
-                    break;
-                }
-            }
-            if (i == waypoints.count()) {
-                WaypointEditableView* widget = wpEditableViews.find(cur).value();
-                widget->hide();
-                editableListLayout->removeWidget(widget);
-                wpEditableViews.remove(cur);
-            }
-        }
-    }
-
-    // then add/update the views for each waypoint in the list
-    for(int i = 0; i < waypoints.count(); i++) {
-        Waypoint *wp = waypoints[i];
-        if (!wpEditableViews.contains(wp)) {
-            WaypointEditableView* wpview = new WaypointEditableView(wp, this);
-            wpEditableViews.insert(wp, wpview);
-            connect(wpview, SIGNAL(moveDownWaypoint(Waypoint*)),    this, SLOT(moveDown(Waypoint*)));
-            connect(wpview, SIGNAL(moveUpWaypoint(Waypoint*)),      this, SLOT(moveUp(Waypoint*)));
-            connect(wpview, SIGNAL(moveTopWaypoint(Waypoint*)),    this, SLOT(moveTop(Waypoint*)));
-            connect(wpview, SIGNAL(moveBottomWaypoint(Waypoint*)),  this, SLOT(moveBottom(Waypoint*)));
-            connect(wpview, SIGNAL(removeWaypoint(Waypoint*)),      this, SLOT(removeWaypoint(Waypoint*)));
-            //connect(wpview, SIGNAL(currentWaypointChanged(quint16)), this, SLOT(currentWaypointChanged(quint16)));
-            connect(wpview, SIGNAL(changeCurrentWaypoint(quint16)), this, SLOT(currentWaypointEditableChanged(quint16)));
-            editableListLayout->insertWidget(i, wpview);
-        }
-        WaypointEditableView *wpv = wpEditableViews.value(wp);
-
-        //check if ordering has changed
-        if(editableListLayout->itemAt(i)->widget() != wpv) {
-            editableListLayout->removeWidget(wpv);
-            editableListLayout->insertWidget(i, wpv);
-        }
-
-        wpv->updateValues();    // update the values of the ui elements in the view
-    }
-    setUpdatesEnabled(true);
+    // The model turns the change into row inserts, removes and moves
     loadFileGlobalWP = false;
-
 }
 
 void WaypointList::moveUp(Waypoint* wp)
@@ -705,6 +668,37 @@ void WaypointList::removeWaypoint(Waypoint* wp)
     }
 }
 
+Waypoint* WaypointList::selectedEditable() const
+{
+    const QModelIndex index = m_ui->editableListView->currentIndex();
+    return index.isValid() ? editableModel->waypointAt(index.row()) : NULL;
+}
+
+void WaypointList::moveSelectedUp()
+{
+    moveUp(selectedEditable());
+}
+
+void WaypointList::moveSelectedDown()
+{
+    moveDown(selectedEditable());
+}
+
+void WaypointList::moveSelectedTop()
+{
+    moveTop(selectedEditable());
+}
+
+void WaypointList::moveSelectedBottom()
+{
+    moveBottom(selectedEditable());
+}
+
+void WaypointList::removeSelected()
+{
+    removeWaypoint(selectedEditable());
+}
+
 void WaypointList::changeEvent(QEvent *e)
 {
     switch (e->type()) {
@@ -725,8 +719,7 @@ void WaypointList::on_clearWPListButton_clicked()
         //Remove all but 1 waypoint, since the first is "home" on APM
         //Also, remove from the END first, work your way back to the first
         while (waypoints.size() > 1) {
-            WaypointEditableView *widget = wpEditableViews.find(waypoints[waypoints.size()-1]).value();
-            widget->remove();
+            removeWaypoint(waypoints[waypoints.size()-1]);
         }
     }
 }
@@ -742,8 +735,7 @@ void WaypointList::clearWPWidget()
     //Remove all but 1 waypoint, since the first is "home" on APM
     //Also, remove from the END first, work your way back to the first
     while(waypoints.size() > 1) {
-        WaypointEditableView* widget = wpEditableViews.find(waypoints[waypoints.size()-1]).value();
-        widget->remove();
+        removeWaypoint(waypoints[waypoints.size()-1]);
     }
 }
 
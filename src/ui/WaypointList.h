@@ -40,7 +40,6 @@ This file is part of the QGROUNDCONTROL project
 #include <QTimer>
 #include "Waypoint.h"
 #include "UASInterface.h"
-#include "WaypointEditableView.h"
 #include "WaypointViewOnlyView.h"
 #include "UnconnectedUASInfoWidget.h"
 //#include "PopupMessage.h"
@@ -50,6 +49,7 @@ namespace Ui
 {
 class WaypointList;
 }
+class WaypointEditableModel;
 
 class WaypointList : public QWidget
 {
@@ -130,10 +130,8 @@ protected:
     virtual void changeEvent(QEvent *e);
 
 protected:
-    QMap<Waypoint*, WaypointEditableView*> wpEditableViews;
     QMap<Waypoint*, WaypointViewOnlyView*> wpViewOnlyViews;
     QVBoxLayout* viewOnlyListLayout;
-    QVBoxLayout* editableListLayout;
     UASInterface* m_uas;
     UASWaypointManager* WPM;
     double mavX;
@@ -144,6 +142,7 @@ protected:
     bool loadFileGlobalWP;
     bool readGlobalWP;
     bool showOfflineWarning;
+    WaypointEditableModel* editableModel;   ///< Model of the "edit"-tab table
 
 private:
     Ui::WaypointList *m_ui;
@@ -151,6 +150,16 @@ private:
 private slots:
     void on_clearWPListButton_clicked();
 
+    /** @brief Waypoint operations on the row selected in the "edit"-tab table */
+    void moveSelectedUp();
+    void moveSelectedDown();
+    void moveSelectedTop();
+    void moveSelectedBottom();
+    void removeSelected();
+
+private:
+    Waypoint* selectedEditable() const;
+
 };
 
 #endif // WAYPOINTLIST_H
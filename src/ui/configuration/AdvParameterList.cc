@@ -26,7 +26,7 @@ This file is part of the APM_PLANNER project
 #include "logging.h"
 #include "configuration.h"
 
-#include <QTableWidgetItem>
+#include <QHeaderView>
 #include <QInputDialog>
 #include <QFileDialog>
 #include <QFile>
@@ -34,13 +34,6 @@ This file is part of the APM_PLANNER project
 #include <QProgressDialog>
 #include <QDesktopServices>
 
-#define ADV_TABLE_COLUMN_PARAM 0
-#define ADV_TABLE_COLUMN_VALUE 1
-#define ADV_TABLE_COLUMN_UNIT 2
-#define ADV_TABLE_COLUMN_RANGE 3
-#define ADV_TABLE_COLUMN_DESCRIPTION 4
-#define ADV_TABLE_COLUMN_COUNT ADV_TABLE_COLUMN_DESCRIPTION + 1
-
 AdvParameterList::AdvParameterList(QWidget *parent) : AP2ConfigWidget(parent),
     m_searchIndex(0),
     m_paramDownloadState(starting),
@@ -51,12 +44,14 @@ AdvParameterList::AdvParameterList(QWidget *parent) : AP2ConfigWidget(parent),
     m_fileDialog(NULL)
 {
     ui.setupUi(this);
+    m_model = new AdvParameterListModel(this);
+    ui.tableView->setModel(m_model);
     connect(ui.refreshPushButton, SIGNAL(clicked()),this, SLOT(refreshButtonClicked()));
     connect(ui.writePushButton, SIGNAL(clicked()),this, SLOT(writeButtonClicked()));
     connect(ui.loadPushButton, SIGNAL(clicked()),this, SLOT(loadButtonClicked()));
     connect(ui.savePushButton, SIGNAL(clicked()),this, SLOT(saveButtonClicked()));
-    connect(ui.tableWidget, SIGNAL(itemChanged(QTableWidgetItem*)),
-            this, SLOT(tableWidgetItemChanged(QTableWidgetItem*)));
+    connect(m_model, SIGNAL(valueEdited(QString,double)), this, SLOT(valueEdited(QString,double)));
+    connect(m_model, SIGNAL(invalidValueEntered(QString)), this, SLOT(invalidValueEntered(QString)));
     connect(ui.downloadRemoteButton, SIGNAL(clicked()),this, SLOT(downloadRemoteFiles()));
     connect(ui.compareButton,SIGNAL(clicked()),this, SLOT(compareButtonClicked()));
 
@@ -66,18 +61,12 @@ AdvParameterList::AdvParameterList(QWidget *parent) : AP2ConfigWidget(parent),
     connect(ui.resetButton, SIGNAL(clicked()), this, SLOT(resetButtonClicked()));
 
 
-    ui.tableWidget->setColumnCount(ADV_TABLE_COLUMN_COUNT);
-    ui.tableWidget->verticalHeader()->hide();
-    ui.tableWidget->setColumnWidth(ADV_TABLE_COLUMN_PARAM,200);
-    ui.tableWidget->setColumnWidth(ADV_TABLE_COLUMN_VALUE,100);
-    ui.tableWidget->setColumnWidth(ADV_TABLE_COLUMN_UNIT,100);
-    ui.tableWidget->setColumnWidth(ADV_TABLE_COLUMN_DESCRIPTION,800);
-    ui.tableWidget->setHorizontalHeaderItem(ADV_TABLE_COLUMN_PARAM, new QTableWidgetItem("Param"));
-    ui.tableWidget->setHorizontalHeaderItem(ADV_TABLE_COLUMN_VALUE, new QTableWidgetItem("Value"));
-    ui.tableWidget->setHorizontalHeaderItem(ADV_TABLE_COLUMN_UNIT, new QTableWidgetItem("Unit"));
-    ui.tableWidget->setHorizontalHeaderItem(ADV_TABLE_COLUMN_RANGE, new QTableWidgetItem("Range"));
-    ui.tableWidget->setHorizontalHeaderItem(ADV_TABLE_COLUMN_DESCRIPTION,new QTableWidgetItem("Description"));
-    ui.tableWidget->horizontalHeaderItem(ADV_TABLE_COLUMN_DESCRIPTION)->setTextAlignment(Qt::AlignLeft);
+    ui.tableView->verticalHeader()->hide();
+    ui.tableView->setSelectionBehavior(QAbstractItemView::SelectRows);
+    ui.tableView->setColumnWidth(AdvParameterListModel::ParamColumn,200);
+    ui.tableView->setColumnWidth(AdvParameterListModel::ValueColumn,100);
+    ui.tableView->setColumnWidth(AdvParameterListModel::UnitColumn,100);
+    ui.tableView->setColumnWidth(AdvParameterListModel::DescriptionColumn,800);
 
     ui.paramProgressBar->setRange(0,0);
     ui.paramProgressBar->hide();
@@ -85,44 +74,16 @@ AdvParameterList::AdvParameterList(QWidget *parent) : AP2ConfigWidget(parent),
 
     initConnections();
 }
-void AdvParameterList::tableWidgetItemChanged(QTableWidgetItem* item)
+void AdvParameterList::invalidValueEntered(const QString &name)
 {
-    if (!ui.tableWidget->item(item->row(),ADV_TABLE_COLUMN_VALUE)
-            || !ui.tableWidget->item(item->row(),ADV_TABLE_COLUMN_PARAM))
-    {
-        //Invalid item, something has gone awry.
-        return;
-    }
-    if (item->column() != ADV_TABLE_COLUMN_VALUE)
-    {
-        //Don't want to edit values that aren't actual values
-        return;
-    }
-
-    // This is to force the use of '.' decimal as the seperator. ie use the 'C' locale.
-    // thousand seperators are also rejected in 'C' locale
-    bool ok = false;
-    double number = item->text().toDouble(&ok);
-    if (!ok)
-    {
-        //Failed to convert
-        QMessageBox::warning(this,"Error","Failed to convert number, please verify your input uses '.' as decimal and no seperator and try again");
-        disconnect(ui.tableWidget, SIGNAL(itemChanged(QTableWidgetItem*)),this, SLOT(tableWidgetItemChanged(QTableWidgetItem*)));
-        ui.tableWidget->item(item->row(),ADV_TABLE_COLUMN_VALUE)->setText(m_paramToOrigValueMap[ui.tableWidget->item(item->row(),ADV_TABLE_COLUMN_PARAM)->text()]);
-        connect(ui.tableWidget, SIGNAL(itemChanged(QTableWidgetItem*)),this, SLOT(tableWidgetItemChanged(QTableWidgetItem*)));
-        return;
-    }
-
-    m_origBrushList.append(ui.tableWidget->item(item->row(),ADV_TABLE_COLUMN_PARAM)->text());
-    QBrush brush = QBrush(QColor::fromRgb(132,181,132));
-    ui.tableWidget->item(item->row(),ADV_TABLE_COLUMN_PARAM)->setBackground(brush);
-    ui.tableWidget->item(item->row(),ADV_TABLE_COLUMN_VALUE)->setBackground(brush);
-    ui.tableWidget->item(item->row(),ADV_TABLE_COLUMN_UNIT)->setBackground(brush);
-    ui.tableWidget->item(item->row(),ADV_TABLE_COLUMN_RANGE)->setBackground(brush);
-    ui.tableWidget->item(item->row(),ADV_TABLE_COLUMN_DESCRIPTION)->setBackground(brush);
-    m_modifiedParamMap[ui.tableWidget->item(item->row(),ADV_TABLE_COLUMN_PARAM)->text()] = number;
-    m_paramToOrigValueMap[ui.tableWidget->item(item->row(),ADV_TABLE_COLUMN_PARAM)->text()] = item->text();
+    Q_UNUSED(name)
+    //Failed to convert, the model keeps the previous value
+    QMessageBox::warning(this,"Error","Failed to convert number, please verify your input uses '.' as decimal and no seperator and try again");
+}
 
+void AdvParameterList::valueEdited(const QString &name, double value)
+{
+    m_modifiedParamMap[name] = value;
 
     int itemsChanged = m_modifiedParamMap.size();
 
@@ -195,14 +156,9 @@ void AdvParameterList::refreshButtonClicked()
     m_paramDownloadState = starting;
 }
 
-void AdvParameterList::setParameterMetaData(const QString &name, const QString &humanname,
-                                            const QString &description, const QString &unit,
-                                            const QString &range)
+void AdvParameterList::setParameterMetaData(const QVector<ParamMetaDataIndex::Entry> &entries)
 {
-    m_paramToNameMap[name] = humanname;
-    m_paramToDescriptionMap[name] = description;
-    m_paramToUnitMap[name] = unit;
-    m_paramToRangeMap[name] = range;
+    m_model->setMetaData(entries);
 }
 
 
@@ -251,19 +207,7 @@ void AdvParameterList::loadDialogAccepted()
 
     ParamCompareDialog::populateParamListFromString(filestr, &m_parameterList, this);
 
-    foreach(UASParameter* param, m_parameterList){
-        // Modify the elements in the table widget.
-        if (param->isModified()){
-            // Update the local table widget
-            QTableWidgetItem* item = m_paramValueMap.value(param->name());
-            if (item){
-                if (param->value() != item->data(Qt::DisplayRole)){
-                    item->setData(Qt::DisplayRole, param->value());
-                    tableWidgetItemChanged(item);
-                }
-            }
-        }
-    }
+    updateTableWidgetElements(m_parameterList);
 }
 
 void AdvParameterList::dialogRejected()
@@ -347,109 +291,8 @@ void AdvParameterList::saveDialogAccepted()
 
 void AdvParameterList::parameterChanged(int /*uas*/, int /*component*/, QString parameterName, QVariant value)
 {
-    QLOG_DEBUG() << "Param:" << parameterName << ": " << value;
-
-    disconnect(ui.tableWidget,SIGNAL(itemChanged(QTableWidgetItem*)),this,SLOT(tableWidgetItemChanged(QTableWidgetItem*)));
-    if (!m_paramValueMap.contains(parameterName))
-    {
-        ui.tableWidget->setRowCount(ui.tableWidget->rowCount()+1);
-
-        //Param name
-        QTableWidgetItem *paramnameitem = new QTableWidgetItem(parameterName);
-        paramnameitem->setFlags(paramnameitem->flags() ^ Qt::ItemIsEditable);
-        ui.tableWidget->setItem(ui.tableWidget->rowCount()-1,ADV_TABLE_COLUMN_PARAM,paramnameitem);
-
-        // Param value
-        QString valstr = "";
-        QMetaType::Type metaType(static_cast<QMetaType::Type>(value.type()));
-        if (metaType == QMetaType::Float || metaType == QMetaType::Double)
-        {
-            valstr = QString::number(value.toFloat(),'f',4);
-        }
-        else
-        {
-            valstr = QString::number(value.toFloat(),'f',0);
-        }
-        QTableWidgetItem *valitem = new QTableWidgetItem(valstr);
-        valitem->setFlags(valitem->flags() | Qt::ItemIsEditable);
-        ui.tableWidget->setItem(ui.tableWidget->rowCount()-1,ADV_TABLE_COLUMN_VALUE,valitem);
-
-        // Param unit
-        if (m_paramToUnitMap.contains(parameterName))
-        {
-            QTableWidgetItem *item = new QTableWidgetItem(m_paramToUnitMap[parameterName]);
-            item->setFlags(item->flags() ^ Qt::ItemIsEditable);
-            ui.tableWidget->setItem(ui.tableWidget->rowCount()-1, ADV_TABLE_COLUMN_UNIT,item);
-        }
-        else
-        {
-            QTableWidgetItem *item = new QTableWidgetItem("");
-            item->setFlags(item->flags() ^ Qt::ItemIsEditable);
-            ui.tableWidget->setItem(ui.tableWidget->rowCount()-1,ADV_TABLE_COLUMN_UNIT,item);
-        }
-
-        // Param range
-        if (m_paramToRangeMap.contains(parameterName))
-        {
-            QTableWidgetItem *item = new QTableWidgetItem(m_paramToRangeMap[parameterName]);
-            item->setFlags(item->flags() ^ Qt::ItemIsEditable);
-            ui.tableWidget->setItem(ui.tableWidget->rowCount()-1, ADV_TABLE_COLUMN_RANGE,item);
-        }
-        else
-        {
-            QTableWidgetItem *item = new QTableWidgetItem("");
-            item->setFlags(item->flags() ^ Qt::ItemIsEditable);
-            ui.tableWidget->setItem(ui.tableWidget->rowCount()-1,ADV_TABLE_COLUMN_RANGE,item);
-        }
-
-        // Description
-        QString desc = "";
-        if (m_paramToNameMap.contains(parameterName))
-        {
-            desc += m_paramToNameMap[parameterName] + " - ";
-        }
-        else
-        {
-            desc = "";
-        }
-
-        if (m_paramToDescriptionMap.contains(parameterName))
-        {
-            desc += m_paramToDescriptionMap[parameterName];
-        }
-        QTableWidgetItem *item = new QTableWidgetItem(desc);
-        item->setFlags(item->flags() ^ Qt::ItemIsEditable);
-        ui.tableWidget->setItem(ui.tableWidget->rowCount()-1,ADV_TABLE_COLUMN_DESCRIPTION,item);
-
-
-        m_paramValueMap[parameterName] = ui.tableWidget->item(ui.tableWidget->rowCount()-1,ADV_TABLE_COLUMN_VALUE);
-        ui.tableWidget->sortByColumn(0,Qt::AscendingOrder);
-    }
-
-    if (m_origBrushList.contains(parameterName))
-    {
-        m_paramValueMap[parameterName]->setBackground(QBrush());
-        ui.tableWidget->item(m_paramValueMap[parameterName]->row(),ADV_TABLE_COLUMN_PARAM)->setBackground(QBrush());
-        ui.tableWidget->item(m_paramValueMap[parameterName]->row(),ADV_TABLE_COLUMN_VALUE)->setBackground(QBrush());
-        ui.tableWidget->item(m_paramValueMap[parameterName]->row(),ADV_TABLE_COLUMN_UNIT)->setBackground(QBrush());
-        ui.tableWidget->item(m_paramValueMap[parameterName]->row(),ADV_TABLE_COLUMN_RANGE)->setBackground(QBrush());
-        ui.tableWidget->item(m_paramValueMap[parameterName]->row(),ADV_TABLE_COLUMN_DESCRIPTION)->setBackground(QBrush());
-        m_origBrushList.removeAll(parameterName);
-    }
-
-    QString valstr = "";
-    QMetaType::Type metaType(static_cast<QMetaType::Type>(value.type()));
-    if (metaType == QMetaType::Float || metaType == QMetaType::Double)
-    {
-        valstr = QString::number(value.toFloat(),'f',6);
-    }
-    else
-    {
-        valstr = QString::number(value.toInt(),'f',0);
-    }
-    m_paramToOrigValueMap[parameterName] = valstr;
-    m_paramValueMap[parameterName]->setText(valstr);
-    connect(ui.tableWidget,SIGNAL(itemChanged(QTableWidgetItem*)),this,SLOT(tableWidgetItemChanged(QTableWidgetItem*)));
+    // Collected by the model and shown in batches
+    m_model->setValue(parameterName,value);
 
     if(m_writingParams) {
         ++m_paramsWritten;
@@ -474,7 +317,11 @@ void AdvParameterList::parameterChanged(int /*uas*/, int /*component*/, QString
 void AdvParameterList::parameterChanged(int uas, int component, int parameterCount, int parameterId, QString parameterName, QVariant value)
 {
     Q_UNUSED(uas)
-    Q_UNUSED(parameterCount)
+    if (parameterId == parameterCount - 1)
+    {
+        // Last parameter of a download, show the whole list now
+        m_model->flush();
+    }
     // Create a parameter list model for comparison feature
     // [TODO] This needs to move to the global parameter model.
 
@@ -510,16 +357,13 @@ void AdvParameterList::downloadRemoteFiles()
 
 void AdvParameterList::updateTableWidgetElements(QMap<QString, UASParameter *> &parameterList)
 {
+    m_model->flush();
     foreach(UASParameter* param, parameterList){
-        // Modify the elements in the table widget.
+        // Modify the elements in the table
         if (param->isModified()){
-            // Update the local table widget
-            QTableWidgetItem* item = m_paramValueMap.value(param->name());
-            if (item){
-                if(param->value().toDouble() != item->data(Qt::DisplayRole).toDouble()){
-                    item->setData(Qt::DisplayRole, param->value());
-                    tableWidgetItemChanged(item);
-                }
+            int row = m_model->rowOf(param->name());
+            if (row >= 0 && param->value().toDouble() != m_model->valueAt(row).toDouble()){
+                m_model->editValue(row, param->value().toDouble());
             }
         }
     }
@@ -545,69 +389,54 @@ void AdvParameterList::findStringInTable(const QString &searchString)
 {
     QLOG_DEBUG() << "Find String in table: " << searchString;
 
-    // Don't want the items to be considered changed
-    disconnect(ui.tableWidget, SIGNAL(itemChanged(QTableWidgetItem*)),
-            this, SLOT(tableWidgetItemChanged(QTableWidgetItem*)));
-
-    if (m_searchItemList.count() > 0){
-       foreach(QTableWidgetItem *item, m_searchItemList){
-            item->setBackground(QBrush());
-            item->setSelected(false);
-       }
-    }
-
-    m_searchItemList.clear();
+    m_searchRows.clear();
     if (searchString.length() > 2){ //need at least three characters to search
-        m_searchItemList = ui.tableWidget->findItems(searchString, Qt::MatchContains);
+        m_model->flush();
+        m_searchRows = m_model->findRows(searchString);
     }
+    m_model->setHighlightedRows(m_searchRows);
 
-    if (m_searchItemList.count() > 0){
-        foreach(QTableWidgetItem *item, m_searchItemList){
-            item->setBackground(QColor(255,255,160));
-        }
-        m_searchIndex = m_searchIndex < m_searchItemList.count()? m_searchIndex
-                                                                : m_searchItemList.count() - 1;
-        ui.tableWidget->scrollToItem(m_searchItemList[m_searchIndex],QAbstractItemView::PositionAtCenter);
-        m_searchItemList[m_searchIndex]->setSelected(true);
+    if (m_searchRows.count() > 0){
+        m_searchIndex = m_searchIndex < m_searchRows.count()? m_searchIndex
+                                                            : m_searchRows.count() - 1;
+        showSearchRow();
     }
-
-    // Reconnect changed signal
-    connect(ui.tableWidget, SIGNAL(itemChanged(QTableWidgetItem*)),
-            this, SLOT(tableWidgetItemChanged(QTableWidgetItem*)));
 }
 
 void AdvParameterList::nextItemInSearch()
 {
     QLOG_DEBUG() << "Find Next Item in table: ";
-    if (m_searchItemList.count()==0)
+    if (m_searchRows.count()==0)
         return;
 
-    m_searchItemList[m_searchIndex]->setSelected(false);
     m_searchIndex++;
-    if(m_searchIndex < m_searchItemList.count()){
-        ui.tableWidget->scrollToItem(m_searchItemList[m_searchIndex],QAbstractItemView::PositionAtCenter);
-        m_searchItemList[m_searchIndex]->setSelected(true);
-    } else {
+    if(m_searchIndex >= m_searchRows.count()){
         m_searchIndex = 0; // loop around
     }
+    showSearchRow();
 }
 
 void AdvParameterList::previousItemInSearch()
 {
     QLOG_DEBUG() << "Find Previous Item in table: ";
 
-    if (m_searchItemList.count()==0)
+    if (m_searchRows.count()==0)
         return;
 
-    m_searchItemList[m_searchIndex]->setSelected(false);
     m_searchIndex--;
-    if(m_searchIndex >= 0){
-        ui.tableWidget->scrollToItem(m_searchItemList[m_searchIndex],QAbstractItemView::PositionAtCenter);
-        m_searchItemList[m_searchIndex]->setSelected(true);
-    } else {
-        m_searchIndex = m_searchItemList.count() - 1; // loops around
+    if(m_searchIndex < 0){
+        m_searchIndex = m_searchRows.count() - 1; // loops around
     }
+    showSearchRow();
 }
+
+void AdvParameterList::showSearchRow()
+{
+    QModelIndex index = m_model->index(m_searchRows[m_searchIndex], AdvParameterListModel::ParamColumn);
+    ui.tableView->scrollTo(index, QAbstractItemView::PositionAtCenter);
+    ui.tableView->selectRow(index.row());
+}
+
 void AdvParameterList::resetButtonClicked()
 {
     if (!m_uas)
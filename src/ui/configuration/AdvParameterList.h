@@ -35,6 +35,7 @@ This file is part of the APM_PLANNER project
 #include <QWidget>
 #include "ui_AdvParameterList.h"
 #include "AP2ConfigWidget.h"
+#include "AdvParameterListModel.h"
 
 class QFileDialog;
 
@@ -47,8 +48,7 @@ class AdvParameterList : public AP2ConfigWidget
 
 public:
     explicit AdvParameterList(QWidget *parent = 0);
-    void setParameterMetaData(const QString& name, const QString& humanname, const QString& description,
-                              const QString& unit, const QString& range);
+    void setParameterMetaData(const QVector<ParamMetaDataIndex::Entry> &entries);
     ~AdvParameterList();
     void updateTableWidgetElements(QMap<QString, UASParameter*> &parameterList);
 
@@ -58,7 +58,8 @@ private slots:
                           QString parameterName, QVariant value);
     void refreshButtonClicked();
     void writeButtonClicked();
-    void tableWidgetItemChanged(QTableWidgetItem* item);
+    void valueEdited(const QString &name, double value);
+    void invalidValueEntered(const QString &name);
     void loadButtonClicked();
     void saveButtonClicked();
     void downloadRemoteFiles();
@@ -74,22 +75,17 @@ private slots:
 private:
     // Helper methods
     void resetParamWriteWidget();
+    void showSearchRow();
 
 private:
     Ui::AdvParameterList ui;
     QMap<QString, UASParameter*> m_parameterList;
 
-    QMap<QString,QTableWidgetItem*> m_paramValueMap;
-    QList<QString> m_origBrushList;
+    AdvParameterListModel *m_model;
     QList<QString> m_waitingParamList;
-    QMap<QString,QString> m_paramToNameMap;
-    QMap<QString,QString> m_paramToDescriptionMap;
     QMap<QString,double> m_modifiedParamMap;
-    QMap<QString,QString> m_paramToUnitMap;
-    QMap<QString,QString> m_paramToRangeMap;
-    QMap<QString,QString> m_paramToOrigValueMap;
 
-    QList<QTableWidgetItem *> m_searchItemList;
+    QList<int> m_searchRows;
     int m_searchIndex;
 
     ParamDownloadState m_paramDownloadState;
@@ -0,0 +1,377 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2013 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+#include "AdvParameterListModel.h"
+
+#include <QBrush>
+#include <QColor>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+
+static bool isFloatValue(const QVariant &value)
+{
+    QMetaType::Type metaType(static_cast<QMetaType::Type>(value.type()));
+    return metaType == QMetaType::Float || metaType == QMetaType::Double;
+}
+
+AdvParameterListModel::AdvParameterListModel(QObject *parent) :
+    QAbstractTableModel(parent)
+{
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(s_flushInterval);
+    connect(&m_flushTimer, SIGNAL(timeout()), this, SLOT(flush()));
+}
+
+void AdvParameterListModel::setMetaData(const QVector<ParamMetaDataIndex::Entry> &entries)
+{
+    m_metaData.clear();
+    m_metaData.reserve(entries.size());
+    foreach (const ParamMetaDataIndex::Entry &entry, entries)
+    {
+        MetaData &metaData = m_metaData[entry.param];
+        metaData.description = entry.humanName + " - " + entry.docs;
+        metaData.unit = entry.units;
+        metaData.range = entry.range;
+    }
+    m_searchTextValid = false;
+    if (!m_rows.isEmpty())
+    {
+        emit dataChanged(index(0, UnitColumn), index(m_rows.size() - 1, DescriptionColumn));
+    }
+}
+
+void AdvParameterListModel::setValue(const QString &name, const QVariant &value)
+{
+    m_pendingValues[name] = value;
+    if (!m_flushTimer.isActive())
+    {
+        // Not restarted by further values, so a running download is still shown every interval
+        m_flushTimer.start();
+    }
+}
+
+void AdvParameterListModel::flush()
+{
+    m_flushTimer.stop();
+    if (m_pendingValues.isEmpty())
+    {
+        return;
+    }
+
+    QVector<Row> newRows;
+    int firstChanged = m_rows.size();
+    int lastChanged = -1;
+    for (QHash<QString,QVariant>::const_iterator i = m_pendingValues.constBegin(); i != m_pendingValues.constEnd(); ++i)
+    {
+        const int row = rowOf(i.key());
+        if (row < 0)
+        {
+            Row newRow;
+            newRow.name = i.key();
+            newRow.value = i.value();
+            newRows.append(newRow);
+            continue;
+        }
+        // The vehicle confirmed or overwrote the value, it is not modified anymore
+        m_rows[row].value = i.value();
+        m_rows[row].modified = false;
+        firstChanged = qMin(firstChanged, row);
+        lastChanged = qMax(lastChanged, row);
+    }
+    m_pendingValues.clear();
+
+    if (lastChanged >= 0)
+    {
+        emit dataChanged(index(firstChanged, 0), index(lastChanged, ColumnCount - 1));
+    }
+    if (newRows.isEmpty())
+    {
+        return;
+    }
+
+    std::sort(newRows.begin(), newRows.end(), [](const Row &a, const Row &b) { return a.name < b.name; });
+    m_searchTextValid = false;
+    if (m_rows.isEmpty() || newRows.size() > s_resetThreshold)
+    {
+        // A parameter download, merging in one go is cheaper than many inserts
+        beginResetModel();
+        QVector<Row> merged;
+        merged.reserve(m_rows.size() + newRows.size());
+        std::merge(m_rows.constBegin(), m_rows.constEnd(), newRows.constBegin(), newRows.constEnd(),
+                   std::back_inserter(merged), [](const Row &a, const Row &b) { return a.name < b.name; });
+        m_rows.swap(merged);
+        m_highlightedRows.clear();
+        endResetModel();
+        return;
+    }
+
+    foreach (const Row &newRow, newRows)
+    {
+        const int row = lowerBound(newRow.name);
+        beginInsertRows(QModelIndex(), row, row);
+        m_rows.insert(row, newRow);
+        endInsertRows();
+    }
+    m_highlightedRows.clear();
+}
+
+bool AdvParameterListModel::editValue(int row, double value)
+{
+    if (row < 0 || row >= m_rows.size())
+    {
+        return false;
+    }
+    Row &edited = m_rows[row];
+    if (!isFloatValue(edited.value) && value == std::floor(value)
+            && std::fabs(value) <= std::numeric_limits<int>::max())
+    {
+        edited.value = static_cast<int>(value);
+    }
+    else
+    {
+        edited.value = value;
+    }
+    edited.modified = true;
+    emit dataChanged(index(row, 0), index(row, ColumnCount - 1));
+    emit valueEdited(edited.name, value);
+    return true;
+}
+
+int AdvParameterListModel::rowOf(const QString &name) const
+{
+    const int row = lowerBound(name);
+    if (row < m_rows.size() && m_rows.at(row).name == name)
+    {
+        return row;
+    }
+    return -1;
+}
+
+QString AdvParameterListModel::nameAt(int row) const
+{
+    return (row >= 0 && row < m_rows.size()) ? m_rows.at(row).name : QString();
+}
+
+QVariant AdvParameterListModel::valueAt(int row) const
+{
+    return (row >= 0 && row < m_rows.size()) ? m_rows.at(row).value : QVariant();
+}
+
+QList<int> AdvParameterListModel::findRows(const QString &searchString) const
+{
+    QList<int> rows;
+    if (searchString.isEmpty())
+    {
+        return rows;
+    }
+
+    // Names are sorted, all names starting with the search string are one range
+    const QString prefix = searchString.toUpper();
+    const int prefixBegin = lowerBound(prefix);
+    int prefixEnd = prefixBegin;
+    while (prefixEnd < m_rows.size() && m_rows.at(prefixEnd).name.startsWith(prefix))
+    {
+        rows.append(prefixEnd++);
+    }
+
+    updateSearchText();
+    const QString needle = searchString.toLower();
+    for (int row = 0; row < m_rows.size(); ++row)
+    {
+        if (row == prefixBegin && prefixEnd > prefixBegin)
+        {
+            row = prefixEnd - 1;
+            continue;
+        }
+        if (m_searchText.at(row).contains(needle)
+                || valueText(m_rows.at(row).value).contains(needle, Qt::CaseInsensitive))
+        {
+            rows.append(row);
+        }
+    }
+    return rows;
+}
+
+void AdvParameterListModel::setHighlightedRows(const QList<int> &rows)
+{
+    QSet<int> changed = m_highlightedRows;
+#if QT_VERSION < QT_VERSION_CHECK(5, 14, 0)
+    m_highlightedRows = rows.toSet();
+#else
+    m_highlightedRows = QSet<int>(rows.begin(), rows.end());
+#endif
+    changed.unite(m_highlightedRows);
+    if (changed.isEmpty())
+    {
+        return;
+    }
+    const int first = *std::min_element(changed.constBegin(), changed.constEnd());
+    const int last = *std::max_element(changed.constBegin(), changed.constEnd());
+    emit dataChanged(index(first, 0), index(last, ColumnCount - 1), QVector<int>() << Qt::BackgroundRole);
+}
+
+int AdvParameterListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rows.size();
+}
+
+int AdvParameterListModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant AdvParameterListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_rows.size())
+    {
+        return QVariant();
+    }
+    const Row &row = m_rows.at(index.row());
+
+    if (role == Qt::BackgroundRole)
+    {
+        if (row.modified)
+        {
+            return QBrush(QColor::fromRgb(132,181,132));
+        }
+        if (m_highlightedRows.contains(index.row()))
+        {
+            return QBrush(QColor(255,255,160));
+        }
+        return QVariant();
+    }
+
+    if (role != Qt::DisplayRole && role != Qt::EditRole)
+    {
+        return QVariant();
+    }
+
+    switch (index.column())
+    {
+    case ParamColumn:
+        return row.name;
+    case ValueColumn:
+        return valueText(row.value);
+    case UnitColumn:
+        return m_metaData.value(row.name).unit;
+    case RangeColumn:
+        return m_metaData.value(row.name).range;
+    case DescriptionColumn:
+        return m_metaData.value(row.name).description;
+    default:
+        return QVariant();
+    }
+}
+
+bool AdvParameterListModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (role != Qt::EditRole || index.column() != ValueColumn || index.row() >= m_rows.size())
+    {
+        return false;
+    }
+    // This is to force the use of '.' decimal as the seperator. ie use the 'C' locale.
+    // thousand seperators are also rejected in 'C' locale
+    bool ok = false;
+    const double number = value.toDouble(&ok);
+    if (!ok)
+    {
+        emit invalidValueEntered(m_rows.at(index.row()).name);
+        return false;
+    }
+    return editValue(index.row(), number);
+}
+
+Qt::ItemFlags AdvParameterListModel::flags(const QModelIndex &index) const
+{
+    Qt::ItemFlags itemFlags = QAbstractTableModel::flags(index);
+    if (index.column() == ValueColumn)
+    {
+        itemFlags |= Qt::ItemIsEditable;
+    }
+    return itemFlags;
+}
+
+QVariant AdvParameterListModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal)
+    {
+        return QVariant();
+    }
+    if (role == Qt::TextAlignmentRole && section == DescriptionColumn)
+    {
+        return int(Qt::AlignLeft | Qt::AlignVCenter);
+    }
+    if (role != Qt::DisplayRole)
+    {
+        return QVariant();
+    }
+    switch (section)
+    {
+    case ParamColumn:
+        return tr("Param");
+    case ValueColumn:
+        return tr("Value");
+    case UnitColumn:
+        return tr("Unit");
+    case RangeColumn:
+        return tr("Range");
+    case DescriptionColumn:
+        return tr("Description");
+    default:
+        return QVariant();
+    }
+}
+
+QString AdvParameterListModel::valueText(const QVariant &value)
+{
+    if (isFloatValue(value))
+    {
+        return QString::number(value.toFloat(),'f',6);
+    }
+    return QString::number(value.toInt());
+}
+
+int AdvParameterListModel::lowerBound(const QString &name) const
+{
+    return static_cast<int>(std::lower_bound(m_rows.constBegin(), m_rows.constEnd(), name,
+                                             [](const Row &row, const QString &key) { return row.name < key; })
+                            - m_rows.constBegin());
+}
+
+void AdvParameterListModel::updateSearchText() const
+{
+    if (m_searchTextValid)
+    {
+        return;
+    }
+    m_searchText.resize(m_rows.size());
+    for (int row = 0; row < m_rows.size(); ++row)
+    {
+        const MetaData metaData = m_metaData.value(m_rows.at(row).name);
+        m_searchText[row] = QString("%1 %2 %3 %4").arg(m_rows.at(row).name, metaData.unit,
+                                                       metaData.range, metaData.description).toLower();
+    }
+    m_searchTextValid = true;
+}
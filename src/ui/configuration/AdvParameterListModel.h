@@ -0,0 +1,126 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2013 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Table model of all parameters of the vehicle for the AdvParameterList
+ *
+ *   The rows are kept sorted by parameter name, so the row vector itself is the
+ *   name index: lookups and prefix searches are binary searches. Values coming
+ *   from the vehicle are collected and applied in batches, one dataChanged() for
+ *   all updated rows instead of one signal per parameter.
+ */
+
+#ifndef ADVPARAMETERLISTMODEL_H
+#define ADVPARAMETERLISTMODEL_H
+
+#include <QAbstractTableModel>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+#include <QVector>
+#include "ParamMetaDataIndex.h"
+
+class AdvParameterListModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column
+    {
+        ParamColumn = 0,
+        ValueColumn,
+        UnitColumn,
+        RangeColumn,
+        DescriptionColumn,
+        ColumnCount
+    };
+
+    explicit AdvParameterListModel(QObject *parent = nullptr);
+
+    void setMetaData(const QVector<ParamMetaDataIndex::Entry> &entries);
+
+    /** @brief Queues a value received from the vehicle, applied on the next flush() */
+    void setValue(const QString &name, const QVariant &value);
+
+    /** @brief Sets a value as edited by the user, marks the row as modified */
+    bool editValue(int row, double value);
+
+    /** @brief Row of a parameter, -1 if it is not in the list */
+    int rowOf(const QString &name) const;
+    QString nameAt(int row) const;
+    QVariant valueAt(int row) const;
+
+    /** @brief Rows matching a search, names starting with it first, then rows containing it */
+    QList<int> findRows(const QString &searchString) const;
+    void setHighlightedRows(const QList<int> &rows);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+public slots:
+    /** @brief Applies all queued values now */
+    void flush();
+
+signals:
+    void valueEdited(const QString &name, double value);
+    void invalidValueEntered(const QString &name);
+
+private:
+    static const int s_flushInterval = 100;     ///< ms values are collected before a flush
+    static const int s_resetThreshold = 64;     ///< More new rows than this reset the model
+
+    class Row
+    {
+    public:
+        QString name;
+        QVariant value;         ///< Value of the vehicle, or the edited value if modified
+        bool modified = false;
+    };
+
+    class MetaData
+    {
+    public:
+        QString description;
+        QString unit;
+        QString range;
+    };
+
+    static QString valueText(const QVariant &value);
+    int lowerBound(const QString &name) const;
+    void updateSearchText() const;
+
+    QVector<Row> m_rows;                        ///< Sorted by name
+    QHash<QString,MetaData> m_metaData;
+    QHash<QString,QVariant> m_pendingValues;
+    QSet<int> m_highlightedRows;
+    QTimer m_flushTimer;
+
+    mutable QVector<QString> m_searchText;      ///< Lower case name, unit, range and description per row
+    mutable bool m_searchTextValid = false;
+};
+
+#endif // ADVPARAMETERLISTMODEL_H
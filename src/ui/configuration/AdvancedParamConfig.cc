@@ -22,11 +22,12 @@ This file is part of the APM_PLANNER project
 
 #include "AdvancedParamConfig.h"
 
-#include "QGCMouseWheelEventFilter.h"
-
 AdvancedParamConfig::AdvancedParamConfig(QWidget *parent) : AP2ConfigWidget(parent)
 {
     ui.setupUi(this);
+    m_paramList = new ParamWidgetList(ui.scrollArea,ui.verticalLayout,this);
+    connect(m_paramList,SIGNAL(doubleValueChanged(QString,double)),this,SLOT(doubleValueChanged(QString,double)));
+    connect(m_paramList,SIGNAL(intValueChanged(QString,int)),this,SLOT(intValueChanged(QString,int)));
     initConnections();
     connect(ui.searchFilter, SIGNAL(textChanged(QString)), this, SLOT(onSearchFilterChanged(const QString &)));
 }
@@ -34,43 +35,16 @@ AdvancedParamConfig::AdvancedParamConfig(QWidget *parent) : AP2ConfigWidget(pare
 AdvancedParamConfig::~AdvancedParamConfig()
 {
 }
-void AdvancedParamConfig::addRange(QString title,QString description,QString param,double min,double max,double increment)
-{
-    ParamWidget *widget = new ParamWidget(param,ui.scrollAreaWidgetContents);
-    connect(widget,SIGNAL(doubleValueChanged(QString,double)),this,SLOT(doubleValueChanged(QString,double)));
-    connect(widget,SIGNAL(intValueChanged(QString,int)),this,SLOT(intValueChanged(QString,int)));
-    m_paramToWidgetMap[param] = widget;
-    widget->setupDouble(title + "(" + param + ")",description,0,min,max,increment);
-    ui.verticalLayout->addWidget(widget);
-    widget->installEventFilter(QGCMouseWheelEventFilter::getFilter());
-    widget->show();
-    if (m_paramToValueMap.contains(param))
-    {
-        widget->setValue(m_paramToValueMap.value(param).toDouble());
-        m_paramToValueMap.remove(param);
-    }
-}
 
-void AdvancedParamConfig::addCombo(QString title,QString description,QString param,QList<QPair<int,QString> > valuelist)
+void AdvancedParamConfig::setParamList(const QVector<ParamMetaDataIndex::Entry> &entries)
 {
-    ParamWidget *widget = new ParamWidget(param,ui.scrollAreaWidgetContents);
-    connect(widget,SIGNAL(doubleValueChanged(QString,double)),this,SLOT(doubleValueChanged(QString,double)));
-    connect(widget,SIGNAL(intValueChanged(QString,int)),this,SLOT(intValueChanged(QString,int)));
-    m_paramToWidgetMap[param] = widget;
-    widget->setupCombo(title + "(" + param + ")",description,valuelist);
-    ui.verticalLayout->addWidget(widget);
-    widget->installEventFilter(QGCMouseWheelEventFilter::getFilter());
-    widget->show();
-    if (m_paramToValueMap.contains(param))
-    {
-        widget->setValue(m_paramToValueMap.value(param).toDouble());
-        m_paramToValueMap.remove(param);
-    }
+    m_paramList->setEntries(entries);
+    m_paramList->setSearchFilter(ui.searchFilter->text());
 }
 
-void AdvancedParamConfig::allParamsAdded(void)
+void AdvancedParamConfig::setParameterValues(const QMap<QString,QVariant> &values)
 {
-    ui.verticalLayout->addStretch();
+    m_paramList->setValues(values);
 }
 
 void AdvancedParamConfig::parameterChanged(int uas, int component, QString parameterName, QVariant value)
@@ -78,23 +52,9 @@ void AdvancedParamConfig::parameterChanged(int uas, int component, QString param
     Q_UNUSED(uas)
     Q_UNUSED(component)
 
-    if (m_paramToWidgetMap.contains(parameterName))
-    {
-        QMetaType::Type metaType(static_cast<QMetaType::Type>(value.type()));
-        if (metaType == QMetaType::Double || metaType == QMetaType::Float)
-        {
-            m_paramToWidgetMap[parameterName]->setValue(value.toDouble());
-        }
-        else
-        {
-            m_paramToWidgetMap[parameterName]->setValue(value.toInt());
-        }
-    }
-    else
-    {
-        m_paramToValueMap[parameterName] = value;
-    }
+    m_paramList->setValue(parameterName,value);
 }
+
 void AdvancedParamConfig::doubleValueChanged(QString param,double value)
 {
     if (!m_uas)
@@ -115,37 +75,5 @@ void AdvancedParamConfig::intValueChanged(QString param,int value)
 
 void AdvancedParamConfig::onSearchFilterChanged(const QString &searchFilterText)
 {
-    if (searchFilterText.isEmpty())
-    {
-        for (int i = 0; i < ui.verticalLayout->count(); ++i)
-        {
-            QLayoutItem *item = ui.verticalLayout->itemAt(i);
-            if (item && item->widget())
-            {
-                item->widget()->setVisible(true);
-            }
-        }
-    }
-    else
-    {
-#if QT_VERSION < QT_VERSION_CHECK(5, 14, 0)
-        QStringList filterList = searchFilterText.toLower().split(' ', QString::SkipEmptyParts);
-#else
-        QStringList filterList = searchFilterText.toLower().split(' ', Qt::SkipEmptyParts);
-#endif
-
-        for (int i = 0; i < ui.verticalLayout->count(); ++i)
-        {
-            ParamWidget *pw = qobject_cast<ParamWidget *>(ui.verticalLayout->itemAt(i)->widget());
-            if (pw)
-            {
-                bool shouldShow = true;
-                foreach (const QString &filterTerm, filterList)
-                {
-                    shouldShow = shouldShow && pw->matchesSearchFilter(filterTerm);
-                }
-                pw->setVisible(shouldShow);
-            }
-        }
-    }
+    m_paramList->setSearchFilter(searchFilterText);
 }
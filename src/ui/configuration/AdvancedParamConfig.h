@@ -33,7 +33,7 @@ This file is part of the APM_PLANNER project
 #include <QWidget>
 #include "ui_AdvancedParamConfig.h"
 #include "AP2ConfigWidget.h"
-#include "ParamWidget.h"
+#include "ParamWidgetList.h"
 class AdvancedParamConfig : public AP2ConfigWidget
 {
     Q_OBJECT
@@ -41,9 +41,8 @@ class AdvancedParamConfig : public AP2ConfigWidget
 public:
     explicit AdvancedParamConfig(QWidget *parent = 0);
     ~AdvancedParamConfig();
-    void addRange(QString title,QString description,QString param,double min,double max,double increment);
-    void addCombo(QString title,QString description,QString param,QList<QPair<int,QString> > valuelist);
-    void allParamsAdded(void);
+    void setParamList(const QVector<ParamMetaDataIndex::Entry> &entries);
+    void setParameterValues(const QMap<QString,QVariant> &values);
 public slots:
     void parameterChanged(int uas, int component, QString parameterName, QVariant value);
 private slots:
@@ -53,8 +52,7 @@ private slots:
     void onSearchFilterChanged(const QString &searchFilterText);
 
 private:
-    QMap<QString,ParamWidget*> m_paramToWidgetMap;
-    QMap<QString,QVariant> m_paramToValueMap;
+    ParamWidgetList *m_paramList;
     Ui::AdvancedParamConfig ui;
 };
 
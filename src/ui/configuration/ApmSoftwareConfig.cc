@@ -23,8 +23,8 @@ This file is part of the APM_PLANNER project
 #include "ApmSoftwareConfig.h"
 #include "logging.h"
 #include "configuration.h"
+#include "ParamMetaDataIndex.h"
 
-#include <QXmlStreamReader>
 #include <QDir>
 #include <QFile>
 #include <QSettings>
@@ -354,8 +354,8 @@ void ApmSoftwareConfig::activeUASSet(UASInterface *uas)
         m_apmPdefFilename = QDir(appDataDir + "/apmplanner2").filePath("apm.pdef.xml"); // Fall back
     }
 
-    QFile xmlfile(m_apmPdefFilename);
-    if (!xmlfile.exists() || !xmlfile.open(QIODevice::ReadOnly))
+    ParamMetaDataIndex metaData;
+    if (!QFile::exists(m_apmPdefFilename) || !metaData.load(m_apmPdefFilename,compare))
     {
         QLOG_DEBUG() << "Xml file (" << m_apmPdefFilename << ") does not exist! - No parameter description available.";
         return;
@@ -363,273 +363,41 @@ void ApmSoftwareConfig::activeUASSet(UASInterface *uas)
 
     QLOG_DEBUG() << "Using (" << m_apmPdefFilename << ") for parameters";
 
-    QXmlStreamReader xml(xmlfile.readAll());
-    xmlfile.close();
-
-    //TODO: Testing to ensure that incorrectly formated XML won't break this.
-    //Also, move this into the Param Manager, as it should handle all metadata.
-    while (!xml.atEnd())
-    {
-        if (xml.isStartElement() && xml.name() == "paramfile")
-        {
-            xml.readNext();
-            while ((xml.name() != "paramfile") && !xml.atEnd())
-            {
-                QString valuetype = "";
-                if (xml.isStartElement() && (xml.name() == "vehicles" || xml.name() == "libraries")) //Enter into the vehicles loop
-                {
-                    valuetype = xml.name().toString();
-                    xml.readNext();
-                    while ((xml.name() != valuetype) && !xml.atEnd())
-                    {
-                        if (xml.isStartElement() && xml.name() == "parameters") //This is a parameter block
-                        {
-                            QString parametersname = "";
-                            if (xml.attributes().hasAttribute("name"))
-                            {
-                                    parametersname = xml.attributes().value("name").toString();
-                            }
-
-                            xml.readNext();
-                            while ((xml.name() != "parameters") && !xml.atEnd())
-                            {
-                                if (xml.isStartElement() && xml.name() == "param")
-                                {
-                                    QString humanname = xml.attributes().value("humanName").toString();
-                                    QString name = xml.attributes().value("name").toString();
-                                    QString tab= xml.attributes().value("user").toString();
-                                    QString range = "";
-                                    if (name.contains(":"))
-                                    {
-                                        name = name.split(":")[1].toUpper();
-                                    }
-                                    QString docs = xml.attributes().value("documentation").toString();
-
-                                    int type = -1; //Type of item
-                                    QMap<QString,QString> fieldmap;
-                                    QList<QPair<QString,QString> > valuemap;
-                                    xml.readNext();
-                                    while ((xml.name() != "param") && !xml.atEnd())
-                                    {
-                                        if (xml.isStartElement() && xml.name() == "values")
-                                        {
-                                            type = 1; //1 is a combobox
-                                            int paramcount = 0;
-                                            xml.readNext();
-                                            while ((xml.name() != "values") && !xml.atEnd())
-                                            {
-                                                if (xml.isStartElement() && xml.name() == "value")
-                                                {
-
-                                                    QString code = xml.attributes().value("code").toString();
-                                                    QString arg = xml.readElementText();
-                                                    valuemap.append(QPair<QString,QString>(code,arg));
-                                                    paramcount++;
-                                                }
-                                                xml.readNext();
-                                            }
-                                        }
-                                        if (xml.isStartElement() && xml.name() == "field")
-                                        {
-                                            type = 2; //2 is a slider
-                                            QString fieldtype = xml.attributes().value("name").toString();
-                                            QString text = xml.readElementText();
-                                            fieldmap[fieldtype] = text;
-                                        }
-                                        xml.readNext();
-                                    }
-                                    if (type == -1)
-                                    {
-                                        //Nothing inside! Assume it's a value, give it a default range.
-                                        type = 2;
-                                        QString fieldtype = "Range";
-                                        QString text = "0 100"; //TODO: Determine a better way of figuring out default ranges.
-                                        fieldmap[fieldtype] = text;
-                                    }
-                                    if (type == 2)
-                                    {
-                                        if (fieldmap.contains("Range"))
-                                        {
-                                            float min = 0;
-                                            float max = 0;
-                                            //Some range fields list "0-10" and some list "0 10". Handle both.
-                                            if (fieldmap["Range"].split(" ").size() > 1)
-                                            {
-                                                min = fieldmap["Range"].split(" ")[0].trimmed().toFloat();
-                                                max = fieldmap["Range"].split(" ")[1].trimmed().toFloat();
-                                            }
-                                            else if (fieldmap["Range"].split("-").size() > 1)
-                                            {
-                                                min = fieldmap["Range"].split("-")[0].trimmed().toFloat();
-                                                max = fieldmap["Range"].split("-")[1].trimmed().toFloat();
-                                            }
-                                            range = QString("%1 to %2").arg(min).arg(max);
-                                        }
-                                    }
-                                    QString units = "";
-                                    if (fieldmap.contains("Units"))
-                                    {
-                                        units = fieldmap["Units"];
-                                    }
-
-                                    //Right here we have a single param in memory
-                                    if (valuemap.size() > 0)
-                                    {
-                                        QList<QPair<int,QString> > valuelist;
-                                        for (int i=0;i<valuemap.size();i++)
-                                        {
-                                            valuelist.append(QPair<int,QString>(valuemap[i].first.toInt(),valuemap[i].second));
-                                        }
-                                        if (compare == parametersname || valuetype == "libraries")
-                                        {
-                                            if (tab == "Standard")
-                                            {
-                                                ParamConfig c;
-                                                c.name = humanname;
-                                                c.docs = docs;
-                                                c.param = name;
-                                                c.valuelist = valuelist;
-                                                c.isAdvanced = false;
-                                                c.isRange = false;
-                                                m_paramConfigList.append(c);
-                                            }
-                                            else if (tab == "Advanced")
-                                            {
-                                                ParamConfig c;
-                                                c.name = humanname;
-                                                c.docs = docs;
-                                                c.param = name;
-                                                c.valuelist = valuelist;
-                                                c.isAdvanced = true;
-                                                c.isRange = false;
-                                                m_paramConfigList.append(c);
-                                            }
-                                            m_advParameterList->setParameterMetaData(name,humanname,docs,units,range);
-                                        }
-                                    }
-                                    else if (fieldmap.size() > 0)
-                                    {
-                                        float min = 0;
-                                        float max = 65535;
-                                        float increment = 655.35; //Starting increment of 1%.
-                                        if (fieldmap.contains("Range"))
-                                        {
-                                            //Some range fields list "0-10" and some list "0 10". Handle both.
-                                            if (fieldmap["Range"].split(" ").size() > 1)
-                                            {
-                                                min = fieldmap["Range"].split(" ")[0].trimmed().toFloat();
-                                                max = fieldmap["Range"].split(" ")[1].trimmed().toFloat();
-                                            }
-                                            else if (fieldmap["Range"].split("-").size() > 1)
-                                            {
-                                                min = fieldmap["Range"].split("-")[0].trimmed().toFloat();
-                                                max = fieldmap["Range"].split("-")[1].trimmed().toFloat();
-                                            }
-                                            increment = (max - min) / 100.0; //1% of total range increment
-                                            range = QString("%1 to %2").arg(min).arg(max);
-                                        }
-                                        if (compare == parametersname || valuetype == "libraries")
-                                        {
-                                            if (tab == "Standard")
-                                            {
-                                                ParamConfig c;
-                                                c.name = humanname;
-                                                c.docs = docs;
-                                                c.param = name;
-                                                c.min = min;
-                                                c.max = max;
-                                                c.increment = increment;
-                                                c.isAdvanced = false;
-                                                c.isRange = true;
-                                                m_paramConfigList.append(c);
-                                            }
-                                            else if (tab == "Advanced")
-                                            {
-                                                ParamConfig c;
-                                                c.name = humanname;
-                                                c.docs = docs;
-                                                c.param = name;
-                                                c.min = min;
-                                                c.max = max;
-                                                c.increment = increment;
-                                                c.isAdvanced = true;
-                                                c.isRange = true;
-                                                m_paramConfigList.append(c);
-                                            }
-                                            m_advParameterList->setParameterMetaData(name,humanname,docs,units,range);
-                                        }
-                                    }
-
-                                }
-                                xml.readNext();
-                            }
-                        }
-                        xml.readNext();
-                    }
-
-                }
-                xml.readNext();
-            }
-        }
-        xml.readNext();
-    }
-
-    m_populateTimer.start(1);
+    m_advParameterList->setParameterMetaData(metaData.entries());
+    // The widgets are created by the views when scrolled into view
+    m_standardParamConfig->setParamList(metaData.entries(ParamMetaDataIndex::StandardTab));
+    m_advancedParamConfig->setParamList(metaData.entries(ParamMetaDataIndex::AdvancedTab));
 
+    m_populateTimer.start(0);
 }
+
 void ApmSoftwareConfig::populateTimerTick()
 {
-    if (m_paramConfigList.size() == 0)
+    m_populateTimer.stop();
+    if (!m_uas)
     {
-        m_populateTimer.stop();
-        m_advancedParamConfig->allParamsAdded();
-        m_standardParamConfig->allParamsAdded();
-        if (m_uas)
-        {
-            //Set all the new parameters to their proper values.
-            //By the time this is hit, the param manager already has a full set of parameters from the vehicle,
-            //no need to re-request them.
-            QList<QString> paramnames = m_uas->getParamManager()->getParameterNames(1);
-            if (paramnames.size() == 0)
-            {
-                //No param names, params are likely not yet done. Wait a second and refresh.
-                QLOG_DEBUG() << "ApmSoftwareConfig::populateTimerTick() - No Param names from param manager. Sleeping for one second...";
-                m_populateTimer.start(1000);
-                return;
-            }
-            for (int i=0;i<paramnames.size();i++)
-            {
-                m_advancedParamConfig->parameterChanged(m_uas->getUASID(),m_uas->getComponentId(),paramnames.at(i),m_uas->getParamManager()->getParameterValue(1,paramnames.at(i)));
-                m_standardParamConfig->parameterChanged(m_uas->getUASID(),m_uas->getComponentId(),paramnames.at(i),m_uas->getParamManager()->getParameterValue(1,paramnames.at(i)));
-            }
-        }
         return;
     }
-    if (m_paramConfigList.at(0).isRange)
+    //Set all the new parameters to their proper values.
+    //By the time this is hit, the param manager already has a full set of parameters from the vehicle,
+    //no need to re-request them.
+    QList<QString> paramnames = m_uas->getParamManager()->getParameterNames(1);
+    if (paramnames.size() == 0)
     {
-        if (m_paramConfigList.at(0).isAdvanced)
-        {
-            m_advancedParamConfig->addRange(m_paramConfigList.at(0).name,m_paramConfigList.at(0).docs,m_paramConfigList.at(0).param,m_paramConfigList.at(0).min,m_paramConfigList.at(0).max,m_paramConfigList.at(0).increment);
-        }
-        else
-        {
-            m_standardParamConfig->addRange(m_paramConfigList.at(0).name,m_paramConfigList.at(0).docs,m_paramConfigList.at(0).param,m_paramConfigList.at(0).min,m_paramConfigList.at(0).max,m_paramConfigList.at(0).increment);
-        }
+        //No param names, params are likely not yet done. Wait a second and refresh.
+        QLOG_DEBUG() << "ApmSoftwareConfig::populateTimerTick() - No Param names from param manager. Sleeping for one second...";
+        m_populateTimer.start(1000);
+        return;
     }
-    else
+    // Names and values are delivered in the same order
+    QList<QVariant> paramvalues = m_uas->getParamManager()->getParameterValues(1);
+    QMap<QString,QVariant> values;
+    for (int i=0;i<paramnames.size() && i<paramvalues.size();i++)
     {
-        if (m_paramConfigList.at(0).isAdvanced)
-        {
-            m_advancedParamConfig->addCombo(m_paramConfigList.at(0).name,m_paramConfigList.at(0).docs,m_paramConfigList.at(0).param,m_paramConfigList.at(0).valuelist);
-        }
-        else
-        {
-            m_standardParamConfig->addCombo(m_paramConfigList.at(0).name,m_paramConfigList.at(0).docs,m_paramConfigList.at(0).param,m_paramConfigList.at(0).valuelist);
-
-        }
+        values.insert(paramnames.at(i),paramvalues.at(i));
     }
-    m_paramConfigList.removeAt(0);
-
+    m_advancedParamConfig->setParameterValues(values);
+    m_standardParamConfig->setParameterValues(values);
 }
 
 void ApmSoftwareConfig::parameterChanged(int uas, int component, int parameterCount, int parameterId, QString parameterName, QVariant value)
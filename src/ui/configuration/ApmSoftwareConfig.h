@@ -79,25 +79,7 @@ private:
 
     static const QString s_xmlSubFolder;
 
-    //Parameter from XML
-    class ParamConfig
-    {
-    public:
-        QString name;
-        QString docs;
-        QString param;
-        double min;
-        double max;
-        double increment;
-        QList<QPair<int,QString> > valuelist;
-        bool isAdvanced;
-        bool isRange;
-    };
-
-    //List of parameters from XML file, to be loaded on a timer
-    QList<ParamConfig> m_paramConfigList;
-
-    //Parameter loading timer
+    //Timer applying the parameter values once the param manager has them
     QTimer m_populateTimer;
 
     QString m_apmPdefFilename;
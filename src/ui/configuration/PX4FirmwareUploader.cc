@@ -7,9 +7,12 @@
 #include <QJsonObject>
 #include <QProcess>
 #include <QApplication>
+#include <QtEndian>
 #include "logging.h"
 
+#define PROTO_INSYNC 0x12
 #define PROTO_OK 0x10
+#define PROTO_PROG_MULTI 0x27
 #define PROTO_GET_DEVICE 0x22
 #define PROTO_EOC 0x20
 #define PROTO_DEVICE_BL_REV 0x01
@@ -54,12 +57,54 @@ static const quint32 crctab[] =
     0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94, 0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
 };
 
-static quint32 crc32(const QByteArray src)
+namespace
 {
-    quint32 state = 0;
-    for (int i = 0; i < src.size(); i++) //Limited to half of 32bits, since QByteArray::size() is an integer. Shouldn't ever be larger anyway
+// crctab extended for slice-by-8: entry [k][i] is the CRC of byte i followed by k zero bytes
+class Crc32SliceTables
+{
+public:
+    Crc32SliceTables()
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            table[0][i] = crctab[i];
+        }
+        for (int i = 0; i < 256; i++)
+        {
+            for (int k = 1; k < 8; k++)
+            {
+                table[k][i] = (table[k - 1][i] >> 8) ^ crctab[table[k - 1][i] & 0xff];
+            }
+        }
+    }
+    quint32 table[8][256];
+};
+
+const Crc32SliceTables &crc32SliceTables()
+{
+    static const Crc32SliceTables tables;
+    return tables;
+}
+}
+
+quint32 PX4FirmwareUploader::crc32(quint32 state, const char *data, qint64 length)
+{
+    const quint32 (*table)[256] = crc32SliceTables().table;
+    const uchar *bytes = reinterpret_cast<const uchar*>(data);
+    while (length >= 8)
+    {
+        const quint32 low = qFromLittleEndian<quint32>(bytes) ^ state;
+        const quint32 high = qFromLittleEndian<quint32>(bytes + 4);
+        state = table[7][low & 0xff] ^ table[6][(low >> 8) & 0xff] ^
+                table[5][(low >> 16) & 0xff] ^ table[4][low >> 24] ^
+                table[3][high & 0xff] ^ table[2][(high >> 8) & 0xff] ^
+                table[1][(high >> 16) & 0xff] ^ table[0][high >> 24];
+        bytes += 8;
+        length -= 8;
+    }
+    while (length-- > 0)
     {
-        state = crctab[(state ^ static_cast<unsigned char>(src[i])) & 0xff] ^ (state >> 8);
+        state = crctab[(state ^ *bytes++) & 0xff] ^ (state >> 8);
     }
     return state;
 }
@@ -67,20 +112,36 @@ static quint32 crc32(const QByteArray src)
 PX4FirmwareUploader::PX4FirmwareUploader(QObject *parent) :
     QThread(parent),
     m_waitingForSync(false),
-    m_currentSNAddress(0)
+    m_currentSNAddress(0),
+    m_fwFramesSent(0),
+    m_framesInFlight(0),
+    m_progMulti(s_progMultiLegacy),
+    m_sendWindow(1),
+    m_fwBytesSent(0),
+    m_localChecksum(0),
+    m_flashSize(0),
+    tempFile(nullptr)
 {
 }
 
+void PX4FirmwareUploader::setPortName(const QString &portName)
+{
+    m_portToUse = portName;
+}
+
 void PX4FirmwareUploader::loadFile(QString filename)
 {
-    foreach (QSerialPortInfo info,QSerialPortInfo::availablePorts())
+    connect(this,SIGNAL(kickOff()),this,SLOT(kickOffTriggered()));
+    if (m_portToUse.isEmpty())
     {
-        m_portlist.append(info.portName());
+        foreach (QSerialPortInfo info,QSerialPortInfo::availablePorts())
+        {
+            m_portlist.append(info.portName());
+        }
+        mp_checkTimer.reset(new QTimer());
+        connect(mp_checkTimer.data(),SIGNAL(timeout()),this,SLOT(checkForPort()));
+        mp_checkTimer->start(250);
     }
-    connect(this,SIGNAL(kickOff()),this,SLOT(kickOffTriggered()));
-    mp_checkTimer.reset(new QTimer());
-    connect(mp_checkTimer.data(),SIGNAL(timeout()),this,SLOT(checkForPort()));
-    mp_checkTimer->start(250);
 
     m_waitingForSync = false;
 
@@ -153,12 +214,21 @@ void PX4FirmwareUploader::loadFile(QString filename)
     {
         uncompressed.append((char)0xFF);
     }
-    m_localChecksum = crc32(uncompressed);
     tempFile = new QTemporaryFile(this);
     tempFile->open();
     tempFile->write(uncompressed);
     tempFile->close();
 
+    if (!m_portToUse.isEmpty())
+    {
+        QLOG_DEBUG() << "Using port" << m_portToUse;
+        m_devInfoList.append(PROTO_DEVICE_BL_REV);
+        m_devInfoList.append(PROTO_DEVICE_BOARD_ID);
+        m_devInfoList.append(PROTO_DEVICE_BOARD_REV);
+        m_devInfoList.append(PROTO_DEVICE_FW_SIZE);
+        emit kickOff();
+        return;
+    }
     QLOG_DEBUG() << "Requesting device replug";
     emit requestDevicePlug();
 }
@@ -192,6 +262,13 @@ void PX4FirmwareUploader::reqChecksum()
     }
     m_currentState = REQ_CHECKSUM;
     mp_port->write(QByteArray().append(0x29).append(0x20));
+
+    // The bootloader checksums the whole flash, the unwritten rest is erased to 0xFF
+    const QByteArray erased(1024, (char)0xFF);
+    for (qint64 remaining = m_flashSize - m_fwBytesSent; remaining > 0; remaining -= erased.size())
+    {
+        m_localChecksum = crc32(m_localChecksum, erased.constData(), qMin<qint64>(remaining, erased.size()));
+    }
 }
 
 bool PX4FirmwareUploader::readChecksum()
@@ -211,11 +288,6 @@ bool PX4FirmwareUploader::readChecksum()
         m_checksum += static_cast<unsigned char>(infobuf[1]) << 8;
         m_checksum += static_cast<unsigned char>(infobuf[2]) << 16;
         m_checksum += static_cast<unsigned char>(infobuf[3]) << 24;
-        for (int i=m_toflashbytes.size();i<m_flashSize;i++)
-        {
-            m_toflashbytes.append((char)0xFF);
-        }
-        m_localChecksum = crc32(m_toflashbytes);
         return true;
     }
     return false;
@@ -356,8 +428,15 @@ void PX4FirmwareUploader::reqFlash()
     tempFile->open();
     m_currentState = SEND_FW;
     m_waitingForSync = true;
-    m_fwBytesCounter = 0;
-    sendNextFwBytes();
+    m_fwFramesSent = 0;
+    m_framesInFlight = 0;
+    m_fwBytesSent = 0;
+    m_localChecksum = 0;
+
+    // Fill the window, every INSYNC/OK received sends the next frame
+    while (m_framesInFlight < m_sendWindow && sendNextFwBytes())
+    {
+    }
 }
 
 bool PX4FirmwareUploader::sendNextFwBytes()
@@ -374,24 +453,44 @@ bool PX4FirmwareUploader::sendNextFwBytes()
     }
     if (tempFile->atEnd())
     {
-        tempFile->close();
-        delete tempFile;
-        tempFile = nullptr;
         return false;
     }
-    if (m_fwBytesCounter++ % 50 == 0)
+    if (m_fwFramesSent++ % 16 == 0)
     {
         emit flashProgress(tempFile->pos(),tempFile->size());
         QLOG_INFO() << "flashing:" << tempFile->pos() << "/" << tempFile->size();
     }
-    QByteArray bytes = tempFile->read(60);
-    m_toflashbytes.append(bytes);
-    QByteArray tosend;
-    tosend.append(0x27);
-    tosend.append(bytes.size());
-    tosend.append(bytes);
-    tosend.append(0x20);
-    mp_port->write(tosend);
+    char frame[s_progMultiMax + 3];
+    const qint64 size = tempFile->read(frame + 2, m_progMulti);
+    if (size <= 0)
+    {
+        return false;
+    }
+    frame[0] = PROTO_PROG_MULTI;
+    frame[1] = static_cast<char>(size);
+    frame[size + 2] = PROTO_EOC;
+    mp_port->write(frame, size + 3);
+
+    // CRC is kept up to date while sending, the image is never held in memory
+    m_localChecksum = crc32(m_localChecksum, frame + 2, size);
+    m_fwBytesSent += size;
+    m_framesInFlight++;
+    return true;
+}
+
+bool PX4FirmwareUploader::readFwSyncs()
+{
+    while (m_framesInFlight > 0 && mp_port->bytesAvailable() >= 2)
+    {
+        char reply[2];
+        mp_port->read(reply, 2);
+        if (reply[0] != (char)PROTO_INSYNC || reply[1] != (char)PROTO_OK)
+        {
+            QLOG_INFO() << "Bad sync return:" << QString::number(reply[0],16) << QString::number(reply[1],16);
+            return false;
+        }
+        m_framesInFlight--;
+    }
     return true;
 }
 
@@ -486,6 +585,25 @@ bool PX4FirmwareUploader::readDeviceInfo()
         emit gotDeviceInfo(m_waitingDeviceInfoVar,reply);
         switch (m_waitingDeviceInfoVar)
         {
+            case PROTO_DEVICE_BL_REV:
+            {
+                QLOG_DEBUG() << "Bootloader Rev:" << reply;
+                emit statusUpdate("Bootloader Rev: " + QString::number(reply));
+                emit bootloaderRev(reply);
+                // Large frames in a window are only known to work with newer bootloaders,
+                // others get the small frames acknowledged one by one like before
+                if (reply >= static_cast<unsigned int>(s_windowedBootloaderRev))
+                {
+                    m_progMulti = s_progMultiMax;
+                    m_sendWindow = s_sendWindow;
+                }
+                else
+                {
+                    m_progMulti = s_progMultiLegacy;
+                    m_sendWindow = 1;
+                }
+            }
+                break;
             case PROTO_DEVICE_BOARD_ID:
             {
                 QLOG_DEBUG() << "Board ID:" << reply;
@@ -579,22 +697,31 @@ void PX4FirmwareUploader::portReadyRead()
     }
     else if (m_currentState == SEND_FW)
     {
-        if (m_waitingForSync)
+        if (!readFwSyncs())
         {
-            if (getSync())
-            {
-                m_waitingForSync = false;
-                if (!sendNextFwBytes())
-                {
-                    //At end
-                    QLOG_INFO() << "finished writing firmware";
-                    emit statusUpdate("Flashing complete, verifying firmware");
-                    m_waitingForSync = false;
-                    reqChecksum();
-                    return;
-                }
-                m_waitingForSync = true;
-            }
+            emit error("Bootloader rejected firmware data, please try again");
+            emit statusUpdate("Flashing failed, bootloader rejected firmware data");
+            tempFile->close();
+            mp_port->close();
+            mp_port.reset();    // calls deleteLater
+            emit complete();
+            return;
+        }
+        while (m_framesInFlight < m_sendWindow && sendNextFwBytes())
+        {
+        }
+        if (m_framesInFlight == 0)
+        {
+            //At end
+            QLOG_INFO() << "finished writing firmware";
+            emit flashProgress(m_fwBytesSent,m_fwBytesSent);
+            emit statusUpdate("Flashing complete, verifying firmware");
+            tempFile->close();
+            delete tempFile;
+            tempFile = nullptr;
+            m_waitingForSync = false;
+            reqChecksum();
+            return;
         }
     }
     else if (m_currentState == REQ_CHECKSUM)
@@ -21,6 +21,23 @@ public:
     void stop();
     void loadFile(QString filename);
 
+    /**
+     * @brief setPortName - uses a known port instead of waiting for a board to be plugged in.
+     *        Must be called before loadFile().
+     */
+    void setPortName(const QString &portName);
+
+    /**
+     * @brief crc32 - continues the bootloader CRC32 (no inversion) over length bytes.
+     *        Uses slice-by-8 tables, 8 bytes per step instead of one.
+     */
+    static quint32 crc32(quint32 state, const char *data, qint64 length);
+
+    static const int s_progMultiMax = 252;      /// Max PROG_MULTI payload of the bootloader, multiple of 4
+    static const int s_sendWindow = 4;          /// PROG_MULTI frames sent without waiting for INSYNC/OK
+    static const int s_progMultiLegacy = 60;    /// PROG_MULTI payload for other bootloaders, sent one at a time
+    static const int s_windowedBootloaderRev = 5; /// First bootloader revision getting s_progMultiMax in s_sendWindow
+
 private:
     QList<QString> m_portlist;
     QString m_portToUse;
@@ -39,7 +56,11 @@ private:
     bool readSN();
     int m_currentSNAddress;
     QByteArray m_snBytes;
-    int m_fwBytesCounter;
+    int m_fwFramesSent;
+    int m_framesInFlight;
+    int m_progMulti;        /// PROG_MULTI payload for the bootloader revision
+    int m_sendWindow;       /// PROG_MULTI frames in flight for the bootloader revision
+    qint64 m_fwBytesSent;
 
     bool reqNextDeviceInfo();
     void getDeviceInfo(unsigned char infobyte);
@@ -47,6 +68,7 @@ private:
     int m_waitingDeviceInfoVar;
 
     bool sendNextFwBytes();
+    bool readFwSyncs();
 
     void reqReboot();
 
@@ -55,7 +77,6 @@ private:
     quint32 m_checksum;
     quint32 m_localChecksum;
     int m_flashSize;
-    QByteArray m_toflashbytes;
 
 
 
@@ -0,0 +1,301 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2013 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+#include "ParamMetaDataIndex.h"
+#include "logging.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFile>
+#include <QMap>
+#include <QSaveFile>
+#include <QXmlStreamReader>
+
+const quint32 ParamMetaDataIndex::s_magic = 0x41504d49; // "APMI"
+const quint32 ParamMetaDataIndex::s_version = 1;
+
+static QDataStream &operator<<(QDataStream &stream, const ParamMetaDataIndex::Entry &entry)
+{
+    stream << entry.param << entry.humanName << entry.docs << entry.units << entry.range
+           << entry.min << entry.max << entry.increment << entry.valueList
+           << entry.isRange << static_cast<quint8>(entry.tab);
+    return stream;
+}
+
+static QDataStream &operator>>(QDataStream &stream, ParamMetaDataIndex::Entry &entry)
+{
+    quint8 tab = 0;
+    stream >> entry.param >> entry.humanName >> entry.docs >> entry.units >> entry.range
+           >> entry.min >> entry.max >> entry.increment >> entry.valueList
+           >> entry.isRange >> tab;
+    entry.tab = static_cast<ParamMetaDataIndex::Tab>(tab);
+    return stream;
+}
+
+static void parseRange(const QString &rangeText, float &min, float &max)
+{
+    //Some range fields list "0-10" and some list "0 10". Handle both.
+    if (rangeText.split(" ").size() > 1)
+    {
+        min = rangeText.split(" ")[0].trimmed().toFloat();
+        max = rangeText.split(" ")[1].trimmed().toFloat();
+    }
+    else if (rangeText.split("-").size() > 1)
+    {
+        min = rangeText.split("-")[0].trimmed().toFloat();
+        max = rangeText.split("-")[1].trimmed().toFloat();
+    }
+}
+
+bool ParamMetaDataIndex::load(const QString &xmlFilename, const QString &vehicle)
+{
+    m_entries.clear();
+
+    QFile xmlfile(xmlFilename);
+    if (!xmlfile.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+    const QByteArray xml = xmlfile.readAll();
+    xmlfile.close();
+
+    // Hashing the file is a small fraction of the time parsing it takes
+    const QByteArray xmlHash = QCryptographicHash::hash(xml, QCryptographicHash::Sha1);
+    const QString indexFilename = cacheFilename(xmlFilename, vehicle);
+    if (readCache(indexFilename, xmlHash))
+    {
+        QLOG_DEBUG() << "ParamMetaDataIndex: using index" << indexFilename << "with" << m_entries.size() << "params";
+        return true;
+    }
+
+    QLOG_DEBUG() << "ParamMetaDataIndex: parsing" << xmlFilename << "for" << vehicle;
+    parseXml(xml, vehicle);
+    writeCache(indexFilename, xmlHash);
+    return true;
+}
+
+QVector<ParamMetaDataIndex::Entry> ParamMetaDataIndex::entries(Tab tab) const
+{
+    QVector<Entry> result;
+    foreach (const Entry &entry, m_entries)
+    {
+        if (entry.tab == tab)
+        {
+            result.append(entry);
+        }
+    }
+    return result;
+}
+
+QString ParamMetaDataIndex::cacheFilename(const QString &xmlFilename, const QString &vehicle)
+{
+    return QString("%1.%2.idx").arg(xmlFilename, vehicle.toLower());
+}
+
+bool ParamMetaDataIndex::readCache(const QString &filename, const QByteArray &xmlHash)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    QByteArray hash;
+    stream >> magic >> version;
+    if (magic != s_magic || version != s_version)
+    {
+        return false;
+    }
+    stream >> hash;
+    if (hash != xmlHash)
+    {
+        return false;
+    }
+    stream >> m_entries;
+    if (stream.status() != QDataStream::Ok)
+    {
+        QLOG_WARN() << "ParamMetaDataIndex: index" << filename << "is corrupt, parsing xml again";
+        m_entries.clear();
+        return false;
+    }
+    return true;
+}
+
+void ParamMetaDataIndex::writeCache(const QString &filename, const QByteArray &xmlHash) const
+{
+    QSaveFile file(filename);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        QLOG_WARN() << "ParamMetaDataIndex: can not write index" << filename;
+        return;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << s_magic << s_version << xmlHash << m_entries;
+    if (!file.commit())
+    {
+        QLOG_WARN() << "ParamMetaDataIndex: can not write index" << filename;
+    }
+}
+
+void ParamMetaDataIndex::parseXml(const QByteArray &xmlData, const QString &vehicle)
+{
+    QXmlStreamReader xml(xmlData);
+
+    //TODO: Testing to ensure that incorrectly formated XML won't break this.
+    //Also, move this into the Param Manager, as it should handle all metadata.
+    while (!xml.atEnd())
+    {
+        if (xml.isStartElement() && xml.name() == "paramfile")
+        {
+            xml.readNext();
+            while ((xml.name() != "paramfile") && !xml.atEnd())
+            {
+                QString valuetype = "";
+                if (xml.isStartElement() && (xml.name() == "vehicles" || xml.name() == "libraries")) //Enter into the vehicles loop
+                {
+                    valuetype = xml.name().toString();
+                    xml.readNext();
+                    while ((xml.name() != valuetype) && !xml.atEnd())
+                    {
+                        if (xml.isStartElement() && xml.name() == "parameters") //This is a parameter block
+                        {
+                            QString parametersname = "";
+                            if (xml.attributes().hasAttribute("name"))
+                            {
+                                    parametersname = xml.attributes().value("name").toString();
+                            }
+
+                            xml.readNext();
+                            while ((xml.name() != "parameters") && !xml.atEnd())
+                            {
+                                if (xml.isStartElement() && xml.name() == "param")
+                                {
+                                    Entry entry;
+                                    entry.humanName = xml.attributes().value("humanName").toString();
+                                    entry.param = xml.attributes().value("name").toString();
+                                    QString tab = xml.attributes().value("user").toString();
+                                    if (entry.param.contains(":"))
+                                    {
+                                        entry.param = entry.param.split(":")[1].toUpper();
+                                    }
+                                    entry.docs = xml.attributes().value("documentation").toString();
+                                    if (tab == "Standard")
+                                    {
+                                        entry.tab = StandardTab;
+                                    }
+                                    else if (tab == "Advanced")
+                                    {
+                                        entry.tab = AdvancedTab;
+                                    }
+
+                                    int type = -1; //Type of item
+                                    QMap<QString,QString> fieldmap;
+                                    xml.readNext();
+                                    while ((xml.name() != "param") && !xml.atEnd())
+                                    {
+                                        if (xml.isStartElement() && xml.name() == "values")
+                                        {
+                                            type = 1; //1 is a combobox
+                                            xml.readNext();
+                                            while ((xml.name() != "values") && !xml.atEnd())
+                                            {
+                                                if (xml.isStartElement() && xml.name() == "value")
+                                                {
+                                                    int code = xml.attributes().value("code").toString().toInt();
+                                                    QString arg = xml.readElementText();
+                                                    entry.valueList.append(QPair<int,QString>(code,arg));
+                                                }
+                                                xml.readNext();
+                                            }
+                                        }
+                                        if (xml.isStartElement() && xml.name() == "field")
+                                        {
+                                            type = 2; //2 is a slider
+                                            QString fieldtype = xml.attributes().value("name").toString();
+                                            QString text = xml.readElementText();
+                                            fieldmap[fieldtype] = text;
+                                        }
+                                        xml.readNext();
+                                    }
+                                    if (type == -1)
+                                    {
+                                        //Nothing inside! Assume it's a value, give it a default range.
+                                        type = 2;
+                                        fieldmap["Range"] = "0 100"; //TODO: Determine a better way of figuring out default ranges.
+                                    }
+                                    if (type == 2 && fieldmap.contains("Range"))
+                                    {
+                                        float min = 0;
+                                        float max = 0;
+                                        parseRange(fieldmap["Range"], min, max);
+                                        entry.range = QString("%1 to %2").arg(min).arg(max);
+                                    }
+                                    if (fieldmap.contains("Units"))
+                                    {
+                                        entry.units = fieldmap["Units"];
+                                    }
+
+                                    //Right here we have a single param in memory
+                                    if (vehicle == parametersname || valuetype == "libraries")
+                                    {
+                                        if (entry.valueList.size() > 0)
+                                        {
+                                            entry.isRange = false;
+                                            m_entries.append(entry);
+                                        }
+                                        else if (fieldmap.size() > 0)
+                                        {
+                                            float min = 0;
+                                            float max = 65535;
+                                            float increment = 655.35; //Starting increment of 1%.
+                                            if (fieldmap.contains("Range"))
+                                            {
+                                                parseRange(fieldmap["Range"], min, max);
+                                                increment = (max - min) / 100.0; //1% of total range increment
+                                            }
+                                            entry.min = min;
+                                            entry.max = max;
+                                            entry.increment = increment;
+                                            entry.isRange = true;
+                                            m_entries.append(entry);
+                                        }
+                                    }
+                                }
+                                xml.readNext();
+                            }
+                        }
+                        xml.readNext();
+                    }
+
+                }
+                xml.readNext();
+            }
+        }
+        xml.readNext();
+    }
+    m_entries.squeeze();
+}
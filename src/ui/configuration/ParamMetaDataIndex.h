@@ -0,0 +1,89 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2013 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Parameter metadata from the *.pdef.xml files, compiled into a binary index
+ *
+ *   The xml is only parsed when it changed. The parsed metadata of a vehicle is
+ *   stored next to the xml file, keyed by the hash of the xml content, and read
+ *   back from there on the next vehicle activation.
+ */
+
+#ifndef PARAMMETADATAINDEX_H
+#define PARAMMETADATAINDEX_H
+
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+class ParamMetaDataIndex
+{
+public:
+    enum Tab
+    {
+        NoTab = 0,
+        StandardTab,
+        AdvancedTab
+    };
+
+    class Entry
+    {
+    public:
+        QString param;      // Parameter name as sent by the vehicle
+        QString humanName;
+        QString docs;
+        QString units;
+        QString range;      // Range as text for the parameter list, e.g. "0 to 100"
+        double min = 0.0;
+        double max = 0.0;
+        double increment = 0.0;
+        QList<QPair<int,QString> > valueList;
+        bool isRange = false;   // true: slider/spin box, false: combo box with valueList
+        Tab tab = NoTab;
+    };
+
+    /**
+     * Loads the metadata of a vehicle, from the cached index if it matches the xml file.
+     * @param xmlFilename the *.pdef.xml file
+     * @param vehicle parameter block name of the vehicle, e.g. "ArduCopter"
+     * @return false if the xml file could not be read
+     */
+    bool load(const QString &xmlFilename, const QString &vehicle);
+
+    const QVector<Entry> &entries() const { return m_entries; }
+    QVector<Entry> entries(Tab tab) const;
+
+private:
+    static const quint32 s_magic;
+    static const quint32 s_version;
+
+    static QString cacheFilename(const QString &xmlFilename, const QString &vehicle);
+    bool readCache(const QString &filename, const QByteArray &xmlHash);
+    void writeCache(const QString &filename, const QByteArray &xmlHash) const;
+    void parseXml(const QByteArray &xml, const QString &vehicle);
+
+    QVector<Entry> m_entries;
+};
+
+#endif // PARAMMETADATAINDEX_H
@@ -0,0 +1,231 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2013 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+#include "ParamWidgetList.h"
+#include "ParamWidget.h"
+#include "QGCMouseWheelEventFilter.h"
+
+#include <QEvent>
+#include <QScrollArea>
+#include <QScrollBar>
+#include <QSpacerItem>
+#include <QVBoxLayout>
+
+ParamWidgetList::ParamWidgetList(QScrollArea *scrollArea, QVBoxLayout *layout, QObject *parent) : QObject(parent),
+    m_scrollArea(scrollArea),
+    m_layout(layout),
+    m_rowHeight(s_defaultRowHeight)
+{
+    // Coalesces scrolling, resizing and filtering into one pass after the layout settled
+    m_realizeTimer.setSingleShot(true);
+    m_realizeTimer.setInterval(0);
+    connect(&m_realizeTimer,SIGNAL(timeout()),this,SLOT(realizeVisible()));
+
+    connect(m_scrollArea->verticalScrollBar(),SIGNAL(valueChanged(int)),&m_realizeTimer,SLOT(start()));
+    connect(m_scrollArea->verticalScrollBar(),SIGNAL(rangeChanged(int,int)),&m_realizeTimer,SLOT(start()));
+    m_scrollArea->viewport()->installEventFilter(this);
+}
+
+void ParamWidgetList::setEntries(const QVector<ParamMetaDataIndex::Entry> &entries)
+{
+    clear();
+    m_entries = entries;
+    m_widgets.fill(0,m_entries.size());
+    m_rowVisible.fill(true,m_entries.size());
+
+    for (int i=0;i<m_entries.size();i++)
+    {
+        const ParamMetaDataIndex::Entry &entry = m_entries.at(i);
+        m_paramToRow[entry.param] = i;
+
+        // Same text ParamWidget::matchesSearchFilter() uses, so filtering needs no widgets
+        QString searchable = QString("%1 %2(%1) %3").arg(entry.param,entry.humanName,entry.docs);
+        for (int j=0;j<entry.valueList.size();j++)
+        {
+            searchable.append(QString(" %1").arg(entry.valueList.at(j).second));
+        }
+        m_searchableText.append(searchable.toLower());
+
+        m_layout->addItem(new QSpacerItem(0,m_rowHeight,QSizePolicy::Minimum,QSizePolicy::Fixed));
+    }
+    m_layout->addStretch();
+
+    if (m_entries.size() > 0)
+    {
+        // The first widget is always visible, it also tells the real height of a row
+        realize(0);
+        m_rowHeight = m_widgets.at(0)->sizeHint().height() + m_layout->spacing();
+        for (int i=1;i<m_entries.size();i++)
+        {
+            m_layout->itemAt(i)->spacerItem()->changeSize(0,m_rowHeight,QSizePolicy::Minimum,QSizePolicy::Fixed);
+        }
+        m_layout->invalidate();
+    }
+    m_realizeTimer.start();
+}
+
+void ParamWidgetList::setValues(const QMap<QString,QVariant> &values)
+{
+    for (QMap<QString,QVariant>::const_iterator i=values.constBegin();i!=values.constEnd();++i)
+    {
+        setValue(i.key(),i.value());
+    }
+}
+
+void ParamWidgetList::setValue(const QString &param, const QVariant &value)
+{
+    // Kept for all parameters, the list may be (re)built after the values arrived
+    m_values[param] = value;
+    QHash<QString,int>::const_iterator row = m_paramToRow.constFind(param);
+    if (row != m_paramToRow.constEnd() && m_widgets.at(row.value()))
+    {
+        applyValue(m_widgets.at(row.value()),value);
+    }
+}
+
+void ParamWidgetList::setSearchFilter(const QString &searchFilterText)
+{
+#if QT_VERSION < QT_VERSION_CHECK(5, 14, 0)
+    QStringList filterList = searchFilterText.toLower().split(' ', QString::SkipEmptyParts);
+#else
+    QStringList filterList = searchFilterText.toLower().split(' ', Qt::SkipEmptyParts);
+#endif
+    for (int i=0;i<m_entries.size();i++)
+    {
+        bool shouldShow = true;
+        foreach (const QString &filterTerm, filterList)
+        {
+            shouldShow = shouldShow && m_searchableText.at(i).contains(filterTerm);
+        }
+        m_rowVisible[i] = shouldShow;
+        if (m_widgets.at(i))
+        {
+            m_widgets.at(i)->setVisible(shouldShow);
+        }
+        else
+        {
+            m_layout->itemAt(i)->spacerItem()->changeSize(0,shouldShow ? m_rowHeight : 0,QSizePolicy::Minimum,QSizePolicy::Fixed);
+        }
+    }
+    m_layout->invalidate();
+    m_realizeTimer.start();
+}
+
+bool ParamWidgetList::eventFilter(QObject *obj, QEvent *event)
+{
+    if (event->type() == QEvent::Resize || event->type() == QEvent::Show)
+    {
+        m_realizeTimer.start();
+    }
+    return QObject::eventFilter(obj,event);
+}
+
+void ParamWidgetList::realizeVisible()
+{
+    if (!m_scrollArea->isVisible())
+    {
+        // Hidden tabs are realized when shown
+        return;
+    }
+    m_layout->activate();
+
+    // Realize one page above and below the view too, so scrolling does not show placeholders
+    const int page = m_scrollArea->viewport()->height();
+    const int top = m_scrollArea->verticalScrollBar()->value() - page;
+    const int bottom = m_scrollArea->verticalScrollBar()->value() + 2 * page;
+
+    int realized = 0;
+    for (int i=0;i<m_entries.size() && realized < s_maxRealizePerPass;i++)
+    {
+        if (m_widgets.at(i) || !m_rowVisible.at(i))
+        {
+            continue;
+        }
+        const QRect geometry = m_layout->itemAt(i)->geometry();
+        if (geometry.bottom() >= top && geometry.top() <= bottom)
+        {
+            realize(i);
+            realized++;
+        }
+    }
+    if (realized > 0)
+    {
+        // Real heights may differ from the placeholders, check again with the new layout
+        m_realizeTimer.start();
+    }
+}
+
+void ParamWidgetList::clear()
+{
+    m_realizeTimer.stop();
+    while (QLayoutItem *item = m_layout->takeAt(0))
+    {
+        delete item->widget();
+        delete item;
+    }
+    m_entries.clear();
+    m_searchableText.clear();
+    m_widgets.clear();
+    m_rowVisible.clear();
+    m_paramToRow.clear();
+}
+
+void ParamWidgetList::realize(int row)
+{
+    const ParamMetaDataIndex::Entry &entry = m_entries.at(row);
+    ParamWidget *widget = new ParamWidget(entry.param,m_scrollArea->widget());
+    connect(widget,SIGNAL(doubleValueChanged(QString,double)),this,SIGNAL(doubleValueChanged(QString,double)));
+    connect(widget,SIGNAL(intValueChanged(QString,int)),this,SIGNAL(intValueChanged(QString,int)));
+    if (entry.isRange)
+    {
+        widget->setupDouble(entry.humanName + "(" + entry.param + ")",entry.docs,0,entry.min,entry.max,entry.increment);
+    }
+    else
+    {
+        widget->setupCombo(entry.humanName + "(" + entry.param + ")",entry.docs,entry.valueList);
+    }
+    widget->installEventFilter(QGCMouseWheelEventFilter::getFilter());
+
+    // Replace the placeholder, the row keeps its index in the layout
+    delete m_layout->takeAt(row);
+    m_layout->insertWidget(row,widget);
+    widget->setVisible(m_rowVisible.at(row));
+    m_widgets[row] = widget;
+
+    if (m_values.contains(entry.param))
+    {
+        applyValue(widget,m_values.value(entry.param));
+    }
+}
+
+void ParamWidgetList::applyValue(ParamWidget *widget, const QVariant &value)
+{
+    QMetaType::Type metaType(static_cast<QMetaType::Type>(value.type()));
+    if (metaType == QMetaType::Double || metaType == QMetaType::Float)
+    {
+        widget->setValue(value.toDouble());
+    }
+    else
+    {
+        widget->setValue(value.toInt());
+    }
+}
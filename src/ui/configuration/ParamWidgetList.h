@@ -0,0 +1,90 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2013 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief List of ParamWidgets in a scroll area, created when scrolled into view
+ *
+ *   Every parameter gets a fixed height placeholder in the layout. A placeholder is
+ *   replaced by its ParamWidget once it comes near the visible part of the scroll
+ *   area, so only the widgets the user actually looks at are ever built.
+ */
+
+#ifndef PARAMWIDGETLIST_H
+#define PARAMWIDGETLIST_H
+
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QStringList>
+#include <QTimer>
+#include <QVariant>
+#include <QVector>
+#include "ParamMetaDataIndex.h"
+
+class ParamWidget;
+class QScrollArea;
+class QVBoxLayout;
+
+class ParamWidgetList : public QObject
+{
+    Q_OBJECT
+
+public:
+    ParamWidgetList(QScrollArea *scrollArea, QVBoxLayout *layout, QObject *parent = 0);
+
+    void setEntries(const QVector<ParamMetaDataIndex::Entry> &entries);
+    void setValues(const QMap<QString,QVariant> &values);
+    void setValue(const QString &param, const QVariant &value);
+    void setSearchFilter(const QString &searchFilterText);
+
+signals:
+    void doubleValueChanged(QString param,double value);
+    void intValueChanged(QString param,int value);
+
+protected:
+    bool eventFilter(QObject *obj, QEvent *event);
+
+private slots:
+    void realizeVisible();
+
+private:
+    static const int s_defaultRowHeight = 100;
+    static const int s_maxRealizePerPass = 32;
+
+    void clear();
+    void realize(int row);
+    void applyValue(ParamWidget *widget, const QVariant &value);
+
+    QScrollArea *m_scrollArea;
+    QVBoxLayout *m_layout;
+    QVector<ParamMetaDataIndex::Entry> m_entries;
+    QStringList m_searchableText;           // lower case, one per row
+    QVector<ParamWidget*> m_widgets;        // 0 until the row is realized
+    QVector<bool> m_rowVisible;             // false if hidden by the search filter
+    QHash<QString,int> m_paramToRow;
+    QHash<QString,QVariant> m_values;       // latest value of every parameter
+    int m_rowHeight;
+    QTimer m_realizeTimer;
+};
+
+#endif // PARAMWIDGETLIST_H
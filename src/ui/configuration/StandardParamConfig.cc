@@ -21,64 +21,40 @@ This file is part of the APM_PLANNER project
 ======================================================================*/
 
 #include "StandardParamConfig.h"
-#include "ParamWidget.h"
-#include "QGCMouseWheelEventFilter.h"
+
 StandardParamConfig::StandardParamConfig(QWidget *parent) : AP2ConfigWidget(parent)
 {
     ui.setupUi(this);
+    m_paramList = new ParamWidgetList(ui.scrollArea,ui.verticalLayout,this);
+    connect(m_paramList,SIGNAL(doubleValueChanged(QString,double)),this,SLOT(doubleValueChanged(QString,double)));
+    connect(m_paramList,SIGNAL(intValueChanged(QString,int)),this,SLOT(intValueChanged(QString,int)));
     initConnections();
     connect(ui.searchFilter, SIGNAL(textChanged(QString)), this, SLOT(onSearchFilterChanged(const QString &)));
 }
+
 StandardParamConfig::~StandardParamConfig()
 {
 }
 
-void StandardParamConfig::allParamsAdded(void)
+void StandardParamConfig::setParamList(const QVector<ParamMetaDataIndex::Entry> &entries)
 {
-    ui.verticalLayout->addStretch();
+    m_paramList->setEntries(entries);
+    m_paramList->setSearchFilter(ui.searchFilter->text());
 }
 
-void StandardParamConfig::addRange(QString title, QString description, QString param, double min, double max, double increment)
+void StandardParamConfig::setParameterValues(const QMap<QString,QVariant> &values)
 {
-    ParamWidget *widget = new ParamWidget(param,ui.scrollAreaWidgetContents);
-    connect(widget,SIGNAL(doubleValueChanged(QString,double)),this,SLOT(doubleValueChanged(QString,double)));
-    connect(widget,SIGNAL(intValueChanged(QString,int)),this,SLOT(intValueChanged(QString,int)));
-    paramToWidgetMap[param] = widget;
-    widget->setupDouble(title + "(" + param + ")",description,0,min,max,increment);
-    ui.verticalLayout->addWidget(widget);
-    widget->installEventFilter(QGCMouseWheelEventFilter::getFilter());
-    widget->show();
+    m_paramList->setValues(values);
 }
 
-void StandardParamConfig::addCombo(QString title,QString description,QString param,QList<QPair<int,QString> > valuelist)
-{
-    ParamWidget *widget = new ParamWidget(param,ui.scrollAreaWidgetContents);
-    connect(widget,SIGNAL(doubleValueChanged(QString,double)),this,SLOT(doubleValueChanged(QString,double)));
-    connect(widget,SIGNAL(intValueChanged(QString,int)),this,SLOT(intValueChanged(QString,int)));
-    paramToWidgetMap[param] = widget;
-    widget->setupCombo(title + "(" + param + ")",description,valuelist);
-    ui.verticalLayout->addWidget(widget);
-    widget->installEventFilter(QGCMouseWheelEventFilter::getFilter());
-    widget->show();
-}
 void StandardParamConfig::parameterChanged(int uas, int component, QString parameterName, QVariant value)
 {
     Q_UNUSED(uas)
     Q_UNUSED(component)
 
-    if (paramToWidgetMap.contains(parameterName))
-    {
-        QMetaType::Type metaType(static_cast<QMetaType::Type>(value.type()));
-        if (metaType == QMetaType::Double || metaType == QMetaType::Float)
-        {
-            paramToWidgetMap[parameterName]->setValue(value.toDouble());
-        }
-        else
-        {
-            paramToWidgetMap[parameterName]->setValue(value.toInt());
-        }
-    }
+    m_paramList->setValue(parameterName,value);
 }
+
 void StandardParamConfig::doubleValueChanged(QString param,double value)
 {
     if (!m_uas)
@@ -99,37 +75,5 @@ void StandardParamConfig::intValueChanged(QString param,int value)
 
 void StandardParamConfig::onSearchFilterChanged(const QString &searchFilterText)
 {
-    if (searchFilterText.isEmpty())
-    {
-        for (int i = 0; i < ui.verticalLayout->count(); ++i)
-        {
-            QLayoutItem *item = ui.verticalLayout->itemAt(i);
-            if (item && item->widget())
-            {
-                item->widget()->setVisible(true);
-            }
-        }
-    }
-    else
-    {
-#if QT_VERSION < QT_VERSION_CHECK(5, 14, 0)
-        QStringList filterList = searchFilterText.toLower().split(' ', QString::SkipEmptyParts);
-#else
-        QStringList filterList = searchFilterText.toLower().split(' ', Qt::SkipEmptyParts);
-#endif
-        for (int i = 0; i < ui.verticalLayout->count(); ++i)
-        {
-            ParamWidget *pw = qobject_cast<ParamWidget *>(ui.verticalLayout->itemAt(i)->widget());
-            if (pw)
-            {
-                bool shouldShow = true;
-                foreach (const QString &filterTerm, filterList)
-                {
-                    shouldShow = shouldShow && pw->matchesSearchFilter(filterTerm);
-                }
-                pw->setVisible(shouldShow);
-            }
-        }
-    }
+    m_paramList->setSearchFilter(searchFilterText);
 }
-
@@ -26,7 +26,7 @@ This file is part of the APM_PLANNER project
 #include <QWidget>
 #include "ui_StandardParamConfig.h"
 #include "AP2ConfigWidget.h"
-#include "ParamWidget.h"
+#include "ParamWidgetList.h"
 class StandardParamConfig : public AP2ConfigWidget
 {
     Q_OBJECT
@@ -34,19 +34,17 @@ class StandardParamConfig : public AP2ConfigWidget
 public:
     explicit StandardParamConfig(QWidget *parent = 0);
     ~StandardParamConfig();
+    void setParamList(const QVector<ParamMetaDataIndex::Entry> &entries);
+    void setParameterValues(const QMap<QString,QVariant> &values);
 
 public slots:
-    void addRange(QString title,QString description,QString param,double min,double max,double increment);
-    void addCombo(QString title,QString description,QString param,QList<QPair<int,QString> > valuelist);
-    void allParamsAdded(void);
-
     void parameterChanged(int uas, int component, QString parameterName, QVariant value);
     void doubleValueChanged(QString param,double value);
     void intValueChanged(QString param,int value);
     void onSearchFilterChanged(const QString &searchFilterText);
 
 private:
-    QMap<QString,ParamWidget*> paramToWidgetMap;
+    ParamWidgetList *m_paramList;
     Ui::StandardParamConfig ui;
 };
 
@@ -54,6 +54,7 @@ This file is part of the PIXHAWK project
 #include <QFileDialog>
 #include <QDesktopServices>
 #include <QMessageBox>
+#include <QCheckBox>
 
 LinechartWidget::LinechartWidget(int systemid, QWidget *parent) : QWidget(parent),
     sysid(systemid),
@@ -594,7 +595,6 @@ void LinechartWidget::stopLogging()
         logFile->close();
         // Postprocess log file
         compressor = new LogCompressor(logFile->fileName(), logFile->fileName());
-        connect(compressor, SIGNAL(finishedFile(QString)), this, SIGNAL(logfileWritten(QString)));
         connect(compressor, SIGNAL(logProcessingStatusChanged(QString)), MainWindow::instance(), SLOT(showStatusMessage(QString)));
 
         QMessageBox msgBox;
@@ -603,7 +603,18 @@ void LinechartWidget::stopLogging()
         msgBox.setInformativeText(tr("Should empty fields (e.g. due to packet drops) be filled with the previous value of the same variable (zero order hold)?"));
         msgBox.setStandardButtons(QMessageBox::Yes | QMessageBox::No);
         msgBox.setDefaultButton(QMessageBox::No);
+        QCheckBox *binaryCheckBox = new QCheckBox(tr("Write a columnar binary file (.bin) instead of text"));
+        msgBox.setCheckBox(binaryCheckBox);
         int ret = msgBox.exec();
+        if (binaryCheckBox->isChecked())
+        {
+            compressor->setOutputFormat(LogCompressor::ColumnarBinaryOutput);
+        }
+        else
+        {
+            // Only the text output can be shown in the data view
+            connect(compressor, SIGNAL(finishedFile(QString)), this, SIGNAL(logfileWritten(QString)));
+        }
         bool fill;
         if (ret == QMessageBox::Yes)
         {
@@ -20,7 +20,10 @@ QGCMapWidget::QGCMapWidget(QWidget *parent) :
     followUAVID(0),
     mapInitialized(false),
     homeAltitude(0),
-    uas(NULL)
+    uas(NULL),
+    waypointListDirty(false),
+    waypointLinesDirty(false),
+    waypointUpdateUas(0)
 {
     // Set the map cache directory
     configuration->SetCacheLocation(QGC::appDataDirectory() + "/mapscache/");
@@ -32,6 +35,9 @@ QGCMapWidget::QGCMapWidget(QWidget *parent) :
     connect(this, SIGNAL(waypointCreated(Waypoint*)), currWPManager, SLOT(addWaypointEditable(Waypoint*)));
     connect(this, SIGNAL(waypointChanged(Waypoint*)), currWPManager, SLOT(notifyOfChangeEditable(Waypoint*)));
     connect(map, SIGNAL(mapChanged()), this, SLOT(redrawWaypointLines()));
+    waypointUpdateTimer.setSingleShot(true);
+    waypointUpdateTimer.setInterval(0);
+    connect(&waypointUpdateTimer, SIGNAL(timeout()), this, SLOT(flushWaypointUpdates()));
     offlineMode = true;
     // Widget is inactive until shown
     defaultGuidedRelativeAlt = 100.0; // Default set to 100m
@@ -742,8 +748,8 @@ void QGCMapWidget::handleMapWaypointEdit(mapcontrol::WayPointItem* waypoint)
 // WAYPOINT UPDATE FUNCTIONS
 
 /**
- * This function is called if a a single waypoint is updated and
- * also if the whole list changes.
+ * This function is called if a a single waypoint is updated. The change
+ * is applied together with all others of this event loop iteration.
  */
 void QGCMapWidget::updateWaypoint(int uas, Waypoint* wp)
 {
@@ -752,93 +758,14 @@ void QGCMapWidget::updateWaypoint(int uas, Waypoint* wp)
     if (firingWaypointChange == wp) {
         return;
     }
-    // Currently only accept waypoint updates from the UAS in focus
-    // this has to be changed to accept read-only updates from other systems as well.
-    UASInterface* uasInstance = UASManager::instance()->getUASForId(uas);
-    if (currWPManager)
-    {
-        // Only accept waypoints in global coordinate frame
-        if (((wp->getFrame() == MAV_FRAME_GLOBAL) ||
-             (wp->getFrame() == MAV_FRAME_GLOBAL_RELATIVE_ALT) ||
-             (wp->getFrame() == MAV_FRAME_GLOBAL_TERRAIN_ALT)) && (wp->isNavigationType() || wp->visibleOnMapWidget()))
-        {
-            // We're good, this is a global waypoint
-
-            // Get the index of this waypoint
-            int wpindex = currWPManager->getIndexOf(wp);
-            // If not found, return (this should never happen, but helps safety)
-            if (wpindex < 0) return;
-            // Mark this wp as currently edited
-            firingWaypointChange = wp;
-
-            QLOG_TRACE() << "UPDATING WAYPOINT" << wpindex << "IN 2D MAP";
-
-            // Check if wp exists yet in map
-            if (!waypointsToIcons.contains(wp))
-            {
-                QLOG_TRACE() << "UPDATING NEW WAYPOINT" << wpindex << "IN 2D MAP";
-                // Create icon for new WP
-                QColor wpColor(Qt::red);
-                if (uasInstance) wpColor = uasInstance->getColor();
-                Waypoint2DIcon* icon = new Waypoint2DIcon(map, this, wp, wpColor, wpindex);
-                ConnectWP(icon);
-                icon->setParentItem(map);
-                // Update maps to allow inverse data association
-                waypointsToIcons.insert(wp, icon);
-                iconsToWaypoints.insert(icon, wp);
-            }
-            else
-            {
-                QLOG_TRACE() << "UPDATING EXISTING WAYPOINT" << wpindex << "IN 2D MAP";
-                // Waypoint exists, block it's signals and update it
-                mapcontrol::WayPointItem* icon = waypointsToIcons.value(wp);
-                // Make sure we don't die on a null pointer
-                // this should never happen, just a precaution
-                if (!icon) return;
-                // Block outgoing signals to prevent an infinite signal loop
-                // should not happen, just a precaution
-                this->blockSignals(true);
-                // Update the WP
-                Waypoint2DIcon* wpicon = dynamic_cast<Waypoint2DIcon*>(icon);
-                if (wpicon)
-                {
-                    // Let icon read out values directly from waypoint
-                    icon->SetNumber(wpindex);
-                    wpicon->updateWaypoint();
-                }
-                else
-                {
-                    // Use safe standard interfaces for non Waypoint-class based wps
-                    icon->SetCoord(internals::PointLatLng(wp->getLatitude(), wp->getLongitude()));
-                    icon->SetAltitude(wp->getAltitude());
-                    icon->SetHeading(wp->getYaw());
-                    icon->SetNumber(wpindex);
-                }
-                // Re-enable signals again
-                this->blockSignals(false);
-            }
-
-            redrawWaypointLines(uas);
-
-            firingWaypointChange = NULL;
-        }
-        else
-        {
-            // Check if the index of this waypoint is larger than the global
-            // waypoint list. This implies that the coordinate frame of this
-            // waypoint was changed and the list containing only global
-            // waypoints was shortened. Thus update the whole list
-            if (waypointsToIcons.count() > currWPManager->getGlobalFrameAndNavTypeCount())
-            {
-                updateWaypointList(uas);
-            }
-        }
-    }
+    dirtyWaypoints.insert(wp);
+    scheduleWaypointUpdate(uas);
 }
 
 void QGCMapWidget::redrawWaypointLines()
 {
-    redrawWaypointLines(uas ? uas->getUASID() : 0);
+    waypointLinesDirty = true;
+    scheduleWaypointUpdate(uas ? uas->getUASID() : 0);
 }
 
 void QGCMapWidget::redrawWaypointLines(int uas)
@@ -885,49 +812,191 @@ void QGCMapWidget::redrawWaypointLines(int uas)
 /**
  * Update the whole list of waypoints. This is e.g. necessary if the list order changed.
  * The UAS manager will emit the appropriate signal whenever updating the list
- * is necessary.
+ * is necessary. The list is compared with the icons on the next event loop
+ * iteration, so a burst of list changes costs one update.
  */
 void QGCMapWidget::updateWaypointList(int uas)
 {
     QLOG_DEBUG() << "UPDATE WP LIST IN 2D MAP CALLED FOR UAS" << uas;
+    waypointListDirty = true;
+    scheduleWaypointUpdate(uas);
+}
+
+void QGCMapWidget::scheduleWaypointUpdate(int uas)
+{
+    waypointUpdateUas = uas;
+    if (!waypointUpdateTimer.isActive())
+    {
+        waypointUpdateTimer.start();
+    }
+}
+
+bool QGCMapWidget::isMapWaypoint(Waypoint* wp) const
+{
+    // Only accept waypoints in global coordinate frame
+    return ((wp->getFrame() == MAV_FRAME_GLOBAL) ||
+            (wp->getFrame() == MAV_FRAME_GLOBAL_RELATIVE_ALT) ||
+            (wp->getFrame() == MAV_FRAME_GLOBAL_TERRAIN_ALT)) && (wp->isNavigationType() || wp->visibleOnMapWidget());
+}
+
+void QGCMapWidget::syncWaypointIcon(Waypoint* wp, int index, bool valuesChanged)
+{
+    mapcontrol::WayPointItem* icon = waypointsToIcons.value(wp, NULL);
+    if (!icon)
+    {
+        QLOG_TRACE() << "UPDATING NEW WAYPOINT" << index << "IN 2D MAP";
+        // Create icon for new WP
+        QColor wpColor(Qt::red);
+        UASInterface* uasInstance = UASManager::instance()->getUASForId(waypointUpdateUas);
+        if (uasInstance) wpColor = uasInstance->getColor();
+        Waypoint2DIcon* newIcon = new Waypoint2DIcon(map, this, wp, wpColor, index);
+        // The waypoint manager owns the numbering, so unlike ConnectWP() the
+        // icons are not connected to each other's renumbering signals
+        connect(newIcon, SIGNAL(WPValuesChanged(WayPointItem*)), this, SIGNAL(WPValuesChanged(WayPointItem*)));
+        newIcon->setParentItem(map);
+        // Update maps to allow inverse data association
+        waypointsToIcons.insert(wp, newIcon);
+        iconsToWaypoints.insert(newIcon, wp);
+        // Drop the icon as soon as the waypoint is gone, not on the next update
+        connect(wp, SIGNAL(destroyed(QObject*)), this, SLOT(waypointDestroyed(QObject*)), Qt::UniqueConnection);
+        return;
+    }
+
+    // Block outgoing signals to prevent an infinite signal loop
+    // should not happen, just a precaution
+    this->blockSignals(true);
+    if (icon->Number() != index)
+    {
+        icon->SetNumber(index);
+    }
+    if (valuesChanged)
+    {
+        QLOG_TRACE() << "UPDATING EXISTING WAYPOINT" << index << "IN 2D MAP";
+        Waypoint2DIcon* wpicon = dynamic_cast<Waypoint2DIcon*>(icon);
+        if (wpicon)
+        {
+            // Let icon read out values directly from waypoint
+            wpicon->updateWaypoint();
+        }
+        else
+        {
+            // Use safe standard interfaces for non Waypoint-class based wps
+            icon->SetCoord(internals::PointLatLng(wp->getLatitude(), wp->getLongitude()));
+            icon->SetAltitude(wp->getAltitude());
+            icon->SetHeading(wp->getYaw());
+        }
+    }
+    // Re-enable signals again
+    this->blockSignals(false);
+}
+
+void QGCMapWidget::removeWaypointIcon(Waypoint* wp)
+{
+    mapcontrol::WayPointItem* icon = waypointsToIcons.take(wp);
+    if (icon)
+    {
+        QLOG_TRACE() << "DELETE EXISTING WP ICON" << icon->Number();
+        iconsToWaypoints.remove(icon);
+        WPDelete(icon);
+    }
+}
+
+void QGCMapWidget::waypointDestroyed(QObject* waypoint)
+{
+    // Only the address is used, the waypoint is already destructed
+    Waypoint* wp = static_cast<Waypoint*>(waypoint);
+    dirtyWaypoints.remove(wp);
+    if (waypointsToIcons.contains(wp))
+    {
+        removeWaypointIcon(wp);
+        waypointLinesDirty = true;
+        scheduleWaypointUpdate(waypointUpdateUas);
+    }
+}
+
+void QGCMapWidget::flushWaypointUpdates()
+{
+    const int uas = waypointUpdateUas;
     // Currently only accept waypoint updates from the UAS in focus
     // this has to be changed to accept read-only updates from other systems as well.
-    if (currWPManager)
+    if (!currWPManager)
+    {
+        dirtyWaypoints.clear();
+        waypointListDirty = false;
+        waypointLinesDirty = false;
+        return;
+    }
+
+    bool linesChanged = waypointLinesDirty;
+    if (waypointListDirty)
     {
-        // Delete first all old waypoints
-        // this is suboptimal (quadratic, but wps should stay in the sub-100 range anyway)
-        QList<Waypoint* > wps = currWPManager->getGlobalFrameAndNavTypeWaypointList(false);
-        foreach (Waypoint* wp, waypointsToIcons.keys())
+        // Diff the icons against the list, existing icons are kept and only
+        // renumbered, their values only change with updateWaypoint()
+        // Copies share the data of the store, they stay valid if syncing changes the mission
+        const MissionStore &mission = currWPManager->getMissionStore();
+        const QList<Waypoint*> wps = mission.waypoints(MissionStore::GlobalFrameMapView);
+        const QVector<int> wpindices = mission.indices(MissionStore::GlobalFrameMapView);
+        QSet<Waypoint*> listed;
+        listed.reserve(wps.count());
+        foreach (Waypoint* wp, wps)
+        {
+            listed.insert(wp);
+        }
+
+        QMap<Waypoint*, mapcontrol::WayPointItem*>::iterator it = waypointsToIcons.begin();
+        while (it != waypointsToIcons.end())
         {
-            if (!wps.contains(wp))
+            if (!listed.contains(it.key()))
             {
-                QLOG_TRACE() << "DELETE EXISTING WP" << wp->getId();
-                // Get icon to work on
-                mapcontrol::WayPointItem* icon = waypointsToIcons.value(wp);
-                waypointsToIcons.remove(wp);
+                mapcontrol::WayPointItem* icon = it.value();
+                it = waypointsToIcons.erase(it);
                 iconsToWaypoints.remove(icon);
                 WPDelete(icon);
             }
+            else
+            {
+                ++it;
+            }
         }
 
-        // Update all existing waypoints
-        foreach (Waypoint* wp, waypointsToIcons.keys())
+        for (int i = 0; i < wps.count(); i++)
         {
-            QLOG_TRACE() << "UPDATING EXISTING WP" << wp->getId();
-            updateWaypoint(uas, wp);
+            syncWaypointIcon(wps.at(i), wpindices.at(i), dirtyWaypoints.contains(wps.at(i)));
         }
-
-        // Update all potentially new waypoints
-        foreach (Waypoint* wp, wps)
+        linesChanged = true;
+    }
+    else
+    {
+        const QList<Waypoint*>& editable = currWPManager->getWaypointEditableList();
+        foreach (Waypoint* wp, dirtyWaypoints)
         {
-            // Update / add only if new
-            if (!waypointsToIcons.contains(wp))
+            // Look the waypoint up by address first, it may have been deleted
+            // without ever getting an icon
+            const int wpindex = editable.indexOf(wp);
+            if (wpindex < 0)
+            {
+                continue;
+            }
+            if (isMapWaypoint(wp))
             {
-                QLOG_TRACE() << "UPDATING NEW WP" << wp->getId();
-                updateWaypoint(uas, wp);
+                syncWaypointIcon(wp, wpindex, true);
+                linesChanged = true;
+            }
+            else if (waypointsToIcons.contains(wp))
+            {
+                // The coordinate frame or the command of this waypoint changed
+                removeWaypointIcon(wp);
+                linesChanged = true;
             }
         }
+    }
 
-//        redrawWaypointLines(uas);
+    dirtyWaypoints.clear();
+    waypointListDirty = false;
+    waypointLinesDirty = false;
+
+    if (linesChanged)
+    {
+        redrawWaypointLines(uas);
     }
 }
@@ -2,6 +2,7 @@
 #define QGCMAPWIDGET_H
 
 #include <QMap>
+#include <QSet>
 #include <QTimer>
 #include "../../../libs/opmapcontrol/opmapcontrol.h"
 
@@ -66,12 +67,13 @@ public slots:
     void goHome();
     /** @brief Jump to the last recorded position of an active UAS */
     void lastPosition();
-    /** @brief Update this waypoint for this UAS */
+    /** @brief Update this waypoint for this UAS on the next event loop iteration */
     void updateWaypoint(int uas, Waypoint* wp);
-    /** @brief Update the whole waypoint */
+    /** @brief Update the whole waypoint list on the next event loop iteration */
     void updateWaypointList(int uas);
-    /** @brief Redraw lines between waypoints */
+    /** @brief Redraw lines between waypoints on the next event loop iteration */
     void redrawWaypointLines();
+    /** @brief Redraw lines between waypoints now */
     void redrawWaypointLines(int uas);
     /** @brief Update the home position on the map */
     void updateHomePosition(double latitude, double longitude, double altitude);
@@ -130,6 +132,10 @@ public slots:
 protected slots:
     /** @brief Convert a map edit into a QGC waypoint event */
     void handleMapWaypointEdit(WayPointItem* waypoint);
+    /** @brief Apply all waypoint changes collected since the last call */
+    void flushWaypointUpdates();
+    /** @brief Remove the icon of a deleted waypoint */
+    void waypointDestroyed(QObject* waypoint);
 
 private:
     void sendGuidedAction(Waypoint *wp, double alt);
@@ -138,6 +144,12 @@ private:
     void shiftOtherSelectedWaypoints(mapcontrol::WayPointItem* selectedWaypoint,
                                      double shiftLong, double shiftLat);
 
+    void scheduleWaypointUpdate(int uas);
+    bool isMapWaypoint(Waypoint* wp) const;
+    /** @brief Create the icon of wp or renumber it, valuesChanged also re-reads its values */
+    void syncWaypointIcon(Waypoint* wp, int index, bool valuesChanged);
+    void removeWaypointIcon(Waypoint* wp);
+
 protected:
     /** @brief Update the highlighting of the currently controlled system */
     void updateSelectedSystem(int uas);
@@ -181,6 +193,12 @@ protected:
     double m_lastLat;
     double m_lastLon;
 
+    QTimer waypointUpdateTimer;         ///< Coalesces waypoint updates to one per event loop iteration
+    QSet<Waypoint*> dirtyWaypoints;     ///< Waypoints changed since the last update, may be deleted
+    bool waypointListDirty;             ///< The waypoint list changed since the last update
+    bool waypointLinesDirty;            ///< The map moved since the last update
+    int waypointUpdateUas;              ///< System of the pending update
+
 };
 
 #endif // QGCMAPWIDGET_H